@@ -17,119 +17,90 @@ http://www.cisst.org/cisst/license.txt.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 #include <cisstCommon/cmnPortability.h>
 
-#if (CISST_OS == CISST_WINDOWS)
-typedef unsigned __int32 uint32_t;
-#else
-#include <stdint.h>
-#endif
-
 #include <cisstVector/vctRodriguezRotation3.h>
 #include <cisstMultiTask/mtsInterfaceProvided.h>
 #include <cisstOSAbstraction/osaSleep.h>
 #include <sawUniversalRobot/mtsUniversalRobotScriptRT.h>
+#include <sawUniversalRobot/osaUniversalRobotClock.h>
+#include <sawUniversalRobot/osaUniversalRobotDashboard.h>
+#include <sawUniversalRobot/osaUniversalRobotReceiver.h>
+#include <sawUniversalRobot/osaUniversalRobotIOEngine.h>
+#include <sawUniversalRobot/osaUniversalRobotInverseKinematicsBatch.h>
+#include <sawUniversalRobot/osaUniversalRobotRTDE.h>
+#include <sawUniversalRobot/osaUniversalRobotRecorder.h>
+#include <sawUniversalRobot/osaUniversalRobotSecondaryClient.h>
+#include <sawUniversalRobot/osaUniversalRobotSnapshot.h>
+#include <sawUniversalRobot/osaUniversalRobotTelemetry.h>
+
+#if CISST_HAS_JSON
+#include <json/json.h>
+#endif
 
 const double MAX_VELOCITY = 12.0*cmnPI_180;
 const double MIN_VELOCITY = 0.001*cmnPI_180;
 const double MAX_ACCELERATION = 4.0*cmnPI_180;
 
-// Packet structs for different versions
-#pragma pack(push, 1)     // Eliminate structure padding
-struct module1 {
-    uint32_t messageSize;
-    double time;          // Time elapsed since controller was started
-    double qTarget[6];    // Target joint positions
-    double qdTarget[6];   // Target joint velocities
-    double qddTarget[6];  // Target joint accelerations
-    double I_Target[6];   // Target joint currents
-    double M_Target[6];   // Target joint torques
-    double qActual[6];    // Actual joint positions
-    double qdActual[6];   // Actual joint velocities
-    double I_Actual[6];   // Actual joint currents
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct module2 {
-    unsigned long long digital_Input;  // Digital input bitmask
-    double motor_Tem[6];      // Joint temperatures (degC)
-    double controller_Time;   // Controller real-time thread execution time
-    double test_Val;          // UR internal use only
-    double robot_Mode;        // Robot mode (see RobotModes enum)
-    double joint_Modes[6];    // Joint control modes (Version 1.8+, see JointModes enum)
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct packet_pre_3 {
-    module1 base1;
-    double tool_Accele[3];    // Tool accelerometer values (Version 1.7+)
-    double blank[15];         // Unused
-    double TCP_force[6];      // Generalized forces in the TCP
-    double tool_Vector[6];    // Tool Cartesian pose (x, y, z, rx, ry, rz)
-    double TCP_speed[6];      // Tool Cartesian speed
-    module2 base2;
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct packet_30_31 {
-    module1 base1;
-    double I_ctrl[6];         // Joint control currents
-    double tool_vec_Act[6];   // Actual tool Cartesian pose (x, y, z, rx, ry, rz)
-    double TCP_speed_Act[6];  // Actual tool Cartesian speed
-    double TCP_force[6];      // Generalized forces in the TCP
-    double tool_vec_Tar[6];   // Target tool Cartesian pose (x, y, z, rx, ry, rz)
-    double TCP_speed_Tar[6];  // Target tool Cartesian speed
-    module2 base2;
-    double safety_Mode;       // Safety mode
-    double blank1[6];         // UR software only
-    double tool_Accele[3];    // Tool accelerometer values
-    double blank2[6];         // UR software only
-    double speed_Scal;        // Speed scaling of trajectory limiter
-    double linear_M_norm;     // Norm of Cartesian linear momentum
-    double blank3;            // UR software only
-    double blank4;            // UR software only
-    double V_main;            // Masterboard main voltage
-    double V_robot;           // Masterboard robot voltage (48V)
-    double I_robot;           // Masterboard robot current
-    double V_joint_Act[6];    // Actual joint voltages
-};
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-struct packet_32 : packet_30_31 {
-    unsigned long long digital_Output; // Digital outputs
-    double program_State;     // Program state
-};
-#pragma pack(pop)
-
 CMN_IMPLEMENT_SERVICES_DERIVED_ONEARG(mtsUniversalRobotScriptRT, mtsTaskContinuous, mtsTaskContinuousConstructorArg)
 
-unsigned long mtsUniversalRobotScriptRT::PacketLength[VER_MAX] = {
-       0,  // VER_UNKNOWN
-     764,  // VER_PRE_18
-     812,  // VER_18
-    1044,  // VER_30_31
-    1060   // VER_32
-};
-
 mtsUniversalRobotScriptRT::mtsUniversalRobotScriptRT(const std::string &name, unsigned int sizeStateTable, bool newThread) :
-    mtsTaskContinuous(name, sizeStateTable, newThread), buffer_idx(0), version(VER_UNKNOWN)
+    mtsTaskContinuous(name, sizeStateTable, newThread), FramerResyncs(0),
+    Receiver(0), ReceiverCPU(-1), IOEngine(0), RTDE(0), RTDEFrequency(125.0),
+    RTDEInputDoubleRegisters(0), RTDEInputRegisterOffset(0), RTDEInputRecipe(-1),
+    ServoEnabled(false), ServoRegisterOffset(0), ServoLookahead(0.1), ServoGain(300.0),
+    ServoTime(0.008), ServoTimeoutCycles(10), ServoRecipe(-1),
+    Recorder(0), Telemetry(0), Replay(0), ReplaySpeed(1.0), ReplayLoop(false),
+    ReplayStartTime(-1.0), ReplayFirstTime(0.0),
+    ReconnectEnabled(true), ConnectStatus(CONNECT_NONE), DisconnectTime(0.0),
+    Dashboard(0), DashboardEnabled(true), DashboardTimeout(2.0), DashboardPollPeriod(0.0),
+    DashboardPollTime(0.0),
+    Secondary(0), SecondaryEnabled(false), SecondaryPort(30002), SecondaryCalibration(true),
+    CalibrationPending(false),
+    Snapshot(0), SnapshotIndex(0), SampleHistory(0), SampleHistorySize(0)
 {
     Init();
 }
 
 mtsUniversalRobotScriptRT::mtsUniversalRobotScriptRT(const mtsTaskContinuousConstructorArg &arg) :
-    mtsTaskContinuous(arg), buffer_idx(0), version(VER_UNKNOWN)
+    mtsTaskContinuous(arg), FramerResyncs(0),
+    Receiver(0), ReceiverCPU(-1), IOEngine(0), RTDE(0), RTDEFrequency(125.0),
+    RTDEInputDoubleRegisters(0), RTDEInputRegisterOffset(0), RTDEInputRecipe(-1),
+    ServoEnabled(false), ServoRegisterOffset(0), ServoLookahead(0.1), ServoGain(300.0),
+    ServoTime(0.008), ServoTimeoutCycles(10), ServoRecipe(-1),
+    Recorder(0), Telemetry(0), Replay(0), ReplaySpeed(1.0), ReplayLoop(false),
+    ReplayStartTime(-1.0), ReplayFirstTime(0.0),
+    ReconnectEnabled(true), ConnectStatus(CONNECT_NONE), DisconnectTime(0.0),
+    Dashboard(0), DashboardEnabled(true), DashboardTimeout(2.0), DashboardPollPeriod(0.0),
+    DashboardPollTime(0.0),
+    Secondary(0), SecondaryEnabled(false), SecondaryPort(30002), SecondaryCalibration(true),
+    CalibrationPending(false),
+    Snapshot(0), SnapshotIndex(0), SampleHistory(0), SampleHistorySize(0)
 {
     Init();
 }
 
 mtsUniversalRobotScriptRT::~mtsUniversalRobotScriptRT()
 {
+    // Wait for the connection and receive threads before closing their sockets
+    if (ConnectStatus != CONNECT_NONE)
+        ConnectThread.Wait();
+    delete Receiver;
+    delete RTDE;
+    delete Recorder;
+    delete Telemetry;
+    delete Replay;
+    delete Dashboard;
+    delete Secondary;
+    delete Snapshot;
+    delete [] SampleHistory;
     socket.Close();
 }
 
@@ -167,6 +138,41 @@ void mtsUniversalRobotScriptRT::Init(void)
     TCPSpeed.SetAll(0.0);
     TCPForce.SetAll(0.0);
     debug.SetAll(0.0);
+    SetSampleHistorySize(1000);
+    JacobianSpatial.SetSize(6, NB_Actuators);
+    JacobianSpatial.SetAll(0.0);
+    InverseKinematicsThreads = 0;
+    TrajectoryStartTime = 0.0;
+    SetTrajectoryJointLimits(vctDouble6(1.05), vctDouble6(1.4), vctDouble6(10.0));
+    SetTrajectoryCartesianLimits(vctDouble2(0.25, 1.05), vctDouble2(1.2, 1.4), vctDouble2(10.0, 10.0));
+    TrajectoryStatus.SetAll(0.0);
+    PathStartTime = 0.0;
+    SetPathLimits(vctDouble6(2.0 * cmnPI), vctDouble6(cmnPI));
+    PathStatus.SetAll(0.0);
+    PathTrackingError.SetSize(2, NB_Actuators);
+    PathTrackingError.SetAll(0.0);
+    UpdateMotionQueueStatus();
+    ChangesInitialized = false;
+    LastRobotMode = 0;
+    LastSafetyMode = 0;
+    LastProgramState = 0;
+    LastJointModes.SetAll(0);
+    LastDigitalIO.SetAll(0);
+    SetMotionEvents(0.0, 0.0, 0.0);
+    MotionJointPosition.SetAll(0.0);
+    MotionJointTime = 0.0;
+    MotionCartesianTime = 0.0;
+    StartupBeginTime = osaUniversalRobotMonotonicTime();
+    StartupTime.SetAll(-1.0);
+    pversion.major = 0;
+    pversion.minor = 0;
+    pversion.bugfix = 0;
+    FrameStatus = osaUniversalRobotClockSync::FRAME_OK;
+    ClockStatus.SetAll(0.0);
+    FramingStatistics.SetAll(0);
+    PacketVersion = osaUniversalRobotPacketDecoder::VER_UNKNOWN;
+    for (size_t i = 0; i < SERVO_NB_REGISTERS; i++)
+        ServoRegisters[i] = 0.0;
     StateTable.AddData(ControllerTime, "ControllerTime");
     StateTable.AddData(ControllerExecTime, "ControllerExecTime");
     StateTable.AddData(JointPos, "PositionJoint");
@@ -179,9 +185,27 @@ void mtsUniversalRobotScriptRT::Init(void)
     StateTable.AddData(CartPos, "PositionCartesian");
     StateTable.AddData(TCPSpeed, "VelocityCartesian");
     StateTable.AddData(CartVelParam, "VelocityCartesianParam");
+    StateTable.AddData(CartPosDesired, "PositionCartesianDesired");
+    StateTable.AddData(CartVelDesiredParam, "VelocityCartesianDesiredParam");
+    StateTable.AddData(CartPosKinematics, "PositionCartesianKinematics");
+    StateTable.AddData(JacobianSpatial, "JacobianSpatial");
     StateTable.AddData(TCPForce, "ForceCartesianForce");
     StateTable.AddData(WrenchGet, "ForceCartesianParam");
     StateTable.AddData(debug, "Debug");
+    StateTable.AddData(Sample, "Sample");
+    StateTable.AddData(ClockStatus, "ClockSynchronization");
+    StateTable.AddData(FramingStatistics, "FramingStatistics");
+    StateTable.AddData(TrajectoryStatus, "TrajectoryStatus");
+    StateTable.AddData(PathStatus, "PathStatus");
+    StateTable.AddData(PathTrackingError, "PathTrackingError");
+    StateTable.AddData(MotionQueueStatus, "MotionQueueStatus");
+    StateTable.AddData(PolyscopeVersionString, "PolyscopeVersion");
+    StateTable.AddData(StartupTime, "StartupTime");
+    StateTable.AddData(DashboardRobotMode, "DashboardRobotMode");
+    StateTable.AddData(DashboardSafetyMode, "DashboardSafetyMode");
+    StateTable.AddData(DashboardProgramState, "DashboardProgramState");
+    StateTable.AddData(ControllerState, "ControllerState");
+    StateTable.AddData(ControllerConfiguration, "ControllerConfiguration");
 
     mInterface = AddInterfaceProvided("control");
     if (mInterface) {
@@ -195,6 +219,8 @@ void mtsUniversalRobotScriptRT::Init(void)
         mInterface->AddCommandReadState(this->StateTable, JointState, "GetStateJoint");
         mInterface->AddCommandReadState(this->StateTable, CartPos, "GetPositionCartesian");
         mInterface->AddCommandReadState(this->StateTable, CartVelParam, "GetVelocityCartesian");
+        mInterface->AddCommandReadState(this->StateTable, CartPosDesired, "GetPositionCartesianDesired");
+        mInterface->AddCommandReadState(this->StateTable, CartVelDesiredParam, "GetVelocityCartesianDesired");
         mInterface->AddCommandReadState(this->StateTable, WrenchGet, "GetWrenchBody");
         mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::JointVelocityMove, this, "JointVelocityMove");
         mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::JointPositionMove, this, "JointPositionMove");
@@ -211,468 +237,2478 @@ void mtsUniversalRobotScriptRT::Init(void)
         mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::SetRobotRunningMode, this, "SetRobotRunningMode");
         mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::SetRobotFreeDriveMode, this, "SetRobotFreeDriveMode");
         mInterface->AddCommandReadState(StateTable, debug, "GetDebug");
+        mInterface->AddCommandReadState(StateTable, Sample, "GetSample");
+        mInterface->AddCommandQualifiedRead(&mtsUniversalRobotScriptRT::GetSamplesSince, this, "GetSamplesSince");
+        mInterface->AddCommandReadState(StateTable, ClockStatus, "GetClockSynchronization");
+        mInterface->AddCommandReadState(StateTable, CartPosKinematics, "GetPositionCartesianKinematics");
+        mInterface->AddCommandReadState(StateTable, JacobianSpatial, "GetJacobianSpatial");
+        mInterface->AddCommandQualifiedRead(&mtsUniversalRobotScriptRT::InverseKinematics, this, "InverseKinematics");
+        mInterface->AddCommandQualifiedRead(&mtsUniversalRobotScriptRT::InverseKinematicsBatch, this, "InverseKinematicsBatch");
         mInterface->AddCommandRead(&mtsUniversalRobotScriptRT::GetVersion, this, "GetVersion");
-//        mInterface->AddCommandRead(&mtsUniversalRobotScriptRT::GetPolyscopeVersion, this, "GetPolyscopeVersion");
+        mInterface->AddCommandReadState(StateTable, FramingStatistics, "GetFramingStatistics");
+        mInterface->AddCommandRead(&mtsUniversalRobotScriptRT::GetQueueLatency, this, "GetQueueLatency");
+        mInterface->AddCommandRead(&mtsUniversalRobotScriptRT::GetPublishLatency, this, "GetPublishLatency");
+        mInterface->AddCommandRead(&mtsUniversalRobotScriptRT::GetReceiverStatistics, this, "GetReceiverStatistics");
+        mInterface->AddCommandRead(&mtsUniversalRobotScriptRT::GetRecoveryTime, this, "GetRecoveryTime");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::SetInputDoubleRegisters, this, "SetInputDoubleRegisters");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::ServoJoint, this, "ServoJoint");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::ServoCartesian, this, "ServoCartesian");
+        mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::StopServo, this, "StopServo");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::TrajectoryJoint, this, "TrajectoryJoint");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::TrajectoryCartesian, this, "TrajectoryCartesian");
+        mInterface->AddCommandReadState(StateTable, TrajectoryStatus, "GetTrajectoryStatus");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::JointPath, this, "JointPath");
+        mInterface->AddCommandReadState(StateTable, PathStatus, "GetPathStatus");
+        mInterface->AddCommandReadState(StateTable, PathTrackingError, "GetPathTrackingError");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::MotionQueueAdd, this, "MotionQueueAdd");
+        mInterface->AddCommandReadState(StateTable, MotionQueueStatus, "GetMotionQueueStatus");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::DashboardCommand, this, "DashboardCommand");
+        mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::PowerOn, this, "PowerOn");
+        mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::PowerOff, this, "PowerOff");
+        mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::BrakeRelease, this, "BrakeRelease");
+        mInterface->AddCommandWrite(&mtsUniversalRobotScriptRT::LoadProgram, this, "LoadProgram");
+        mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::PlayProgram, this, "PlayProgram");
+        mInterface->AddCommandVoid(&mtsUniversalRobotScriptRT::RefreshDashboard, this, "RefreshDashboard");
+        mInterface->AddCommandReadState(StateTable, PolyscopeVersionString, "GetPolyscopeVersion");
+        mInterface->AddCommandReadState(StateTable, DashboardRobotMode, "GetDashboardRobotMode");
+        mInterface->AddCommandReadState(StateTable, DashboardSafetyMode, "GetDashboardSafetyMode");
+        mInterface->AddCommandReadState(StateTable, DashboardProgramState, "GetDashboardProgramState");
+        mInterface->AddCommandReadState(StateTable, StartupTime, "GetStartupTime");
+        mInterface->AddCommandReadState(StateTable, ControllerState, "GetControllerState");
+        mInterface->AddCommandReadState(StateTable, ControllerConfiguration, "GetControllerConfiguration");
 
         mInterface->AddEventVoid(SocketErrorEvent, "SocketError");
         mInterface->AddEventVoid(RobotNotReadyEvent, "RobotNotReady");
         mInterface->AddEventVoid(ReceiveTimeoutEvent, "ReceiveTimeout");
         vctULong2 arg;
         mInterface->AddEventWrite(PacketInvalid, "PacketInvalid", arg);
+        mInterface->AddEventWrite(ReconnectAttemptEvent, "ReconnectAttempt", int(0));
+        mInterface->AddEventWrite(ReconnectedEvent, "Reconnected", double(0.0));
+        mInterface->AddEventWrite(WaypointReachedEvent, "WaypointReached", int(0));
+        mInterface->AddEventWrite(TrajectoryCompletedEvent, "TrajectoryCompleted", double(0.0));
+        mInterface->AddEventWrite(PathCompletedEvent, "PathCompleted", double(0.0));
+        mInterface->AddEventWrite(MotionWaypointCompletedEvent, "MotionWaypointCompleted", int(0));
+        mInterface->AddEventWrite(MotionQueueCompletedEvent, "MotionQueueCompleted", int(0));
+        mInterface->AddEventWrite(DashboardReplyEvent, "DashboardReply", std::string(""));
+        mInterface->AddEventWrite(DashboardErrorEvent, "DashboardError", std::string(""));
+        mInterface->AddEventWrite(RobotModeChangedEvent, "RobotModeChanged", int(0));
+        mInterface->AddEventWrite(SafetyModeChangedEvent, "SafetyModeChanged", int(0));
+        mInterface->AddEventWrite(ProgramStateChangedEvent, "ProgramStateChanged", int(0));
+        mInterface->AddEventWrite(JointModesChangedEvent, "JointModesChanged", LastJointModes);
+        mInterface->AddEventWrite(DigitalIOChangedEvent, "DigitalIOChanged", LastDigitalIO);
+        mInterface->AddEventWrite(JointMotionEvent, "JointMotion", JointState);
+        mInterface->AddEventWrite(CartesianMotionEvent, "CartesianMotion", CartPos);
+        mInterface->AddEventWrite(ControllerStateEvent, "ControllerState", ControllerState);
+        mInterface->AddEventWrite(ControllerConfigurationEvent, "ControllerConfiguration", ControllerConfiguration);
+        mInterface->AddEventWrite(ControllerMessageEvent, "ControllerMessage", std::string(""));
 
         // Stats
         mInterface->AddCommandReadState(StateTable, StateTable.PeriodStats,
                                         "GetPeriodStatistics");
     }
-
-    for (size_t i = 0; i < VER_MAX; i++)
-        PacketCount[i] = 0;
 }
 
-void mtsUniversalRobotScriptRT::Configure(const std::string &ipAddr)
+#if CISST_HAS_JSON
+// Read size positive limits if value is set; returns false if it is invalid
+static bool ReadLimits(const Json::Value &value, double *limits, size_t size)
 {
-    if (ipAddr.empty())
-        CMN_LOG_CLASS_INIT_ERROR << "Configure method requires IP address" << std::endl;
-    else {
-        ipAddress = ipAddr;
-        currentPort = 30003;
-        CMN_LOG_CLASS_INIT_VERBOSE << "Connecting to ip " << ipAddress
-                                   << ", port " << currentPort << std::endl;
-        std::cout << "Connecting to ip " << ipAddress << ", port " << currentPort << " ..." << std::endl;
-        if (socket.Connect(ipAddress.c_str(), currentPort)) {
-            std::cout << "Connected" << std::endl;
-            UR_State = UR_IDLE;
-        }
-        else {
-            CMN_LOG_CLASS_INIT_ERROR << "Socket not connected" << std::endl;
-        }
+    if (value.isNull())
+        return true;
+    if (value.size() != size)
+        return false;
+    for (Json::ArrayIndex i = 0; i < size; i++) {
+        if (!(value[i].asDouble() > 0.0))
+            return false;
+        limits[i] = value[i].asDouble();
     }
-
-//    std::string pver;
-//    GetPolyscopeVersion(pver);
+    return true;
 }
+#endif
 
-void mtsUniversalRobotScriptRT::Startup(void)
+bool mtsUniversalRobotScriptRT::ConfigureJSON(const std::string &filename, std::string &ipAddr)
 {
-    if (UR_State != UR_NOT_CONNECTED) {
-        // Flush any existing packets
-        while (socket.Receive(buffer, sizeof(buffer)) > 0);
-        mInterface->SendStatus(this->GetName() + ": socket connected " + ipAddress);
-    } else {
-        mInterface->SendError(this->GetName() + ": socket not connected " + ipAddress);
+#if CISST_HAS_JSON
+    std::ifstream jsonStream;
+    jsonStream.open(filename.c_str());
+    Json::Value jsonConfig;
+    Json::Reader jsonReader;
+    if (!jsonReader.parse(jsonStream, jsonConfig)) {
+        CMN_LOG_CLASS_INIT_ERROR << "Configure: failed to parse configuration file \""
+                                 << filename << "\"\n"
+                                 << jsonReader.getFormattedErrorMessages();
+        return false;
     }
 
-//    std::string pver;
-//    GetPolyscopeVersion(pver);
-}
+    ipAddr = jsonConfig["ip"].asString();
 
-void mtsUniversalRobotScriptRT::Run(void)
-{
-    // Turn this on to enable sanity check of time difference.
-    //bool timeCheckEnabled = (ControllerTime != 0);
-    bool timeCheckEnabled = false;
+    const Json::Value framePolicy = jsonConfig["frame-policy"];
+    if (!framePolicy.isNull()) {
+        if (framePolicy.asString() == "newest")
+            Framer.SetPolicy(osaUniversalRobotStreamFramer::NEWEST_FRAME);
+        else if (framePolicy.asString() == "all")
+            Framer.SetPolicy(osaUniversalRobotStreamFramer::ALL_FRAMES);
+        else {
+            CMN_LOG_CLASS_INIT_ERROR << "Configure: invalid \"frame-policy\" \""
+                                     << framePolicy.asString() << "\", must be \"all\" or \"newest\"" << std::endl;
+            return false;
+        }
+    }
 
-    if (UR_State == UR_NOT_CONNECTED) {
-        // Try to connect here?
-        // Call any connected components
-        RunEvent();
-        ProcessQueuedCommands();
-        Sleep(0.008 * cmn_s);
-        return;
+    const Json::Value sampleHistory = jsonConfig["sample-history"];
+    if (!sampleHistory.isNull())
+        SetSampleHistorySize(sampleHistory.asUInt());
+
+    // Optional host-side kinematics
+    const Json::Value kinematics = jsonConfig["kinematics"];
+    if (!kinematics.isNull()) {
+        vctDouble6 tool(0.0);
+        const Json::Value jsonTool = kinematics["tool"];
+        if (!jsonTool.isNull()) {
+            if (jsonTool.size() != 6) {
+                CMN_LOG_CLASS_INIT_ERROR << "Configure: \"kinematics\" \"tool\" must have 6 elements"
+                                         << std::endl;
+                return false;
+            }
+            for (Json::ArrayIndex i = 0; i < 6; i++)
+                tool[i] = jsonTool[i].asDouble();
+        }
+        if (!SetKinematics(kinematics["model"].asString(), tool))
+            return false;
+        if (!kinematics["ik-threads"].isNull())
+            InverseKinematicsThreads = kinematics["ik-threads"].asUInt();
     }
 
-    // Receive a packet with timeout. We choose a timeout of 500 msec, which is much
-    // larger than expected (should get packets every 8 msec). Thus, if we don't get
-    // a packet, then we raise the ReceiveTimeout event.
-    buffer[buffer_idx+0] = buffer[buffer_idx+1] = buffer[buffer_idx+2] = buffer[buffer_idx+3] = 0;
-    int numBytes = buffer_idx + socket.Receive(buffer+buffer_idx, sizeof(buffer)-buffer_idx, 0.5 * cmn_s);
-    if (numBytes < 0) {
-        buffer_idx = 0;
-        SocketError();
-        socket.Close();
-        UR_State = UR_NOT_CONNECTED;
-        RunEvent();
-        ProcessQueuedCommands();
-        return;
+    // Optional dedicated receive thread
+    const Json::Value receiveThread = jsonConfig["receive-thread"];
+    if (!receiveThread.isNull() && receiveThread["enable"].asBool()) {
+        int cpu = -1;
+        if (!receiveThread["cpu"].isNull())
+            cpu = receiveThread["cpu"].asInt();
+        size_t queueSize = 64;
+        if (!receiveThread["queue-size"].isNull())
+            queueSize = receiveThread["queue-size"].asUInt();
+        EnableReceiveThread(cpu, queueSize);
     }
-    else if (numBytes == 0) {
-        buffer_idx = 0;
-        ReceiveTimeout();
-        RunEvent();
-        ProcessQueuedCommands();
-        return;
+
+    // Optional I/O engine shared by all the robots of the process
+    const Json::Value ioEngine = jsonConfig["io-engine"];
+    if (!ioEngine.isNull() && ioEngine["enable"].asBool()) {
+        EnableIOEngine(osaUniversalRobotIOEngine::Shared(),
+                       ioEngine["cpu"].isNull() ? -1 : ioEngine["cpu"].asInt(),
+                       ioEngine["queue-size"].isNull() ? 64 : ioEngine["queue-size"].asUInt());
     }
 
-    uint32_t packageLength;
-    // Byteswap package length
-    char *p = (char *)(&packageLength);
-    p[0] = buffer[3]; p[1] = buffer[2]; p[2] = buffer[1]; p[3] = buffer[0];
-    if ((packageLength > 0) && (packageLength <= static_cast<uint32_t>(numBytes))) {
-        // Byteswap all the doubles in the package
-        for (size_t i = 4; i < packageLength-4; i += 8) {
-            for (size_t j = 0; j < 4; j++) {
-                char tmp = buffer[i + j];
-                buffer[i + j] = buffer[i + 7 - j];
-                buffer[i + 7 - j] = tmp;
-            }
-        }
-        // Check against expected versions. Even if we already know which version of firmware
-        // we are communicating with, we keep checking in case we made a mistake. This also
-        // collects useful debug data.
-        int i;
-        for (i = VER_UNKNOWN+1; i < VER_MAX; i++) {
-            if (packageLength == PacketLength[i]) {
-                PacketCount[i]++;
-                if (version == VER_UNKNOWN)
-                    version = static_cast<FirmwareVersion>(i);
-                else if (i != version) {
-                    // Could we have auto-detected the wrong version?
-                    if (PacketCount[i] > PacketCount[version]) {
-                        CMN_LOG_CLASS_RUN_WARNING << "Switching from version " << version
-                                                  << " to version " << i << std::endl;
-                        version = static_cast<FirmwareVersion>(i);
-                    }
-                }
-                break;
-            }
-        }
-        // If we didn't find a match above, increment the VER_UNKNOWN packet counter
-        if (i == VER_MAX)
-            PacketCount[VER_UNKNOWN]++;
-        if (version != VER_UNKNOWN) {
-            if (packageLength < PacketLength[version]) {
-                debug[2] += 1;
-                debug[3] = packageLength;
-            }
-            else if (packageLength > PacketLength[version]) {
-                debug[4] += 1;
-                debug[5] = packageLength;
-            }
-            // Following is valid for all versions
-            module1 *base1 = reinterpret_cast<module1 *>(buffer);
-            // First, do a sanity check on the packet. The new ControllerTime (base1->time)
-            // should be about 0.008 seconds later than the previous value.
-            double timeDiff = base1->time - ControllerTime;
-            debug[0] = 1000.0*timeDiff;
-            if (timeCheckEnabled && ((timeDiff < 0.004) || (timeDiff > 0.024))) {
-                // Could create a different event
-                PacketInvalid(vctULong2(numBytes, packageLength));
-                // Try to recover next time
-                ControllerTime += 0.008;
-            }
-            else {
-                ControllerTime = base1->time;
-                JointPos.Assign(base1->qActual);
-                JointPosParam.SetPosition(JointPos);
-                JointVel.Assign(base1->qdActual);
-                JointVelParam.SetVelocity(JointVel);
-                JointEffort.Assign(base1->I_Actual);
-                JointTargetEffort.Assign(base1->I_Target);
-
-                JointState.Position().Assign(JointPos);
-                JointState.Velocity().Assign(JointVel);
-                JointState.Effort().Assign(JointEffort);
-            }
-            module2 *base2 = (version <= VER_18) ? (module2 *)(&((packet_pre_3 *)buffer)->base2)
-                                                 : (module2 *)(&((packet_30_31 *)buffer)->base2);
-            // Following is documented to be "controller realtime thread execution time"
-            // Not sure what this is, or what are the units
-            ControllerExecTime = base2->controller_Time;
-            debug[1] = ControllerExecTime;
-
-            double *tool_vec = 0;
-            if (version < VER_30_31) {
-                packet_pre_3 *packet = (packet_pre_3 *)(buffer);
-                // Documentation does not specify whether tool_Vector field is
-                // the actual or target Cartesian position.
-                tool_vec = packet->tool_Vector;
-            }
-            else if (version >= VER_30_31) {
-                packet_30_31 *packet = (packet_30_31 *)(buffer);
-                tool_vec = packet->tool_vec_Act;  // actual Cartesian position
-            }
-            if (tool_vec) {
-                vct3 position(tool_vec);
-                vct3 orientation(tool_vec+3);
-                vctRodriguezRotation3<double> rot(orientation);
-                vctDoubleRot3 cartRot(rot);  // rotation matrix, from world frame to the end-effector frame
-                vctFrm3 frm(cartRot, position);
-                CartPos.SetPosition(frm);
-            }
-            // Finished with packet; now preserve any extra data for next time
-            if (packageLength < static_cast<unsigned long>(numBytes)) {
-                memmove(buffer, buffer+packageLength, numBytes-packageLength);
-                buffer_idx = numBytes-packageLength;
-            }
-            else
-                buffer_idx = 0;
-        }
-        else
-            buffer_idx = 0;
+    // Optional RTDE interface for robot data
+    const Json::Value rtde = jsonConfig["rtde"];
+    if (!rtde.isNull() && rtde["enable"].asBool()) {
+        double frequency = 125.0;
+        if (!rtde["frequency"].isNull())
+            frequency = rtde["frequency"].asDouble();
+        std::vector<std::string> outputs;
+        const Json::Value jsonOutputs = rtde["outputs"];
+        for (Json::ArrayIndex i = 0; i < jsonOutputs.size(); i++)
+            outputs.push_back(jsonOutputs[i].asString());
+        EnableRTDE(frequency, outputs,
+                   rtde["input-double-registers"].asUInt(),
+                   rtde["input-register-offset"].asUInt());
     }
-    else {
-        buffer_idx = 0;
-        PacketInvalid(vctULong2(numBytes, packageLength));
-        mInterface->SendError(this->GetName() + ": invalid package");
-        // purge buffer
-        while (socket.Receive(buffer, sizeof(buffer)) > 0);
+
+    // Flight recorder and replay
+    const Json::Value recorder = jsonConfig["recorder"];
+    if (!recorder.isNull() && (recorder["enable"].isNull() || recorder["enable"].asBool())) {
+        const double sizeMB = recorder["size-mb"].isNull() ? 64.0 : recorder["size-mb"].asDouble();
+        EnableRecorder(recorder["file"].asString(), static_cast<size_t>(sizeMB * 1024.0 * 1024.0));
+    }
+    const Json::Value telemetry = jsonConfig["telemetry"];
+    if (!telemetry.isNull() && (telemetry["enable"].isNull() || telemetry["enable"].asBool())) {
+        std::vector<std::string> fields;
+        const Json::Value jsonFields = telemetry["fields"];
+        for (Json::ArrayIndex i = 0; i < jsonFields.size(); i++)
+            fields.push_back(jsonFields[i].asString());
+        EnableTelemetry(telemetry["file"].asString(), fields,
+                        telemetry["rows-per-chunk"].isNull() ? 1000 : telemetry["rows-per-chunk"].asUInt(),
+                        telemetry["compression-level"].asInt());
+    }
+    const Json::Value replay = jsonConfig["replay"];
+    if (!replay.isNull() && (replay["enable"].isNull() || replay["enable"].asBool())) {
+        EnableReplay(replay["file"].asString(),
+                     replay["speed"].isNull() ? 1.0 : replay["speed"].asDouble(),
+                     replay["loop"].asBool());
     }
 
-    // Advance the state table now, so that any connected components can get
-    // the latest data.
-    StateTable.Advance();
+    // Dashboard server client
+    const Json::Value dashboard = jsonConfig["dashboard"];
+    if (!dashboard.isNull()) {
+        if (dashboard["enable"].isNull() || dashboard["enable"].asBool())
+            EnableDashboard(dashboard["timeout"].isNull() ? 2.0 : dashboard["timeout"].asDouble(),
+                            dashboard["poll-period"].asDouble());
+        else
+            DisableDashboard();
+    }
 
-    // Call any connected components
-    RunEvent();
+    // Snapshot for readers outside the task
+    const Json::Value snapshot = jsonConfig["snapshot"];
+    if (!snapshot.isNull() && (snapshot["enable"].isNull() || snapshot["enable"].asBool())
+        && !EnableSnapshot(snapshot["shared-memory"].asString())) {
+        CMN_LOG_CLASS_INIT_ERROR << "Configure: can't create \"snapshot\" shared memory" << std::endl;
+        return false;
+    }
 
-    ProcessQueuedCommands();
+    // Secondary interface client
+    const Json::Value secondary = jsonConfig["secondary"];
+    if (!secondary.isNull() && (secondary["enable"].isNull() || secondary["enable"].asBool())) {
+        EnableSecondary(secondary["port"].isNull() ? 30002 : static_cast<unsigned short>(secondary["port"].asUInt()),
+                        secondary["calibration"].isNull() || secondary["calibration"].asBool());
+    }
 
-    switch (UR_State) {
+    // Automatic reconnection
+    const Json::Value reconnect = jsonConfig["reconnect"];
+    if (!reconnect.isNull()) {
+        if (reconnect["enable"].isNull() || reconnect["enable"].asBool())
+            EnableReconnect(reconnect["initial-delay"].isNull() ? 0.1 : reconnect["initial-delay"].asDouble(),
+                            reconnect["max-delay"].isNull() ? 5.0 : reconnect["max-delay"].asDouble(),
+                            reconnect["connect-timeout"].isNull() ? 1.0 : reconnect["connect-timeout"].asDouble());
+        else
+            DisableReconnect();
+    }
 
-    case UR_IDLE:
-        break;
+    // Optional servo mode (uses RTDE input registers)
+    const Json::Value servo = jsonConfig["servo"];
+    if (!servo.isNull() && servo["enable"].asBool()) {
+        EnableServo(servo["register-offset"].asUInt(),
+                    servo["lookahead"].isNull() ? 0.1 : servo["lookahead"].asDouble(),
+                    servo["gain"].isNull() ? 300.0 : servo["gain"].asDouble(),
+                    servo["time"].isNull() ? 0.008 : servo["time"].asDouble(),
+                    servo["timeout-cycles"].isNull() ? 10 : servo["timeout-cycles"].asInt());
+    }
 
-    case UR_VEL_MOVING:
-        VelCmdTimeout--;
-        if (VelCmdTimeout <= 0) {
-            if (socket.Send(VelCmdStop) == -1)
-                 SocketError();
-            UR_State = UR_IDLE;
+    // Default trajectory limits
+    const Json::Value trajectory = jsonConfig["trajectory"];
+    if (!trajectory.isNull()) {
+        const Json::Value joint = trajectory["joint"];
+        if (!ReadLimits(joint["velocity"], TrajectoryJointVelocity.Pointer(), 6)
+            || !ReadLimits(joint["acceleration"], TrajectoryJointAcceleration.Pointer(), 6)
+            || !ReadLimits(joint["jerk"], TrajectoryJointJerk.Pointer(), 6)) {
+            CMN_LOG_CLASS_INIT_ERROR << "Configure: \"trajectory\" \"joint\" limits must have 6 positive elements"
+                                     << std::endl;
+            return false;
         }
-        else {
-            if (socket.Send(VelCmdString) == -1)
-                 SocketError();
+        const Json::Value cartesian = trajectory["cartesian"];
+        if (!ReadLimits(cartesian["velocity"], TrajectoryCartesianVelocity.Pointer(), 2)
+            || !ReadLimits(cartesian["acceleration"], TrajectoryCartesianAcceleration.Pointer(), 2)
+            || !ReadLimits(cartesian["jerk"], TrajectoryCartesianJerk.Pointer(), 2)) {
+            CMN_LOG_CLASS_INIT_ERROR << "Configure: \"trajectory\" \"cartesian\" limits must have 2 positive elements"
+                                     << std::endl;
+            return false;
         }
-        break;
+    }
 
-    case UR_FREE_DRIVE:
-        break;
+    // Joint path limits
+    const Json::Value path = jsonConfig["path"];
+    if (!path.isNull()) {
+        if (!ReadLimits(path["position-limits"], PathPositionLimits.Pointer(), 6)
+            || !ReadLimits(path["velocity-limits"], PathVelocityLimits.Pointer(), 6)) {
+            CMN_LOG_CLASS_INIT_ERROR << "Configure: \"path\" limits must have 6 positive elements"
+                                     << std::endl;
+            return false;
+        }
+    }
 
-    case UR_POS_MOVING:
-        if (JointVel.Norm() == 0.0)
-            UR_State = UR_IDLE;
-        break;
+    // Significant motion events
+    const Json::Value motionEvents = jsonConfig["motion-events"];
+    if (!motionEvents.isNull()) {
+        SetMotionEvents(motionEvents["joint-threshold"].asDouble(),
+                        motionEvents["linear-threshold"].asDouble(),
+                        motionEvents["angular-threshold"].asDouble(),
+                        motionEvents["max-period"].asDouble());
+    }
 
-    case UR_POWERING_ON:
-        break;
+    const Json::Value motionQueue = jsonConfig["motion-queue"];
+    if (!motionQueue.isNull() && !motionQueue["capacity"].isNull())
+        SetMotionQueueCapacity(motionQueue["capacity"].asUInt());
+    return true;
+#else
+    CMN_LOG_CLASS_INIT_ERROR << "Configure: can't load \"" << filename
+                             << "\", cisst was compiled without JSON support" << std::endl;
+    return false;
+#endif
+}
 
-    case UR_POWERING_OFF:
-        break;
+void mtsUniversalRobotScriptRT::Configure(const std::string &ipAddrOrFile)
+{
+    StartupBeginTime = osaUniversalRobotMonotonicTime();
+    std::string ipAddr = ipAddrOrFile;
+    // If a JSON file is provided, the IP address is read from the file
+    const std::string extension(".json");
+    if ((ipAddrOrFile.size() > extension.size())
+        && (ipAddrOrFile.compare(ipAddrOrFile.size() - extension.size(), extension.size(), extension) == 0)) {
+        if (!ConfigureJSON(ipAddrOrFile, ipAddr))
+            return;
+    }
 
-    default:
-        CMN_LOG_CLASS_RUN_ERROR << "Run: unknown state = " << UR_State << std::endl;
+    if (Replay) {
+        // No controller; the decoder detects the version from the recorded frames
+        UR_State = UR_IDLE;
+        CMN_LOG_CLASS_INIT_VERBOSE << "Configure: replaying " << Replay->GetNumberOfFrames()
+                                   << " frames" << std::endl;
+    }
+    else if (ipAddr.empty())
+        CMN_LOG_CLASS_INIT_ERROR << "Configure method requires IP address" << std::endl;
+    else {
+        ipAddress = ipAddr;
+        currentPort = 30003;
+        // Smallest and largest packets we expect on port 30003 (leaves room for newer firmware)
+        Framer.SetLengthRange(osaUniversalRobotPacketDecoder::PacketLength[osaUniversalRobotPacketDecoder::VER_PRE_18],
+                              4096);
+        // The dashboard thread queries the Polyscope version while we connect; replies
+        // are processed by Run
+        if (DashboardEnabled && !Dashboard) {
+            Dashboard = new osaUniversalRobotDashboard;
+            Dashboard->Start(ipAddress, 29999, DashboardTimeout);
+            RefreshDashboard();
+        }
+        if (SecondaryEnabled && !Secondary) {
+            Secondary = new osaUniversalRobotSecondaryClient;
+            Secondary->Start(ipAddress, SecondaryPort);
+        }
+        CMN_LOG_CLASS_INIT_VERBOSE << "Connecting to ip " << ipAddress
+                                   << ", port " << currentPort << std::endl;
+        // If the controller is not reachable, the connection thread keeps trying after
+        // the timeout and Run gets the result
+        StartConnect();
+        const int status = FinishConnect(Reconnect.GetConnectTimeout());
+        if (status == CONNECT_IN_PROGRESS) {
+            CMN_LOG_CLASS_INIT_ERROR << "Socket not connected after " << Reconnect.GetConnectTimeout()
+                                     << " s, still trying" << std::endl;
+        }
+        else if (status == CONNECT_FAILED) {
+            CMN_LOG_CLASS_INIT_ERROR << "Socket not connected" << std::endl;
+        }
+        else {
+            UR_State = UR_IDLE;
+            if (status == CONNECT_RTDE_FAILED) {
+                CMN_LOG_CLASS_INIT_ERROR << "Configure: failed to set up RTDE, using port "
+                                         << currentPort << " for robot data" << std::endl;
+                delete RTDE;
+                RTDE = 0;
+            }
+            StartupTime[0] = osaUniversalRobotMonotonicTime() - StartupBeginTime;
+            CMN_LOG_CLASS_INIT_VERBOSE << "Configure: connected in " << 1000.0 * StartupTime[0]
+                                       << " ms" << std::endl;
+        }
     }
 }
 
+void mtsUniversalRobotScriptRT::EnableRecorder(const std::string &filename, size_t capacity)
+{
+    if (!Recorder)
+        Recorder = new osaUniversalRobotRecorder;
+    if (!Recorder->Open(filename, capacity)) {
+        CMN_LOG_CLASS_INIT_ERROR << "EnableRecorder: failed to create \"" << filename << "\"" << std::endl;
+        delete Recorder;
+        Recorder = 0;
+    }
+    UpdateFrameSinks();
+}
 
-void mtsUniversalRobotScriptRT::Cleanup(void)
+void mtsUniversalRobotScriptRT::EnableTelemetry(const std::string &filename,
+                                                const std::vector<std::string> &fields,
+                                                size_t rowsPerChunk, int compressionLevel)
 {
+    if (!Telemetry)
+        Telemetry = new osaUniversalRobotTelemetry;
+    if (!Telemetry->Open(filename, fields, rowsPerChunk, compressionLevel)) {
+        CMN_LOG_CLASS_INIT_ERROR << "EnableTelemetry: failed to create \"" << filename << "\"" << std::endl;
+        delete Telemetry;
+        Telemetry = 0;
+    }
+    UpdateFrameSinks();
 }
 
-void mtsUniversalRobotScriptRT::SocketError(void)
+void mtsUniversalRobotScriptRT::UpdateFrameSinks(void)
 {
-    SocketErrorEvent();
-    mInterface->SendError(this->GetName() + ": socket error, IP: " + ipAddress);
+    FrameSinks.clear();
+    if (Recorder)
+        FrameSinks.push_back(Recorder);
+    if (Telemetry)
+        FrameSinks.push_back(Telemetry);
+    if (Receiver)
+        Receiver->SetFrameSinks(FrameSinks);
 }
 
-void mtsUniversalRobotScriptRT::RobotNotReady(void)
+void mtsUniversalRobotScriptRT::EnableReplay(const std::string &filename, double speed, bool loop)
 {
-    RobotNotReadyEvent();
-    mInterface->SendWarning(this->GetName() + ": robot not ready");
+    if (!Replay)
+        Replay = new osaUniversalRobotReplay;
+    if (!Replay->Open(filename)) {
+        CMN_LOG_CLASS_INIT_ERROR << "EnableReplay: failed to open \"" << filename << "\"" << std::endl;
+        delete Replay;
+        Replay = 0;
+        return;
+    }
+    ReplaySpeed = (speed > 0.0) ? speed : 0.0;
+    ReplayLoop = loop;
+    ReplayStartTime = -1.0;
+    // Replay does not reconnect
+    ReconnectEnabled = false;
 }
 
-void mtsUniversalRobotScriptRT::ReceiveTimeout(void)
+void mtsUniversalRobotScriptRT::EnableReconnect(double initialDelay, double maximumDelay,
+                                                double connectTimeout)
 {
-    ReceiveTimeoutEvent();
-    mInterface->SendError(this->GetName() + ": socket timeout");
+    ReconnectEnabled = true;
+    Reconnect.SetBackoff(initialDelay, maximumDelay);
+    Reconnect.SetConnectTimeout(connectTimeout);
 }
 
+void mtsUniversalRobotScriptRT::EnableDashboard(double timeout, double pollPeriod)
+{
+    DashboardEnabled = true;
+    DashboardTimeout = timeout;
+    DashboardPollPeriod = pollPeriod;
+}
 
-bool mtsUniversalRobotScriptRT::SendAndReceive(osaSocket &socket, std::string cmd, std::string &recv)
+void mtsUniversalRobotScriptRT::EnableSecondary(unsigned short port, bool useCalibration)
 {
-    char buf[100];
-    if (socket.Send(cmd) < 0) return false;
-    osaSleep(0.1);   // wait for reply
-    if (socket.Receive(buf, 100) < 0) return false;
+    SecondaryEnabled = true;
+    SecondaryPort = port;
+    SecondaryCalibration = useCalibration;
+}
 
-    recv = buf;
-    return true;
+bool mtsUniversalRobotScriptRT::EnableSnapshot(const std::string &sharedMemoryName)
+{
+    if (!Snapshot)
+        Snapshot = new osaUniversalRobotSnapshot;
+    return sharedMemoryName.empty() || Snapshot->CreateShared(sharedMemoryName);
 }
 
-void mtsUniversalRobotScriptRT::SetRobotFreeDriveMode(void)
+void mtsUniversalRobotScriptRT::SetSampleHistorySize(size_t size)
 {
-    if (UR_State == UR_IDLE) {
-        int ret;
-        if (version < VER_30_31) {
-            ret = socket.Send("set robotmode freedrive\n");
-        } else {
-            ret = socket.Send("def saw_ur_freedrive():\n\tfreedrive_mode()\nsleep(20)\nend\n");
-        }
+    // At least one sample can be read while the next one is written
+    delete [] SampleHistory;
+    SampleHistorySize = (size < 2) ? 2 : size;
+    SampleHistory = new SampleSlot[SampleHistorySize];
+    for (size_t i = 0; i < SampleHistorySize; i++) {
+        SampleHistory[i].Sequence.store(0, std::memory_order_relaxed);
+        for (size_t j = 0; j < SAMPLE_RECORD_WORDS; j++)
+            SampleHistory[i].Words[j].store(0, std::memory_order_relaxed);
+    }
+    SampleHistoryLatest = 0;
+}
 
-        if (ret == -1) {
-            SocketError();
-        } else {
-            UR_State = UR_FREE_DRIVE;
-            mInterface->SendStatus(this->GetName() + ": set freedrive mode");
-        }
+bool mtsUniversalRobotScriptRT::SetKinematics(const std::string &model, const vctDouble6 &tool)
+{
+    if (!Kinematics.SetModel(model)) {
+        CMN_LOG_CLASS_INIT_ERROR << "SetKinematics: unknown model \"" << model
+                                 << "\", must be \"UR3\", \"UR5\" or \"UR10\"" << std::endl;
+        return false;
     }
-    else
-        RobotNotReady();   // if not idle, ignore command and raise event
+    Kinematics.SetTool(tool.Pointer());
+    UpdateInverseKinematicsModel();
+    return true;
 }
 
-void mtsUniversalRobotScriptRT::SetRobotRunningMode(void)
+void mtsUniversalRobotScriptRT::UpdateInverseKinematicsModel(void)
 {
-    if (UR_State == UR_FREE_DRIVE) {
-        int ret;
-        if (version < VER_30_31) {
-            ret = socket.Send("set robotmode run\n");
-        } else {
-            ret = socket.Send("end_freedrive_mode()\n");
-        }
+    KinematicsMutex.Lock();
+    InverseKinematicsModel = Kinematics;
+    KinematicsMutex.Unlock();
+}
 
-        if (ret == -1) {
-            SocketError();
-        } else {
-            UR_State = UR_IDLE;
-            mInterface->SendStatus(this->GetName() + ": set running mode");
-        }
+void mtsUniversalRobotScriptRT::EnableReceiveThread(int cpu, size_t queueSize)
+{
+    if (Receiver) {
+        Receiver->Stop();
+        delete Receiver;
     }
-    else
-        RobotNotReady();   // if not idle, ignore command and raise event
+    Receiver = new osaUniversalRobotReceiver(Framer, Decoder, queueSize);
+    Receiver->SetFrameSinks(FrameSinks);
+    ReceiverCPU = cpu;
+    IOEngine = 0;
 }
 
-void mtsUniversalRobotScriptRT::DisableMotorPower(void)
+void mtsUniversalRobotScriptRT::EnableIOEngine(osaUniversalRobotIOEngine &engine, int cpu, size_t queueSize)
 {
-    if (socket.Send("powerdown()\n") == -1)
-        SocketError();
+    EnableReceiveThread(cpu, queueSize);
+    IOEngine = &engine;
 }
 
-void mtsUniversalRobotScriptRT::JointVelocityMove(const prmVelocityJointSet &jtvelSet)
+void mtsUniversalRobotScriptRT::EnableRTDE(double frequency, const std::vector<std::string> &outputs,
+                                           size_t numInputDoubleRegisters, size_t inputRegisterOffset)
 {
-    if ((UR_State == UR_IDLE) || (UR_State == UR_VEL_MOVING)) {
-        vctDoubleVec jtvel(NB_Actuators);
-        jtvelSet.GetGoal(jtvel);
-        // velocity check
-        for (int i = 0; i < NB_Actuators; i++) {
-            if (jtvel[i] > 0) {
-                if (jtvel[i] < MIN_VELOCITY)
-                    jtvel[i] = MIN_VELOCITY;
-                else if (jtvel[i] > MAX_VELOCITY)
-                    jtvel[i] = MAX_VELOCITY;
-            }
-            else {
-                if (jtvel[i] > -MIN_VELOCITY)
-                    jtvel[i] = -MIN_VELOCITY;
-                else if (jtvel[i] < -MAX_VELOCITY)
-                    jtvel[i] = -MAX_VELOCITY;
-            }
-        }
-        // String length is about 28 + 6*7 = 70; set it to 100 to be sure
-        // speedj(qd, a, t)
-        sprintf(VelCmdString,
-                "speedj([%6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf], %6.4lf, 0.0)\n",
-                jtvel[0], jtvel[1], jtvel[2], jtvel[3], jtvel[4], jtvel[5], 1.4);
-        strcpy(VelCmdStop, "speedj([0.0, 0.0, 0.0, 0.0, 0.0, 0.0], 1.4, 0.0)\n");
-        VelCmdTimeout = 100;   // Number of cycles for command to remain valid
-        UR_State = UR_VEL_MOVING;
-    }
-    else
-        RobotNotReady();
+    if (!RTDE)
+        RTDE = new osaUniversalRobotRTDE;
+    RTDEFrequency = frequency;
+    if (frequency > 0.0)
+        ClockSync.SetNominalPeriod(1.0 / frequency);
+    RTDEOutputs = outputs;
+    RTDEInputDoubleRegisters = numInputDoubleRegisters;
+    RTDEInputRegisterOffset = inputRegisterOffset;
 }
 
-void mtsUniversalRobotScriptRT::JointPositionMove(const prmPositionJointSet &jtposSet)
+void mtsUniversalRobotScriptRT::EnableServo(size_t registerOffset, double lookahead, double gain,
+                                            double time, int timeoutCycles)
 {
-    char JointPosCmdString[100];
-    if (UR_State == UR_IDLE) {
-        vctDoubleVec jtpos(NB_Actuators);
-        jtposSet.GetGoal(jtpos);
-        // For now, we issue a movej command; in the future, we may use a trajectory
-        // generator and use servoj.
-        sprintf(JointPosCmdString,
-                "movej([%6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf], a=%6.4lf, v=%6.4lf)\n",
-                jtpos[0], jtpos[1], jtpos[2], jtpos[3], jtpos[4], jtpos[5], 1.4, 0.2);
-        if (socket.Send(JointPosCmdString) == -1)
-            SocketError();
-        else
-            UR_State = UR_POS_MOVING;
+    if (!RTDE)
+        EnableRTDE();
+    // Limits documented for servoj
+    if ((lookahead < 0.03) || (lookahead > 0.2)) {
+        lookahead = (lookahead < 0.03) ? 0.03 : 0.2;
+        CMN_LOG_CLASS_INIT_WARNING << "EnableServo: lookahead must be between 0.03 and 0.2, using "
+                                   << lookahead << std::endl;
     }
-    else
-        RobotNotReady();
+    if ((gain < 100.0) || (gain > 2000.0)) {
+        gain = (gain < 100.0) ? 100.0 : 2000.0;
+        CMN_LOG_CLASS_INIT_WARNING << "EnableServo: gain must be between 100 and 2000, using "
+                                   << gain << std::endl;
+    }
+    ServoEnabled = true;
+    ServoRegisterOffset = registerOffset;
+    ServoLookahead = lookahead;
+    ServoGain = gain;
+    ServoTime = time;
+    ServoTimeoutCycles = (timeoutCycles > 0) ? timeoutCycles : 1;
 }
 
-void mtsUniversalRobotScriptRT::CartesianVelocityMove(const prmVelocityCartesianSet &CartVel)
+// URScript program calling servoj with the setpoints written in the input registers
+static std::string GenerateServoProgram(size_t offset, double lookahead, double gain,
+                                        double time, int timeoutCycles)
 {
-    if ((UR_State == UR_IDLE) || (UR_State == UR_VEL_MOVING)) {
-        vct3 velxyz = CartVel.GetVelocity();
-        vct3 velrot = CartVel.GetAngularVelocity();
-        // speedl(qd, a, t, aRot)
-        sprintf(VelCmdString,
-                "speedl([%6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf], %6.4lf, 0.0)\n",
-                velxyz.X(), velxyz.Y(), velxyz.Z(), velrot.X(), velrot.Y(), velrot.Z(), 1.4);
-        strcpy(VelCmdStop, "speedl([0.0, 0.0, 0.0, 0.0, 0.0, 0.0], 1.4, 0.0)\n");
-        VelCmdTimeout = 100;   // Number of cycles for command to remain valid
-        UR_State = UR_VEL_MOVING;
+    std::ostringstream setpoint;
+    for (size_t i = 1; i <= 6; i++)
+        setpoint << ((i > 1) ? ", " : "") << "read_input_float_register(" << offset + i << ")";
+
+    std::ostringstream program;
+    program << std::fixed << std::setprecision(4)
+            << "def saw_ur_servo():\n"
+            << "  last = read_input_float_register(" << offset + 7 << ")\n"
+            << "  stale = 0\n"
+            << "  stopped = False\n"
+            << "  while True:\n"
+            << "    mode = read_input_float_register(" << offset << ")\n"
+            << "    counter = read_input_float_register(" << offset + 7 << ")\n"
+            << "    if counter == last:\n"
+            << "      stale = stale + 1\n"
+            << "    else:\n"
+            << "      stale = 0\n"
+            << "      last = counter\n"
+            << "    end\n"
+            << "    if mode == 0 or stale > " << timeoutCycles << ":\n"
+            << "      if not stopped:\n"
+            << "        stopj(2.0)\n"
+            << "        stopped = True\n"
+            << "      end\n"
+            << "      sync()\n"
+            << "    elif mode == 1:\n"
+            << "      stopped = False\n"
+            << "      servoj([" << setpoint.str() << "], 0, 0, " << time << ", " << lookahead << ", " << gain << ")\n"
+            << "    else:\n"
+            << "      stopped = False\n"
+            << "      servoj(get_inverse_kin(p[" << setpoint.str() << "]), 0, 0, "
+            << time << ", " << lookahead << ", " << gain << ")\n"
+            << "    end\n"
+            << "  end\n"
+            << "end\n";
+    return program.str();
+}
+
+bool mtsUniversalRobotScriptRT::ConnectRTDE(void)
+{
+    CMN_LOG_CLASS_INIT_VERBOSE << "Connecting to ip " << ipAddress << ", port 30004" << std::endl;
+    if (!RTDE->Connect(ipAddress) || !RTDE->NegotiateProtocolVersion())
+        return false;
+    unsigned int version[4];
+    if (RTDE->GetControllerVersion(version)) {
+        CMN_LOG_CLASS_INIT_VERBOSE << "Controller version " << version[0] << "." << version[1]
+                                   << "." << version[2] << "." << version[3] << std::endl;
     }
-    else
-        RobotNotReady();
+    // RTDE requires software 3.4 or later, so the port 30003 packets (which are not
+    // decoded) are the Version 3.2+ ones; this selects the script commands to use.
+    Decoder.SetVersion(osaUniversalRobotPacketDecoder::VER_32);
+    PacketVersion = osaUniversalRobotPacketDecoder::VER_32;
+
+    if (RTDEOutputs.empty())
+        RTDEOutputs = osaUniversalRobotRTDE::DefaultOutputs();
+    // Trajectories and paths are timed with the controller time
+    if (ServoEnabled && (std::find(RTDEOutputs.begin(), RTDEOutputs.end(), "timestamp") == RTDEOutputs.end()))
+        RTDEOutputs.push_back("timestamp");
+    if (!RTDE->SetupOutputs(RTDEFrequency, RTDEOutputs))
+        return false;
+    RTDEInputRecipe = -1;
+    if (RTDEInputDoubleRegisters > 0) {
+        std::vector<std::string> inputs;
+        for (size_t i = 0; i < RTDEInputDoubleRegisters; i++) {
+            std::stringstream name;
+            name << "input_double_register_" << (RTDEInputRegisterOffset + i);
+            inputs.push_back(name.str());
+        }
+        RTDEInputRecipe = RTDE->SetupInputs(inputs);
+        if (RTDEInputRecipe < 0)
+            return false;
+    }
+    ServoRecipe = -1;
+    if (ServoEnabled) {
+        std::vector<std::string> inputs;
+        for (size_t i = 0; i < SERVO_NB_REGISTERS; i++) {
+            std::stringstream name;
+            name << "input_double_register_" << (ServoRegisterOffset + i);
+            inputs.push_back(name.str());
+        }
+        ServoRecipe = RTDE->SetupInputs(inputs);
+        if (ServoRecipe < 0)
+            return false;
+        ServoProgram = GenerateServoProgram(ServoRegisterOffset, ServoLookahead, ServoGain,
+                                            ServoTime, ServoTimeoutCycles);
+    }
+    RTDE->SetFramePolicy(Framer.GetPolicy());
+    return true;
 }
 
-void mtsUniversalRobotScriptRT::CartesianPositionMove(const prmPositionCartesianSet &CartPos)
+void mtsUniversalRobotScriptRT::StartReceiving(void)
 {
-    char CartPosCmdString[100];
-    if (UR_State == UR_IDLE) {
-        vctDoubleFrm3 cartFrm = CartPos.GetGoal();
-        vctRodriguezRotation3<double> rot;
-        rot.From(cartFrm.Rotation());  // The rotation vector
-        sprintf(CartPosCmdString,
-            "movel(p[%6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf, %6.4lf], a=%6.4lf, v=%6.4lf)\n",
-            cartFrm.Translation().X(), cartFrm.Translation().Y(), cartFrm.Translation().Z(),
-            rot.X(), rot.Y(), rot.Z(), 1.2, 0.08);
-        if (socket.Send(CartPosCmdString) == -1)
-            SocketError();
+    // Flush the packets buffered since the connection with non-blocking receives,
+    // keeping the newest one so that the first sample is published without waiting
+    // for the next packet (RTDE does not use port 30003 for robot data).  The ring
+    // may not hold all the buffered data, receive until the socket is empty.
+    while (Framer.Receive(socket, 0.0) > 0) {
+        if (RTDE)
+            Framer.Reset();
         else
-            UR_State = UR_POS_MOVING;
+            Framer.KeepNewest();
     }
-    else
-        RobotNotReady();
+    if (RTDE) {
+        // Started by the connection thread
+        RTDE->KeepNewest();
+        if (Receiver)
+            CMN_LOG_CLASS_INIT_WARNING << "StartReceiving: receive thread is not used with RTDE" << std::endl;
+    }
+    else if (Receiver && IOEngine) {
+        if (!IOEngine->Start(ReceiverCPU) || !Receiver->Start(&socket, *IOEngine)) {
+            CMN_LOG_CLASS_INIT_WARNING << "StartReceiving: failed to use I/O engine, using a receive thread"
+                                       << std::endl;
+            IOEngine = 0;
+            Receiver->Start(&socket, ReceiverCPU);
+        }
+    }
+    else if (Receiver)
+        Receiver->Start(&socket, ReceiverCPU);
 }
 
-void mtsUniversalRobotScriptRT::StopMotion(void)
+void mtsUniversalRobotScriptRT::Startup(void)
 {
-    if (socket.Send("stopj(1.4)\n") == -1)
-        SocketError();
+    if (Replay) {
+        mInterface->SendStatus(this->GetName() + ": replaying recording");
+        return;
+    }
+    if (UR_State != UR_NOT_CONNECTED) {
+        StartReceiving();
+        mInterface->SendStatus(this->GetName() + ": socket connected " + ipAddress);
+    } else {
+        mInterface->SendError(this->GetName() + ": socket not connected " + ipAddress);
+        // Keep trying if the controller is not up yet
+        if (ReconnectEnabled && !ipAddress.empty()) {
+            DisconnectTime = osaUniversalRobotMonotonicTime();
+            Reconnect.Start(ipAddress, currentPort, DisconnectTime);
+        }
+    }
 }
 
-
-void mtsUniversalRobotScriptRT::GetPolyscopeVersion(std::string &pver)
+void mtsUniversalRobotScriptRT::ProcessPacket(const osaUniversalRobotDecodedPacket &packet)
 {
-    osaSocket socketDB;    // Dashboard Server
-    if (socketDB.Connect(ipAddress.c_str(), 29999)) {
-        std::cout << "Connected to Dashboard Server" << std::endl;
+    // RTDE packets do not have a version
+    if (packet.Version != osaUniversalRobotPacketDecoder::VER_UNKNOWN) {
+        const unsigned long expectedLength = osaUniversalRobotPacketDecoder::PacketLength[packet.Version];
+        if (packet.Length < expectedLength) {
+            debug[2] += 1;
+            debug[3] = packet.Length;
+        }
+        else if (packet.Length > expectedLength) {
+            debug[4] += 1;
+            debug[5] = packet.Length;
+        }
     }
-    else {
-        CMN_LOG_CLASS_INIT_ERROR << "Socket not connected to dashboard server" << std::endl;
+    // Decoding fails if the version is unknown or the packet is too short for the
+    // detected version (or does not match the RTDE recipe)
+    if (!packet.Decoded)
+        return;
+    if (packet.Version != osaUniversalRobotPacketDecoder::VER_UNKNOWN)
+        PacketVersion = packet.Version;
+    if (StartupTime[1] < 0.0) {
+        StartupTime[1] = osaUniversalRobotMonotonicTime() - StartupBeginTime;
+        std::stringstream message;
+        message << this->GetName() << ": first sample " << std::fixed << std::setprecision(1)
+                << 1000.0 * StartupTime[1] << " ms after Configure";
+        mInterface->SendStatus(message.str());
     }
 
-    SendAndReceive(socketDB, "PolyscopeVersion\n", pver);
-
-    std::vector<std::string> strings;
-    std::string s;
-    std::istringstream f(pver);
-    while (getline(f, s, '.')) {
-        strings.push_back(s);
+    // The new ControllerTime (Sample.Time) should be one controller period later than
+    // the previous value; gaps and duplicates are detected by the clock synchronization.
+    // RTDE packets only have a controller time if "timestamp" is in the outputs.
+    debug[0] = 1000.0 * (packet.Sample.Time - ControllerTime);
+    FrameStatus = osaUniversalRobotClockSync::FRAME_OK;
+    if (packet.Sample.Time > 0.0) {
+        FrameStatus = ClockSync.Update(packet.Sample.Time, packet.ReceiveTime);
+        ClockStatus.Assign(ClockSync.GetOffset(), ClockSync.GetDrift(), ClockSync.GetDelay(),
+                           ClockSync.GetJitter(), static_cast<double>(ClockSync.GetFramesDropped()),
+                           static_cast<double>(ClockSync.GetFramesDuplicated()));
     }
+    PublishSample(packet.Sample);
+    UpdateSample(packet);
+    PublishChanges(packet);
+    const double publishTime = osaUniversalRobotMonotonicTime();
+    LatencyMutex.Lock();
+    PublishLatency.Add(publishTime - packet.ReceiveTime);
+    LatencyMutex.Unlock();
+}
 
-    if (strings.size() != 3) {
-        std::cerr << "invalid version\n";
+void mtsUniversalRobotScriptRT::CloseSocket(void)
+{
+    if (Receiver) {
+        Receiver->Stop();
+        // Packets received before the error are stale once reconnected
+        osaUniversalRobotReceiver::QueueType &queue = Receiver->Queue();
+        while (queue.Front())
+            queue.Pop();
     }
-    else {
-        // FIXME: major in string is 3, however atoi returns 0
-        pversion.major = atoi(strings[0].c_str());
-        pversion.minor = atoi(strings[1].c_str());
-        pversion.bugfix = atoi(strings[2].c_str());
-        std::cout << "major = " << strings[0].c_str() << "  minor = " << strings[1] << "  bugfix = " << strings[2] << "\n";
+    if (RTDE)
+        RTDE->Close();
+    Framer.Reset();
+    SocketError();
+    socket.Close();
+    UR_State = UR_NOT_CONNECTED;
+    Trajectory.Clear();
+    Path.Clear();
+    // The program is aborted by the controller
+    MotionQueue.Clear();
+    UpdateMotionQueueStatus();
+    // Raise all the change events once reconnected
+    ChangesInitialized = false;
+    if (ReconnectEnabled) {
+        DisconnectTime = osaUniversalRobotMonotonicTime();
+        Reconnect.Start(ipAddress, currentPort, DisconnectTime);
     }
+}
 
-    socketDB.Close();
+void mtsUniversalRobotScriptRT::StartConnect(void)
+{
+    ConnectStatus = CONNECT_IN_PROGRESS;
+    ConnectThread.Create<mtsUniversalRobotScriptRT, void *>(this, &mtsUniversalRobotScriptRT::RunConnect,
+                                                            0, "URconnect");
+}
+
+void * mtsUniversalRobotScriptRT::RunConnect(void *)
+{
+    int status = CONNECT_FAILED;
+    // Probe first, so that an unreachable controller does not block the reconnection
+    // schedule, Cleanup or the destructor until the operating system timeout
+    if (osaUniversalRobotReconnect::Probe(ipAddress, currentPort, Reconnect.GetConnectTimeout())
+        && socket.Connect(ipAddress.c_str(), currentPort)) {
+        status = CONNECT_OK;
+        // The data received until Run starts is flushed by StartReceiving
+        if (RTDE && (!ConnectRTDE() || !RTDE->Start()))
+            status = CONNECT_RTDE_FAILED;
+    }
+    ConnectStatus = status;
+    return 0;
+}
+
+int mtsUniversalRobotScriptRT::FinishConnect(double timeout)
+{
+    const double deadline = osaUniversalRobotMonotonicTime() + timeout;
+    while ((ConnectStatus == CONNECT_IN_PROGRESS) && (osaUniversalRobotMonotonicTime() < deadline))
+        osaSleep(1.0 * cmn_ms);
+    const int status = ConnectStatus;
+    if ((status != CONNECT_NONE) && (status != CONNECT_IN_PROGRESS)) {
+        ConnectThread.Wait();
+        ConnectStatus = CONNECT_NONE;
+    }
+    return status;
+}
+
+void mtsUniversalRobotScriptRT::TryReconnect(void)
+{
+    const double now = osaUniversalRobotMonotonicTime();
+    switch (FinishConnect()) {
+
+    case CONNECT_IN_PROGRESS:
+        break;
+
+    case CONNECT_OK:
+        {
+            Reconnect.Stop();
+            UR_State = UR_IDLE;
+            // Keep the firmware version and statistics unless the packet length changed
+            Decoder.Resynchronize();
+            StartReceiving();
+            if (StartupTime[0] < 0.0)
+                StartupTime[0] = now - StartupBeginTime;
+            const double recovery = now - DisconnectTime;
+            LatencyMutex.Lock();
+            RecoveryTime.Add(recovery);
+            LatencyMutex.Unlock();
+            ReconnectedEvent(recovery);
+            std::stringstream message;
+            message << this->GetName() << ": reconnected to " << ipAddress << " after "
+                    << std::fixed << std::setprecision(2) << recovery << " s";
+            mInterface->SendStatus(message.str());
+        }
+        break;
+
+    case CONNECT_FAILED:
+    case CONNECT_RTDE_FAILED:
+        if (RTDE)
+            RTDE->Close();
+        socket.Close();
+        if (Reconnect.IsActive())
+            Reconnect.Retry(now);
+        break;
+
+    default:
+        // No attempt in progress
+        if (Reconnect.Poll(now) == osaUniversalRobotReconnect::STARTED) {
+            ReconnectAttemptEvent(static_cast<int>(Reconnect.GetAttempts()));
+            CMN_LOG_CLASS_RUN_VERBOSE << "TryReconnect: attempt " << Reconnect.GetAttempts()
+                                      << " to " << ipAddress << std::endl;
+            StartConnect();
+        }
+        break;
+    }
+}
+
+void mtsUniversalRobotScriptRT::ReportFramerResyncs(const osaUniversalRobotStreamFramer::Statistics &stats,
+                                                    unsigned long numBytes)
+{
+    // The framer resynchronizes on the next valid header; report the invalid data
+    if (stats.Resyncs != FramerResyncs) {
+        FramerResyncs = stats.Resyncs;
+        PacketInvalid(vctULong2(numBytes, stats.LastInvalidLength));
+        mInterface->SendError(this->GetName() + ": invalid package");
+    }
+}
+
+int mtsUniversalRobotScriptRT::ReceiveFromSocket(void)
+{
+    // Receive all available data with timeout. We choose a timeout of 500 msec, which is
+    // much larger than expected (should get packets every 8 msec). Thus, if we don't get
+    // any data, then we raise the ReceiveTimeout event.
+    // Do not wait if a packet is already buffered (see StartReceiving)
+    int numBytes = Framer.Receive(socket, Framer.HasFrame() ? 0.0 : 0.5 * cmn_s);
+    const double receiveTime = osaUniversalRobotMonotonicTime();
+    if (numBytes < 0) {
+        CloseSocket();
+        return 0;
+    }
+    else if ((numBytes == 0) && !Framer.HasFrame()) {
+        ReceiveTimeout();
+        return 0;
+    }
+
+    // Process all complete packets (or only the newest one, depending on the frame policy).
+    // The state table is advanced after each packet so that no sample is overwritten.
+    int numPackets = 0;
+    const char *frame;
+    unsigned long length;
+    while (Framer.NextFrame(frame, length)) {
+        Decoder.DecodePacket(frame, length, Packet);
+        Packet.ReceiveTime = receiveTime;
+        Packet.DecodeTime = osaUniversalRobotMonotonicTime();
+        for (size_t i = 0; i < FrameSinks.size(); i++)
+            FrameSinks[i]->Frame(frame, length, receiveTime);
+        ProcessPacket(Packet);
+        // Advance the state table now, so that any connected components can get
+        // the latest data.
+        AdvanceStateTable();
+        numPackets++;
+    }
+    ReportFramerResyncs(Framer.GetStatistics(), static_cast<unsigned long>(numBytes));
+    return numPackets;
+}
+
+int mtsUniversalRobotScriptRT::ReceiveFromThread(void)
+{
+    // Same timeout as when receiving directly from the socket
+    if (!Receiver->WaitForPackets(0.5 * cmn_s)) {
+        if (Receiver->SocketErrorOccurred())
+            CloseSocket();
+        else
+            ReceiveTimeout();
+        return 0;
+    }
+
+    int numPackets = 0;
+    osaUniversalRobotReceiver::QueueType &queue = Receiver->Queue();
+    const osaUniversalRobotDecodedPacket *packet;
+    while ((packet = queue.Front()) != 0) {
+        // The receive thread queues the packets as soon as they are decoded
+        const double queueLatency = osaUniversalRobotMonotonicTime() - packet->DecodeTime;
+        LatencyMutex.Lock();
+        QueueLatency.Add(queueLatency);
+        LatencyMutex.Unlock();
+        ProcessPacket(*packet);
+        queue.Pop();
+        AdvanceStateTable();
+        numPackets++;
+    }
+    // The framer belongs to the receive thread, use its copy of the statistics
+    osaUniversalRobotStreamFramer::Statistics stats;
+    unsigned long bytesBuffered;
+    Receiver->GetFramerStatistics(stats, bytesBuffered);
+    ReportFramerResyncs(stats, bytesBuffered);
+    return numPackets;
+}
+
+int mtsUniversalRobotScriptRT::ReceiveFromRTDE(void)
+{
+    // Port 30003 is only used for commands; discard the data it sends so that the
+    // socket buffers do not fill up
+    int discarded;
+    do {
+        discarded = Framer.Receive(socket, 0.0);
+        Framer.Reset();
+    } while (discarded > 0);
+    if (discarded < 0) {
+        CloseSocket();
+        return 0;
+    }
+
+    // Same timeout as port 30003, although RTDE packets are usually more frequent
+    int numBytes = RTDE->Receive(0.5 * cmn_s);
+    const double receiveTime = osaUniversalRobotMonotonicTime();
+    if (numBytes < 0) {
+        CloseSocket();
+        return 0;
+    }
+    else if (numBytes == 0) {
+        ReceiveTimeout();
+        return 0;
+    }
+
+    int numPackets = 0;
+    while (RTDE->NextPacket(Packet)) {
+        Packet.ReceiveTime = receiveTime;
+        Packet.DecodeTime = osaUniversalRobotMonotonicTime();
+        ProcessPacket(Packet);
+        AdvanceStateTable();
+        numPackets++;
+    }
+    return numPackets;
+}
+
+int mtsUniversalRobotScriptRT::ReceiveFromReplay(void)
+{
+    osaUniversalRobotReplay::Frame frame;
+    if (!Replay->Front(frame)) {
+        if (ReplayLoop && (Replay->GetNumberOfFrames() > 0)) {
+            Replay->Rewind();
+            ReplayStartTime = -1.0;
+        }
+        else {
+            if (ReplayStartTime >= 0.0) {
+                mInterface->SendStatus(this->GetName() + ": end of recording");
+                ReplayStartTime = -1.0;
+            }
+            Sleep(0.008 * cmn_s);
+        }
+        return 0;
+    }
+
+    double now = osaUniversalRobotMonotonicTime();
+    if (ReplayStartTime < 0.0) {
+        ReplayStartTime = now;
+        ReplayFirstTime = frame.ReceiveTime;
+    }
+    // Wait until the frame is due, as the socket would (but process commands at least
+    // every 0.5 s, in case of a gap in the recording)
+    if (ReplaySpeed > 0.0) {
+        const double due = ReplayStartTime + (frame.ReceiveTime - ReplayFirstTime) / ReplaySpeed;
+        if (due > now) {
+            Sleep(std::min(due - now, 0.5 * cmn_s));
+            now = osaUniversalRobotMonotonicTime();
+            if (due > now)
+                return 0;
+        }
+    }
+
+    // Frames received together are replayed together
+    int numPackets = 0;
+    const double receiveTime = frame.ReceiveTime;
+    while (Replay->Front(frame) && (frame.ReceiveTime == receiveTime)) {
+        Decoder.DecodePacket(frame.Data, frame.Length, Packet);
+        // Export with the original receive time, e.g., to convert a recording
+        if (Telemetry)
+            Telemetry->Frame(frame.Data, frame.Length, frame.ReceiveTime);
+        Packet.ReceiveTime = now;
+        Packet.DecodeTime = osaUniversalRobotMonotonicTime();
+        ProcessPacket(Packet);
+        AdvanceStateTable();
+        Replay->Pop();
+        numPackets++;
+    }
+    return numPackets;
+}
+
+void mtsUniversalRobotScriptRT::Run(void)
+{
+    if (Dashboard)
+        RunDashboard();
+    if (Secondary)
+        RunSecondary();
+
+    if (UR_State == UR_NOT_CONNECTED) {
+        // The connection attempt made by Configure may not be finished yet
+        if ((ConnectStatus != CONNECT_NONE) || (ReconnectEnabled && Reconnect.IsActive()))
+            TryReconnect();
+        // Call any connected components
+        RunEvent();
+        ProcessQueuedCommands();
+        AdvanceStateTable();
+        Sleep(0.008 * cmn_s);
+        return;
+    }
+
+    // Get new packets, either directly from the socket or from the receive thread
+    int numPackets;
+    if (Replay)
+        numPackets = ReceiveFromReplay();
+    else if (RTDE)
+        numPackets = ReceiveFromRTDE();
+    else
+        numPackets = Receiver ? ReceiveFromThread() : ReceiveFromSocket();
+    if (numPackets == 0) {
+        // Socket error, timeout, or only part of a packet received so far; the
+        // statistics and the state changed by the commands are still published
+        RunEvent();
+        ProcessQueuedCommands();
+        AdvanceStateTable();
+        return;
+    }
+
+    // Call any connected components
+    RunEvent();
+
+    ProcessQueuedCommands();
+
+    switch (UR_State) {
+
+    case UR_IDLE:
+        break;
+
+    case UR_VEL_MOVING:
+        VelCmdTimeout--;
+        if (VelCmdTimeout <= 0) {
+            SendCommand(VelCmdStop);
+            UR_State = UR_IDLE;
+        }
+        else
+            SendCommand(VelCmd);
+        break;
+
+    case UR_FREE_DRIVE:
+        break;
+
+    case UR_POS_MOVING:
+        if (!MotionQueue.Empty())
+            RunMotionQueue();
+        else if (JointVel.Norm() == 0.0)
+            UR_State = UR_IDLE;
+        break;
+
+    case UR_POWERING_ON:
+        break;
+
+    case UR_SERVO:
+        // Setpoints are sent by the trajectory or by the servo commands; the servo
+        // program stops the robot if they are not updated
+        if (Trajectory.IsActive())
+            RunTrajectory();
+        else if (Path.IsActive())
+            RunPath();
+        break;
+
+    case UR_POWERING_OFF:
+        break;
+
+    default:
+        CMN_LOG_CLASS_RUN_ERROR << "Run: unknown state = " << UR_State << std::endl;
+    }
+}
+
+void mtsUniversalRobotScriptRT::PublishSample(const osaUniversalRobotSample &sample)
+{
+    ControllerTime = sample.Time;
+    JointPos.Assign(sample.JointPosition);
+    JointPosParam.SetPosition(JointPos);
+    JointTargetPos.Assign(sample.JointTargetPosition);
+    JointVel.Assign(sample.JointVelocity);
+    JointVelParam.SetVelocity(JointVel);
+    JointTargetVel.Assign(sample.JointTargetVelocity);
+    JointEffort.Assign(sample.JointCurrent);
+    JointTargetEffort.Assign(sample.JointTargetCurrent);
+
+    JointState.Position().Assign(JointPos);
+    JointState.Velocity().Assign(JointVel);
+    JointState.Effort().Assign(JointEffort);
+
+    // Following is documented to be "controller realtime thread execution time"
+    // Not sure what this is, or what are the units
+    ControllerExecTime = sample.ControllerExecTime;
+    debug[1] = ControllerExecTime;
+
+    // Rotation matrix, from world frame to the end-effector frame; only computed
+    // when the pose changed
+    if (PoseActual.Update(sample.ToolVector))
+        SetPosition(PoseActual.Translation(), PoseActual.Rotation(), CartPos);
+    if (PoseDesired.Update(sample.ToolTargetVector))
+        SetPosition(PoseDesired.Translation(), PoseDesired.Rotation(), CartPosDesired);
+
+    // Host-side kinematics of the configured model, including the tool offset
+    if (Kinematics.IsValid()) {
+        Kinematics.Update(sample.JointPosition);
+        SetPosition(Kinematics.Translation(), Kinematics.Rotation(), CartPosKinematics);
+        const double *jacobian = Kinematics.Jacobian();
+        for (size_t row = 0; row < 6; row++)
+            for (size_t column = 0; column < 6; column++)
+                JacobianSpatial.Element(row, column) = jacobian[6*row + column];
+    }
+
+    TCPSpeed.Assign(sample.TCPSpeed);
+    CartVelParam.SetVelocityLinear(vct3(sample.TCPSpeed));
+    CartVelParam.SetVelocityAngular(vct3(sample.TCPSpeed+3));
+    CartVelDesiredParam.SetVelocityLinear(vct3(sample.TCPTargetSpeed));
+    CartVelDesiredParam.SetVelocityAngular(vct3(sample.TCPTargetSpeed+3));
+    TCPForce.Assign(sample.TCPForce);
+    WrenchGet.SetForce(TCPForce);
+}
+
+void mtsUniversalRobotScriptRT::SetPosition(const double *translation, const double *rotation,
+                                            prmPositionCartesianGet &position)
+{
+    vctFrm3 &frame = position.Position();
+    for (size_t row = 0; row < 3; row++) {
+        frame.Translation().Element(row) = translation[row];
+        for (size_t column = 0; column < 3; column++)
+            frame.Rotation().Element(row, column) = rotation[3*row + column];
+    }
+}
+
+void mtsUniversalRobotScriptRT::UpdateSample(const osaUniversalRobotDecodedPacket &packet)
+{
+    SampleRecord record;
+    record.Index = SampleHistoryLatest.load(std::memory_order_relaxed) + 1;
+    record.Version = packet.Version;
+    record.FrameStatus = FrameStatus;
+    record.ReceiveTime = packet.ReceiveTime;
+    record.HostTime = ClockSync.IsSynchronized() ? ClockSync.ToHost(packet.Sample.Time) : packet.ReceiveTime;
+    record.Data = packet.Sample;
+    RecordToSample(record, Sample);
+
+    // Write the record, then publish it
+    unsigned long long words[SAMPLE_RECORD_WORDS];
+    memcpy(words, &record, sizeof(words));
+    SampleSlot &slot = SampleHistory[record.Index % SampleHistorySize];
+    const unsigned long long sequence = slot.Sequence.load(std::memory_order_relaxed);
+    slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < SAMPLE_RECORD_WORDS; i++)
+        slot.Words[i].store(words[i], std::memory_order_relaxed);
+    slot.Sequence.store(sequence + 2, std::memory_order_release);
+    SampleHistoryLatest.store(record.Index, std::memory_order_release);
+}
+
+void mtsUniversalRobotScriptRT::RecordToSample(const SampleRecord &record, mtsUniversalRobotSample &sample)
+{
+    const osaUniversalRobotSample &data = record.Data;
+    sample.Index = record.Index;
+    sample.Version = static_cast<int>(record.Version);
+    sample.ReceiveTime = record.ReceiveTime;
+    sample.FrameStatus = static_cast<int>(record.FrameStatus);
+    sample.HostTime = record.HostTime;
+    sample.ControllerTime = data.Time;
+    sample.ControllerExecTime = data.ControllerExecTime;
+    sample.RobotMode = data.RobotMode;
+    sample.SafetyMode = data.SafetyMode;
+    sample.ProgramState = data.ProgramState;
+    sample.DigitalInputs = data.DigitalInputs;
+    sample.DigitalOutputs = data.DigitalOutputs;
+    sample.SpeedScaling = data.SpeedScaling;
+    sample.PositionJoint.Assign(data.JointPosition);
+    sample.VelocityJoint.Assign(data.JointVelocity);
+    sample.CurrentJoint.Assign(data.JointCurrent);
+    sample.PositionJointDesired.Assign(data.JointTargetPosition);
+    sample.VelocityJointDesired.Assign(data.JointTargetVelocity);
+    sample.AccelerationJointDesired.Assign(data.JointTargetAcceleration);
+    sample.CurrentJointDesired.Assign(data.JointTargetCurrent);
+    sample.TorqueJointDesired.Assign(data.JointTargetTorque);
+    sample.ControlCurrentJoint.Assign(data.JointControlCurrent);
+    sample.TemperatureJoint.Assign(data.MotorTemperature);
+    sample.VoltageJoint.Assign(data.JointVoltage);
+    sample.ModeJoint.Assign(data.JointMode);
+    sample.PoseCartesian.Assign(data.ToolVector);
+    sample.VelocityCartesian.Assign(data.TCPSpeed);
+    sample.ForceCartesian.Assign(data.TCPForce);
+    sample.PoseCartesianDesired.Assign(data.ToolTargetVector);
+    sample.VelocityCartesianDesired.Assign(data.TCPTargetSpeed);
+    sample.ToolAccelerometer.Assign(data.ToolAccelerometer);
+    sample.LinearMomentumNorm = data.LinearMomentumNorm;
+    sample.VoltageMain = data.MainVoltage;
+    sample.VoltageRobot = data.RobotVoltage;
+    sample.CurrentRobot = data.RobotCurrent;
+}
+
+bool mtsUniversalRobotScriptRT::ReadSampleRecord(unsigned long long index, SampleRecord &record) const
+{
+    // A slot is only written again with a newer sample, so the copy fails instead of
+    // retrying if it overlaps a write
+    const SampleSlot &slot = SampleHistory[index % SampleHistorySize];
+    const unsigned long long sequence = slot.Sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+        return false;
+    unsigned long long words[SAMPLE_RECORD_WORDS];
+    for (size_t i = 0; i < SAMPLE_RECORD_WORDS; i++)
+        words[i] = slot.Words[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.Sequence.load(std::memory_order_relaxed) != sequence)
+        return false;
+    memcpy(&record, words, sizeof(words));
+    return (record.Index == index);
+}
+
+void mtsUniversalRobotScriptRT::LatestJointPosition(double position[6]) const
+{
+    // The read only fails if the task wrote a full history of samples meanwhile
+    SampleRecord record;
+    while (!ReadSampleRecord(SampleHistoryLatest.load(std::memory_order_acquire), record)) {}
+    memcpy(position, record.Data.JointPosition, sizeof(record.Data.JointPosition));
+}
+
+void mtsUniversalRobotScriptRT::UpdateFramingStatistics(void)
+{
+    // Keep the last values while not connected, RTDE may be in use by the connection thread
+    if (UR_State == UR_NOT_CONNECTED)
+        return;
+    osaUniversalRobotStreamFramer::Statistics stats;
+    if (Receiver && Receiver->IsRunning()) {
+        unsigned long bytesBuffered;
+        Receiver->GetFramerStatistics(stats, bytesBuffered);
+    }
+    else
+        stats = RTDE ? RTDE->GetFramer().GetStatistics() : Framer.GetStatistics();
+    FramingStatistics.Assign(stats.FramesReceived, stats.FramesDelivered,
+                             stats.FramesCoalesced, stats.FramesDropped,
+                             stats.Resyncs, stats.BytesDiscarded);
+}
+
+void mtsUniversalRobotScriptRT::AdvanceStateTable(void)
+{
+    UpdateFramingStatistics();
+    StateTable.Advance();
+    // Packets that could not be decoded do not update the sample
+    if (Snapshot && (Sample.Index != SnapshotIndex))
+        PublishSnapshot();
+}
+
+void mtsUniversalRobotScriptRT::PublishSnapshot(void)
+{
+    osaUniversalRobotSnapshotData data;
+    data.Index = Sample.Index;
+    data.ControllerTime = Sample.ControllerTime;
+    data.HostTime = Sample.HostTime;
+    data.ReceiveTime = Sample.ReceiveTime;
+    for (size_t i = 0; i < 6; i++) {
+        data.JointPosition[i] = Sample.PositionJoint[i];
+        data.JointVelocity[i] = Sample.VelocityJoint[i];
+        data.JointEffort[i] = Sample.CurrentJoint[i];
+        data.ToolPose[i] = Sample.PoseCartesian[i];
+        data.ToolSpeed[i] = Sample.VelocityCartesian[i];
+        data.ToolForce[i] = Sample.ForceCartesian[i];
+    }
+    const double *rotation = PoseActual.Rotation();
+    for (size_t i = 0; i < 9; i++)
+        data.ToolRotation[i] = rotation[i];
+    data.RobotMode = Sample.RobotMode;
+    data.SafetyMode = Sample.SafetyMode;
+    Snapshot->Publish(data);
+    SnapshotIndex = Sample.Index;
+}
+
+// Names of the robot modes (see RobotModes) and safety modes, for the status messages
+static const char * RobotModeName(int mode)
+{
+    static const char *names[] = { "DISCONNECTED", "CONFIRM_SAFETY", "BOOTING", "POWER_OFF", "POWER_ON",
+                                   "IDLE", "BACKDRIVE", "RUNNING", "UPDATING_FIRMWARE" };
+    return ((mode >= 0) && (mode < 9)) ? names[mode] : "UNKNOWN";
+}
+
+static const char * SafetyModeName(int mode)
+{
+    static const char *names[] = { "UNKNOWN", "NORMAL", "REDUCED", "PROTECTIVE_STOP", "RECOVERY",
+                                   "SAFEGUARD_STOP", "SYSTEM_EMERGENCY_STOP", "ROBOT_EMERGENCY_STOP",
+                                   "VIOLATION", "FAULT" };
+    return ((mode >= 0) && (mode < 10)) ? names[mode] : "UNKNOWN";
+}
+
+void mtsUniversalRobotScriptRT::PublishChanges(const osaUniversalRobotDecodedPacket &packet)
+{
+    // Discrete values, compared every sample (fields that are not received stay 0)
+    const osaUniversalRobotSample &sample = packet.Sample;
+    const int robotMode = static_cast<int>(sample.RobotMode);
+    if (!ChangesInitialized || (robotMode != LastRobotMode)) {
+        LastRobotMode = robotMode;
+        RobotModeChangedEvent(robotMode);
+        mInterface->SendStatus(this->GetName() + ": robot mode " + RobotModeName(robotMode));
+    }
+    const int safetyMode = static_cast<int>(sample.SafetyMode);
+    if (!ChangesInitialized || (safetyMode != LastSafetyMode)) {
+        LastSafetyMode = safetyMode;
+        SafetyModeChangedEvent(safetyMode);
+        // 0 if the firmware does not send it
+        if (safetyMode > 1)
+            mInterface->SendWarning(this->GetName() + ": safety mode " + SafetyModeName(safetyMode));
+        else if (ChangesInitialized)
+            mInterface->SendStatus(this->GetName() + ": safety mode " + SafetyModeName(safetyMode));
+    }
+    const int programState = static_cast<int>(sample.ProgramState);
+    if (!ChangesInitialized || (programState != LastProgramState)) {
+        LastProgramState = programState;
+        ProgramStateChangedEvent(programState);
+    }
+    bool jointModesChanged = !ChangesInitialized;
+    for (size_t joint = 0; joint < NB_Actuators; joint++) {
+        const int mode = static_cast<int>(sample.JointMode[joint]);
+        if (mode != LastJointModes[joint]) {
+            LastJointModes[joint] = mode;
+            jointModesChanged = true;
+        }
+    }
+    if (jointModesChanged)
+        JointModesChangedEvent(LastJointModes);
+    const unsigned long inputs = static_cast<unsigned long>(sample.DigitalInputs);
+    const unsigned long outputs = static_cast<unsigned long>(sample.DigitalOutputs);
+    if (!ChangesInitialized || (inputs != LastDigitalIO[0]) || (outputs != LastDigitalIO[1])) {
+        LastDigitalIO[0] = inputs;
+        LastDigitalIO[1] = outputs;
+        DigitalIOChangedEvent(LastDigitalIO);
+    }
+
+    // Significant motions, from the state table entries
+    const double time = packet.ReceiveTime;
+    if (MotionJointThreshold > 0.0) {
+        bool moved = !ChangesInitialized
+            || ((MotionMaximumPeriod > 0.0) && (time - MotionJointTime >= MotionMaximumPeriod));
+        for (size_t joint = 0; !moved && (joint < NB_Actuators); joint++)
+            moved = (std::fabs(JointPos[joint] - MotionJointPosition[joint]) > MotionJointThreshold);
+        if (moved) {
+            MotionJointPosition.Assign(JointPos);
+            MotionJointTime = time;
+            JointMotionEvent(JointState);
+        }
+    }
+    if ((MotionLinearThreshold > 0.0) || (MotionAngularThreshold > 0.0)) {
+        const vctFrm3 &pose = CartPos.Position();
+        bool moved = !ChangesInitialized
+            || ((MotionMaximumPeriod > 0.0) && (time - MotionCartesianTime >= MotionMaximumPeriod));
+        if (!moved && (MotionLinearThreshold > 0.0))
+            moved = ((pose.Translation() - MotionCartesianPosition.Translation()).Norm() > MotionLinearThreshold);
+        if (!moved && (MotionAngularThreshold > 0.0)) {
+            // Angle of the rotation between the poses, from the trace of R0^T R
+            double trace = 0.0;
+            for (size_t row = 0; row < 3; row++)
+                for (size_t column = 0; column < 3; column++)
+                    trace += pose.Rotation().Element(row, column)
+                        * MotionCartesianPosition.Rotation().Element(row, column);
+            moved = (0.5 * (trace - 1.0) < std::cos(MotionAngularThreshold));
+        }
+        if (moved) {
+            MotionCartesianPosition.Assign(pose);
+            MotionCartesianTime = time;
+            CartesianMotionEvent(CartPos);
+        }
+    }
+    ChangesInitialized = true;
+}
+
+void mtsUniversalRobotScriptRT::GetSamplesSince(const unsigned long long &index,
+                                                mtsUniversalRobotSamples &samples) const
+{
+    samples.Samples.clear();
+    samples.Missed = 0;
+    const unsigned long long latest = SampleHistoryLatest.load(std::memory_order_acquire);
+    if (index >= latest)
+        return;
+    unsigned long long first = index + 1;
+    if (latest - index > SampleHistorySize)
+        first = latest - SampleHistorySize + 1;
+    samples.Samples.reserve(static_cast<size_t>(latest - first + 1));
+    // The oldest samples may be overwritten by the next ones while we copy
+    SampleRecord record;
+    unsigned long long numOverwritten = 0;
+    for (unsigned long long i = first; i <= latest; i++) {
+        if (ReadSampleRecord(i, record)) {
+            samples.Samples.resize(samples.Samples.size() + 1);
+            RecordToSample(record, samples.Samples.back());
+        }
+        else
+            numOverwritten++;
+    }
+    samples.Missed = (first - (index + 1)) + numOverwritten;
+}
+
+void mtsUniversalRobotScriptRT::InverseKinematics(const vctFrm3 &pose, vctDoubleVec &jointPosition) const
+{
+    double rotation[9];
+    double translation[3];
+    for (size_t row = 0; row < 3; row++) {
+        translation[row] = pose.Translation()[row];
+        for (size_t column = 0; column < 3; column++)
+            rotation[3*row + column] = pose.Rotation().Element(row, column);
+    }
+    KinematicsMutex.Lock();
+    const osaUniversalRobotKinematics kinematics(InverseKinematicsModel);
+    KinematicsMutex.Unlock();
+    double seed[6];
+    LatestJointPosition(seed);
+    double q[6];
+    if (kinematics.Inverse(rotation, translation, seed, q)) {
+        jointPosition.SetSize(NB_Actuators);
+        jointPosition.Assign(q);
+    }
+    else
+        jointPosition.SetSize(0);
+}
+
+void mtsUniversalRobotScriptRT::InverseKinematicsBatch(const vctDoubleMat &poses,
+                                                       vctDoubleMat &jointPositions) const
+{
+    const size_t numPoses = poses.rows();
+    jointPositions.SetSize(numPoses, NB_Actuators);
+    if (numPoses == 0)
+        return;
+    KinematicsMutex.Lock();
+    const osaUniversalRobotKinematics kinematics(InverseKinematicsModel);
+    KinematicsMutex.Unlock();
+    if ((poses.cols() != 6) || !kinematics.IsValid()) {
+        jointPositions.SetAll(std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+    osaUniversalRobotInverseKinematicsBatch batch(InverseKinematicsThreads);
+    batch.Resize(numPoses);
+    for (size_t component = 0; component < 6; component++) {
+        double *values = batch.Pose(component);
+        for (size_t i = 0; i < numPoses; i++)
+            values[i] = poses.Element(i, component);
+    }
+    double seed[6];
+    LatestJointPosition(seed);
+    batch.Solve(kinematics, seed);
+    for (size_t joint = 0; joint < NB_Actuators; joint++) {
+        const double *values = batch.Joint(joint);
+        for (size_t i = 0; i < numPoses; i++)
+            jointPositions.Element(i, joint) = batch.Reachable()[i] ? values[i]
+                : std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+void mtsUniversalRobotScriptRT::Cleanup(void)
+{
+    if (ConnectStatus != CONNECT_NONE) {
+        ConnectThread.Wait();
+        ConnectStatus = CONNECT_NONE;
+    }
+    if (Receiver)
+        Receiver->Stop();
+    if (Dashboard)
+        Dashboard->Stop();
+    if (Secondary)
+        Secondary->Stop();
+    // Write the last rows
+    if (Telemetry)
+        Telemetry->Close();
+}
+
+// Summary of a latency histogram: number of samples, 50th, 99th and 99.9th percentiles, and
+// maximum (in seconds)
+static void LatencySummary(const osaUniversalRobotLatencyHistogram &histogram, vctDoubleVec &summary)
+{
+    summary.SetSize(5);
+    summary[0] = static_cast<double>(histogram.Count());
+    summary[1] = histogram.Percentile(0.5);
+    summary[2] = histogram.Percentile(0.99);
+    summary[3] = histogram.Percentile(0.999);
+    summary[4] = histogram.Maximum();
+}
+
+void mtsUniversalRobotScriptRT::GetQueueLatency(vctDoubleVec &latency) const
+{
+    LatencyMutex.Lock();
+    LatencySummary(QueueLatency, latency);
+    LatencyMutex.Unlock();
+}
+
+void mtsUniversalRobotScriptRT::GetPublishLatency(vctDoubleVec &latency) const
+{
+    LatencyMutex.Lock();
+    LatencySummary(PublishLatency, latency);
+    LatencyMutex.Unlock();
+}
+
+void mtsUniversalRobotScriptRT::GetRecoveryTime(vctDoubleVec &recovery) const
+{
+    LatencyMutex.Lock();
+    LatencySummary(RecoveryTime, recovery);
+    LatencyMutex.Unlock();
+}
+
+void mtsUniversalRobotScriptRT::GetReceiverStatistics(vctULong3 &stats) const
+{
+    if (Receiver)
+        stats.Assign(Receiver->GetWakeups(), Receiver->GetPacketsQueued(), Receiver->GetOverflows());
+    else
+        stats.SetAll(0);
+}
+
+void mtsUniversalRobotScriptRT::SetInputDoubleRegisters(const vctDoubleVec &values)
+{
+    // RTDE may be in use by the connection thread
+    if (UR_State == UR_NOT_CONNECTED) {
+        SocketError();
+        return;
+    }
+    if (!RTDE || (RTDEInputRecipe < 0)) {
+        mInterface->SendWarning(this->GetName() + ": RTDE input registers not configured");
+        return;
+    }
+    if (values.size() != RTDEInputDoubleRegisters) {
+        mInterface->SendWarning(this->GetName() + ": SetInputDoubleRegisters, wrong number of values");
+        return;
+    }
+    if (!RTDE->SendInputs(RTDEInputRecipe, values.Pointer(), values.size()))
+        SocketError();
+}
+
+void mtsUniversalRobotScriptRT::SocketError(void)
+{
+    SocketErrorEvent();
+    mInterface->SendError(this->GetName() + ": socket error, IP: " + ipAddress);
+}
+
+void mtsUniversalRobotScriptRT::RobotNotReady(void)
+{
+    RobotNotReadyEvent();
+    mInterface->SendWarning(this->GetName() + ": robot not ready");
+}
+
+void mtsUniversalRobotScriptRT::ReceiveTimeout(void)
+{
+    ReceiveTimeoutEvent();
+    mInterface->SendError(this->GetName() + ": socket timeout");
+}
+
+
+bool mtsUniversalRobotScriptRT::SendCommand(const osaUniversalRobotCommandEncoder &command)
+{
+    return SendCommand(command.Data(), command.Length());
+}
+
+bool mtsUniversalRobotScriptRT::SendCommand(const char *script)
+{
+    return SendCommand(script, strlen(script));
+}
+
+bool mtsUniversalRobotScriptRT::SendCommand(const std::string &script)
+{
+    return SendCommand(script.c_str(), script.size());
+}
+
+bool mtsUniversalRobotScriptRT::SendCommand(const char *data, size_t length)
+{
+    // No controller to send to
+    if (Replay)
+        return true;
+    // The socket may be in use by the connection thread
+    if (UR_State == UR_NOT_CONNECTED) {
+        SocketError();
+        return false;
+    }
+    if (socket.Send(data, static_cast<unsigned int>(length)) == -1) {
+        SocketError();
+        return false;
+    }
+    return true;
+}
+
+void mtsUniversalRobotScriptRT::SetRobotFreeDriveMode(void)
+{
+    if (UR_State == UR_IDLE) {
+        bool sent;
+        if (PacketVersion < osaUniversalRobotPacketDecoder::VER_30_31) {
+            sent = SendCommand("set robotmode freedrive\n");
+        } else {
+            sent = SendCommand("def saw_ur_freedrive():\n\tfreedrive_mode()\nsleep(20)\nend\n");
+        }
+
+        if (sent) {
+            UR_State = UR_FREE_DRIVE;
+            mInterface->SendStatus(this->GetName() + ": set freedrive mode");
+        }
+    }
+    else
+        RobotNotReady();   // if not idle, ignore command and raise event
+}
+
+void mtsUniversalRobotScriptRT::SetRobotRunningMode(void)
+{
+    if (UR_State == UR_FREE_DRIVE) {
+        bool sent;
+        if (PacketVersion < osaUniversalRobotPacketDecoder::VER_30_31) {
+            sent = SendCommand("set robotmode run\n");
+        } else {
+            sent = SendCommand("end_freedrive_mode()\n");
+        }
+
+        if (sent) {
+            UR_State = UR_IDLE;
+            mInterface->SendStatus(this->GetName() + ": set running mode");
+        }
+    }
+    else
+        RobotNotReady();   // if not idle, ignore command and raise event
+}
+
+void mtsUniversalRobotScriptRT::DisableMotorPower(void)
+{
+    SendCommand("powerdown()\n");
+}
+
+void mtsUniversalRobotScriptRT::JointVelocityMove(const prmVelocityJointSet &jtvelSet)
+{
+    if ((UR_State == UR_IDLE) || (UR_State == UR_VEL_MOVING)) {
+        const vctDoubleVec &goal = jtvelSet.Goal();
+        if (goal.size() != NB_Actuators) {
+            mInterface->SendError(this->GetName() + ": JointVelocityMove, invalid size");
+            return;
+        }
+        double jtvel[NB_Actuators];
+        // velocity check
+        for (int i = 0; i < NB_Actuators; i++) {
+            jtvel[i] = goal[i];
+            if (jtvel[i] > 0) {
+                if (jtvel[i] < MIN_VELOCITY)
+                    jtvel[i] = MIN_VELOCITY;
+                else if (jtvel[i] > MAX_VELOCITY)
+                    jtvel[i] = MAX_VELOCITY;
+            }
+            else {
+                if (jtvel[i] > -MIN_VELOCITY)
+                    jtvel[i] = -MIN_VELOCITY;
+                else if (jtvel[i] < -MAX_VELOCITY)
+                    jtvel[i] = -MAX_VELOCITY;
+            }
+        }
+        // speedj(qd, a, t)
+        if (!VelCmd.SpeedJ(jtvel, 1.4, 0.0)) {
+            mInterface->SendError(this->GetName() + ": JointVelocityMove, invalid velocity");
+            return;
+        }
+        const double zero[NB_Actuators] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        VelCmdStop.SpeedJ(zero, 1.4, 0.0);
+        VelCmdTimeout = 100;   // Number of cycles for command to remain valid
+        UR_State = UR_VEL_MOVING;
+    }
+    else
+        RobotNotReady();
+}
+
+void mtsUniversalRobotScriptRT::JointPositionMove(const prmPositionJointSet &jtposSet)
+{
+    if ((ServoRecipe >= 0) && ((UR_State == UR_IDLE) || (UR_State == UR_SERVO))) {
+        // Trajectory generated on the host, with the default limits
+        mtsUniversalRobotJointTrajectory trajectory;
+        const vctDoubleVec &jtpos = jtposSet.Goal();
+        if (jtpos.size() != NB_Actuators) {
+            mInterface->SendError(this->GetName() + ": JointPositionMove, invalid position");
+            return;
+        }
+        trajectory.Waypoints.push_back(vctDouble6(jtpos.Pointer()));
+        TrajectoryJoint(trajectory);
+    }
+    else if (UR_State == UR_IDLE) {
+        const vctDoubleVec &jtpos = jtposSet.Goal();
+        // Without servo mode, we issue a movej command
+        if ((jtpos.size() != NB_Actuators) || !PosCmd.MoveJ(jtpos.Pointer(), 1.4, 0.2)) {
+            mInterface->SendError(this->GetName() + ": JointPositionMove, invalid position");
+            return;
+        }
+        if (SendCommand(PosCmd))
+            UR_State = UR_POS_MOVING;
+    }
+    else
+        RobotNotReady();
+}
+
+void mtsUniversalRobotScriptRT::CartesianVelocityMove(const prmVelocityCartesianSet &CartVel)
+{
+    if ((UR_State == UR_IDLE) || (UR_State == UR_VEL_MOVING)) {
+        const vct3 &velxyz = CartVel.GetVelocity();
+        const vct3 &velrot = CartVel.GetAngularVelocity();
+        const double vel[6] = { velxyz.X(), velxyz.Y(), velxyz.Z(), velrot.X(), velrot.Y(), velrot.Z() };
+        // speedl(xd, a, t)
+        if (!VelCmd.SpeedL(vel, 1.4, 0.0)) {
+            mInterface->SendError(this->GetName() + ": CartesianVelocityMove, invalid velocity");
+            return;
+        }
+        const double zero[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        VelCmdStop.SpeedL(zero, 1.4, 0.0);
+        VelCmdTimeout = 100;   // Number of cycles for command to remain valid
+        UR_State = UR_VEL_MOVING;
+    }
+    else
+        RobotNotReady();
+}
+
+void mtsUniversalRobotScriptRT::CartesianPositionMove(const prmPositionCartesianSet &CartPos)
+{
+    if ((ServoRecipe >= 0) && ((UR_State == UR_IDLE) || (UR_State == UR_SERVO))) {
+        // Trajectory generated on the host, with the default limits
+        mtsUniversalRobotCartesianTrajectory trajectory;
+        trajectory.Waypoints.push_back(CartPos.GetGoal());
+        TrajectoryCartesian(trajectory);
+    }
+    else if (UR_State == UR_IDLE) {
+        const vctDoubleFrm3 &cartFrm = CartPos.GetGoal();
+        vctRodriguezRotation3<double> rot;
+        rot.From(cartFrm.Rotation());  // The rotation vector
+        const double pose[6] = { cartFrm.Translation().X(), cartFrm.Translation().Y(), cartFrm.Translation().Z(),
+                                 rot.X(), rot.Y(), rot.Z() };
+        if (!PosCmd.MoveL(pose, 1.2, 0.08)) {
+            mInterface->SendError(this->GetName() + ": CartesianPositionMove, invalid position");
+            return;
+        }
+        if (SendCommand(PosCmd))
+            UR_State = UR_POS_MOVING;
+    }
+    else
+        RobotNotReady();
+}
+
+void mtsUniversalRobotScriptRT::StopMotion(void)
+{
+    if (!MotionQueue.Empty()) {
+        MotionQueue.Clear();
+        UpdateMotionQueueStatus();
+    }
+    if (UR_State == UR_SERVO) {
+        StopServo();
+        return;
+    }
+    SendCommand("stopj(1.4)\n");
+}
+
+bool mtsUniversalRobotScriptRT::SendServoSetpoint(ServoModes mode, const double setpoint[6])
+{
+    ServoRegisters[SERVO_MODE_REGISTER] = mode;
+    for (size_t i = 0; i < 6; i++)
+        ServoRegisters[SERVO_SETPOINT_REGISTER + i] = setpoint[i];
+    ServoRegisters[SERVO_COUNTER_REGISTER] += 1.0;
+    if (!RTDE->SendInputs(ServoRecipe, ServoRegisters, SERVO_NB_REGISTERS)) {
+        SocketError();
+        return false;
+    }
+    return true;
+}
+
+bool mtsUniversalRobotScriptRT::StartServo(void)
+{
+    // The registers already hold the first setpoint, so the program does not need to wait
+    if (!SendCommand(ServoProgram))
+        return false;
+    UR_State = UR_SERVO;
+    mInterface->SendStatus(this->GetName() + ": servo mode started");
+    return true;
+}
+
+void mtsUniversalRobotScriptRT::ServoJoint(const prmPositionJointSet &jtposSet)
+{
+    if (ServoRecipe < 0) {
+        mInterface->SendError(this->GetName() + ": ServoJoint, servo mode not enabled");
+        return;
+    }
+    if ((UR_State != UR_IDLE) && (UR_State != UR_SERVO)) {
+        RobotNotReady();
+        return;
+    }
+    const vctDoubleVec &jtpos = jtposSet.Goal();
+    if (jtpos.size() != NB_Actuators) {
+        mInterface->SendError(this->GetName() + ": ServoJoint, invalid size");
+        return;
+    }
+    for (size_t i = 0; i < NB_Actuators; i++) {
+        if (!CISST_ISFINITE(jtpos[i])) {
+            mInterface->SendError(this->GetName() + ": ServoJoint, invalid position");
+            return;
+        }
+    }
+    // Streamed setpoints replace the trajectory
+    Trajectory.Clear();
+    Path.Clear();
+    if (SendServoSetpoint(SERVO_JOINT, jtpos.Pointer()) && (UR_State == UR_IDLE))
+        StartServo();
+}
+
+void mtsUniversalRobotScriptRT::ServoCartesian(const prmPositionCartesianSet &cartPosSet)
+{
+    if (ServoRecipe < 0) {
+        mInterface->SendError(this->GetName() + ": ServoCartesian, servo mode not enabled");
+        return;
+    }
+    if ((UR_State != UR_IDLE) && (UR_State != UR_SERVO)) {
+        RobotNotReady();
+        return;
+    }
+    const vctDoubleFrm3 &cartFrm = cartPosSet.GetGoal();
+    vctRodriguezRotation3<double> rot;
+    rot.From(cartFrm.Rotation());
+    const double pose[6] = { cartFrm.Translation().X(), cartFrm.Translation().Y(), cartFrm.Translation().Z(),
+                             rot.X(), rot.Y(), rot.Z() };
+    for (size_t i = 0; i < 6; i++) {
+        if (!CISST_ISFINITE(pose[i])) {
+            mInterface->SendError(this->GetName() + ": ServoCartesian, invalid position");
+            return;
+        }
+    }
+    Trajectory.Clear();
+    Path.Clear();
+    if (SendServoSetpoint(SERVO_CARTESIAN, pose) && (UR_State == UR_IDLE))
+        StartServo();
+}
+
+void mtsUniversalRobotScriptRT::StopServo(void)
+{
+    Trajectory.Clear();
+    Path.Clear();
+    if (UR_State != UR_SERVO)
+        return;
+    // The program stops the robot in idle mode; sending a new script then ends it
+    const double current[6] = { JointPos[0], JointPos[1], JointPos[2], JointPos[3], JointPos[4], JointPos[5] };
+    SendServoSetpoint(SERVO_IDLE, current);
+    SendCommand("stopj(1.4)\n");
+    UR_State = UR_IDLE;
+    mInterface->SendStatus(this->GetName() + ": servo mode stopped");
+}
+
+
+void mtsUniversalRobotScriptRT::SetTrajectoryJointLimits(const vctDouble6 &velocity,
+                                                         const vctDouble6 &acceleration,
+                                                         const vctDouble6 &jerk)
+{
+    TrajectoryJointVelocity.Assign(velocity);
+    TrajectoryJointAcceleration.Assign(acceleration);
+    TrajectoryJointJerk.Assign(jerk);
+}
+
+void mtsUniversalRobotScriptRT::SetTrajectoryCartesianLimits(const vctDouble2 &velocity,
+                                                             const vctDouble2 &acceleration,
+                                                             const vctDouble2 &jerk)
+{
+    TrajectoryCartesianVelocity.Assign(velocity);
+    TrajectoryCartesianAcceleration.Assign(acceleration);
+    TrajectoryCartesianJerk.Assign(jerk);
+}
+
+void mtsUniversalRobotScriptRT::TrajectoryStart(ServoModes mode, double start[6]) const
+{
+    const bool servoing = (UR_State == UR_SERVO) && (ServoRegisters[SERVO_MODE_REGISTER] == mode);
+    for (size_t i = 0; i < 6; i++) {
+        if (servoing)
+            start[i] = ServoRegisters[SERVO_SETPOINT_REGISTER + i];
+        else
+            start[i] = (mode == SERVO_JOINT) ? JointPos[i] : Sample.PoseCartesian[i];
+    }
+}
+
+void mtsUniversalRobotScriptRT::TrajectoryJoint(const mtsUniversalRobotJointTrajectory &trajectory)
+{
+    if (ServoRecipe < 0) {
+        mInterface->SendError(this->GetName() + ": TrajectoryJoint, servo mode not enabled");
+        return;
+    }
+    if ((UR_State != UR_IDLE) && (UR_State != UR_SERVO)) {
+        RobotNotReady();
+        return;
+    }
+    const size_t numWaypoints = trajectory.Waypoints.size();
+    std::vector<double> waypoints(6 * numWaypoints);
+    for (size_t w = 0; w < numWaypoints; w++) {
+        for (size_t i = 0; i < NB_Actuators; i++) {
+            waypoints[6 * w + i] = trajectory.Waypoints[w][i];
+            if (!CISST_ISFINITE(waypoints[6 * w + i])) {
+                mInterface->SendError(this->GetName() + ": TrajectoryJoint, invalid waypoint");
+                return;
+            }
+        }
+    }
+    if (numWaypoints == 0) {
+        mInterface->SendError(this->GetName() + ": TrajectoryJoint, no waypoint");
+        return;
+    }
+    // Limits that are not set are the default ones
+    double velocity[6], acceleration[6], jerk[6];
+    for (size_t i = 0; i < NB_Actuators; i++) {
+        velocity[i] = (trajectory.Velocity[i] > 0.0) ? trajectory.Velocity[i] : TrajectoryJointVelocity[i];
+        acceleration[i] = (trajectory.Acceleration[i] > 0.0) ? trajectory.Acceleration[i] : TrajectoryJointAcceleration[i];
+        jerk[i] = (trajectory.Jerk[i] > 0.0) ? trajectory.Jerk[i] : TrajectoryJointJerk[i];
+    }
+    double start[6];
+    TrajectoryStart(SERVO_JOINT, start);
+    if (!Trajectory.SetJoint(start, &waypoints[0], numWaypoints, velocity, acceleration, jerk, trajectory.Blend)) {
+        mInterface->SendError(this->GetName() + ": TrajectoryJoint, invalid limits");
+        return;
+    }
+    StartTrajectory();
+}
+
+void mtsUniversalRobotScriptRT::TrajectoryCartesian(const mtsUniversalRobotCartesianTrajectory &trajectory)
+{
+    if (ServoRecipe < 0) {
+        mInterface->SendError(this->GetName() + ": TrajectoryCartesian, servo mode not enabled");
+        return;
+    }
+    if ((UR_State != UR_IDLE) && (UR_State != UR_SERVO)) {
+        RobotNotReady();
+        return;
+    }
+    const size_t numWaypoints = trajectory.Waypoints.size();
+    if (numWaypoints == 0) {
+        mInterface->SendError(this->GetName() + ": TrajectoryCartesian, no waypoint");
+        return;
+    }
+    // Poses as (x, y, z, rx, ry, rz), as sent to the servo program
+    std::vector<double> waypoints(6 * numWaypoints);
+    for (size_t w = 0; w < numWaypoints; w++) {
+        const vctFrm3 &frame = trajectory.Waypoints[w];
+        double *pose = &waypoints[6 * w];
+        double rotation[9];
+        for (size_t row = 0; row < 3; row++) {
+            pose[row] = frame.Translation()[row];
+            for (size_t column = 0; column < 3; column++)
+                rotation[3*row + column] = frame.Rotation().Element(row, column);
+        }
+        osaUniversalRobotPoseConverter::RotationToAxisAngle(rotation, pose + 3);
+        for (size_t i = 0; i < 6; i++) {
+            if (!CISST_ISFINITE(pose[i])) {
+                mInterface->SendError(this->GetName() + ": TrajectoryCartesian, invalid waypoint");
+                return;
+            }
+        }
+    }
+    double velocity[2], acceleration[2], jerk[2];
+    for (size_t i = 0; i < 2; i++) {
+        velocity[i] = (trajectory.Velocity[i] > 0.0) ? trajectory.Velocity[i] : TrajectoryCartesianVelocity[i];
+        acceleration[i] = (trajectory.Acceleration[i] > 0.0) ? trajectory.Acceleration[i] : TrajectoryCartesianAcceleration[i];
+        jerk[i] = (trajectory.Jerk[i] > 0.0) ? trajectory.Jerk[i] : TrajectoryCartesianJerk[i];
+    }
+    double start[6];
+    TrajectoryStart(SERVO_CARTESIAN, start);
+    if (!Trajectory.SetCartesian(start, &waypoints[0], numWaypoints, velocity, acceleration, jerk, trajectory.Blend)) {
+        mInterface->SendError(this->GetName() + ": TrajectoryCartesian, invalid limits");
+        return;
+    }
+    StartTrajectory();
+}
+
+bool mtsUniversalRobotScriptRT::StartTrajectory(void)
+{
+    Path.Clear();
+    TrajectoryStartTime = ControllerTime;
+    TrajectoryStatus[0] = 0.0;
+    TrajectoryStatus[1] = Trajectory.GetDuration();
+    TrajectoryStatus[2] = 0.0;
+    double setpoint[6];
+    Trajectory.Evaluate(0.0, setpoint);
+    const ServoModes mode = (Trajectory.GetSpace() == osaUniversalRobotTrajectory::JOINT) ? SERVO_JOINT : SERVO_CARTESIAN;
+    if (!SendServoSetpoint(mode, setpoint)) {
+        Trajectory.Clear();
+        return false;
+    }
+    if (UR_State == UR_IDLE)
+        return StartServo();
+    return true;
+}
+
+void mtsUniversalRobotScriptRT::RunTrajectory(void)
+{
+    const double time = ControllerTime - TrajectoryStartTime;
+    const size_t reached = Trajectory.GetWaypointsReached();
+    double setpoint[6];
+    Trajectory.Evaluate(time, setpoint);
+    const ServoModes mode = (Trajectory.GetSpace() == osaUniversalRobotTrajectory::JOINT) ? SERVO_JOINT : SERVO_CARTESIAN;
+    if (!SendServoSetpoint(mode, setpoint)) {
+        Trajectory.Clear();
+        return;
+    }
+    for (size_t i = reached; i < Trajectory.GetWaypointsReached(); i++)
+        WaypointReachedEvent(static_cast<int>(i));
+
+    const double duration = Trajectory.GetDuration();
+    TrajectoryStatus[0] = ((duration > 0.0) && (time < duration)) ? time / duration : 1.0;
+    TrajectoryStatus[1] = (time < duration) ? duration - time : 0.0;
+    TrajectoryStatus[2] = static_cast<double>(Trajectory.GetWaypointsReached());
+
+    // servoj follows the setpoints with a delay (lookahead time), so the last setpoint
+    // is held until the robot reached it
+    if (time >= duration + ServoLookahead + 2.0 * ServoTime) {
+        StopServo();
+        TrajectoryCompletedEvent(duration);
+    }
+}
+
+void mtsUniversalRobotScriptRT::SetPathLimits(const vctDouble6 &position, const vctDouble6 &velocity)
+{
+    PathPositionLimits.Assign(position);
+    PathVelocityLimits.Assign(velocity);
+}
+
+void mtsUniversalRobotScriptRT::JointPath(const mtsUniversalRobotJointPath &path)
+{
+    if (ServoRecipe < 0) {
+        mInterface->SendError(this->GetName() + ": JointPath, servo mode not enabled");
+        return;
+    }
+    if ((UR_State != UR_IDLE) && (UR_State != UR_SERVO)) {
+        RobotNotReady();
+        return;
+    }
+    const size_t numPoints = path.Positions.size();
+    if ((numPoints == 0) || (path.Times.size() != numPoints)) {
+        mInterface->SendError(this->GetName() + ": JointPath, invalid size");
+        return;
+    }
+
+    // The path starts at the last setpoint (or current position) at time 0, so the
+    // velocity to the first point is checked too
+    double start[6];
+    TrajectoryStart(SERVO_JOINT, start);
+    Path.Resize(numPoints + 1);
+    double *time = Path.Time();
+    time[0] = 0.0;
+    for (size_t k = 0; k < numPoints; k++)
+        time[k + 1] = path.Times[k];
+    for (size_t joint = 0; joint < NB_Actuators; joint++) {
+        double *position = Path.Position(joint);
+        position[0] = start[joint];
+        for (size_t k = 0; k < numPoints; k++)
+            position[k + 1] = path.Positions[k][joint];
+    }
+    size_t point, joint;
+    const osaUniversalRobotJointPath::Violation violation =
+        Path.Check(PathPositionLimits.Pointer(), PathVelocityLimits.Pointer(), point, joint);
+    if (violation != osaUniversalRobotJointPath::VALID) {
+        std::stringstream message;
+        message << this->GetName() << ": JointPath, ";
+        if (violation == osaUniversalRobotJointPath::TIME_NOT_INCREASING)
+            message << "times must be positive and increasing";
+        else if (violation == osaUniversalRobotJointPath::POSITION_LIMIT)
+            message << "position limit exceeded";
+        else
+            message << "velocity limit exceeded";
+        // Point 0 is the start point
+        if (point > 0)
+            message << " at point " << point - 1;
+        else
+            message << " at start point";
+        if (violation != osaUniversalRobotJointPath::TIME_NOT_INCREASING)
+            message << ", joint " << joint;
+        Path.Clear();
+        mInterface->SendError(message.str());
+        return;
+    }
+
+    Trajectory.Clear();
+    Path.Activate();
+    PathStartTime = ControllerTime;
+    PathStatus.Assign(0.0, Path.GetDuration(), 0.0);
+    PathTrackingError.SetAll(0.0);
+    double setpoint[6];
+    Path.Evaluate(0.0, setpoint);
+    if (!SendServoSetpoint(SERVO_JOINT, setpoint)) {
+        Path.Clear();
+        return;
+    }
+    if (UR_State == UR_IDLE)
+        StartServo();
+}
+
+void mtsUniversalRobotScriptRT::RunPath(void)
+{
+    const double time = ControllerTime - PathStartTime;
+    double setpoint[6];
+    const size_t numPassed = Path.Evaluate(time, setpoint);
+    if (!SendServoSetpoint(SERVO_JOINT, setpoint)) {
+        Path.Clear();
+        return;
+    }
+    // servoj follows the setpoints with a delay of about the lookahead time
+    if (time >= ServoLookahead)
+        Path.Track(time - ServoLookahead, JointPos.Pointer());
+
+    const double duration = Path.GetDuration();
+    PathStatus[0] = (time < duration) ? time / duration : 1.0;
+    PathStatus[1] = (time < duration) ? duration - time : 0.0;
+    PathStatus[2] = static_cast<double>(numPassed - 1);   // Without the start point
+
+    if (time >= duration + ServoLookahead + 2.0 * ServoTime) {
+        double rms[6], maximum[6];
+        Path.GetTrackingError(rms, maximum);
+        double largest = 0.0;
+        for (size_t joint = 0; joint < NB_Actuators; joint++) {
+            PathTrackingError.Element(0, joint) = rms[joint];
+            PathTrackingError.Element(1, joint) = maximum[joint];
+            if (maximum[joint] > largest)
+                largest = maximum[joint];
+        }
+        StopServo();
+        PathCompletedEvent(largest);
+    }
+}
+
+void mtsUniversalRobotScriptRT::SetMotionEvents(double jointThreshold, double linearThreshold,
+                                                double angularThreshold, double maximumPeriod)
+{
+    MotionJointThreshold = jointThreshold;
+    MotionLinearThreshold = linearThreshold;
+    MotionAngularThreshold = angularThreshold;
+    MotionMaximumPeriod = maximumPeriod;
+}
+
+void mtsUniversalRobotScriptRT::SetMotionQueueCapacity(size_t capacity)
+{
+    MotionQueue.SetCapacity(capacity);
+    UpdateMotionQueueStatus();
+}
+
+void mtsUniversalRobotScriptRT::UpdateMotionQueueStatus(void)
+{
+    MotionQueueStatus.Assign(static_cast<double>(MotionQueue.Size()),
+                             static_cast<double>(MotionQueue.GetLastCompleted()),
+                             static_cast<double>(MotionQueue.GetNextId()));
+}
+
+void mtsUniversalRobotScriptRT::MotionQueueAdd(const mtsUniversalRobotMotionBatch &batch)
+{
+    // Waypoints can be added while the queue is executed, but not during other motions
+    if ((UR_State != UR_IDLE) && !((UR_State == UR_POS_MOVING) && !MotionQueue.Empty())) {
+        RobotNotReady();
+        return;
+    }
+    if ((batch.Policy < osaUniversalRobotMotionQueue::APPEND)
+        || (batch.Policy > osaUniversalRobotMotionQueue::PREEMPT)) {
+        mInterface->SendError(this->GetName() + ": MotionQueueAdd, invalid policy");
+        return;
+    }
+    const bool joint = !batch.JointPositions.empty();
+    if (joint == !batch.Poses.empty()) {
+        mInterface->SendError(this->GetName() + ": MotionQueueAdd, batch must have either joint positions or poses");
+        return;
+    }
+
+    // Same parameters as JointPositionMove and CartesianPositionMove by default
+    osaUniversalRobotMotionQueue::Waypoint waypoint;
+    waypoint.Type = joint ? osaUniversalRobotMotionQueue::MOVE_JOINT : osaUniversalRobotMotionQueue::MOVE_LINEAR;
+    waypoint.Acceleration = (batch.Acceleration > 0.0) ? batch.Acceleration : (joint ? 1.4 : 1.2);
+    waypoint.Velocity = (batch.Velocity > 0.0) ? batch.Velocity : (joint ? 0.2 : 0.08);
+    waypoint.BlendRadius = (batch.BlendRadius > 0.0) ? batch.BlendRadius : 0.0;
+    waypoint.HasToolPosition = false;
+    // Tool position of the joint waypoints, to detect them when they are blended
+    osaUniversalRobotKinematics model(Kinematics);
+
+    const size_t numWaypoints = joint ? batch.JointPositions.size() : batch.Poses.size();
+    std::vector<osaUniversalRobotMotionQueue::Waypoint> waypoints(numWaypoints, waypoint);
+    for (size_t w = 0; w < numWaypoints; w++) {
+        double *position = waypoints[w].Position;
+        if (joint) {
+            for (size_t i = 0; i < NB_Actuators; i++)
+                position[i] = batch.JointPositions[w][i];
+        }
+        else {
+            const vctFrm3 &frame = batch.Poses[w];
+            double rotation[9];
+            for (size_t row = 0; row < 3; row++) {
+                position[row] = frame.Translation()[row];
+                for (size_t column = 0; column < 3; column++)
+                    rotation[3*row + column] = frame.Rotation().Element(row, column);
+            }
+            osaUniversalRobotPoseConverter::RotationToAxisAngle(rotation, position + 3);
+        }
+        for (size_t i = 0; i < 6; i++) {
+            if (!CISST_ISFINITE(position[i])) {
+                mInterface->SendError(this->GetName() + ": MotionQueueAdd, invalid waypoint");
+                return;
+            }
+        }
+        if (joint && model.IsValid()) {
+            model.Update(position, false);
+            for (size_t i = 0; i < 3; i++)
+                waypoints[w].ToolPosition[i] = model.Translation()[i];
+            waypoints[w].HasToolPosition = true;
+        }
+    }
+    if (numWaypoints == 0) {
+        mInterface->SendError(this->GetName() + ": MotionQueueAdd, no waypoint");
+        return;
+    }
+
+    if (!MotionQueue.Add(&waypoints[0], numWaypoints,
+                         static_cast<osaUniversalRobotMotionQueue::Policy>(batch.Policy))) {
+        mInterface->SendError(this->GetName() + ": MotionQueueAdd, queue full");
+        return;
+    }
+    // The new program replaces the one running, starting with the waypoint the robot
+    // is moving to (unless it was preempted)
+    if (!MotionQueue.Compile(MotionQueueProgram)) {
+        mInterface->SendError(this->GetName() + ": MotionQueueAdd, waypoint can not be encoded");
+        MotionQueue.Clear();
+    }
+    else if (!SendCommand(MotionQueueProgram))
+        MotionQueue.Clear();
+    else
+        UR_State = UR_POS_MOVING;
+    UpdateMotionQueueStatus();
+}
+
+void mtsUniversalRobotScriptRT::RunMotionQueue(void)
+{
+    const size_t numReached = MotionQueue.NumberReached(JointPos.Pointer(), Sample.PoseCartesian.Pointer(),
+                                                        Kinematics.IsValid() ? Kinematics.Translation() : 0);
+    if (numReached == 0)
+        return;
+    for (size_t i = 0; i < numReached; i++) {
+        MotionQueue.Pop();
+        MotionWaypointCompletedEvent(MotionQueue.GetLastCompleted());
+    }
+    UpdateMotionQueueStatus();
+    // The state goes back to idle once the robot stopped
+    if (MotionQueue.Empty())
+        MotionQueueCompletedEvent(MotionQueue.GetLastCompleted());
+}
+
+// Version in the reply to PolyscopeVersion, e.g., "URSoftware 3.15.7.106331 (Jan 01 2021)"
+static bool ParsePolyscopeVersion(const std::string &reply, int &major, int &minor, int &bugfix)
+{
+    const size_t start = reply.find_first_of("0123456789");
+    if (start == std::string::npos)
+        return false;
+    return (sscanf(reply.c_str() + start, "%d.%d.%d", &major, &minor, &bugfix) == 3);
+}
+
+// Value in a reply such as "Robotmode: RUNNING"
+static std::string DashboardValue(const std::string &reply)
+{
+    const size_t colon = reply.find(": ");
+    return (colon == std::string::npos) ? reply : reply.substr(colon + 2);
+}
+
+bool mtsUniversalRobotScriptRT::DashboardRequest(const std::string &command, DashboardTags tag)
+{
+    if (!Dashboard) {
+        if (tag == DASHBOARD_CLIENT)
+            mInterface->SendWarning(this->GetName() + ": dashboard not enabled");
+        return false;
+    }
+    if (!Dashboard->Request(command, tag)) {
+        if (tag == DASHBOARD_CLIENT)
+            mInterface->SendError(this->GetName() + ": dashboard busy, \"" + command + "\" not sent");
+        return false;
+    }
+    return true;
+}
+
+void mtsUniversalRobotScriptRT::DashboardCommand(const std::string &command)
+{
+    DashboardRequest(command, DASHBOARD_CLIENT);
+}
+
+void mtsUniversalRobotScriptRT::PowerOn(void)
+{
+    DashboardRequest("power on", DASHBOARD_CLIENT);
+}
+
+void mtsUniversalRobotScriptRT::PowerOff(void)
+{
+    DashboardRequest("power off", DASHBOARD_CLIENT);
+}
+
+void mtsUniversalRobotScriptRT::BrakeRelease(void)
+{
+    DashboardRequest("brake release", DASHBOARD_CLIENT);
+}
+
+void mtsUniversalRobotScriptRT::LoadProgram(const std::string &program)
+{
+    DashboardRequest("load " + program, DASHBOARD_CLIENT);
+}
+
+void mtsUniversalRobotScriptRT::PlayProgram(void)
+{
+    DashboardRequest("play", DASHBOARD_CLIENT);
+}
+
+void mtsUniversalRobotScriptRT::RefreshDashboard(void)
+{
+    DashboardRequest("PolyscopeVersion", DASHBOARD_INTERNAL);
+    QueryDashboardStatus();
+}
+
+void mtsUniversalRobotScriptRT::QueryDashboardStatus(void)
+{
+    // Sent together, the three replies take one round trip
+    DashboardRequest("robotmode", DASHBOARD_INTERNAL);
+    DashboardRequest("safetymode", DASHBOARD_INTERNAL);
+    DashboardRequest("programState", DASHBOARD_INTERNAL);
+    DashboardPollTime = osaUniversalRobotMonotonicTime();
+}
+
+void mtsUniversalRobotScriptRT::RunDashboard(void)
+{
+    osaUniversalRobotDashboard::Reply reply;
+    while (Dashboard->NextReply(reply)) {
+        if (reply.Result != osaUniversalRobotDashboard::REPLY_OK) {
+            const std::string reason = (reply.Result == osaUniversalRobotDashboard::REPLY_TIMEOUT)
+                ? "timeout" : "not connected";
+            if (reply.Tag == DASHBOARD_CLIENT) {
+                DashboardErrorEvent(reply.Command);
+                mInterface->SendError(this->GetName() + ": dashboard, \"" + reply.Command
+                                      + "\" failed (" + reason + ")");
+            }
+            else {
+                CMN_LOG_CLASS_RUN_WARNING << "RunDashboard: \"" << reply.Command << "\" failed ("
+                                          << reason << ")" << std::endl;
+            }
+            continue;
+        }
+        // The states are updated whoever sent the query
+        if (reply.Command == "PolyscopeVersion") {
+            if (StartupTime[2] < 0.0)
+                StartupTime[2] = osaUniversalRobotMonotonicTime() - StartupBeginTime;
+            PolyscopeVersionString = reply.Text;
+            if (!ParsePolyscopeVersion(reply.Text, pversion.major, pversion.minor, pversion.bugfix))
+                CMN_LOG_CLASS_RUN_WARNING << "RunDashboard: invalid version \"" << reply.Text << "\"" << std::endl;
+        }
+        else if (reply.Command == "robotmode")
+            DashboardRobotMode = DashboardValue(reply.Text);
+        else if (reply.Command == "safetymode")
+            DashboardSafetyMode = DashboardValue(reply.Text);
+        else if (reply.Command == "programState")
+            DashboardProgramState = reply.Text;
+        if (reply.Tag == DASHBOARD_CLIENT)
+            DashboardReplyEvent(reply.Text);
+    }
+
+    if ((DashboardPollPeriod > 0.0)
+        && (osaUniversalRobotMonotonicTime() - DashboardPollTime >= DashboardPollPeriod))
+        QueryDashboardStatus();
+}
+
+void mtsUniversalRobotScriptRT::RunSecondary(void)
+{
+    osaUniversalRobotSecondaryParser::Message message;
+    while (Secondary->NextMessage(message)) {
+        std::stringstream text;
+        if (message.Code != 0)
+            text << "C" << message.Code << "A" << message.Argument << ": ";
+        text << message.Text;
+        ControllerMessageEvent(text.str());
+        if (message.ReportLevel >= osaUniversalRobotSecondaryParser::REPORT_VIOLATION)
+            mInterface->SendError(this->GetName() + ": controller, " + text.str());
+        else if (message.ReportLevel == osaUniversalRobotSecondaryParser::REPORT_WARNING)
+            mInterface->SendWarning(this->GetName() + ": controller, " + text.str());
+        else if (message.ReportLevel == osaUniversalRobotSecondaryParser::REPORT_INFO)
+            mInterface->SendStatus(this->GetName() + ": controller, " + text.str());
+    }
+
+    // Calibration received during a motion
+    if (CalibrationPending && ((UR_State == UR_IDLE) || (UR_State == UR_NOT_CONNECTED))) {
+        ApplyCalibration();
+        ControllerConfigurationEvent(ControllerConfiguration);
+    }
+
+    // Copied at 10 Hz only
+    osaUniversalRobotSecondaryParser::Data data;
+    const unsigned int changes = Secondary->Fetch(data);
+    if (changes == 0)
+        return;
+
+    const osaUniversalRobotSecondaryParser::RobotModeData &mode = data.RobotMode;
+    const osaUniversalRobotSecondaryParser::MasterboardData &masterboard = data.Masterboard;
+    ControllerState.RobotMode = mode.RobotMode;
+    ControllerState.ControlMode = mode.ControlMode;
+    ControllerState.PowerOn = mode.PowerOn;
+    ControllerState.EmergencyStopped = mode.EmergencyStopped;
+    ControllerState.ProtectiveStopped = mode.ProtectiveStopped;
+    ControllerState.ProgramRunning = mode.ProgramRunning;
+    ControllerState.ProgramPaused = mode.ProgramPaused;
+    ControllerState.TargetSpeedFraction = mode.TargetSpeedFraction;
+    ControllerState.SpeedScaling = mode.SpeedScaling;
+    ControllerState.SafetyMode = masterboard.SafetyMode;
+    ControllerState.ReducedMode = masterboard.ReducedMode;
+    ControllerState.DigitalInputs = masterboard.DigitalInputs;
+    ControllerState.DigitalOutputs = masterboard.DigitalOutputs;
+    ControllerState.MasterboardTemperature = masterboard.Temperature;
+    ControllerState.RobotVoltage = masterboard.RobotVoltage;
+    ControllerState.RobotCurrent = masterboard.RobotCurrent;
+    if (changes & (osaUniversalRobotSecondaryParser::ROBOT_MODE | osaUniversalRobotSecondaryParser::MASTERBOARD))
+        ControllerStateEvent(ControllerState);
+
+    const unsigned int configurationChanges = osaUniversalRobotSecondaryParser::VERSION
+        | osaUniversalRobotSecondaryParser::CONFIGURATION | osaUniversalRobotSecondaryParser::KINEMATICS
+        | osaUniversalRobotSecondaryParser::TCP_OFFSET;
+    if ((changes & configurationChanges) == 0)
+        return;
+
+    const osaUniversalRobotSecondaryParser::VersionData &version = data.Version;
+    const osaUniversalRobotSecondaryParser::ConfigurationData &configuration = data.Configuration;
+    const osaUniversalRobotSecondaryParser::KinematicsData &kinematics = data.Kinematics;
+    std::stringstream versionString;
+    versionString << version.ProjectName << " " << version.Major << "." << version.Minor << "."
+                  << version.Bugfix << "." << version.Build;
+    ControllerConfiguration.Version = versionString.str();
+    ControllerConfiguration.RobotType = configuration.RobotType;
+    ControllerConfiguration.RobotSubType = configuration.RobotSubType;
+    ControllerConfiguration.JointMinimum.Assign(configuration.JointMinimum);
+    ControllerConfiguration.JointMaximum.Assign(configuration.JointMaximum);
+    ControllerConfiguration.JointMaximumSpeed.Assign(configuration.JointMaximumSpeed);
+    ControllerConfiguration.JointMaximumAcceleration.Assign(configuration.JointMaximumAcceleration);
+    ControllerConfiguration.DHA.Assign(kinematics.A);
+    ControllerConfiguration.DHD.Assign(kinematics.D);
+    ControllerConfiguration.DHAlpha.Assign(kinematics.Alpha);
+    ControllerConfiguration.DHTheta.Assign(kinematics.Theta);
+    ControllerConfiguration.TCPOffset.Assign(data.TCPOffset);
+
+    // Applied when the parameters change, e.g., once connected; the model must not
+    // change under a motion, so a calibration received while moving waits for idle
+    if ((changes & osaUniversalRobotSecondaryParser::KINEMATICS) && SecondaryCalibration) {
+        CalibrationPending = true;
+        if ((UR_State == UR_IDLE) || (UR_State == UR_NOT_CONNECTED))
+            ApplyCalibration();
+        else
+            CMN_LOG_CLASS_RUN_VERBOSE << "RunSecondary: calibration deferred until the robot is idle" << std::endl;
+    }
+    ControllerConfigurationEvent(ControllerConfiguration);
+}
+
+void mtsUniversalRobotScriptRT::ApplyCalibration(void)
+{
+    CalibrationPending = false;
+    const bool calibrated = Kinematics.SetCalibration(ControllerConfiguration.DHA.Pointer(),
+                                                      ControllerConfiguration.DHD.Pointer(),
+                                                      ControllerConfiguration.DHAlpha.Pointer(),
+                                                      ControllerConfiguration.DHTheta.Pointer());
+    UpdateInverseKinematicsModel();
+    ControllerConfiguration.Calibrated = Kinematics.IsCalibrated();
+    if (calibrated) {
+        CMN_LOG_CLASS_RUN_VERBOSE << "ApplyCalibration: using the calibration of the "
+                                  << Kinematics.GetModel() << std::endl;
+    }
+    else {
+        mInterface->SendWarning(this->GetName() + ": calibrated kinematic parameters of the controller "
+                                "do not match the kinematic model, using the nominal parameters");
+    }
 }
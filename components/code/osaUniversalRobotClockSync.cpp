@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cmath>
+
+#include <sawUniversalRobot/osaUniversalRobotClockSync.h>
+
+osaUniversalRobotClockSync::osaUniversalRobotClockSync(double nominalPeriod, size_t blockSize,
+                                                       size_t numBlocks) :
+    BlockSize((blockSize > 0) ? blockSize : 1),
+    BlockMinimum((numBlocks > 2) ? numBlocks : 2),
+    BlockTime((numBlocks > 2) ? numBlocks : 2),
+    FramesDropped(0), FramesDuplicated(0), Resets(0)
+{
+    SetNominalPeriod(nominalPeriod);
+    Reset();
+}
+
+void osaUniversalRobotClockSync::SetNominalPeriod(double period)
+{
+    NominalPeriod = (period > 0.0) ? period : 0.008;
+    Period = NominalPeriod;
+}
+
+void osaUniversalRobotClockSync::Reset(void)
+{
+    Started = false;
+    ControllerOrigin = 0.0;
+    HostOrigin = 0.0;
+    LastControllerTime = 0.0;
+    NumBlocksUsed = 0;
+    NextBlock = 0;
+    BlockCount = 0;
+    CurrentMinimum = 0.0;
+    CurrentMinimumTime = 0.0;
+    Intercept = 0.0;
+    Slope = 0.0;
+    DelayMean = 0.0;
+    DelayVariance = 0.0;
+    Period = NominalPeriod;
+}
+
+osaUniversalRobotClockSync::FrameStatus
+osaUniversalRobotClockSync::Update(double controllerTime, double hostTime)
+{
+    FrameStatus status = FRAME_OK;
+    if (!Started) {
+        Started = true;
+        ControllerOrigin = controllerTime;
+        HostOrigin = hostTime;
+        LastControllerTime = 0.0;
+        Intercept = 0.0;
+        CurrentMinimum = 0.0;
+        CurrentMinimumTime = 0.0;
+        BlockCount = 1;
+        return FRAME_FIRST;
+    }
+
+    const double time = controllerTime - ControllerOrigin;
+    const double difference = (hostTime - HostOrigin) - time;
+    const double step = time - LastControllerTime;
+    if (step < -Period) {
+        // Controller restarted
+        Reset();
+        Resets++;
+        Update(controllerTime, hostTime);
+        return FRAME_RESET;
+    }
+    if (step < 0.5 * Period) {
+        FramesDuplicated++;
+        return FRAME_DUPLICATE;
+    }
+    const double numPeriods = std::floor(step / Period + 0.5);
+    if (numPeriods >= 2.0) {
+        FramesDropped += static_cast<unsigned long>(numPeriods) - 1;
+        status = FRAME_DROPPED;
+    }
+    else {
+        // Slowly refine the period with the frames that are one period apart
+        Period += (step - Period) / 1000.0;
+    }
+    LastControllerTime = time;
+
+    // The envelope can not be above a frame
+    const double model = Intercept + Slope * time;
+    double delay = difference - model;
+    if (delay < 0.0) {
+        Intercept += delay;
+        delay = 0.0;
+    }
+    const double alpha = 1.0 / static_cast<double>(BlockSize);
+    const double deviation = delay - DelayMean;
+    DelayMean += alpha * deviation;
+    DelayVariance = (1.0 - alpha) * (DelayVariance + alpha * deviation * deviation);
+
+    if ((BlockCount == 0) || (difference < CurrentMinimum)) {
+        CurrentMinimum = difference;
+        CurrentMinimumTime = time;
+    }
+    BlockCount++;
+    if (BlockCount >= BlockSize) {
+        BlockMinimum[NextBlock] = CurrentMinimum;
+        BlockTime[NextBlock] = CurrentMinimumTime;
+        NextBlock = (NextBlock + 1) % BlockMinimum.size();
+        if (NumBlocksUsed < BlockMinimum.size())
+            NumBlocksUsed++;
+        BlockCount = 0;
+        Fit();
+    }
+    return status;
+}
+
+void osaUniversalRobotClockSync::Fit(void)
+{
+    if (NumBlocksUsed < 2) {
+        Intercept = BlockMinimum[0];
+        Slope = 0.0;
+        return;
+    }
+    double meanTime = 0.0;
+    double meanMinimum = 0.0;
+    for (size_t i = 0; i < NumBlocksUsed; i++) {
+        meanTime += BlockTime[i];
+        meanMinimum += BlockMinimum[i];
+    }
+    meanTime /= NumBlocksUsed;
+    meanMinimum /= NumBlocksUsed;
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (size_t i = 0; i < NumBlocksUsed; i++) {
+        const double dt = BlockTime[i] - meanTime;
+        covariance += dt * (BlockMinimum[i] - meanMinimum);
+        variance += dt * dt;
+    }
+    Slope = (variance > 0.0) ? covariance / variance : 0.0;
+    Intercept = meanMinimum - Slope * meanTime;
+    // Keep the envelope below all the minima used
+    double shift = 0.0;
+    for (size_t i = 0; i < NumBlocksUsed; i++) {
+        const double residual = BlockMinimum[i] - (Intercept + Slope * BlockTime[i]);
+        if (residual < shift)
+            shift = residual;
+    }
+    Intercept += shift;
+}
+
+double osaUniversalRobotClockSync::ToHost(double controllerTime) const
+{
+    const double time = controllerTime - ControllerOrigin;
+    return HostOrigin + time + Intercept + Slope * time;
+}
+
+double osaUniversalRobotClockSync::ToController(double hostTime) const
+{
+    // host - HostOrigin = time * (1 + Slope) + Intercept
+    const double time = (hostTime - HostOrigin - Intercept) / (1.0 + Slope);
+    return ControllerOrigin + time;
+}
+
+double osaUniversalRobotClockSync::GetOffset(void) const
+{
+    return (HostOrigin - ControllerOrigin) + Intercept + Slope * LastControllerTime;
+}
+
+double osaUniversalRobotClockSync::GetJitter(void) const
+{
+    return std::sqrt(DelayVariance);
+}
@@ -0,0 +1,175 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <sawUniversalRobot/osaUniversalRobotCommandEncoder.h>
+
+// Values are rounded to 4 decimals, i.e., to an integer number of 1/SCALE
+const long long SCALE = 10000;
+const int DECIMALS = 4;
+
+// Large enough for robot units (rad, m, rad/s, ...) with margin; the scaled
+// value must fit in a 64-bit integer
+const double osaUniversalRobotCommandEncoder::MAX_VALUE = 1.0e9;
+
+osaUniversalRobotCommandEncoder::osaUniversalRobotCommandEncoder(void)
+{
+    Reset();
+}
+
+void osaUniversalRobotCommandEncoder::Reset(void)
+{
+    Size = 0;
+    Buffer[0] = '\0';
+    Failed = false;
+}
+
+bool osaUniversalRobotCommandEncoder::Append(const char *text)
+{
+    // Keep room for the terminating null character
+    while (*text) {
+        if (Size >= BUFFER_SIZE - 1) {
+            Failed = true;
+            return false;
+        }
+        Buffer[Size++] = *text++;
+    }
+    Buffer[Size] = '\0';
+    return true;
+}
+
+bool osaUniversalRobotCommandEncoder::AppendNumber(double value)
+{
+    // Also rejects NaN, for which all comparisons are false
+    if (!((value > -MAX_VALUE) && (value < MAX_VALUE))) {
+        Failed = true;
+        return false;
+    }
+    const bool negative = (value < 0.0);
+    if (negative)
+        value = -value;
+    // Round to nearest
+    unsigned long long scaled = static_cast<unsigned long long>(value * SCALE + 0.5);
+    // Digits in reverse order: 4 decimals, decimal point, integer part, sign
+    char digits[32];
+    size_t numDigits = 0;
+    for (int i = 0; i < DECIMALS; i++) {
+        digits[numDigits++] = static_cast<char>('0' + scaled % 10);
+        scaled /= 10;
+    }
+    digits[numDigits++] = '.';
+    do {
+        digits[numDigits++] = static_cast<char>('0' + scaled % 10);
+        scaled /= 10;
+    } while (scaled != 0);
+    if (negative)
+        digits[numDigits++] = '-';
+
+    if (Size + numDigits >= BUFFER_SIZE) {
+        Failed = true;
+        return false;
+    }
+    while (numDigits > 0)
+        Buffer[Size++] = digits[--numDigits];
+    Buffer[Size] = '\0';
+    return true;
+}
+
+bool osaUniversalRobotCommandEncoder::AppendVector(const double *values, size_t size)
+{
+    Append("[");
+    for (size_t i = 0; i < size; i++) {
+        if (i > 0)
+            Append(", ");
+        AppendNumber(values[i]);
+    }
+    return Append("]") && !Failed;
+}
+
+bool osaUniversalRobotCommandEncoder::Finish(void)
+{
+    Append("\n");
+    if (Failed) {
+        // Never leave a partial command in the buffer
+        Size = 0;
+        Buffer[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
+bool osaUniversalRobotCommandEncoder::Encode6(const char *prefix, const double values[6],
+                                              const char *separator, double value1,
+                                              const char *separator2, double value2)
+{
+    Reset();
+    Append(prefix);
+    AppendVector(values, 6);
+    Append(separator);
+    AppendNumber(value1);
+    Append(separator2);
+    AppendNumber(value2);
+    Append(")");
+    return Finish();
+}
+
+bool osaUniversalRobotCommandEncoder::SpeedJ(const double qd[6], double acceleration, double time)
+{
+    return Encode6("speedj(", qd, ", ", acceleration, ", ", time);
+}
+
+bool osaUniversalRobotCommandEncoder::SpeedL(const double xd[6], double acceleration, double time)
+{
+    return Encode6("speedl(", xd, ", ", acceleration, ", ", time);
+}
+
+bool osaUniversalRobotCommandEncoder::EncodeMove(const char *prefix, const double values[6],
+                                                  double acceleration, double velocity, double radius)
+{
+    Reset();
+    Append(prefix);
+    AppendVector(values, 6);
+    Append(", a=");
+    AppendNumber(acceleration);
+    Append(", v=");
+    AppendNumber(velocity);
+    // Also written if NaN, so that it is rejected
+    if (radius != 0.0) {
+        Append(", r=");
+        AppendNumber(radius);
+    }
+    Append(")");
+    return Finish();
+}
+
+bool osaUniversalRobotCommandEncoder::MoveJ(const double q[6], double acceleration, double velocity,
+                                            double radius)
+{
+    return EncodeMove("movej(", q, acceleration, velocity, radius);
+}
+
+bool osaUniversalRobotCommandEncoder::MoveL(const double pose[6], double acceleration, double velocity,
+                                            double radius)
+{
+    return EncodeMove("movel(p", pose, acceleration, velocity, radius);
+}
+
+bool osaUniversalRobotCommandEncoder::StopJ(double acceleration)
+{
+    Reset();
+    Append("stopj(");
+    AppendNumber(acceleration);
+    Append(")");
+    return Finish();
+}
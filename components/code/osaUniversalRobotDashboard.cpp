@@ -0,0 +1,226 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cisstCommon/cmnLogger.h>
+#include <cisstCommon/cmnUnits.h>
+#include <cisstOSAbstraction/osaSleep.h>
+#include <sawUniversalRobot/osaUniversalRobotClock.h>
+#include <sawUniversalRobot/osaUniversalRobotDashboard.h>
+#include <sawUniversalRobot/osaUniversalRobotReconnect.h>
+
+// Delay between connection attempts (s)
+const double RECONNECT_DELAY = 1.0;
+// Longest wait for data, so that new requests are sent promptly (s)
+const double RECEIVE_TIMEOUT = 0.005;
+
+osaUniversalRobotDashboard::osaUniversalRobotDashboard(void) :
+    Port(29999), Timeout(2.0), StopRequested(false), Running(false), Connected(false),
+    GreetingReceived(false), NextConnectTime(0.0)
+{
+}
+
+osaUniversalRobotDashboard::~osaUniversalRobotDashboard()
+{
+    Stop();
+}
+
+bool osaUniversalRobotDashboard::Start(const std::string &host, unsigned short port, double timeout)
+{
+    if (Running) {
+        CMN_LOG_INIT_WARNING << "osaUniversalRobotDashboard::Start: thread already running" << std::endl;
+        return false;
+    }
+    Host = host;
+    Port = port;
+    Timeout = timeout;
+    NextConnectTime = 0.0;
+    StopRequested = false;
+    Running = true;
+    Thread.Create<osaUniversalRobotDashboard, void *>(this, &osaUniversalRobotDashboard::RunThread,
+                                                       0, "URdash");
+    return true;
+}
+
+void osaUniversalRobotDashboard::Stop(void)
+{
+    if (!Running)
+        return;
+    StopRequested = true;
+    Thread.Wait();
+    Running = false;
+    Disconnect();
+    Sent.clear();
+    Mutex.Lock();
+    Requests.clear();
+    Mutex.Unlock();
+}
+
+bool osaUniversalRobotDashboard::Request(const std::string &command, unsigned int tag)
+{
+    if (!Running)
+        return false;
+    Pending pending;
+    pending.Command = command;
+    pending.Tag = tag;
+    pending.Deadline = 0.0;
+    Mutex.Lock();
+    const bool queued = (Requests.size() < MAX_PENDING);
+    if (queued)
+        Requests.push_back(pending);
+    Mutex.Unlock();
+    return queued;
+}
+
+bool osaUniversalRobotDashboard::NextReply(Reply &reply)
+{
+    Mutex.Lock();
+    const bool available = !Replies.empty();
+    if (available) {
+        reply = Replies.front();
+        Replies.pop_front();
+    }
+    Mutex.Unlock();
+    return available;
+}
+
+void osaUniversalRobotDashboard::AddReply(const Pending &pending, const std::string &text, Status status)
+{
+    Reply reply;
+    reply.Command = pending.Command;
+    reply.Text = text;
+    reply.Result = status;
+    reply.Tag = pending.Tag;
+    Mutex.Lock();
+    Replies.push_back(reply);
+    Mutex.Unlock();
+}
+
+bool osaUniversalRobotDashboard::Connect(void)
+{
+    // Probe first, so that an unreachable controller does not block Stop
+    if (!osaUniversalRobotReconnect::Probe(Host, Port, RECONNECT_DELAY)
+        || !Socket.Connect(Host, Port))
+        return false;
+    GreetingReceived = false;
+    Line.clear();
+    Connected = true;
+    return true;
+}
+
+void osaUniversalRobotDashboard::Disconnect(void)
+{
+    if (Connected) {
+        Socket.Close();
+        Connected = false;
+    }
+}
+
+void osaUniversalRobotDashboard::FailSent(Status status)
+{
+    for (size_t i = 0; i < Sent.size(); i++)
+        AddReply(Sent[i], "", (i == 0) ? status : REPLY_DISCONNECTED);
+    Sent.clear();
+}
+
+bool osaUniversalRobotDashboard::ReceiveLines(double timeoutSec)
+{
+    char buffer[512];
+    const int numBytes = Socket.Receive(buffer, sizeof(buffer), timeoutSec);
+    if (numBytes < 0)
+        return false;
+    for (int i = 0; i < numBytes; i++) {
+        if (buffer[i] != '\n') {
+            if (buffer[i] != '\r')
+                Line += buffer[i];
+            continue;
+        }
+        // The server sends a greeting when the connection is opened
+        if (!GreetingReceived)
+            GreetingReceived = true;
+        else if (!Sent.empty()) {
+            AddReply(Sent.front(), Line, REPLY_OK);
+            Sent.pop_front();
+            // The next reply is due one timeout after this one, since the server
+            // processes the commands in order
+            if (!Sent.empty())
+                Sent.front().Deadline = osaUniversalRobotMonotonicTime() + Timeout;
+        }
+        else {
+            CMN_LOG_RUN_WARNING << "osaUniversalRobotDashboard: unexpected reply \"" << Line << "\"" << std::endl;
+        }
+        Line.clear();
+    }
+    return true;
+}
+
+void * osaUniversalRobotDashboard::RunThread(void *)
+{
+    while (!StopRequested) {
+        double now = osaUniversalRobotMonotonicTime();
+        std::deque<Pending> toSend;
+        Mutex.Lock();
+        toSend.swap(Requests);
+        Mutex.Unlock();
+
+        if (!Connected) {
+            // Connect at start, then only when there are requests to send
+            const bool attempt = (now >= NextConnectTime) && (!toSend.empty() || (NextConnectTime == 0.0));
+            if (attempt && !Connect()) {
+                NextConnectTime = now + RECONNECT_DELAY;
+                CMN_LOG_RUN_WARNING << "osaUniversalRobotDashboard: can't connect to "
+                                    << Host << ":" << Port << std::endl;
+            }
+            if (!Connected) {
+                // Requests fail rather than wait for the controller
+                for (size_t i = 0; i < toSend.size(); i++)
+                    AddReply(toSend[i], "", REPLY_DISCONNECTED);
+                osaSleep(0.01 * cmn_s);
+                continue;
+            }
+        }
+
+        // Send all the requests at once, without waiting for the replies (separate
+        // small sends would be delayed by the Nagle algorithm)
+        if (!toSend.empty()) {
+            std::string data;
+            for (size_t i = 0; i < toSend.size(); i++) {
+                data += toSend[i].Command;
+                data += '\n';
+                // Only used once the request is the first one waiting (see ReceiveLines)
+                toSend[i].Deadline = now + Timeout;
+                Sent.push_back(toSend[i]);
+            }
+            if (Socket.Send(data) != static_cast<int>(data.size())) {
+                FailSent(REPLY_DISCONNECTED);
+                Disconnect();
+                continue;
+            }
+        }
+
+        if (!ReceiveLines(RECEIVE_TIMEOUT)) {
+            FailSent(REPLY_DISCONNECTED);
+            Disconnect();
+            continue;
+        }
+        now = osaUniversalRobotMonotonicTime();
+        if (!Sent.empty() && (now > Sent.front().Deadline)) {
+            CMN_LOG_RUN_WARNING << "osaUniversalRobotDashboard: no reply to \"" << Sent.front().Command
+                                << "\", reconnecting" << std::endl;
+            FailSent(REPLY_TIMEOUT);
+            Disconnect();
+        }
+    }
+    return 0;
+}
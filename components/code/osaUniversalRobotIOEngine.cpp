@@ -0,0 +1,195 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cisstCommon/cmnLogger.h>
+#include <sawUniversalRobot/osaUniversalRobotIOEngine.h>
+#include <sawUniversalRobot/osaUniversalRobotReceiver.h>
+
+#if (CISST_OS == CISST_LINUX)
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+// Maximum number of events returned by each epoll_wait
+const int MAX_EVENTS = 16;
+// epoll_wait timeout, so that the thread can check StopRequested
+const int WAIT_TIMEOUT_MS = 100;
+
+osaUniversalRobotIOEngine::osaUniversalRobotIOEngine(void) :
+    EpollId(-1), CPU(-1), StopRequested(false), Running(false),
+    Wakeups(0), SocketsServiced(0)
+{
+}
+
+osaUniversalRobotIOEngine::~osaUniversalRobotIOEngine()
+{
+    Stop();
+}
+
+osaUniversalRobotIOEngine & osaUniversalRobotIOEngine::Shared(void)
+{
+    static osaUniversalRobotIOEngine engine;
+    return engine;
+}
+
+bool osaUniversalRobotIOEngine::Start(int cpu)
+{
+#if (CISST_OS == CISST_LINUX)
+    // Several components may start the shared engine
+    Mutex.Lock();
+    if (Running) {
+        Mutex.Unlock();
+        return true;
+    }
+    EpollId = epoll_create1(0);
+    if (EpollId < 0) {
+        Mutex.Unlock();
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotIOEngine::Start: epoll_create1 failed" << std::endl;
+        return false;
+    }
+    CPU = cpu;
+    StopRequested = false;
+    Running = true;
+    Thread.Create<osaUniversalRobotIOEngine, void *>(this, &osaUniversalRobotIOEngine::RunThread,
+                                                      0, "URio");
+    Mutex.Unlock();
+    return true;
+#else
+    CMN_LOG_INIT_ERROR << "osaUniversalRobotIOEngine::Start: only available on Linux" << std::endl;
+    return false;
+#endif
+}
+
+void osaUniversalRobotIOEngine::Stop(void)
+{
+    if (!Running)
+        return;
+    StopRequested = true;
+    Thread.Wait();
+#if (CISST_OS == CISST_LINUX)
+    Mutex.Lock();
+    Entries.clear();
+    close(EpollId);
+    EpollId = -1;
+    Running = false;
+    Mutex.Unlock();
+#endif
+}
+
+size_t osaUniversalRobotIOEngine::Find(const osaUniversalRobotReceiver *receiver) const
+{
+    size_t i;
+    for (i = 0; i < Entries.size(); i++) {
+        if (Entries[i].Receiver == receiver)
+            break;
+    }
+    return i;
+}
+
+void osaUniversalRobotIOEngine::RemoveEntry(size_t index)
+{
+#if (CISST_OS == CISST_LINUX)
+    epoll_ctl(EpollId, EPOLL_CTL_DEL, Entries[index].SocketId, 0);
+#endif
+    Entries.erase(Entries.begin() + index);
+}
+
+bool osaUniversalRobotIOEngine::Add(osaUniversalRobotReceiver *receiver, int socketId)
+{
+#if (CISST_OS == CISST_LINUX)
+    Mutex.Lock();
+    if (!Running || (Find(receiver) < Entries.size())) {
+        Mutex.Unlock();
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotIOEngine::Add: engine not running or receiver already added"
+                           << std::endl;
+        return false;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = receiver;
+    if (epoll_ctl(EpollId, EPOLL_CTL_ADD, socketId, &event) != 0) {
+        Mutex.Unlock();
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotIOEngine::Add: epoll_ctl failed for socket "
+                           << socketId << std::endl;
+        return false;
+    }
+    Entry entry;
+    entry.Receiver = receiver;
+    entry.SocketId = socketId;
+    Entries.push_back(entry);
+    Mutex.Unlock();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void osaUniversalRobotIOEngine::Remove(osaUniversalRobotReceiver *receiver)
+{
+    Mutex.Lock();
+    // The receiver may already have been removed after a socket error
+    const size_t index = Find(receiver);
+    if (index < Entries.size())
+        RemoveEntry(index);
+    Mutex.Unlock();
+}
+
+size_t osaUniversalRobotIOEngine::GetNumberOfReceivers(void)
+{
+    Mutex.Lock();
+    const size_t number = Entries.size();
+    Mutex.Unlock();
+    return number;
+}
+
+void * osaUniversalRobotIOEngine::RunThread(void *)
+{
+#if (CISST_OS == CISST_LINUX)
+    if ((CPU >= 0) && !osaUniversalRobotReceiver::PinCurrentThread(CPU)) {
+        CMN_LOG_RUN_WARNING << "osaUniversalRobotIOEngine: failed to pin thread to CPU "
+                            << CPU << std::endl;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!StopRequested) {
+        const int numEvents = epoll_wait(EpollId, events, MAX_EVENTS, WAIT_TIMEOUT_MS);
+        if (numEvents <= 0)
+            continue;   // Timeout or signal
+        Wakeups++;
+        Mutex.Lock();
+        for (int i = 0; i < numEvents; i++) {
+            osaUniversalRobotReceiver *receiver =
+                static_cast<osaUniversalRobotReceiver *>(events[i].data.ptr);
+            // Skip receivers removed since epoll_wait returned
+            const size_t index = Find(receiver);
+            if (index == Entries.size())
+                continue;
+            SocketsServiced++;
+            // Do not wait, epoll reported data (or an error) on this socket
+            const int numBytes = receiver->Service(0.0);
+            if ((numBytes == 0) && (events[i].events & (EPOLLERR | EPOLLHUP)))
+                receiver->ReportSocketError();
+            if (numBytes <= 0) {
+                // Stop monitoring the socket after an error, otherwise epoll would keep
+                // reporting it; the component closes it
+                if (receiver->SocketErrorOccurred())
+                    RemoveEntry(index);
+            }
+        }
+        Mutex.Unlock();
+    }
+#endif
+    return 0;
+}
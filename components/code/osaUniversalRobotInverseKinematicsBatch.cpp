@@ -0,0 +1,106 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <thread>
+
+#include <sawUniversalRobot/osaUniversalRobotInverseKinematicsBatch.h>
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+
+// Below this number of poses per thread, threads cost more than they save
+const size_t MIN_POSES_PER_THREAD = 256;
+
+osaUniversalRobotInverseKinematicsBatch::osaUniversalRobotInverseKinematicsBatch(size_t numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+    // The calling thread is the first worker
+    for (size_t i = 1; i < numThreads; i++)
+        Workers.push_back(new Worker);
+}
+
+osaUniversalRobotInverseKinematicsBatch::~osaUniversalRobotInverseKinematicsBatch()
+{
+    for (size_t i = 0; i < Workers.size(); i++)
+        delete Workers[i];
+}
+
+void osaUniversalRobotInverseKinematicsBatch::Resize(size_t numPoses)
+{
+    for (size_t i = 0; i < 6; i++) {
+        PoseData[i].resize(numPoses);
+        JointData[i].resize(numPoses);
+    }
+    Valid.resize(numPoses);
+}
+
+size_t osaUniversalRobotInverseKinematicsBatch::Solve(const osaUniversalRobotKinematics &kinematics,
+                                                      const double seed[6])
+{
+    const size_t numPoses = GetNumberOfPoses();
+    size_t numThreads = Workers.size() + 1;
+    if (numThreads > numPoses / MIN_POSES_PER_THREAD)
+        numThreads = (numPoses / MIN_POSES_PER_THREAD > 0) ? numPoses / MIN_POSES_PER_THREAD : 1;
+    const size_t posesPerThread = (numPoses + numThreads - 1) / numThreads;
+
+    for (size_t i = 1; i < numThreads; i++) {
+        Worker *worker = Workers[i - 1];
+        worker->Batch = this;
+        worker->Kinematics = &kinematics;
+        worker->Seed = seed;
+        worker->Begin = i * posesPerThread;
+        worker->End = (worker->Begin + posesPerThread < numPoses) ? worker->Begin + posesPerThread : numPoses;
+        worker->NumSolved = 0;
+        worker->Thread.Create<Worker, void *>(worker, &Worker::RunThread, 0, "URik");
+    }
+    size_t numSolved = 0;
+    SolveRange(kinematics, seed, 0, (posesPerThread < numPoses) ? posesPerThread : numPoses, numSolved);
+    for (size_t i = 1; i < numThreads; i++) {
+        Workers[i - 1]->Thread.Wait();
+        numSolved += Workers[i - 1]->NumSolved;
+    }
+    return numSolved;
+}
+
+void osaUniversalRobotInverseKinematicsBatch::SolveRange(const osaUniversalRobotKinematics &kinematics,
+                                                         const double seed[6],
+                                                         size_t begin, size_t end, size_t &numSolved)
+{
+    for (size_t index = begin; index < end; index++) {
+        double translation[3];
+        double axisAngle[3];
+        for (size_t i = 0; i < 3; i++) {
+            translation[i] = PoseData[i][index];
+            axisAngle[i] = PoseData[3 + i][index];
+        }
+        double rotation[9];
+        osaUniversalRobotPoseConverter::AxisAngleToRotation(axisAngle, rotation);
+        double q[6];
+        const bool reachable = kinematics.Inverse(rotation, translation, seed, q);
+        Valid[index] = reachable ? 1 : 0;
+        if (reachable) {
+            numSolved++;
+            for (size_t joint = 0; joint < 6; joint++)
+                JointData[joint][index] = q[joint];
+        }
+    }
+}
+
+void * osaUniversalRobotInverseKinematicsBatch::Worker::RunThread(void *)
+{
+    Batch->SolveRange(*Kinematics, Seed, Begin, End, NumSolved);
+    return 0;
+}
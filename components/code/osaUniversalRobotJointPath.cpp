@@ -0,0 +1,148 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cmath>
+
+#include <sawUniversalRobot/osaUniversalRobotJointPath.h>
+
+osaUniversalRobotJointPath::osaUniversalRobotJointPath(void):
+    NumPoints(0)
+{
+    Resize(0);
+    Activate();
+}
+
+void osaUniversalRobotJointPath::Resize(size_t numPoints)
+{
+    // Keep the capacity, so that a shorter path does not allocate; one element
+    // at least so that the pointers are valid
+    const size_t size = (numPoints > 0) ? numPoints : 1;
+    if (TimeData.size() < size) {
+        TimeData.resize(size);
+        for (size_t joint = 0; joint < 6; joint++)
+            PositionData[joint].resize(size);
+    }
+    NumPoints = numPoints;
+    Clear();
+}
+
+osaUniversalRobotJointPath::Violation
+osaUniversalRobotJointPath::Check(const double positionLimits[6], const double velocityLimits[6],
+                                  size_t &point, size_t &joint) const
+{
+    const double *time = &TimeData[0];
+    const size_t numSegments = (NumPoints > 0) ? NumPoints - 1 : 0;
+
+    // Count the violations without branches (comparisons are written so that NaN
+    // is a violation), then look for the first one
+    size_t violations = 0;
+    for (size_t k = 0; k < numSegments; k++)
+        violations += !(time[k + 1] > time[k]);
+    if (violations > 0) {
+        for (point = 1; time[point] > time[point - 1]; point++);
+        joint = 0;
+        return TIME_NOT_INCREASING;
+    }
+
+    for (joint = 0; joint < 6; joint++) {
+        const double *q = &PositionData[joint][0];
+        const double limit = positionLimits[joint];
+        for (size_t k = 0; k < NumPoints; k++)
+            violations += !(std::fabs(q[k]) <= limit);
+        if (violations > 0) {
+            for (point = 0; std::fabs(q[point]) <= limit; point++);
+            return POSITION_LIMIT;
+        }
+    }
+
+    for (joint = 0; joint < 6; joint++) {
+        const double *q = &PositionData[joint][0];
+        const double limit = velocityLimits[joint];
+        // |dq| <= v dt, without division
+        for (size_t k = 0; k < numSegments; k++)
+            violations += !(std::fabs(q[k + 1] - q[k]) <= limit * (time[k + 1] - time[k]));
+        if (violations > 0) {
+            for (point = 1; std::fabs(q[point] - q[point - 1]) <= limit * (time[point] - time[point - 1]); point++);
+            return VELOCITY_LIMIT;
+        }
+    }
+    point = 0;
+    joint = 0;
+    return VALID;
+}
+
+void osaUniversalRobotJointPath::Activate(void)
+{
+    Active = (NumPoints > 0);
+    Cursor = 0;
+    TrackingCursor = 0;
+    NumTrackingSamples = 0;
+    for (size_t joint = 0; joint < 6; joint++) {
+        SumSquaredError[joint] = 0.0;
+        MaximumError[joint] = 0.0;
+    }
+}
+
+void osaUniversalRobotJointPath::Clear(void)
+{
+    Active = false;
+    Cursor = 0;
+    TrackingCursor = 0;
+}
+
+void osaUniversalRobotJointPath::Interpolate(double time, size_t &cursor, double position[6]) const
+{
+    const double *times = &TimeData[0];
+    // Segment [cursor, cursor + 1] contains time
+    while ((cursor + 1 < NumPoints) && (times[cursor + 1] <= time))
+        cursor++;
+    if ((cursor + 1 >= NumPoints) || (time <= times[cursor])) {
+        for (size_t joint = 0; joint < 6; joint++)
+            position[joint] = PositionData[joint][cursor];
+        return;
+    }
+    const double s = (time - times[cursor]) / (times[cursor + 1] - times[cursor]);
+    for (size_t joint = 0; joint < 6; joint++) {
+        const double *q = &PositionData[joint][cursor];
+        position[joint] = q[0] + s * (q[1] - q[0]);
+    }
+}
+
+size_t osaUniversalRobotJointPath::Evaluate(double time, double position[6])
+{
+    Interpolate(time, Cursor, position);
+    return (time >= GetDuration()) ? NumPoints : Cursor + 1;
+}
+
+void osaUniversalRobotJointPath::Track(double time, const double actual[6])
+{
+    double position[6];
+    Interpolate(time, TrackingCursor, position);
+    for (size_t joint = 0; joint < 6; joint++) {
+        const double error = std::fabs(actual[joint] - position[joint]);
+        SumSquaredError[joint] += error * error;
+        if (error > MaximumError[joint])
+            MaximumError[joint] = error;
+    }
+    NumTrackingSamples++;
+}
+
+void osaUniversalRobotJointPath::GetTrackingError(double rms[6], double maximum[6]) const
+{
+    for (size_t joint = 0; joint < 6; joint++) {
+        rms[joint] = (NumTrackingSamples > 0) ? std::sqrt(SumSquaredError[joint] / NumTrackingSamples) : 0.0;
+        maximum[joint] = MaximumError[joint];
+    }
+}
@@ -0,0 +1,335 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <sawUniversalRobot/osaUniversalRobotKinematics.h>
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+
+osaUniversalRobotKinematics::osaUniversalRobotKinematics(void) :
+    Function(0),
+    Inverter(0),
+    Name(""),
+    Calibrated(false)
+{
+    const double identity[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    SetTool(identity);
+    memset(RotationMatrix, 0, sizeof(RotationMatrix));
+    memset(TranslationVector, 0, sizeof(TranslationVector));
+    memset(JacobianMatrix, 0, sizeof(JacobianMatrix));
+}
+
+bool osaUniversalRobotKinematics::SetModel(const std::string &model)
+{
+    if (model == osaUniversalRobotUR3::Name()) {
+        Function = &osaUniversalRobotKinematicsModel<osaUniversalRobotUR3>::Compute;
+        Inverter = &osaUniversalRobotKinematicsModel<osaUniversalRobotUR3>::Inverse;
+        Name = osaUniversalRobotUR3::Name();
+    }
+    else if (model == osaUniversalRobotUR5::Name()) {
+        Function = &osaUniversalRobotKinematicsModel<osaUniversalRobotUR5>::Compute;
+        Inverter = &osaUniversalRobotKinematicsModel<osaUniversalRobotUR5>::Inverse;
+        Name = osaUniversalRobotUR5::Name();
+    }
+    else if (model == osaUniversalRobotUR10::Name()) {
+        Function = &osaUniversalRobotKinematicsModel<osaUniversalRobotUR10>::Compute;
+        Inverter = &osaUniversalRobotKinematicsModel<osaUniversalRobotUR10>::Inverse;
+        Name = osaUniversalRobotUR10::Name();
+    }
+    else
+        return false;
+    Calibrated = false;
+    return true;
+}
+
+std::string osaUniversalRobotKinematics::GetModel(void) const
+{
+    return Name;
+}
+
+void osaUniversalRobotKinematics::SetTool(const double pose[6])
+{
+    for (size_t i = 0; i < 3; i++)
+        ToolTranslation[i] = pose[i];
+    osaUniversalRobotPoseConverter::AxisAngleToRotation(pose + 3, ToolRotation);
+}
+
+void osaUniversalRobotKinematics::Update(const double q[6], bool computeJacobian)
+{
+    if (Calibrated)
+        ComputeCalibrated(q, ToolRotation, ToolTranslation, RotationMatrix, TranslationVector,
+                          computeJacobian ? JacobianMatrix : 0);
+    else if (Function)
+        Function(q, ToolRotation, ToolTranslation, RotationMatrix, TranslationVector,
+                 computeJacobian ? JacobianMatrix : 0);
+}
+
+// (R, p) = (R, p) * (rotation, translation)
+static void Multiply(double R[9], double p[3], const double rotation[9], const double translation[3])
+{
+    double result[9];
+    for (size_t row = 0; row < 3; row++) {
+        const double *Rrow = R + 3*row;
+        p[row] += Rrow[0] * translation[0] + Rrow[1] * translation[1] + Rrow[2] * translation[2];
+        for (size_t column = 0; column < 3; column++)
+            result[3*row + column] = Rrow[0] * rotation[column]
+                                   + Rrow[1] * rotation[3 + column]
+                                   + Rrow[2] * rotation[6 + column];
+    }
+    for (size_t k = 0; k < 9; k++)
+        R[k] = result[k];
+}
+
+void osaUniversalRobotKinematics::ComputeCalibrated(const double q[6],
+                                                    const double toolRotation[9], const double toolTranslation[3],
+                                                    double rotation[9], double translation[3], double *jacobian) const
+{
+    double R[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+    double p[3] = { 0.0, 0.0, 0.0 };
+    double axis[6][3];
+    double origin[6][3];
+
+    for (size_t i = 0; i < 6; i++) {
+        for (size_t k = 0; k < 3; k++) {
+            axis[i][k] = R[3*k + 2];
+            origin[i][k] = p[k];
+        }
+        // Rows (c, -s ca, s sa), (s, c ca, -c sa), (0, sa, ca) and translation (a c, a s, d)
+        const double c = std::cos(q[i] + CalibrationTheta[i]);
+        const double s = std::sin(q[i] + CalibrationTheta[i]);
+        const double ca = std::cos(CalibrationAlpha[i]);
+        const double sa = std::sin(CalibrationAlpha[i]);
+        const double link[9] = { c, -s * ca, s * sa,
+                                 s, c * ca, -c * sa,
+                                 0.0, sa, ca };
+        const double linkTranslation[3] = { CalibrationA[i] * c, CalibrationA[i] * s, CalibrationD[i] };
+        Multiply(R, p, link, linkTranslation);
+    }
+    Multiply(R, p, toolRotation, toolTranslation);
+
+    for (size_t k = 0; k < 9; k++)
+        rotation[k] = R[k];
+    for (size_t k = 0; k < 3; k++)
+        translation[k] = p[k];
+
+    if (!jacobian)
+        return;
+    for (size_t i = 0; i < 6; i++) {
+        const double *z = axis[i];
+        const double r[3] = { p[0] - origin[i][0], p[1] - origin[i][1], p[2] - origin[i][2] };
+        jacobian[     i] = z[1] * r[2] - z[2] * r[1];
+        jacobian[ 6 + i] = z[2] * r[0] - z[0] * r[2];
+        jacobian[12 + i] = z[0] * r[1] - z[1] * r[0];
+        jacobian[18 + i] = z[0];
+        jacobian[24 + i] = z[1];
+        jacobian[30 + i] = z[2];
+    }
+}
+
+// Solve the 6x6 system A x = b (row-major, modified in place) with partial pivoting;
+// returns false if A is singular
+static bool Solve6(double A[36], double b[6])
+{
+    for (size_t column = 0; column < 6; column++) {
+        size_t pivot = column;
+        for (size_t row = column + 1; row < 6; row++) {
+            if (std::fabs(A[6*row + column]) > std::fabs(A[6*pivot + column]))
+                pivot = row;
+        }
+        if (std::fabs(A[6*pivot + column]) < 1.0e-12)
+            return false;
+        if (pivot != column) {
+            for (size_t k = 0; k < 6; k++)
+                std::swap(A[6*pivot + k], A[6*column + k]);
+            std::swap(b[pivot], b[column]);
+        }
+        for (size_t row = column + 1; row < 6; row++) {
+            const double factor = A[6*row + column] / A[6*column + column];
+            for (size_t k = column; k < 6; k++)
+                A[6*row + k] -= factor * A[6*column + k];
+            b[row] -= factor * b[column];
+        }
+    }
+    for (size_t row = 6; row > 0; row--) {
+        const size_t i = row - 1;
+        for (size_t k = i + 1; k < 6; k++)
+            b[i] -= A[6*i + k] * b[k];
+        b[i] /= A[6*i + i];
+    }
+    return true;
+}
+
+bool osaUniversalRobotKinematics::Refine(const double rotation[9], const double translation[3], double q[6]) const
+{
+    const double identity[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+    const double zero[3] = { 0.0, 0.0, 0.0 };
+    // Calibrations are close to the nominal parameters, so a few iterations are enough
+    for (size_t iteration = 0; iteration < 10; iteration++) {
+        double R[9], p[3], J[36];
+        ComputeCalibrated(q, identity, zero, R, p, J);
+        // Position error, and rotation error as the rotation vector of goal * R^T (small angles)
+        double error[6];
+        double errorNorm = 0.0;
+        for (size_t k = 0; k < 3; k++)
+            error[k] = translation[k] - p[k];
+        double E[9];
+        for (size_t row = 0; row < 3; row++) {
+            for (size_t column = 0; column < 3; column++)
+                E[3*row + column] = rotation[3*row] * R[3*column]
+                                  + rotation[3*row + 1] * R[3*column + 1]
+                                  + rotation[3*row + 2] * R[3*column + 2];
+        }
+        error[3] = 0.5 * (E[7] - E[5]);
+        error[4] = 0.5 * (E[2] - E[6]);
+        error[5] = 0.5 * (E[3] - E[1]);
+        for (size_t k = 0; k < 6; k++)
+            errorNorm += error[k] * error[k];
+        if (errorNorm < 1.0e-24)
+            return true;
+        if (!Solve6(J, error))
+            return false;
+        for (size_t joint = 0; joint < 6; joint++)
+            q[joint] += error[joint];
+    }
+    return false;
+}
+
+bool osaUniversalRobotKinematics::SetCalibration(const double a[6], const double d[6],
+                                                 const double alpha[6], const double theta[6])
+{
+    // Parallel joints make the parameters ambiguous (e.g., offsets along the axes of
+    // joints 2 to 4 compensate each other), so the calibration is compared to the
+    // nominal models by the flange poses it gives
+    const double configurations[3][6] = { { 0.0, -1.5, 1.5, -1.5, -1.5, 0.0 },
+                                          { 0.5, -1.0, 1.2, -0.7, 1.1, 0.3 },
+                                          { -1.2, -2.0, -1.0, 0.4, -0.6, 2.0 } };
+    const double identity[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+    const double zero[3] = { 0.0, 0.0, 0.0 };
+    const char *models[3] = { osaUniversalRobotUR3::Name(), osaUniversalRobotUR5::Name(),
+                              osaUniversalRobotUR10::Name() };
+    osaUniversalRobotKinematics calibrated(*this);
+    for (size_t i = 0; i < 6; i++) {
+        calibrated.CalibrationA[i] = a[i];
+        calibrated.CalibrationD[i] = d[i];
+        calibrated.CalibrationAlpha[i] = alpha[i];
+        calibrated.CalibrationTheta[i] = theta[i];
+    }
+    const std::string current = GetModel();
+    const char *bestModel = 0;
+    double bestDistance = 0.0;
+    for (size_t m = 0; m < 3; m++) {
+        if (!current.empty() && (current != models[m]))
+            continue;
+        osaUniversalRobotKinematics nominal;
+        nominal.SetModel(models[m]);
+        double distance = 0.0;
+        for (size_t c = 0; c < 3; c++) {
+            double R[9], p[3], nominalR[9], nominalP[3];
+            calibrated.ComputeCalibrated(configurations[c], identity, zero, R, p, 0);
+            nominal.Function(configurations[c], identity, zero, nominalR, nominalP, 0);
+            // Position difference (m) and, for the orientation, largest difference of the
+            // rotation matrix elements (about the angle in radians)
+            for (size_t k = 0; k < 3; k++)
+                distance = std::max(distance, std::fabs(p[k] - nominalP[k]));
+            for (size_t k = 0; k < 9; k++)
+                distance = std::max(distance, std::fabs(R[k] - nominalR[k]));
+        }
+        if (!bestModel || (distance < bestDistance)) {
+            bestModel = models[m];
+            bestDistance = distance;
+        }
+    }
+    if (!bestModel || (bestDistance > 0.01))
+        return false;
+    SetModel(bestModel);
+    for (size_t i = 0; i < 6; i++) {
+        CalibrationA[i] = a[i];
+        CalibrationD[i] = d[i];
+        CalibrationAlpha[i] = alpha[i];
+        CalibrationTheta[i] = theta[i];
+    }
+    Calibrated = true;
+    return true;
+}
+
+size_t osaUniversalRobotKinematics::InverseAll(const double rotation[9], const double translation[3],
+                                               double solutions[8][6]) const
+{
+    if (!Inverter)
+        return 0;
+    // Flange = tool pose * inverse(tool offset)
+    double flangeRotation[9];
+    double flangeTranslation[3];
+    for (size_t row = 0; row < 3; row++) {
+        for (size_t column = 0; column < 3; column++)
+            flangeRotation[3*row + column] = rotation[3*row] * ToolRotation[3*column]
+                                           + rotation[3*row + 1] * ToolRotation[3*column + 1]
+                                           + rotation[3*row + 2] * ToolRotation[3*column + 2];
+    }
+    for (size_t row = 0; row < 3; row++)
+        flangeTranslation[row] = translation[row]
+            - (flangeRotation[3*row] * ToolTranslation[0]
+               + flangeRotation[3*row + 1] * ToolTranslation[1]
+               + flangeRotation[3*row + 2] * ToolTranslation[2]);
+    size_t numSolutions = Inverter(flangeRotation, flangeTranslation, solutions);
+    if (!Calibrated)
+        return numSolutions;
+    // Start from the nominal solutions
+    size_t numRefined = 0;
+    for (size_t i = 0; i < numSolutions; i++) {
+        if (!Refine(flangeRotation, flangeTranslation, solutions[i]))
+            continue;
+        for (size_t joint = 0; joint < 6; joint++)
+            solutions[numRefined][joint] = solutions[i][joint];
+        numRefined++;
+    }
+    return numRefined;
+}
+
+bool osaUniversalRobotKinematics::Inverse(const double pose[6], const double seed[6], double q[6]) const
+{
+    double rotation[9];
+    osaUniversalRobotPoseConverter::AxisAngleToRotation(pose + 3, rotation);
+    return Inverse(rotation, pose, seed, q);
+}
+
+bool osaUniversalRobotKinematics::Inverse(const double rotation[9], const double translation[3],
+                                          const double seed[6], double q[6]) const
+{
+    double solutions[8][6];
+    const size_t numSolutions = InverseAll(rotation, translation, solutions);
+    double bestDistance = -1.0;
+    for (size_t i = 0; i < numSolutions; i++) {
+        double distance = 0.0;
+        for (size_t joint = 0; joint < 6; joint++) {
+            double angle = solutions[i][joint];
+            const double difference = angle - seed[joint];
+            if (difference > cmnPI)
+                angle -= 2.0 * cmnPI;
+            else if (difference < -cmnPI)
+                angle += 2.0 * cmnPI;
+            solutions[i][joint] = angle;
+            distance += (angle - seed[joint]) * (angle - seed[joint]);
+        }
+        if ((bestDistance < 0.0) || (distance < bestDistance)) {
+            bestDistance = distance;
+            for (size_t joint = 0; joint < 6; joint++)
+                q[joint] = solutions[i][joint];
+        }
+    }
+    return (numSolutions > 0);
+}
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <math.h>
+#include <stddef.h>
+
+#include <sawUniversalRobot/osaUniversalRobotLatencyHistogram.h>
+
+// Lower bound of the first logarithmic bucket; bucket 0 is for smaller values
+const double MIN_LATENCY = 1.0e-6;
+
+osaUniversalRobotLatencyHistogram::osaUniversalRobotLatencyHistogram(void)
+{
+    Reset();
+}
+
+void osaUniversalRobotLatencyHistogram::Reset(void)
+{
+    for (size_t i = 0; i < NB_BUCKETS; i++)
+        Buckets[i] = 0;
+    NumSamples = 0;
+    Sum = 0.0;
+    Min = 0.0;
+    Max = 0.0;
+}
+
+size_t osaUniversalRobotLatencyHistogram::BucketIndex(double latency)
+{
+    if (latency < MIN_LATENCY)
+        return 0;
+    // latency = mantissa * 2^exponent, with mantissa in [0.5, 1)
+    int exponent;
+    double mantissa = frexp(latency / MIN_LATENCY, &exponent);
+    size_t octave = static_cast<size_t>(exponent - 1);
+    if (octave >= OCTAVES)
+        return NB_BUCKETS - 1;
+    size_t sub = static_cast<size_t>((2.0 * mantissa - 1.0) * SUB_BUCKETS);
+    return 1 + octave * SUB_BUCKETS + sub;
+}
+
+double osaUniversalRobotLatencyHistogram::BucketUpperBound(size_t index)
+{
+    if (index == 0)
+        return MIN_LATENCY;
+    size_t octave = (index - 1) / SUB_BUCKETS;
+    size_t sub = (index - 1) % SUB_BUCKETS;
+    return MIN_LATENCY * ldexp(1.0 + static_cast<double>(sub + 1) / SUB_BUCKETS, static_cast<int>(octave));
+}
+
+void osaUniversalRobotLatencyHistogram::Add(double latency)
+{
+    Buckets[BucketIndex(latency)]++;
+    if ((NumSamples == 0) || (latency < Min))
+        Min = latency;
+    if (latency > Max)
+        Max = latency;
+    Sum += latency;
+    NumSamples++;
+}
+
+double osaUniversalRobotLatencyHistogram::Percentile(double p) const
+{
+    if (NumSamples == 0)
+        return 0.0;
+    const double target = p * NumSamples;
+    unsigned long cumulative = 0;
+    for (size_t i = 0; i < NB_BUCKETS - 1; i++) {
+        cumulative += Buckets[i];
+        if (cumulative >= target) {
+            double bound = BucketUpperBound(i);
+            return (bound < Max) ? bound : Max;
+        }
+    }
+    return Max;
+}
@@ -0,0 +1,166 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cmath>
+
+#include <sawUniversalRobot/osaUniversalRobotCommandEncoder.h>
+#include <sawUniversalRobot/osaUniversalRobotMotionQueue.h>
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+
+// Distance to a waypoint that is not blended at which it is reached; the program
+// sends positions with 4 decimals
+const double POSITION_TOLERANCE = 0.001;      // m
+const double ORIENTATION_TOLERANCE = 0.005;   // rad
+const double JOINT_TOLERANCE = 0.002;         // rad
+
+static double Distance(const double a[3], const double b[3])
+{
+    const double d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    return std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+}
+
+osaUniversalRobotMotionQueue::osaUniversalRobotMotionQueue(size_t capacity):
+    Capacity(capacity),
+    NextId(0),
+    LastCompleted(-1)
+{
+}
+
+void osaUniversalRobotMotionQueue::SetCapacity(size_t capacity)
+{
+    Clear();
+    Capacity = capacity;
+}
+
+bool osaUniversalRobotMotionQueue::Add(Waypoint *waypoints, size_t numWaypoints, Policy policy)
+{
+    size_t kept = Waypoints.size();
+    if (policy == REPLACE)
+        kept = (kept > 0) ? 1 : 0;
+    else if (policy == PREEMPT)
+        kept = 0;
+    if (kept + numWaypoints > Capacity)
+        return false;
+
+    Waypoints.resize(kept);
+    for (size_t i = 0; i < numWaypoints; i++) {
+        Waypoint &waypoint = waypoints[i];
+        if (waypoint.Type == MOVE_LINEAR) {
+            for (size_t k = 0; k < 3; k++)
+                waypoint.ToolPosition[k] = waypoint.Position[k];
+            waypoint.HasToolPosition = true;
+        }
+        if (waypoint.BlendRadius < 0.0)
+            waypoint.BlendRadius = 0.0;
+        waypoint.Id = NextId++;
+        Waypoints.push_back(waypoint);
+    }
+    LimitBlendRadii();
+    return true;
+}
+
+void osaUniversalRobotMotionQueue::LimitBlendRadii(void)
+{
+    for (size_t i = 1; i < Waypoints.size(); i++) {
+        Waypoint &previous = Waypoints[i - 1];
+        Waypoint &waypoint = Waypoints[i];
+        if (!previous.HasToolPosition || !waypoint.HasToolPosition)
+            continue;
+        const double half = 0.5 * Distance(previous.ToolPosition, waypoint.ToolPosition);
+        if (previous.BlendRadius > half)
+            previous.BlendRadius = half;
+        if (waypoint.BlendRadius > half)
+            waypoint.BlendRadius = half;
+    }
+}
+
+void osaUniversalRobotMotionQueue::Pop(void)
+{
+    LastCompleted = Waypoints.front().Id;
+    Waypoints.pop_front();
+}
+
+void osaUniversalRobotMotionQueue::Clear(void)
+{
+    Waypoints.clear();
+}
+
+bool osaUniversalRobotMotionQueue::IsReached(const Waypoint &waypoint, bool last,
+                                             const double jointPosition[6], const double toolPose[6],
+                                             const double *modelToolPosition) const
+{
+    // The last waypoint is not blended (see Compile)
+    const double radius = last ? 0.0 : waypoint.BlendRadius;
+    if (waypoint.Type == MOVE_LINEAR) {
+        if (Distance(toolPose, waypoint.Position) > radius + POSITION_TOLERANCE)
+            return false;
+        if (radius > 0.0)
+            return true;
+        // Angle of the rotation from the waypoint to the tool
+        double goal[9], actual[9];
+        osaUniversalRobotPoseConverter::AxisAngleToRotation(waypoint.Position + 3, goal);
+        osaUniversalRobotPoseConverter::AxisAngleToRotation(toolPose + 3, actual);
+        double trace = 0.0;
+        for (size_t k = 0; k < 9; k++)
+            trace += goal[k] * actual[k];
+        return (0.5 * (trace - 1.0) >= std::cos(ORIENTATION_TOLERANCE));
+    }
+    if ((radius > 0.0) && waypoint.HasToolPosition && modelToolPosition)
+        return (Distance(modelToolPosition, waypoint.ToolPosition) <= radius + POSITION_TOLERANCE);
+    for (size_t i = 0; i < 6; i++) {
+        if (std::fabs(jointPosition[i] - waypoint.Position[i]) > JOINT_TOLERANCE)
+            return false;
+    }
+    return true;
+}
+
+size_t osaUniversalRobotMotionQueue::NumberReached(const double jointPosition[6], const double toolPose[6],
+                                                   const double *modelToolPosition) const
+{
+    const size_t size = Waypoints.size();
+    if (size == 0)
+        return 0;
+    if (IsReached(Waypoints[0], size == 1, jointPosition, toolPose, modelToolPosition))
+        return 1;
+    // A blended joint waypoint without tool position is only detected once the robot
+    // reaches the next one
+    const Waypoint &front = Waypoints[0];
+    if ((size > 1) && (front.Type == MOVE_JOINT) && (front.BlendRadius > 0.0) && !front.HasToolPosition
+        && IsReached(Waypoints[1], size == 2, jointPosition, toolPose, modelToolPosition))
+        return 2;
+    return 0;
+}
+
+bool osaUniversalRobotMotionQueue::Compile(std::string &program) const
+{
+    // Each move is formatted by the same bounds-checked encoder as the single commands
+    osaUniversalRobotCommandEncoder encoder;
+    program = "def saw_ur_queue():\n";
+    for (size_t w = 0; w < Waypoints.size(); w++) {
+        const Waypoint &waypoint = Waypoints[w];
+        const double radius = (w + 1 < Waypoints.size()) ? waypoint.BlendRadius : 0.0;
+        const bool encoded = (waypoint.Type == MOVE_JOINT)
+            ? encoder.MoveJ(waypoint.Position, waypoint.Acceleration, waypoint.Velocity, radius)
+            : encoder.MoveL(waypoint.Position, waypoint.Acceleration, waypoint.Velocity, radius);
+        if (!encoded) {
+            program.clear();
+            return false;
+        }
+        program += "  ";
+        program += encoder.Data();
+    }
+    program += "end\n";
+    return true;
+}
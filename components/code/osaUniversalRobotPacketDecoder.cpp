@@ -0,0 +1,582 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include <cisstCommon/cmnLogger.h>
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+
+#if (CISST_OS == CISST_WINDOWS)
+#include <stdlib.h>
+typedef unsigned __int64 uint64_t;
+#endif
+
+// The portable byte swapping code can be forced (e.g., to test it) by
+// defining SAW_UNIVERSAL_ROBOT_PORTABLE_BYTE_SWAP
+#if !defined(SAW_UNIVERSAL_ROBOT_PORTABLE_BYTE_SWAP)
+#if defined(__GNUC__)
+#define BYTE_SWAP_GNUC
+#elif defined(_MSC_VER)
+#define BYTE_SWAP_MSC
+#endif
+#if defined(__SSSE3__)
+#define BYTE_SWAP_SSSE3
+#include <tmmintrin.h>
+#endif
+#endif
+
+// Packet structs for different versions.  These are only used to compute
+// the field offsets; the network buffer is never cast to these types.
+#pragma pack(push, 1)     // Eliminate structure padding
+struct module1 {
+    uint32_t messageSize;
+    double time;          // Time elapsed since controller was started
+    double qTarget[6];    // Target joint positions
+    double qdTarget[6];   // Target joint velocities
+    double qddTarget[6];  // Target joint accelerations
+    double I_Target[6];   // Target joint currents
+    double M_Target[6];   // Target joint torques
+    double qActual[6];    // Actual joint positions
+    double qdActual[6];   // Actual joint velocities
+    double I_Actual[6];   // Actual joint currents
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct module2 {
+    unsigned long long digital_Input;  // Digital input bitmask
+    double motor_Tem[6];      // Joint temperatures (degC)
+    double controller_Time;   // Controller real-time thread execution time
+    double test_Val;          // UR internal use only
+    double robot_Mode;        // Robot mode (see RobotModes enum)
+    double joint_Modes[6];    // Joint control modes (Version 1.8+, see JointModes enum)
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct packet_pre_3 {
+    module1 base1;
+    double tool_Accele[3];    // Tool accelerometer values (Version 1.7+)
+    double blank[15];         // Unused
+    double TCP_force[6];      // Generalized forces in the TCP
+    double tool_Vector[6];    // Tool Cartesian pose (x, y, z, rx, ry, rz)
+    double TCP_speed[6];      // Tool Cartesian speed
+    module2 base2;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct packet_30_31 {
+    module1 base1;
+    double I_ctrl[6];         // Joint control currents
+    double tool_vec_Act[6];   // Actual tool Cartesian pose (x, y, z, rx, ry, rz)
+    double TCP_speed_Act[6];  // Actual tool Cartesian speed
+    double TCP_force[6];      // Generalized forces in the TCP
+    double tool_vec_Tar[6];   // Target tool Cartesian pose (x, y, z, rx, ry, rz)
+    double TCP_speed_Tar[6];  // Target tool Cartesian speed
+    module2 base2;
+    double safety_Mode;       // Safety mode
+    double blank1[6];         // UR software only
+    double tool_Accele[3];    // Tool accelerometer values
+    double blank2[6];         // UR software only
+    double speed_Scal;        // Speed scaling of trajectory limiter
+    double linear_M_norm;     // Norm of Cartesian linear momentum
+    double blank3;            // UR software only
+    double blank4;            // UR software only
+    double V_main;            // Masterboard main voltage
+    double V_robot;           // Masterboard robot voltage (48V)
+    double I_robot;           // Masterboard robot current
+    double V_joint_Act[6];    // Actual joint voltages
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct packet_32 : packet_30_31 {
+    unsigned long long digital_Output; // Digital outputs
+    double program_State;     // Program state
+};
+#pragma pack(pop)
+
+const unsigned long osaUniversalRobotPacketDecoder::PacketLength[VER_MAX] = {
+       0,  // VER_UNKNOWN
+     764,  // VER_PRE_18
+     812,  // VER_18
+    1044,  // VER_30_31
+    1060   // VER_32
+};
+
+// Field tables, used to export all the fields (e.g., telemetry)
+#define MODULE1_FIELDS \
+    { "time",        offsetof(module1, time),      1, false }, \
+    { "q_target",    offsetof(module1, qTarget),   6, false }, \
+    { "qd_target",   offsetof(module1, qdTarget),  6, false }, \
+    { "qdd_target",  offsetof(module1, qddTarget), 6, false }, \
+    { "i_target",    offsetof(module1, I_Target),  6, false }, \
+    { "m_target",    offsetof(module1, M_Target),  6, false }, \
+    { "q_actual",    offsetof(module1, qActual),   6, false }, \
+    { "qd_actual",   offsetof(module1, qdActual),  6, false }, \
+    { "i_actual",    offsetof(module1, I_Actual),  6, false }
+
+#define MODULE2_FIELDS(_packet) \
+    { "digital_inputs",     offsetof(_packet, base2) + offsetof(module2, digital_Input),   1, true }, \
+    { "motor_temperatures", offsetof(_packet, base2) + offsetof(module2, motor_Tem),       6, false }, \
+    { "controller_time",    offsetof(_packet, base2) + offsetof(module2, controller_Time), 1, false }, \
+    { "robot_mode",         offsetof(_packet, base2) + offsetof(module2, robot_Mode),      1, false }
+
+#define JOINT_MODES_FIELD(_packet) \
+    { "joint_modes",        offsetof(_packet, base2) + offsetof(module2, joint_Modes),     6, false }
+
+#define PACKET_3_FIELDS \
+    { "i_control",          offsetof(packet_30_31, I_ctrl),        6, false }, \
+    { "tool_vector_actual", offsetof(packet_30_31, tool_vec_Act),  6, false }, \
+    { "tcp_speed_actual",   offsetof(packet_30_31, TCP_speed_Act), 6, false }, \
+    { "tcp_force",          offsetof(packet_30_31, TCP_force),     6, false }, \
+    { "tool_vector_target", offsetof(packet_30_31, tool_vec_Tar),  6, false }, \
+    { "tcp_speed_target",   offsetof(packet_30_31, TCP_speed_Tar), 6, false }, \
+    MODULE2_FIELDS(packet_30_31), \
+    JOINT_MODES_FIELD(packet_30_31), \
+    { "safety_mode",          offsetof(packet_30_31, safety_Mode),   1, false }, \
+    { "tool_accelerometer",   offsetof(packet_30_31, tool_Accele),   3, false }, \
+    { "speed_scaling",        offsetof(packet_30_31, speed_Scal),    1, false }, \
+    { "linear_momentum_norm", offsetof(packet_30_31, linear_M_norm), 1, false }, \
+    { "v_main",               offsetof(packet_30_31, V_main),        1, false }, \
+    { "v_robot",              offsetof(packet_30_31, V_robot),       1, false }, \
+    { "i_robot",              offsetof(packet_30_31, I_robot),       1, false }, \
+    { "v_joint_actual",       offsetof(packet_30_31, V_joint_Act),   6, false }
+
+static const osaUniversalRobotPacketDecoder::Field FieldsPre18[] = {
+    MODULE1_FIELDS,
+    { "tool_accelerometer", offsetof(packet_pre_3, tool_Accele), 3, false },
+    { "tcp_force",          offsetof(packet_pre_3, TCP_force),   6, false },
+    { "tool_vector",        offsetof(packet_pre_3, tool_Vector), 6, false },
+    { "tcp_speed",          offsetof(packet_pre_3, TCP_speed),   6, false },
+    MODULE2_FIELDS(packet_pre_3)
+};
+
+static const osaUniversalRobotPacketDecoder::Field Fields18[] = {
+    MODULE1_FIELDS,
+    { "tool_accelerometer", offsetof(packet_pre_3, tool_Accele), 3, false },
+    { "tcp_force",          offsetof(packet_pre_3, TCP_force),   6, false },
+    { "tool_vector",        offsetof(packet_pre_3, tool_Vector), 6, false },
+    { "tcp_speed",          offsetof(packet_pre_3, TCP_speed),   6, false },
+    MODULE2_FIELDS(packet_pre_3),
+    JOINT_MODES_FIELD(packet_pre_3)
+};
+
+static const osaUniversalRobotPacketDecoder::Field Fields3031[] = {
+    MODULE1_FIELDS,
+    PACKET_3_FIELDS
+};
+
+static const osaUniversalRobotPacketDecoder::Field Fields32[] = {
+    MODULE1_FIELDS,
+    PACKET_3_FIELDS,
+    // packet_32 extends packet_30_31 (offsetof is not standard for derived structs)
+    { "digital_outputs", sizeof(packet_30_31),     1, true },
+    { "program_state",   sizeof(packet_30_31) + 8, 1, false }
+};
+
+#define NB_FIELDS(_table) (sizeof(_table) / sizeof(_table[0]))
+
+const osaUniversalRobotPacketDecoder::Field *
+osaUniversalRobotPacketDecoder::GetFields(FirmwareVersion version, size_t &numFields)
+{
+    switch (version) {
+    case VER_PRE_18:
+        numFields = NB_FIELDS(FieldsPre18);
+        return FieldsPre18;
+    case VER_18:
+        numFields = NB_FIELDS(Fields18);
+        return Fields18;
+    case VER_30_31:
+        numFields = NB_FIELDS(Fields3031);
+        return Fields3031;
+    case VER_32:
+        numFields = NB_FIELDS(Fields32);
+        return Fields32;
+    default:
+        numFields = 0;
+        return 0;
+    }
+}
+
+// Byte swapping helpers.  All multi-byte fields are big-endian on the wire.
+// memcpy is used for unaligned loads; compilers reduce it to a single move.
+static inline uint32_t LoadBigEndian32(const char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(BYTE_SWAP_GNUC)
+    return __builtin_bswap32(value);
+#elif defined(BYTE_SWAP_MSC)
+    return _byteswap_ulong(value);
+#else
+    return ((value & 0x000000ffUL) << 24) | ((value & 0x0000ff00UL) << 8)
+         | ((value & 0x00ff0000UL) >> 8)  | ((value & 0xff000000UL) >> 24);
+#endif
+}
+
+static inline double LoadBigEndianDouble(const char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(BYTE_SWAP_GNUC)
+    value = __builtin_bswap64(value);
+#elif defined(BYTE_SWAP_MSC)
+    value = _byteswap_uint64(value);
+#else
+    value = (static_cast<uint64_t>(LoadBigEndian32(p)) << 32) | LoadBigEndian32(p + 4);
+#endif
+    double result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// Load the 6 consecutive big-endian doubles starting at p
+static inline void LoadBigEndianVec6(const char *p, double *out)
+{
+#if defined(BYTE_SWAP_SSSE3)
+    // Swap two doubles at a time with a single byte shuffle
+    const __m128i mask = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,
+                                      0, 1, 2, 3, 4, 5, 6, 7);
+    for (size_t i = 0; i < 6; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8*i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(v, mask));
+    }
+#else
+    for (size_t i = 0; i < 6; i++)
+        out[i] = LoadBigEndianDouble(p + 8*i);
+#endif
+}
+
+static inline void StoreBigEndian32(char *p, uint32_t value)
+{
+    for (size_t i = 4; i > 0; i--) {
+        p[i-1] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+static inline void StoreBigEndianDouble(char *p, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (size_t i = 8; i > 0; i--) {
+        p[i-1] = static_cast<char>(bits & 0xff);
+        bits >>= 8;
+    }
+}
+
+static inline void StoreBigEndianVec6(char *p, const double *values)
+{
+    for (size_t i = 0; i < 6; i++)
+        StoreBigEndianDouble(p + 8*i, values[i]);
+}
+
+// Digital input/output bits are sent as 64-bit integers
+static inline double LoadBigEndianBits(const char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(BYTE_SWAP_GNUC)
+    value = __builtin_bswap64(value);
+#elif defined(BYTE_SWAP_MSC)
+    value = _byteswap_uint64(value);
+#else
+    value = (static_cast<uint64_t>(LoadBigEndian32(p)) << 32) | LoadBigEndian32(p + 4);
+#endif
+    return static_cast<double>(value);
+}
+
+static inline void StoreBigEndianBits(char *p, double value)
+{
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (size_t i = 8; i > 0; i--) {
+        p[i-1] = static_cast<char>(bits & 0xff);
+        bits >>= 8;
+    }
+}
+
+static inline void LoadBigEndianVec(const char *p, double *out, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        out[i] = LoadBigEndianDouble(p + 8*i);
+}
+
+static inline void StoreBigEndianVec(char *p, const double *values, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        StoreBigEndianDouble(p + 8*i, values[i]);
+}
+
+static inline void ZeroVec(double *values, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        values[i] = 0.0;
+}
+
+// Offsets of the fields that differ between packet layouts, and fields available
+struct LayoutPre3 {
+    enum { TOOL_VECTOR = offsetof(packet_pre_3, tool_Vector),
+           TCP_SPEED   = offsetof(packet_pre_3, TCP_speed),
+           TCP_FORCE   = offsetof(packet_pre_3, TCP_force),
+           TOOL_ACCELEROMETER = offsetof(packet_pre_3, tool_Accele),
+           BASE2       = offsetof(packet_pre_3, base2),
+           DIGITAL_OUTPUTS = 0,
+           PROGRAM_STATE   = 0 };
+    enum { JOINT_MODES = false, PACKET_3 = false, PACKET_32 = false };
+};
+
+struct Layout18 : public LayoutPre3 {
+    enum { JOINT_MODES = true };
+};
+
+struct Layout3 {
+    enum { TOOL_VECTOR = offsetof(packet_30_31, tool_vec_Act),
+           TCP_SPEED   = offsetof(packet_30_31, TCP_speed_Act),
+           TCP_FORCE   = offsetof(packet_30_31, TCP_force),
+           TOOL_ACCELEROMETER = offsetof(packet_30_31, tool_Accele),
+           BASE2       = offsetof(packet_30_31, base2),
+           // packet_32 extends packet_30_31 (offsetof is not standard for derived structs)
+           DIGITAL_OUTPUTS = sizeof(packet_30_31),
+           PROGRAM_STATE   = sizeof(packet_30_31) + 8 };
+    enum { JOINT_MODES = true, PACKET_3 = true, PACKET_32 = false };
+};
+
+struct Layout32 : public Layout3 {
+    enum { PACKET_32 = true };
+};
+
+// One instance per packet layout; all offsets are compile-time constants and the
+// tests on the fields available are resolved at compile time
+template <class _layout>
+static void DecodeLayout(const char *packet, osaUniversalRobotSample &sample)
+{
+    sample.Time = LoadBigEndianDouble(packet + offsetof(module1, time));
+    LoadBigEndianVec6(packet + offsetof(module1, qActual), sample.JointPosition);
+    LoadBigEndianVec6(packet + offsetof(module1, qdActual), sample.JointVelocity);
+    LoadBigEndianVec6(packet + offsetof(module1, I_Actual), sample.JointCurrent);
+    LoadBigEndianVec6(packet + offsetof(module1, qTarget), sample.JointTargetPosition);
+    LoadBigEndianVec6(packet + offsetof(module1, qdTarget), sample.JointTargetVelocity);
+    LoadBigEndianVec6(packet + offsetof(module1, I_Target), sample.JointTargetCurrent);
+    LoadBigEndianVec6(packet + offsetof(module1, qddTarget), sample.JointTargetAcceleration);
+    LoadBigEndianVec6(packet + offsetof(module1, M_Target), sample.JointTargetTorque);
+    // For pre-3.0 versions, documentation does not specify whether tool_Vector field
+    // is the actual or target Cartesian position.
+    LoadBigEndianVec6(packet + _layout::TOOL_VECTOR, sample.ToolVector);
+    LoadBigEndianVec6(packet + _layout::TCP_SPEED, sample.TCPSpeed);
+    LoadBigEndianVec6(packet + _layout::TCP_FORCE, sample.TCPForce);
+    LoadBigEndianVec(packet + _layout::TOOL_ACCELEROMETER, sample.ToolAccelerometer, 3);
+    // Following is documented to be "controller realtime thread execution time"
+    sample.ControllerExecTime = LoadBigEndianDouble(packet + _layout::BASE2
+                                                    + offsetof(module2, controller_Time));
+    sample.RobotMode = LoadBigEndianDouble(packet + _layout::BASE2 + offsetof(module2, robot_Mode));
+    sample.DigitalInputs = LoadBigEndianBits(packet + _layout::BASE2 + offsetof(module2, digital_Input));
+    LoadBigEndianVec6(packet + _layout::BASE2 + offsetof(module2, motor_Tem), sample.MotorTemperature);
+    if (_layout::JOINT_MODES)
+        LoadBigEndianVec6(packet + _layout::BASE2 + offsetof(module2, joint_Modes), sample.JointMode);
+    else
+        ZeroVec(sample.JointMode, 6);
+
+    if (_layout::PACKET_3) {
+        LoadBigEndianVec6(packet + offsetof(packet_30_31, I_ctrl), sample.JointControlCurrent);
+        LoadBigEndianVec6(packet + offsetof(packet_30_31, tool_vec_Tar), sample.ToolTargetVector);
+        LoadBigEndianVec6(packet + offsetof(packet_30_31, TCP_speed_Tar), sample.TCPTargetSpeed);
+        LoadBigEndianVec6(packet + offsetof(packet_30_31, V_joint_Act), sample.JointVoltage);
+        sample.SafetyMode = LoadBigEndianDouble(packet + offsetof(packet_30_31, safety_Mode));
+        sample.SpeedScaling = LoadBigEndianDouble(packet + offsetof(packet_30_31, speed_Scal));
+        sample.LinearMomentumNorm = LoadBigEndianDouble(packet + offsetof(packet_30_31, linear_M_norm));
+        sample.MainVoltage = LoadBigEndianDouble(packet + offsetof(packet_30_31, V_main));
+        sample.RobotVoltage = LoadBigEndianDouble(packet + offsetof(packet_30_31, V_robot));
+        sample.RobotCurrent = LoadBigEndianDouble(packet + offsetof(packet_30_31, I_robot));
+    }
+    else {
+        ZeroVec(sample.JointControlCurrent, 6);
+        ZeroVec(sample.ToolTargetVector, 6);
+        ZeroVec(sample.TCPTargetSpeed, 6);
+        ZeroVec(sample.JointVoltage, 6);
+        sample.SafetyMode = 0.0;
+        sample.SpeedScaling = 0.0;
+        sample.LinearMomentumNorm = 0.0;
+        sample.MainVoltage = 0.0;
+        sample.RobotVoltage = 0.0;
+        sample.RobotCurrent = 0.0;
+    }
+
+    if (_layout::PACKET_32) {
+        sample.DigitalOutputs = LoadBigEndianBits(packet + _layout::DIGITAL_OUTPUTS);
+        sample.ProgramState = LoadBigEndianDouble(packet + _layout::PROGRAM_STATE);
+    }
+    else {
+        sample.DigitalOutputs = 0.0;
+        sample.ProgramState = 0.0;
+    }
+}
+
+template <class _layout>
+static void EncodeLayout(const osaUniversalRobotSample &sample, char *packet)
+{
+    StoreBigEndianDouble(packet + offsetof(module1, time), sample.Time);
+    StoreBigEndianVec6(packet + offsetof(module1, qActual), sample.JointPosition);
+    StoreBigEndianVec6(packet + offsetof(module1, qdActual), sample.JointVelocity);
+    StoreBigEndianVec6(packet + offsetof(module1, I_Actual), sample.JointCurrent);
+    StoreBigEndianVec6(packet + offsetof(module1, qTarget), sample.JointTargetPosition);
+    StoreBigEndianVec6(packet + offsetof(module1, qdTarget), sample.JointTargetVelocity);
+    StoreBigEndianVec6(packet + offsetof(module1, I_Target), sample.JointTargetCurrent);
+    StoreBigEndianVec6(packet + offsetof(module1, qddTarget), sample.JointTargetAcceleration);
+    StoreBigEndianVec6(packet + offsetof(module1, M_Target), sample.JointTargetTorque);
+    StoreBigEndianVec6(packet + _layout::TOOL_VECTOR, sample.ToolVector);
+    StoreBigEndianVec6(packet + _layout::TCP_SPEED, sample.TCPSpeed);
+    StoreBigEndianVec6(packet + _layout::TCP_FORCE, sample.TCPForce);
+    StoreBigEndianVec(packet + _layout::TOOL_ACCELEROMETER, sample.ToolAccelerometer, 3);
+    StoreBigEndianDouble(packet + _layout::BASE2 + offsetof(module2, controller_Time),
+                         sample.ControllerExecTime);
+    StoreBigEndianDouble(packet + _layout::BASE2 + offsetof(module2, robot_Mode), sample.RobotMode);
+    StoreBigEndianBits(packet + _layout::BASE2 + offsetof(module2, digital_Input), sample.DigitalInputs);
+    StoreBigEndianVec6(packet + _layout::BASE2 + offsetof(module2, motor_Tem), sample.MotorTemperature);
+    if (_layout::JOINT_MODES)
+        StoreBigEndianVec6(packet + _layout::BASE2 + offsetof(module2, joint_Modes), sample.JointMode);
+    if (_layout::PACKET_3) {
+        StoreBigEndianVec6(packet + offsetof(packet_30_31, I_ctrl), sample.JointControlCurrent);
+        StoreBigEndianVec6(packet + offsetof(packet_30_31, tool_vec_Tar), sample.ToolTargetVector);
+        StoreBigEndianVec6(packet + offsetof(packet_30_31, TCP_speed_Tar), sample.TCPTargetSpeed);
+        StoreBigEndianVec6(packet + offsetof(packet_30_31, V_joint_Act), sample.JointVoltage);
+        StoreBigEndianDouble(packet + offsetof(packet_30_31, safety_Mode), sample.SafetyMode);
+        StoreBigEndianDouble(packet + offsetof(packet_30_31, speed_Scal), sample.SpeedScaling);
+        StoreBigEndianDouble(packet + offsetof(packet_30_31, linear_M_norm), sample.LinearMomentumNorm);
+        StoreBigEndianDouble(packet + offsetof(packet_30_31, V_main), sample.MainVoltage);
+        StoreBigEndianDouble(packet + offsetof(packet_30_31, V_robot), sample.RobotVoltage);
+        StoreBigEndianDouble(packet + offsetof(packet_30_31, I_robot), sample.RobotCurrent);
+    }
+    if (_layout::PACKET_32) {
+        StoreBigEndianBits(packet + _layout::DIGITAL_OUTPUTS, sample.DigitalOutputs);
+        StoreBigEndianDouble(packet + _layout::PROGRAM_STATE, sample.ProgramState);
+    }
+}
+
+osaUniversalRobotPacketDecoder::osaUniversalRobotPacketDecoder(void) :
+    Version(VER_UNKNOWN), DecodeCurrent(0), Resync(false)
+{
+    for (size_t i = 0; i < VER_MAX; i++)
+        PacketCount[i] = 0;
+}
+
+osaUniversalRobotPacketDecoder::FirmwareVersion
+osaUniversalRobotPacketDecoder::VersionFromLength(unsigned long length)
+{
+    for (int i = VER_UNKNOWN+1; i < VER_MAX; i++) {
+        if (length == PacketLength[i])
+            return static_cast<FirmwareVersion>(i);
+    }
+    return VER_UNKNOWN;
+}
+
+uint32_t osaUniversalRobotPacketDecoder::PacketLengthFromHeader(const char *buffer)
+{
+    return LoadBigEndian32(buffer);
+}
+
+osaUniversalRobotPacketDecoder::DecodeFunction
+osaUniversalRobotPacketDecoder::GetDecodeFunction(FirmwareVersion version)
+{
+    switch (version) {
+    case VER_PRE_18:
+        return &DecodeLayout<LayoutPre3>;
+    case VER_18:
+        return &DecodeLayout<Layout18>;
+    case VER_30_31:
+        return &DecodeLayout<Layout3>;
+    case VER_32:
+        return &DecodeLayout<Layout32>;
+    default:
+        return 0;
+    }
+}
+
+osaUniversalRobotPacketDecoder::FirmwareVersion
+osaUniversalRobotPacketDecoder::Update(unsigned long packageLength)
+{
+    FirmwareVersion ver = VersionFromLength(packageLength);
+    PacketCount[ver]++;
+    if (ver != VER_UNKNOWN) {
+        if (Version == VER_UNKNOWN)
+            SetVersion(ver);
+        else if (Resync) {
+            if (ver != Version) {
+                CMN_LOG_RUN_WARNING << "osaUniversalRobotPacketDecoder: version changed from "
+                                    << Version << " to " << ver << " after reconnection" << std::endl;
+                SetVersion(ver);
+            }
+            Resync = false;
+        }
+        else if (ver != Version) {
+            // Could we have auto-detected the wrong version?
+            if (PacketCount[ver] > PacketCount[Version]) {
+                CMN_LOG_RUN_WARNING << "osaUniversalRobotPacketDecoder: switching from version "
+                                    << Version << " to version " << ver << std::endl;
+                SetVersion(ver);
+            }
+        }
+    }
+    return Version;
+}
+
+void osaUniversalRobotPacketDecoder::SetVersion(FirmwareVersion version)
+{
+    Version = version;
+    DecodeCurrent = GetDecodeFunction(version);
+}
+
+bool osaUniversalRobotPacketDecoder::Decode(const char *packet, unsigned long length,
+                                            osaUniversalRobotSample &sample) const
+{
+    if (!DecodeCurrent || (length < PacketLength[Version]))
+        return false;
+    DecodeCurrent(packet, sample);
+    return true;
+}
+
+void osaUniversalRobotPacketDecoder::DecodePacket(const char *packet, unsigned long length,
+                                                  osaUniversalRobotDecodedPacket &result)
+{
+    result.Length = length;
+    result.Version = Update(length);
+    result.Decoded = Decode(packet, length, result.Sample);
+}
+
+bool osaUniversalRobotPacketDecoder::Encode(FirmwareVersion version, const osaUniversalRobotSample &sample,
+                                            char *packet, unsigned long size)
+{
+    if ((version <= VER_UNKNOWN) || (version >= VER_MAX) || (size < PacketLength[version]))
+        return false;
+    memset(packet, 0, PacketLength[version]);
+    StoreBigEndian32(packet, static_cast<uint32_t>(PacketLength[version]));
+    switch (version) {
+    case VER_PRE_18:
+        EncodeLayout<LayoutPre3>(sample, packet);
+        break;
+    case VER_18:
+        EncodeLayout<Layout18>(sample, packet);
+        break;
+    case VER_30_31:
+        EncodeLayout<Layout3>(sample, packet);
+        break;
+    default:
+        EncodeLayout<Layout32>(sample, packet);
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cmath>
+#include <cstring>
+
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+
+// Below this squared angle, the Taylor series are used (the error of the second
+// order terms is below the double precision)
+const double SMALL_ANGLE_SQUARED = 1.0e-8;
+
+osaUniversalRobotPoseConverter::osaUniversalRobotPoseConverter(void) :
+    Valid(false)
+{
+    memset(Pose, 0, sizeof(Pose));
+    AxisAngleToRotation(Pose + 3, RotationMatrix);
+}
+
+void osaUniversalRobotPoseConverter::AxisAngleToRotation(const double axisAngle[3], double rotation[9])
+{
+    const double x = axisAngle[0];
+    const double y = axisAngle[1];
+    const double z = axisAngle[2];
+    const double angleSquared = x * x + y * y + z * z;
+    // R = I + a [v]x + b [v]x^2, with a = sin(t)/t and b = (1 - cos(t))/t^2
+    double a, b;
+    if (angleSquared < SMALL_ANGLE_SQUARED) {
+        a = 1.0 - angleSquared / 6.0;
+        b = 0.5 - angleSquared / 24.0;
+    }
+    else {
+        const double angle = std::sqrt(angleSquared);
+        a = std::sin(angle) / angle;
+        b = (1.0 - std::cos(angle)) / angleSquared;
+    }
+    const double bxy = b * x * y;
+    const double bxz = b * x * z;
+    const double byz = b * y * z;
+    rotation[0] = 1.0 - b * (y * y + z * z);
+    rotation[1] = bxy - a * z;
+    rotation[2] = bxz + a * y;
+    rotation[3] = bxy + a * z;
+    rotation[4] = 1.0 - b * (x * x + z * z);
+    rotation[5] = byz - a * x;
+    rotation[6] = bxz - a * y;
+    rotation[7] = byz + a * x;
+    rotation[8] = 1.0 - b * (x * x + y * y);
+}
+
+void osaUniversalRobotPoseConverter::RotationToAxisAngle(const double rotation[9], double axisAngle[3])
+{
+    // sin(t) n from the antisymmetric part, cos(t) from the trace
+    double v[3] = { 0.5 * (rotation[7] - rotation[5]),
+                    0.5 * (rotation[2] - rotation[6]),
+                    0.5 * (rotation[3] - rotation[1]) };
+    const double s = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    const double c = 0.5 * (rotation[0] + rotation[4] + rotation[8] - 1.0);
+    const double angle = std::atan2(s, c);
+    if (c > -0.99) {
+        const double scale = (s > 1.0e-12) ? angle / s : 1.0;
+        for (size_t i = 0; i < 3; i++)
+            axisAngle[i] = scale * v[i];
+        return;
+    }
+    // Close to pi, sin(t) is not precise enough: the symmetric part is
+    // cos(t) I + (1 - cos(t)) n n^T, use its largest diagonal element
+    size_t k = 0;
+    if (rotation[4] > rotation[3*k + k])
+        k = 1;
+    if (rotation[8] > rotation[3*k + k])
+        k = 2;
+    double n[3];
+    for (size_t i = 0; i < 3; i++)
+        n[i] = 0.5 * (rotation[3*i + k] + rotation[3*k + i]) - ((i == k) ? c : 0.0);
+    const double norm = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    // The sign of the axis is given by sin(t) n
+    const double sign = ((n[0] * v[0] + n[1] * v[1] + n[2] * v[2]) < 0.0) ? -1.0 : 1.0;
+    for (size_t i = 0; i < 3; i++)
+        axisAngle[i] = sign * angle * n[i] / norm;
+}
+
+bool osaUniversalRobotPoseConverter::Update(const double pose[6])
+{
+    // Bit-wise comparison: no recomputation for an idle robot
+    if (Valid && (memcmp(pose, Pose, sizeof(Pose)) == 0))
+        return false;
+    memcpy(Pose, pose, sizeof(Pose));
+    AxisAngleToRotation(Pose + 3, RotationMatrix);
+    Valid = true;
+    return true;
+}
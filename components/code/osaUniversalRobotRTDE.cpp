@@ -0,0 +1,493 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include <cisstCommon/cmnLogger.h>
+#include <sawUniversalRobot/osaUniversalRobotClock.h>
+#include <sawUniversalRobot/osaUniversalRobotRTDE.h>
+
+#if (CISST_OS == CISST_WINDOWS)
+typedef unsigned __int64 uint64_t;
+#endif
+
+// All multi-byte fields are big-endian on the wire
+static inline uint64_t LoadBigEndian(const char *p, size_t numBytes)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    uint64_t value = 0;
+    for (size_t i = 0; i < numBytes; i++)
+        value = (value << 8) | u[i];
+    return value;
+}
+
+static inline double LoadBigEndianDouble(const char *p)
+{
+    const uint64_t value = LoadBigEndian(p, 8);
+    double result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+static inline void StoreBigEndian(char *p, uint64_t value, size_t numBytes)
+{
+    for (size_t i = numBytes; i > 0; i--) {
+        p[i-1] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+static inline void StoreBigEndianDouble(char *p, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    StoreBigEndian(p, bits, 8);
+}
+
+// Output fields that can be subscribed, with the corresponding sample member
+struct SampleField {
+    const char *Name;
+    osaUniversalRobotRTDE::FieldType Type;
+    size_t Offset;
+};
+
+static const SampleField SampleFields[] = {
+    { "timestamp",             osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, Time) },
+    { "actual_q",              osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointPosition) },
+    { "actual_qd",             osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointVelocity) },
+    { "actual_current",        osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointCurrent) },
+    { "target_q",              osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointTargetPosition) },
+    { "target_qd",             osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointTargetVelocity) },
+    { "target_current",        osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointTargetCurrent) },
+    { "actual_TCP_pose",       osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, ToolVector) },
+    { "actual_TCP_speed",      osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, TCPSpeed) },
+    { "actual_TCP_force",      osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, TCPForce) },
+    { "actual_execution_time", osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, ControllerExecTime) },
+    { "robot_mode",            osaUniversalRobotRTDE::TYPE_INT32,    offsetof(osaUniversalRobotSample, RobotMode) },
+    { "target_qdd",            osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointTargetAcceleration) },
+    { "target_moment",         osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointTargetTorque) },
+    { "joint_temperatures",    osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, MotorTemperature) },
+    { "actual_digital_input_bits",  osaUniversalRobotRTDE::TYPE_UINT64, offsetof(osaUniversalRobotSample, DigitalInputs) },
+    { "actual_tool_accelerometer",  osaUniversalRobotRTDE::TYPE_VECTOR3D, offsetof(osaUniversalRobotSample, ToolAccelerometer) },
+    { "joint_mode",            osaUniversalRobotRTDE::TYPE_VECTOR6INT32, offsetof(osaUniversalRobotSample, JointMode) },
+    { "joint_control_output",  osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointControlCurrent) },
+    { "target_TCP_pose",       osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, ToolTargetVector) },
+    { "target_TCP_speed",      osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, TCPTargetSpeed) },
+    { "actual_joint_voltage",  osaUniversalRobotRTDE::TYPE_VECTOR6D, offsetof(osaUniversalRobotSample, JointVoltage) },
+    { "safety_mode",           osaUniversalRobotRTDE::TYPE_INT32,    offsetof(osaUniversalRobotSample, SafetyMode) },
+    { "speed_scaling",         osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, SpeedScaling) },
+    { "actual_momentum",       osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, LinearMomentumNorm) },
+    { "actual_main_voltage",   osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, MainVoltage) },
+    { "actual_robot_voltage",  osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, RobotVoltage) },
+    { "actual_robot_current",  osaUniversalRobotRTDE::TYPE_DOUBLE,   offsetof(osaUniversalRobotSample, RobotCurrent) },
+    { "actual_digital_output_bits", osaUniversalRobotRTDE::TYPE_UINT64, offsetof(osaUniversalRobotSample, DigitalOutputs) },
+    { "runtime_state",         osaUniversalRobotRTDE::TYPE_UINT32,   offsetof(osaUniversalRobotSample, ProgramState) }
+};
+
+const size_t NB_SAMPLE_FIELDS = sizeof(SampleFields)/sizeof(SampleFields[0]);
+
+// Size of package header (2-byte size and 1-byte type)
+const size_t HEADER_SIZE = 3;
+
+osaUniversalRobotRTDE::osaUniversalRobotRTDE(void) :
+    Framer(16384, 2), ProtocolVersion(1), Frequency(0.0), OutputRecipeId(0), OutputLength(0)
+{
+    Framer.SetLengthRange(HEADER_SIZE, 8192);
+}
+
+bool osaUniversalRobotRTDE::Connect(const std::string &host, unsigned short port)
+{
+    Framer.Reset();
+    Outputs.clear();
+    Inputs.clear();
+    return Socket.Connect(host, port);
+}
+
+void osaUniversalRobotRTDE::Close(void)
+{
+    Socket.Close();
+    Framer.Reset();
+}
+
+const std::vector<std::string> & osaUniversalRobotRTDE::DefaultOutputs(void)
+{
+    static std::vector<std::string> names;
+    if (names.empty()) {
+        names.push_back("timestamp");
+        names.push_back("actual_q");
+        names.push_back("actual_qd");
+        names.push_back("actual_current");
+        names.push_back("actual_TCP_pose");
+        names.push_back("actual_TCP_speed");
+        names.push_back("actual_TCP_force");
+        names.push_back("robot_mode");
+    }
+    return names;
+}
+
+// Names of the types, in the order of FieldType
+static const char *TypeNames[osaUniversalRobotRTDE::TYPE_UNKNOWN] = {
+    "BOOL", "UINT8", "UINT32", "UINT64", "INT32", "DOUBLE",
+    "VECTOR3D", "VECTOR6D", "VECTOR6INT32", "VECTOR6UINT32" };
+
+osaUniversalRobotRTDE::FieldType osaUniversalRobotRTDE::TypeFromName(const std::string &name)
+{
+    for (int i = 0; i < TYPE_UNKNOWN; i++) {
+        if (name == TypeNames[i])
+            return static_cast<FieldType>(i);
+    }
+    return TYPE_UNKNOWN;
+}
+
+size_t osaUniversalRobotRTDE::TypeSize(FieldType type)
+{
+    switch (type) {
+    case TYPE_BOOL:
+    case TYPE_UINT8:          return 1;
+    case TYPE_UINT32:
+    case TYPE_INT32:          return 4;
+    case TYPE_UINT64:
+    case TYPE_DOUBLE:         return 8;
+    case TYPE_VECTOR3D:       return 24;
+    case TYPE_VECTOR6D:       return 48;
+    case TYPE_VECTOR6INT32:
+    case TYPE_VECTOR6UINT32:  return 24;
+    default:                  return 0;
+    }
+}
+
+bool osaUniversalRobotRTDE::ParseTypes(const char *names, size_t size, std::vector<FieldType> &types)
+{
+    types.clear();
+    std::string list(names, size);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        const std::string name = list.substr(start, end - start);
+        FieldType type = TypeFromName(name);
+        if (type == TYPE_UNKNOWN) {
+            // NOT_FOUND or IN_USE
+            CMN_LOG_INIT_ERROR << "osaUniversalRobotRTDE: field " << types.size()
+                               << " not available: " << name << std::endl;
+            return false;
+        }
+        types.push_back(type);
+        start = end + 1;
+    }
+    return true;
+}
+
+std::string osaUniversalRobotRTDE::TextMessage(const char *payload, size_t size) const
+{
+    // Version 2: message length, message, source length, source, warning level
+    if (ProtocolVersion >= 2) {
+        const size_t messageSize = (size > 0) ? static_cast<unsigned char>(payload[0]) : size;
+        if (messageSize + 2 <= size) {
+            const size_t sourceSize = static_cast<unsigned char>(payload[messageSize + 1]);
+            if (messageSize + sourceSize + 2 <= size)
+                return std::string(payload + messageSize + 2, sourceSize) + ": "
+                     + std::string(payload + 1, messageSize);
+        }
+    }
+    // Version 1: the payload is the message
+    return std::string(payload, size);
+}
+
+bool osaUniversalRobotRTDE::SendPackage(char type, const char *payload, size_t size)
+{
+    const size_t length = HEADER_SIZE + size;
+    if (SendBuffer.size() < length)
+        SendBuffer.resize(length);
+    StoreBigEndian(&SendBuffer[0], length, 2);
+    SendBuffer[2] = type;
+    if (size > 0)
+        memcpy(&SendBuffer[HEADER_SIZE], payload, size);
+    return (Socket.Send(&SendBuffer[0], static_cast<unsigned int>(length)) == static_cast<int>(length));
+}
+
+bool osaUniversalRobotRTDE::WaitForReply(char type, const char *&payload, unsigned long &size,
+                                         double timeoutSec)
+{
+    const double deadline = osaUniversalRobotMonotonicTime() + timeoutSec;
+    while (true) {
+        const char *frame;
+        unsigned long length;
+        while (Framer.NextFrame(frame, length)) {
+            if (frame[2] == type) {
+                payload = frame + HEADER_SIZE;
+                size = length - HEADER_SIZE;
+                return true;
+            }
+            if (frame[2] == TEXT_MESSAGE)
+                CMN_LOG_INIT_WARNING << "osaUniversalRobotRTDE: message from controller: "
+                                     << TextMessage(frame + HEADER_SIZE, length - HEADER_SIZE) << std::endl;
+            // Data packages received before the reply are discarded
+        }
+        const double remaining = deadline - osaUniversalRobotMonotonicTime();
+        if ((remaining <= 0.0) || (Framer.Receive(Socket, remaining) <= 0)) {
+            CMN_LOG_INIT_ERROR << "osaUniversalRobotRTDE: no reply to request " << type << std::endl;
+            return false;
+        }
+    }
+}
+
+bool osaUniversalRobotRTDE::NegotiateProtocolVersion(unsigned short version)
+{
+    char request[2];
+    StoreBigEndian(request, version, 2);
+    const char *reply;
+    unsigned long size;
+    if (!SendPackage(REQUEST_PROTOCOL_VERSION, request, sizeof(request))
+        || !WaitForReply(REQUEST_PROTOCOL_VERSION, reply, size) || (size < 1))
+        return false;
+    if (reply[0] == 0) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotRTDE: protocol version " << version
+                           << " not accepted by controller" << std::endl;
+        return false;
+    }
+    ProtocolVersion = version;
+    return true;
+}
+
+bool osaUniversalRobotRTDE::GetControllerVersion(unsigned int version[4])
+{
+    const char *reply;
+    unsigned long size;
+    if (!SendPackage(GET_URCONTROL_VERSION, 0, 0)
+        || !WaitForReply(GET_URCONTROL_VERSION, reply, size) || (size < 16))
+        return false;
+    for (size_t i = 0; i < 4; i++)
+        version[i] = static_cast<unsigned int>(LoadBigEndian(reply + 4*i, 4));
+    return true;
+}
+
+bool osaUniversalRobotRTDE::SetupOutputs(double frequency, const std::vector<std::string> &names)
+{
+    // Find the sample member for each field
+    std::vector<const SampleField *> fields;
+    std::string request;
+    if (ProtocolVersion >= 2) {
+        request.resize(8);
+        StoreBigEndianDouble(&request[0], frequency);
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        size_t j;
+        for (j = 0; j < NB_SAMPLE_FIELDS; j++) {
+            if (names[i] == SampleFields[j].Name)
+                break;
+        }
+        if (j == NB_SAMPLE_FIELDS) {
+            CMN_LOG_INIT_ERROR << "osaUniversalRobotRTDE: unsupported output field " << names[i] << std::endl;
+            return false;
+        }
+        fields.push_back(&SampleFields[j]);
+        if (i > 0)
+            request += ',';
+        request += names[i];
+    }
+
+    const char *reply;
+    unsigned long size;
+    if (!SendPackage(CONTROL_PACKAGE_SETUP_OUTPUTS, request.data(), request.size())
+        || !WaitForReply(CONTROL_PACKAGE_SETUP_OUTPUTS, reply, size))
+        return false;
+    // Recipe id is only present in protocol version 2
+    const size_t idSize = (ProtocolVersion >= 2) ? 1 : 0;
+    std::vector<FieldType> types;
+    if ((size < idSize) || !ParseTypes(reply + idSize, size - idSize, types))
+        return false;
+    if (types.size() != names.size()) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotRTDE: expected " << names.size()
+                           << " output types, received " << types.size() << std::endl;
+        return false;
+    }
+    // The values are written in the sample member, which only holds the expected type
+    for (size_t i = 0; i < types.size(); i++) {
+        if (types[i] != fields[i]->Type) {
+            CMN_LOG_INIT_ERROR << "osaUniversalRobotRTDE: output field " << fields[i]->Name
+                               << " is " << TypeNames[types[i]] << ", expected "
+                               << TypeNames[fields[i]->Type] << std::endl;
+            return false;
+        }
+    }
+
+    OutputRecipeId = idSize ? static_cast<unsigned char>(reply[0]) : 0;
+    OutputLength = HEADER_SIZE + idSize;
+    Outputs.resize(types.size());
+    for (size_t i = 0; i < types.size(); i++) {
+        Outputs[i].Type = types[i];
+        Outputs[i].SampleOffset = fields[i]->Offset;
+        OutputLength += TypeSize(types[i]);
+    }
+    Frequency = frequency;
+    return true;
+}
+
+int osaUniversalRobotRTDE::SetupInputs(const std::vector<std::string> &names)
+{
+    std::string request;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (i > 0)
+            request += ',';
+        request += names[i];
+    }
+    const char *reply;
+    unsigned long size;
+    if (!SendPackage(CONTROL_PACKAGE_SETUP_INPUTS, request.data(), request.size())
+        || !WaitForReply(CONTROL_PACKAGE_SETUP_INPUTS, reply, size) || (size < 1))
+        return -1;
+    InputRecipe recipe;
+    recipe.Id = static_cast<unsigned char>(reply[0]);
+    if (!ParseTypes(reply + 1, size - 1, recipe.Types))
+        return -1;
+    // Largest input package, so that SendInputs does not allocate memory
+    size_t length = HEADER_SIZE + 1;
+    for (size_t i = 0; i < recipe.Types.size(); i++)
+        length += TypeSize(recipe.Types[i]);
+    if (SendBuffer.size() < length)
+        SendBuffer.resize(length);
+    Inputs.push_back(recipe);
+    return recipe.Id;
+}
+
+bool osaUniversalRobotRTDE::Start(void)
+{
+    const char *reply;
+    unsigned long size;
+    if (!SendPackage(CONTROL_PACKAGE_START, 0, 0)
+        || !WaitForReply(CONTROL_PACKAGE_START, reply, size) || (size < 1))
+        return false;
+    return (reply[0] != 0);
+}
+
+bool osaUniversalRobotRTDE::Pause(void)
+{
+    const char *reply;
+    unsigned long size;
+    if (!SendPackage(CONTROL_PACKAGE_PAUSE, 0, 0)
+        || !WaitForReply(CONTROL_PACKAGE_PAUSE, reply, size) || (size < 1))
+        return false;
+    return (reply[0] != 0);
+}
+
+int osaUniversalRobotRTDE::Receive(double timeoutSec)
+{
+    return Framer.Receive(Socket, timeoutSec);
+}
+
+void osaUniversalRobotRTDE::KeepNewest(void)
+{
+    // Errors are reported by the next Receive.  The ring may not hold all the
+    // buffered data, receive until the socket is empty.
+    while (Framer.Receive(Socket, 0.0) > 0)
+        Framer.KeepNewest();
+}
+
+bool osaUniversalRobotRTDE::NextPacket(osaUniversalRobotDecodedPacket &packet)
+{
+    const char *frame;
+    unsigned long length;
+    while (Framer.NextFrame(frame, length)) {
+        if (frame[2] == TEXT_MESSAGE) {
+            CMN_LOG_RUN_WARNING << "osaUniversalRobotRTDE: message from controller: "
+                                << TextMessage(frame + HEADER_SIZE, length - HEADER_SIZE) << std::endl;
+            continue;
+        }
+        if (frame[2] != DATA_PACKAGE)
+            continue;
+
+        packet.Length = length;
+        packet.Version = osaUniversalRobotPacketDecoder::VER_UNKNOWN;
+        packet.Decoded = false;
+        const char *data = frame + HEADER_SIZE;
+        if (ProtocolVersion >= 2) {
+            if (static_cast<unsigned char>(*data) != OutputRecipeId)
+                return true;
+            data++;
+        }
+        if (length != OutputLength)
+            return true;
+
+        // Fields not in the recipe are set to 0
+        memset(&packet.Sample, 0, sizeof(packet.Sample));
+        char *sample = reinterpret_cast<char *>(&packet.Sample);
+        for (size_t i = 0; i < Outputs.size(); i++) {
+            double *value = reinterpret_cast<double *>(sample + Outputs[i].SampleOffset);
+            const FieldType type = Outputs[i].Type;
+            switch (type) {
+            case TYPE_DOUBLE:
+                *value = LoadBigEndianDouble(data);
+                break;
+            case TYPE_VECTOR3D:
+            case TYPE_VECTOR6D:
+                for (size_t j = 0; j < TypeSize(type)/8; j++)
+                    value[j] = LoadBigEndianDouble(data + 8*j);
+                break;
+            case TYPE_INT32:
+                *value = static_cast<int>(LoadBigEndian(data, 4));
+                break;
+            case TYPE_VECTOR6INT32:
+                for (size_t j = 0; j < 6; j++)
+                    value[j] = static_cast<int>(LoadBigEndian(data + 4*j, 4));
+                break;
+            case TYPE_VECTOR6UINT32:
+                for (size_t j = 0; j < 6; j++)
+                    value[j] = static_cast<double>(LoadBigEndian(data + 4*j, 4));
+                break;
+            default:
+                *value = static_cast<double>(LoadBigEndian(data, TypeSize(type)));
+                break;
+            }
+            data += TypeSize(type);
+        }
+        packet.Decoded = true;
+        return true;
+    }
+    return false;
+}
+
+bool osaUniversalRobotRTDE::SendInputs(int recipeId, const double *values, size_t count)
+{
+    const InputRecipe *recipe = 0;
+    for (size_t i = 0; i < Inputs.size(); i++) {
+        if (Inputs[i].Id == recipeId)
+            recipe = &Inputs[i];
+    }
+    if (!recipe || (count != recipe->Types.size()))
+        return false;
+
+    // SendBuffer was sized in SetupInputs; build the package in place
+    char *p = &SendBuffer[HEADER_SIZE];
+    *p++ = static_cast<char>(recipeId);
+    for (size_t i = 0; i < count; i++) {
+        const FieldType type = recipe->Types[i];
+        if (type == TYPE_DOUBLE)
+            StoreBigEndianDouble(p, values[i]);
+        else if (type == TYPE_INT32)
+            StoreBigEndian(p, static_cast<uint32_t>(static_cast<int32_t>(values[i])), 4);
+        else if ((type == TYPE_BOOL) || (type == TYPE_UINT8) || (type == TYPE_UINT32) || (type == TYPE_UINT64))
+            StoreBigEndian(p, static_cast<uint64_t>(values[i]), TypeSize(type));
+        else
+            return false;   // Vector inputs are not supported
+        p += TypeSize(type);
+    }
+    const size_t length = static_cast<size_t>(p - &SendBuffer[0]);
+    StoreBigEndian(&SendBuffer[0], length, 2);
+    SendBuffer[2] = DATA_PACKAGE;
+    return (Socket.Send(&SendBuffer[0], static_cast<unsigned int>(length)) == static_cast<int>(length));
+}
@@ -0,0 +1,194 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>
+
+#include <cisstCommon/cmnLogger.h>
+#include <cisstCommon/cmnUnits.h>
+#include <cisstOSAbstraction/osaSocket.h>
+#include <sawUniversalRobot/osaUniversalRobotClock.h>
+#include <sawUniversalRobot/osaUniversalRobotReceiver.h>
+#include <sawUniversalRobot/osaUniversalRobotIOEngine.h>
+#include <sawUniversalRobot/osaUniversalRobotFrameSink.h>
+
+#if (CISST_OS == CISST_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+osaUniversalRobotReceiver::osaUniversalRobotReceiver(osaUniversalRobotStreamFramer &framer,
+                                                     osaUniversalRobotPacketDecoder &decoder,
+                                                     size_t queueSize) :
+    Framer(framer), Decoder(decoder), PacketQueue(queueSize),
+    Socket(0), CPU(-1), Engine(0), StopRequested(false), Running(false),
+    SocketErrorFlag(false), Overflows(0), Wakeups(0), PacketsQueued(0)
+{
+    PublishFramerStatistics();
+}
+
+osaUniversalRobotReceiver::~osaUniversalRobotReceiver()
+{
+    Stop();
+}
+
+bool osaUniversalRobotReceiver::Start(osaSocket *socket, int cpu)
+{
+    if (Running) {
+        CMN_LOG_INIT_WARNING << "osaUniversalRobotReceiver::Start: thread already running" << std::endl;
+        return false;
+    }
+    Socket = socket;
+    CPU = cpu;
+    StopRequested = false;
+    SocketErrorFlag = false;
+    Running = true;
+    Engine = 0;
+    Thread.Create<osaUniversalRobotReceiver, void *>(this, &osaUniversalRobotReceiver::RunThread,
+                                                      0, "URrecv");
+    return true;
+}
+
+bool osaUniversalRobotReceiver::Start(osaSocket *socket, osaUniversalRobotIOEngine &engine)
+{
+    if (Running) {
+        CMN_LOG_INIT_WARNING << "osaUniversalRobotReceiver::Start: receiver already running" << std::endl;
+        return false;
+    }
+    Socket = socket;
+    SocketErrorFlag = false;
+    Engine = &engine;
+    Running = true;
+    if (!engine.Add(this, socket->GetIdentifier())) {
+        Engine = 0;
+        Running = false;
+        return false;
+    }
+    return true;
+}
+
+void osaUniversalRobotReceiver::Stop(void)
+{
+    if (!Running)
+        return;
+    if (Engine) {
+        // Returns once the engine thread is no longer using this receiver
+        Engine->Remove(this);
+        Engine = 0;
+    }
+    else {
+        StopRequested = true;
+        Thread.Wait();
+    }
+    Running = false;
+}
+
+bool osaUniversalRobotReceiver::WaitForPackets(double timeoutSec)
+{
+    if (PacketQueue.Front())
+        return true;
+    PacketsAvailable.Wait(timeoutSec);
+    return (PacketQueue.Front() != 0);
+}
+
+bool osaUniversalRobotReceiver::PinCurrentThread(int cpu)
+{
+#if (CISST_OS == CISST_LINUX)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0);
+#else
+    return false;
+#endif
+}
+
+void osaUniversalRobotReceiver::PublishFramerStatistics(void)
+{
+    unsigned long values[NB_FRAMER_STATISTICS];
+    memcpy(values, &Framer.GetStatistics(), sizeof(values));
+    for (size_t i = 0; i < NB_FRAMER_STATISTICS; i++)
+        FramerStatistics[i].store(values[i], std::memory_order_relaxed);
+    FramerBytesBuffered.store(static_cast<unsigned long>(Framer.Size()), std::memory_order_relaxed);
+}
+
+void osaUniversalRobotReceiver::GetFramerStatistics(osaUniversalRobotStreamFramer::Statistics &stats,
+                                                    unsigned long &bytesBuffered) const
+{
+    unsigned long values[NB_FRAMER_STATISTICS];
+    for (size_t i = 0; i < NB_FRAMER_STATISTICS; i++)
+        values[i] = FramerStatistics[i].load(std::memory_order_relaxed);
+    memcpy(&stats, values, sizeof(values));
+    bytesBuffered = FramerBytesBuffered.load(std::memory_order_relaxed);
+}
+
+void osaUniversalRobotReceiver::ReportSocketError(void)
+{
+    SocketErrorFlag = true;
+    // Wake up the task so that it closes the socket
+    PacketsAvailable.Raise();
+}
+
+int osaUniversalRobotReceiver::Service(double timeoutSec)
+{
+    int numBytes = Framer.Receive(*Socket, timeoutSec);
+    const double receiveTime = osaUniversalRobotMonotonicTime();
+    if (numBytes < 0) {
+        ReportSocketError();
+        return -1;
+    }
+    // With the ALL_FRAMES policy, nothing is received while the ring is full of frames
+    if ((numBytes == 0) && !Framer.HasFrame())
+        return 0;
+    Wakeups++;
+    const char *frame;
+    unsigned long length;
+    while (Framer.NextFrame(frame, length)) {
+        for (size_t i = 0; i < FrameSinks.size(); i++)
+            FrameSinks[i]->Frame(frame, length, receiveTime);
+        osaUniversalRobotDecodedPacket *packet = PacketQueue.WriteSlot();
+        if (!packet) {
+            // Task is not keeping up; drop the packet after decoding it, so that the
+            // version detection and the decoder statistics still see it
+            Decoder.DecodePacket(frame, length, DroppedPacket);
+            Overflows++;
+            continue;
+        }
+        Decoder.DecodePacket(frame, length, *packet);
+        packet->ReceiveTime = receiveTime;
+        // Also the time the packet is queued
+        packet->DecodeTime = osaUniversalRobotMonotonicTime();
+        PacketQueue.Push();
+        PacketsQueued++;
+    }
+    PublishFramerStatistics();
+    PacketsAvailable.Raise();
+    return numBytes;
+}
+
+void * osaUniversalRobotReceiver::RunThread(void *)
+{
+    if ((CPU >= 0) && !PinCurrentThread(CPU)) {
+        CMN_LOG_RUN_WARNING << "osaUniversalRobotReceiver: failed to pin thread to CPU "
+                            << CPU << std::endl;
+    }
+
+    while (!StopRequested) {
+        // Short timeout so that we can check StopRequested; the task detects
+        // receive timeouts itself
+        if (Service(0.1 * cmn_s) < 0)
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cstring>
+
+#include <cisstCommon/cmnLogger.h>
+#include <sawUniversalRobot/osaUniversalRobotReconnect.h>
+
+#if (CISST_OS != CISST_WINDOWS)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+osaUniversalRobotReconnect::osaUniversalRobotReconnect(void) :
+    Port(0), InitialDelay(0.1), MaximumDelay(5.0), Multiplier(2.0), ConnectTimeout(1.0),
+    State(IDLE), Delay(0.1), NextAttemptTime(0.0), Attempts(0)
+{
+}
+
+void osaUniversalRobotReconnect::SetBackoff(double initialDelay, double maximumDelay, double multiplier)
+{
+    InitialDelay = (initialDelay > 0.0) ? initialDelay : 0.0;
+    MaximumDelay = (maximumDelay > InitialDelay) ? maximumDelay : InitialDelay;
+    Multiplier = (multiplier > 1.0) ? multiplier : 1.0;
+}
+
+void osaUniversalRobotReconnect::Start(const std::string &host, unsigned short port, double now)
+{
+    Host = host;
+    Port = port;
+    Attempts = 0;
+    Delay = InitialDelay;
+    NextAttemptTime = now + Delay;
+    State = WAITING;
+}
+
+void osaUniversalRobotReconnect::Stop(void)
+{
+    State = IDLE;
+}
+
+void osaUniversalRobotReconnect::Retry(double now)
+{
+    ScheduleNext(now);
+}
+
+void osaUniversalRobotReconnect::ScheduleNext(double now)
+{
+    Delay *= Multiplier;
+    if (Delay > MaximumDelay)
+        Delay = MaximumDelay;
+    NextAttemptTime = now + Delay;
+    State = WAITING;
+}
+
+bool osaUniversalRobotReconnect::Probe(const std::string &host, unsigned short port, double timeout)
+{
+#if (CISST_OS != CISST_WINDOWS)
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        CMN_LOG_RUN_ERROR << "osaUniversalRobotReconnect: invalid IP address " << host << std::endl;
+        return false;
+    }
+    const int socketId = socket(AF_INET, SOCK_STREAM, 0);
+    if (socketId < 0)
+        return false;
+    fcntl(socketId, F_SETFL, fcntl(socketId, F_GETFL, 0) | O_NONBLOCK);
+    if ((connect(socketId, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0)
+        && (errno != EINPROGRESS)) {
+        close(socketId);
+        return false;
+    }
+    struct pollfd pollSocket;
+    pollSocket.fd = socketId;
+    pollSocket.events = POLLOUT;
+    pollSocket.revents = 0;
+    int error = -1;
+    if (poll(&pollSocket, 1, static_cast<int>(timeout * 1000.0)) > 0) {
+        socklen_t length = sizeof(error);
+        getsockopt(socketId, SOL_SOCKET, SO_ERROR, &error, &length);
+    }
+    close(socketId);
+    return (error == 0);
+#else
+    // No non-blocking probe, the caller connects directly
+    return true;
+#endif
+}
+
+osaUniversalRobotReconnect::Status osaUniversalRobotReconnect::Poll(double now)
+{
+    if ((State != WAITING) || (now < NextAttemptTime))
+        return State;
+    Attempts++;
+    State = IN_PROGRESS;
+    return STARTED;
+}
@@ -0,0 +1,320 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <atomic>
+#include <cstring>
+
+#include <cisstCommon/cmnLogger.h>
+#include <sawUniversalRobot/osaUniversalRobotRecorder.h>
+
+#if (CISST_OS != CISST_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace osaUniversalRobotRecording;
+
+const uint64_t HEADER_SIZE = 64;
+
+// Offset after a record: the next record starts at the beginning of the ring if there
+// is no room for a record header before the end
+static uint64_t Advance(uint64_t offset, uint64_t size, uint64_t capacity)
+{
+    offset += size;
+    if (offset + sizeof(RecordHeader) > capacity)
+        offset = 0;
+    return offset;
+}
+
+osaUniversalRobotRecorder::osaUniversalRobotRecorder(void) :
+    Header(0), Ring(0), MappedSize(0), FileId(-1)
+{
+}
+
+osaUniversalRobotRecorder::~osaUniversalRobotRecorder()
+{
+    Close();
+}
+
+bool osaUniversalRobotRecorder::Open(const std::string &filename, size_t capacity)
+{
+    Close();
+#if (CISST_OS != CISST_WINDOWS)
+    // The ring must hold a few packets; keep records aligned
+    capacity &= ~static_cast<size_t>(7);
+    if (capacity < 64 * 1024) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotRecorder::Open: capacity must be at least 64 kB" << std::endl;
+        return false;
+    }
+    FileId = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (FileId < 0) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotRecorder::Open: can't create \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    MappedSize = HEADER_SIZE + capacity;
+    // Allocate the disk blocks now, so that writing to the mapping can not fail later
+    if (posix_fallocate(FileId, 0, MappedSize) != 0) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotRecorder::Open: can't allocate " << MappedSize
+                           << " bytes for \"" << filename << "\"" << std::endl;
+        Close();
+        return false;
+    }
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    // Map all the pages now rather than on first write
+    flags |= MAP_POPULATE;
+#endif
+    void *mapping = mmap(0, MappedSize, PROT_READ | PROT_WRITE, flags, FileId, 0);
+    if (mapping == MAP_FAILED) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotRecorder::Open: can't map \"" << filename << "\"" << std::endl;
+        Close();
+        return false;
+    }
+    Header = static_cast<FileHeader *>(mapping);
+    Ring = static_cast<char *>(mapping) + HEADER_SIZE;
+    memset(Header, 0, HEADER_SIZE);
+    memcpy(Header->Magic, MAGIC, sizeof(MAGIC));
+    Header->FormatVersion = FORMAT_VERSION;
+    Header->HeaderSize = static_cast<uint32_t>(HEADER_SIZE);
+    Header->Capacity = capacity;
+    return true;
+#else
+    CMN_LOG_INIT_ERROR << "osaUniversalRobotRecorder::Open: not available on Windows" << std::endl;
+    return false;
+#endif
+}
+
+void osaUniversalRobotRecorder::Close(void)
+{
+#if (CISST_OS != CISST_WINDOWS)
+    if (Header) {
+        msync(Header, MappedSize, MS_SYNC);
+        munmap(Header, MappedSize);
+        Header = 0;
+        Ring = 0;
+    }
+    if (FileId >= 0) {
+        close(FileId);
+        FileId = -1;
+    }
+#endif
+}
+
+unsigned long long osaUniversalRobotRecorder::GetRecordsWritten(void) const
+{
+    return Header ? Header->RecordsWritten : 0;
+}
+
+uint64_t osaUniversalRobotRecorder::NextOffset(uint64_t offset) const
+{
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(Ring + offset);
+    if (record->Marker == WRAP_MARKER)
+        return 0;
+    return Advance(offset, RecordSize(record->Length), Header->Capacity);
+}
+
+void osaUniversalRobotRecorder::DropOldest(void)
+{
+    // Wrap markers are not counted as records
+    if (reinterpret_cast<const RecordHeader *>(Ring + Header->Tail)->Marker != WRAP_MARKER)
+        Header->Records--;
+    Header->Tail = NextOffset(Header->Tail);
+}
+
+bool osaUniversalRobotRecorder::Record(const char *frame, unsigned long length, double receiveTime)
+{
+    if (!Header)
+        return false;
+    const uint64_t capacity = Header->Capacity;
+    const uint64_t size = RecordSize(length);
+    if (size > capacity / 2)
+        return false;
+
+    uint64_t head = Header->Head;
+    if (Header->Records == 0)
+        Header->Tail = head;
+    if (head + size > capacity) {
+        // No room before the end of the ring: drop the records after head and wrap
+        while ((Header->Records > 0) && (Header->Tail >= head))
+            DropOldest();
+        RecordHeader *wrap = reinterpret_cast<RecordHeader *>(Ring + head);
+        wrap->Length = 0;
+        wrap->Marker = WRAP_MARKER;
+        wrap->ReceiveTime = 0.0;
+        head = 0;
+        if (Header->Records == 0)
+            Header->Tail = head;
+    }
+    // Drop the records overwritten by this one
+    while ((Header->Records > 0) && (Header->Tail >= head) && (Header->Tail < head + size))
+        DropOldest();
+    if (Header->Records == 0)
+        Header->Tail = head;
+
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(Ring + head);
+    record->Length = static_cast<uint32_t>(length);
+    record->Marker = RECORD_MARKER;
+    record->ReceiveTime = receiveTime;
+    memcpy(Ring + head + sizeof(RecordHeader), frame, length);
+    // Publish the record only once it is complete
+    std::atomic_thread_fence(std::memory_order_release);
+    Header->Head = Advance(head, size, capacity);
+    Header->Records++;
+    Header->RecordsWritten++;
+    return true;
+}
+
+osaUniversalRobotReplay::osaUniversalRobotReplay(void) :
+    Header(0), Ring(0), MappedSize(0), Offset(0), Remaining(0)
+{
+}
+
+osaUniversalRobotReplay::~osaUniversalRobotReplay()
+{
+    Close();
+}
+
+bool osaUniversalRobotReplay::Open(const std::string &filename)
+{
+    Close();
+#if (CISST_OS != CISST_WINDOWS)
+    const int fileId = open(filename.c_str(), O_RDONLY);
+    if (fileId < 0) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotReplay::Open: can't open \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    struct stat fileStatus;
+    if ((fstat(fileId, &fileStatus) != 0) || (static_cast<uint64_t>(fileStatus.st_size) < HEADER_SIZE)) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotReplay::Open: \"" << filename << "\" is too short" << std::endl;
+        close(fileId);
+        return false;
+    }
+    MappedSize = static_cast<size_t>(fileStatus.st_size);
+    void *mapping = mmap(0, MappedSize, PROT_READ, MAP_PRIVATE, fileId, 0);
+    // The mapping remains valid after the file is closed
+    close(fileId);
+    if (mapping == MAP_FAILED) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotReplay::Open: can't map \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    Header = static_cast<const FileHeader *>(mapping);
+    if ((memcmp(Header->Magic, MAGIC, sizeof(MAGIC)) != 0)
+        || (Header->FormatVersion != FORMAT_VERSION)
+        || (Header->HeaderSize < sizeof(FileHeader)) || (Header->HeaderSize % 8 != 0)
+        || (Header->HeaderSize > MappedSize)
+        || (Header->Capacity < sizeof(RecordHeader))
+        || (Header->Capacity > MappedSize - Header->HeaderSize)) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotReplay::Open: \"" << filename
+                           << "\" is not a valid recording" << std::endl;
+        Close();
+        return false;
+    }
+    Ring = static_cast<const char *>(mapping) + Header->HeaderSize;
+    // The file may be truncated or corrupted, e.g., if it was copied while recording
+    if (!CheckRecords()) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotReplay::Open: \"" << filename
+                           << "\" has invalid records" << std::endl;
+        Close();
+        return false;
+    }
+    Rewind();
+    return true;
+#else
+    CMN_LOG_INIT_ERROR << "osaUniversalRobotReplay::Open: not available on Windows" << std::endl;
+    return false;
+#endif
+}
+
+void osaUniversalRobotReplay::Close(void)
+{
+#if (CISST_OS != CISST_WINDOWS)
+    if (Header) {
+        munmap(const_cast<FileHeader *>(Header), MappedSize);
+        Header = 0;
+        Ring = 0;
+    }
+#endif
+    Remaining = 0;
+}
+
+unsigned long long osaUniversalRobotReplay::GetNumberOfFrames(void) const
+{
+    return Header ? Header->Records : 0;
+}
+
+void osaUniversalRobotReplay::Rewind(void)
+{
+    if (!Header)
+        return;
+    Offset = Header->Tail;
+    Remaining = Header->Records;
+    SkipWrap();
+}
+
+bool osaUniversalRobotReplay::CheckRecords(void) const
+{
+    // Offsets are aligned and leave room for a record header, as written by the recorder
+    const uint64_t capacity = Header->Capacity;
+    if ((Header->Tail % 8 != 0) || (Header->Tail + sizeof(RecordHeader) > capacity)
+        || (Header->Head % 8 != 0) || (Header->Head + sizeof(RecordHeader) > capacity)
+        || (Header->Records > capacity / sizeof(RecordHeader)))
+        return false;
+    // Same traversal as Rewind and Pop
+    uint64_t offset = Header->Tail;
+    for (uint64_t i = 0; i < Header->Records; i++) {
+        if (reinterpret_cast<const RecordHeader *>(Ring + offset)->Marker == WRAP_MARKER)
+            offset = 0;
+        const RecordHeader *record = reinterpret_cast<const RecordHeader *>(Ring + offset);
+        if ((record->Marker != RECORD_MARKER)
+            || (offset + RecordSize(record->Length) > capacity))
+            return false;
+        offset = Advance(offset, RecordSize(record->Length), capacity);
+    }
+    return true;
+}
+
+void osaUniversalRobotReplay::SkipWrap(void)
+{
+    if ((Remaining > 0)
+        && (reinterpret_cast<const RecordHeader *>(Ring + Offset)->Marker == WRAP_MARKER))
+        Offset = 0;
+}
+
+bool osaUniversalRobotReplay::Front(Frame &frame) const
+{
+    if (Remaining == 0)
+        return false;
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(Ring + Offset);
+    // Stop at corrupted records rather than reading outside the ring
+    if ((record->Marker != RECORD_MARKER)
+        || (Offset + RecordSize(record->Length) > Header->Capacity))
+        return false;
+    frame.Data = Ring + Offset + sizeof(RecordHeader);
+    frame.Length = record->Length;
+    frame.ReceiveTime = record->ReceiveTime;
+    return true;
+}
+
+void osaUniversalRobotReplay::Pop(void)
+{
+    if (Remaining == 0)
+        return;
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(Ring + Offset);
+    Offset = Advance(Offset, RecordSize(record->Length), Header->Capacity);
+    Remaining--;
+    SkipWrap();
+}
@@ -0,0 +1,146 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>
+
+#include <cisstCommon/cmnLogger.h>
+#include <cisstCommon/cmnUnits.h>
+#include <cisstOSAbstraction/osaSleep.h>
+#include <sawUniversalRobot/osaUniversalRobotReconnect.h>
+#include <sawUniversalRobot/osaUniversalRobotSecondaryClient.h>
+
+// Delay between connection attempts (s)
+const double RECONNECT_DELAY = 1.0;
+// Longest wait for data, so that Stop is handled promptly (s)
+const double RECEIVE_TIMEOUT = 0.1;
+// Messages are sent at 10 Hz; robot state messages are about 1 kB
+const size_t RING_SIZE = 16384;
+const unsigned long MAX_MESSAGE_LENGTH = 8192;
+
+osaUniversalRobotSecondaryClient::osaUniversalRobotSecondaryClient(void) :
+    Port(30002), StopRequested(false), Running(false), Connected(false),
+    Framer(RING_SIZE, 4), Changes(0), FirstMessage(0), NumMessages(0), MessagesDropped(0)
+{
+    Framer.SetLengthRange(5, MAX_MESSAGE_LENGTH);
+    memset(&Shared, 0, sizeof(Shared));
+}
+
+osaUniversalRobotSecondaryClient::~osaUniversalRobotSecondaryClient()
+{
+    Stop();
+}
+
+bool osaUniversalRobotSecondaryClient::Start(const std::string &host, unsigned short port)
+{
+    if (Running) {
+        CMN_LOG_INIT_WARNING << "osaUniversalRobotSecondaryClient::Start: thread already running" << std::endl;
+        return false;
+    }
+    Host = host;
+    Port = port;
+    StopRequested = false;
+    Running = true;
+    Thread.Create<osaUniversalRobotSecondaryClient, void *>(this, &osaUniversalRobotSecondaryClient::RunThread,
+                                                             0, "URsec");
+    return true;
+}
+
+void osaUniversalRobotSecondaryClient::Stop(void)
+{
+    if (!Running)
+        return;
+    StopRequested = true;
+    Thread.Wait();
+    Running = false;
+    if (Connected) {
+        Socket.Close();
+        Connected = false;
+    }
+}
+
+unsigned int osaUniversalRobotSecondaryClient::Fetch(osaUniversalRobotSecondaryParser::Data &data)
+{
+    Mutex.Lock();
+    const unsigned int changes = Changes;
+    if (changes != 0)
+        data = Shared;
+    Changes = 0;
+    Mutex.Unlock();
+    return changes;
+}
+
+bool osaUniversalRobotSecondaryClient::NextMessage(osaUniversalRobotSecondaryParser::Message &message)
+{
+    Mutex.Lock();
+    const bool available = (NumMessages > 0);
+    if (available) {
+        message = Messages[FirstMessage];
+        FirstMessage = (FirstMessage + 1) % MAX_MESSAGES;
+        NumMessages--;
+    }
+    Mutex.Unlock();
+    return available;
+}
+
+void * osaUniversalRobotSecondaryClient::RunThread(void *)
+{
+    while (!StopRequested) {
+        if (!Connected) {
+            // Probe first, so that an unreachable controller does not block Stop
+            if (!osaUniversalRobotReconnect::Probe(Host, Port, RECONNECT_DELAY)
+                || !Socket.Connect(Host, Port)) {
+                CMN_LOG_RUN_WARNING << "osaUniversalRobotSecondaryClient: can't connect to "
+                                    << Host << ":" << Port << std::endl;
+                osaSleep(RECONNECT_DELAY * cmn_s);
+                continue;
+            }
+            // The controller sends the version message first
+            Framer.Reset();
+            Parser.Reset();
+            Connected = true;
+        }
+
+        if (Framer.Receive(Socket, RECEIVE_TIMEOUT) < 0) {
+            CMN_LOG_RUN_WARNING << "osaUniversalRobotSecondaryClient: connection to "
+                                << Host << ":" << Port << " lost" << std::endl;
+            Socket.Close();
+            Connected = false;
+            continue;
+        }
+        const char *frame;
+        unsigned long length;
+        while (Framer.NextFrame(frame, length)) {
+            const unsigned int changes = Parser.Parse(frame, length);
+            if (changes == 0)
+                continue;
+            Mutex.Lock();
+            if (changes & ~osaUniversalRobotSecondaryParser::MESSAGE_RECEIVED) {
+                Shared = Parser.GetData();
+                Changes |= (changes & ~osaUniversalRobotSecondaryParser::MESSAGE_RECEIVED);
+            }
+            if (changes & osaUniversalRobotSecondaryParser::MESSAGE_RECEIVED) {
+                if (NumMessages == MAX_MESSAGES) {
+                    FirstMessage = (FirstMessage + 1) % MAX_MESSAGES;
+                    NumMessages--;
+                    MessagesDropped++;
+                }
+                Messages[(FirstMessage + NumMessages) % MAX_MESSAGES] = Parser.GetMessage();
+                NumMessages++;
+            }
+            Mutex.Unlock();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,385 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cisstCommon/cmnPortability.h>
+#include <sawUniversalRobot/osaUniversalRobotSecondaryParser.h>
+
+#if (CISST_OS == CISST_WINDOWS)
+typedef unsigned __int64 uint64_t;
+typedef unsigned __int32 uint32_t;
+#else
+#include <stdint.h>
+#endif
+
+// Length and type of messages and packages
+const size_t HEADER_SIZE = 5;
+
+// Sequential reader of big-endian fields.  A read past the end returns 0 and
+// clears Valid, so that a package can be read field by field and checked once.
+class osaUniversalRobotSecondaryReader {
+public:
+    osaUniversalRobotSecondaryReader(const char *data, size_t size):
+        Data(data), Size(size), Offset(0), Valid(true)
+    {}
+
+    const char * Take(size_t numBytes)
+    {
+        if (!Valid || (numBytes > Size - Offset)) {
+            Valid = false;
+            return 0;
+        }
+        const char *p = Data + Offset;
+        Offset += numBytes;
+        return p;
+    }
+
+    uint64_t Unsigned(size_t numBytes)
+    {
+        const unsigned char *u = reinterpret_cast<const unsigned char *>(Take(numBytes));
+        uint64_t value = 0;
+        for (size_t i = 0; u && (i < numBytes); i++)
+            value = (value << 8) | u[i];
+        return value;
+    }
+
+    int Int32(void)
+    { return static_cast<int>(static_cast<int32_t>(Unsigned(4))); }
+
+    int Int8(void)
+    { return static_cast<int>(static_cast<signed char>(Unsigned(1))); }
+
+    bool Bool(void)
+    { return (Unsigned(1) != 0); }
+
+    double Double(void)
+    {
+        const uint64_t bits = Unsigned(8);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    double Float(void)
+    {
+        const uint32_t bits = static_cast<uint32_t>(Unsigned(4));
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void Doubles(double *values, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            values[i] = Double();
+    }
+
+    // Copy numBytes (truncated) as a string
+    void Text(char *text, size_t textSize, size_t numBytes)
+    {
+        const char *p = Take(numBytes);
+        const size_t size = (p && (numBytes < textSize)) ? numBytes : (p ? textSize - 1 : 0);
+        if (size > 0)
+            memcpy(text, p, size);
+        text[size] = '\0';
+    }
+
+    size_t Remaining(void) const
+    { return Size - Offset; }
+
+    const char *Data;
+    size_t Size;
+    size_t Offset;
+    bool Valid;
+};
+
+osaUniversalRobotSecondaryParser::osaUniversalRobotSecondaryParser(void)
+{
+    Reset();
+}
+
+void osaUniversalRobotSecondaryParser::Reset(void)
+{
+    // memset, so that the padding compares equal with memcmp
+    memset(&Values, 0, sizeof(Values));
+    memset(&LastMessage, 0, sizeof(LastMessage));
+    NumErrors = 0;
+}
+
+unsigned int osaUniversalRobotSecondaryParser::Parse(const char *frame, unsigned long length)
+{
+    if (length < HEADER_SIZE) {
+        NumErrors++;
+        return 0;
+    }
+    const char *payload = frame + HEADER_SIZE;
+    const size_t size = length - HEADER_SIZE;
+    switch (static_cast<unsigned char>(frame[4])) {
+    case MESSAGE_ROBOT_STATE:
+        return ParseRobotState(payload, size);
+    case MESSAGE_ROBOT:
+        return ParseRobotMessage(payload, size);
+    default:
+        // E.g., program state messages
+        return 0;
+    }
+}
+
+static unsigned int ParseRobotMode(osaUniversalRobotSecondaryReader &reader,
+                                   osaUniversalRobotSecondaryParser::RobotModeData &values)
+{
+    osaUniversalRobotSecondaryParser::RobotModeData data;
+    reader.Unsigned(8);  // Timestamp
+    data.RealRobotConnected = reader.Bool();
+    data.RealRobotEnabled = reader.Bool();
+    data.PowerOn = reader.Bool();
+    data.EmergencyStopped = reader.Bool();
+    data.ProtectiveStopped = reader.Bool();
+    data.ProgramRunning = reader.Bool();
+    data.ProgramPaused = reader.Bool();
+    data.RobotMode = reader.Int8();
+    data.ControlMode = reader.Int8();
+    data.TargetSpeedFraction = reader.Double();
+    data.SpeedScaling = reader.Double();
+    if (!reader.Valid)
+        return 0;
+    // Speed scaling changes continuously while the trajectory is slowed down
+    const bool changed = (data.RealRobotConnected != values.RealRobotConnected)
+        || (data.RealRobotEnabled != values.RealRobotEnabled)
+        || (data.PowerOn != values.PowerOn)
+        || (data.EmergencyStopped != values.EmergencyStopped)
+        || (data.ProtectiveStopped != values.ProtectiveStopped)
+        || (data.ProgramRunning != values.ProgramRunning)
+        || (data.ProgramPaused != values.ProgramPaused)
+        || (data.RobotMode != values.RobotMode)
+        || (data.ControlMode != values.ControlMode)
+        || (data.TargetSpeedFraction != values.TargetSpeedFraction);
+    values = data;
+    return changed ? osaUniversalRobotSecondaryParser::ROBOT_MODE : 0;
+}
+
+static unsigned int ParseMasterboard(osaUniversalRobotSecondaryReader &reader,
+                                     osaUniversalRobotSecondaryParser::MasterboardData &values)
+{
+    osaUniversalRobotSecondaryParser::MasterboardData data;
+    data.DigitalInputs = static_cast<unsigned int>(reader.Unsigned(4));
+    data.DigitalOutputs = static_cast<unsigned int>(reader.Unsigned(4));
+    // Analog input ranges and values, analog output domains and values
+    reader.Take(2 + 16 + 2 + 16);
+    data.Temperature = reader.Float();
+    data.RobotVoltage = reader.Float();
+    data.RobotCurrent = reader.Float();
+    data.IOCurrent = reader.Float();
+    data.SafetyMode = reader.Int8();
+    data.ReducedMode = reader.Bool();
+    if (!reader.Valid)
+        return 0;
+    // Analog values change with every message
+    const bool changed = (data.DigitalInputs != values.DigitalInputs)
+        || (data.DigitalOutputs != values.DigitalOutputs)
+        || (data.SafetyMode != values.SafetyMode)
+        || (data.ReducedMode != values.ReducedMode);
+    values = data;
+    return changed ? osaUniversalRobotSecondaryParser::MASTERBOARD : 0;
+}
+
+// Copy data to values if it is valid; returns change if the values changed
+template <class _data>
+static unsigned int Update(const osaUniversalRobotSecondaryReader &reader, const _data &data, _data &values,
+                           unsigned int change)
+{
+    if (!reader.Valid || (memcmp(&data, &values, sizeof(_data)) == 0))
+        return 0;
+    memcpy(&values, &data, sizeof(_data));
+    return change;
+}
+
+unsigned int osaUniversalRobotSecondaryParser::ParseRobotState(const char *payload, size_t size)
+{
+    // Package layouts of older controllers differ
+    if (Values.Version.Major < 3)
+        return 0;
+    unsigned int changes = STATE_RECEIVED;
+    osaUniversalRobotSecondaryReader message(payload, size);
+    while (message.Remaining() >= HEADER_SIZE) {
+        const size_t packageSize = static_cast<size_t>(message.Unsigned(4));
+        if ((packageSize < HEADER_SIZE) || (packageSize - 4 > message.Remaining())) {
+            NumErrors++;
+            break;
+        }
+        const int type = static_cast<int>(message.Unsigned(1));
+        osaUniversalRobotSecondaryReader reader(message.Take(packageSize - HEADER_SIZE), packageSize - HEADER_SIZE);
+        switch (type) {
+        case PACKAGE_ROBOT_MODE:
+            changes |= ParseRobotMode(reader, Values.RobotMode);
+            break;
+        case PACKAGE_MASTERBOARD:
+            changes |= ParseMasterboard(reader, Values.Masterboard);
+            break;
+        case PACKAGE_CARTESIAN:
+            {
+                // Tool pose (6 doubles), then TCP offset
+                double offset[6];
+                reader.Take(6 * 8);
+                reader.Doubles(offset, 6);
+                changes |= Update(reader, offset, Values.TCPOffset, TCP_OFFSET);
+            }
+            break;
+        case PACKAGE_KINEMATICS:
+            {
+                KinematicsData data;
+                memset(&data, 0, sizeof(data));
+                for (size_t i = 0; i < 6; i++)
+                    data.Checksum[i] = static_cast<unsigned int>(reader.Unsigned(4));
+                reader.Doubles(data.Theta, 6);
+                reader.Doubles(data.A, 6);
+                reader.Doubles(data.D, 6);
+                reader.Doubles(data.Alpha, 6);
+                data.CalibrationStatus = static_cast<unsigned int>(reader.Unsigned(4));
+                changes |= Update(reader, data, Values.Kinematics, KINEMATICS);
+            }
+            break;
+        case PACKAGE_CONFIGURATION:
+            {
+                ConfigurationData data;
+                memset(&data, 0, sizeof(data));
+                // Limits are sent joint by joint
+                for (size_t i = 0; i < 6; i++) {
+                    data.JointMinimum[i] = reader.Double();
+                    data.JointMaximum[i] = reader.Double();
+                }
+                for (size_t i = 0; i < 6; i++) {
+                    data.JointMaximumSpeed[i] = reader.Double();
+                    data.JointMaximumAcceleration[i] = reader.Double();
+                }
+                data.JointDefaultVelocity = reader.Double();
+                data.JointDefaultAcceleration = reader.Double();
+                data.ToolDefaultVelocity = reader.Double();
+                data.ToolDefaultAcceleration = reader.Double();
+                data.EquivalentRadius = reader.Double();
+                reader.Doubles(data.A, 6);
+                reader.Doubles(data.D, 6);
+                reader.Doubles(data.Alpha, 6);
+                reader.Doubles(data.Theta, 6);
+                data.MasterboardVersion = reader.Int32();
+                data.ControllerBoxType = reader.Int32();
+                data.RobotType = reader.Int32();
+                data.RobotSubType = reader.Int32();
+                changes |= Update(reader, data, Values.Configuration, CONFIGURATION);
+            }
+            break;
+        default:
+            // Joint, tool, force, additional info, calibration and safety data are
+            // not used (joint and tool data are in the real-time packets)
+            break;
+        }
+        if (!reader.Valid)
+            NumErrors++;
+    }
+    return changes;
+}
+
+unsigned int osaUniversalRobotSecondaryParser::ParseRobotMessage(const char *payload, size_t size)
+{
+    osaUniversalRobotSecondaryReader reader(payload, size);
+    reader.Unsigned(8);  // Timestamp
+    const int source = reader.Int8();
+    const int type = reader.Int8();
+    if (!reader.Valid) {
+        NumErrors++;
+        return 0;
+    }
+
+    if (type == ROBOT_MESSAGE_VERSION) {
+        VersionData data;
+        memset(&data, 0, sizeof(data));
+        reader.Text(data.ProjectName, sizeof(data.ProjectName), static_cast<size_t>(reader.Unsigned(1)));
+        data.Major = static_cast<int>(reader.Unsigned(1));
+        data.Minor = static_cast<int>(reader.Unsigned(1));
+        data.Bugfix = reader.Int32();
+        data.Build = reader.Int32();
+        if (reader.Valid)
+            reader.Text(data.BuildDate, sizeof(data.BuildDate), reader.Remaining());
+        const unsigned int changes = Update(reader, data, Values.Version, VERSION);
+        if (!reader.Valid)
+            NumErrors++;
+        return changes;
+    }
+
+    Message &message = LastMessage;
+    message.Type = type;
+    message.Source = source;
+    message.Code = 0;
+    message.Argument = 0;
+    message.ReportLevel = REPORT_INFO;
+    char title[64];
+    title[0] = '\0';
+    switch (type) {
+    case ROBOT_MESSAGE_TEXT:
+        break;
+    case ROBOT_MESSAGE_POPUP:
+        {
+            reader.Take(8);  // Request id and type
+            const bool warning = reader.Bool();
+            const bool error = reader.Bool();
+            reader.Take(1);  // Blocking
+            reader.Text(title, sizeof(title), static_cast<size_t>(reader.Unsigned(1)));
+            message.ReportLevel = error ? REPORT_VIOLATION : (warning ? REPORT_WARNING : REPORT_INFO);
+        }
+        break;
+    case ROBOT_MESSAGE_SAFETY_MODE:
+        message.Code = reader.Int32();
+        message.Argument = reader.Int32();
+        reader.Take(1 + 4 + 4);  // Safety mode type and report data
+        message.ReportLevel = REPORT_VIOLATION;
+        break;
+    case ROBOT_MESSAGE_ERROR_CODE:
+        message.Code = reader.Int32();
+        message.Argument = reader.Int32();
+        message.ReportLevel = reader.Int32();
+        reader.Take(1 + 4);  // Report data type and data
+        break;
+    case ROBOT_MESSAGE_KEY:
+        message.Code = reader.Int32();
+        message.Argument = reader.Int32();
+        reader.Text(title, sizeof(title), static_cast<size_t>(reader.Unsigned(1)));
+        break;
+    case ROBOT_MESSAGE_RUNTIME_EXCEPTION:
+        {
+            const int line = reader.Int32();
+            const int column = reader.Int32();
+            snprintf(title, sizeof(title), "line %d, column %d", line, column);
+            message.ReportLevel = REPORT_FAULT;
+        }
+        break;
+    default:
+        // Labels and value requests are for the program
+        return 0;
+    }
+    if (!reader.Valid) {
+        NumErrors++;
+        return 0;
+    }
+    // "title: text", truncated
+    size_t offset = 0;
+    if (title[0] != '\0')
+        offset = static_cast<size_t>(snprintf(message.Text, sizeof(message.Text), "%s: ", title));
+    if (offset >= sizeof(message.Text))
+        offset = sizeof(message.Text) - 1;
+    reader.Text(message.Text + offset, sizeof(message.Text) - offset, reader.Remaining());
+    return MESSAGE_RECEIVED;
+}
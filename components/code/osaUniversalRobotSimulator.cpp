@@ -0,0 +1,427 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include <cisstCommon/cmnLogger.h>
+#include <cisstOSAbstraction/osaSleep.h>
+#include <sawUniversalRobot/osaUniversalRobotClock.h>
+#include <sawUniversalRobot/osaUniversalRobotSimulator.h>
+
+// Robot mode reported by the simulator (ROBOT_MODE_RUNNING)
+const double SIMULATED_ROBOT_MODE = 7.0;
+
+// Delay between the two parts of a fragmented packet
+const double FRAGMENT_DELAY = 0.0005;
+
+osaUniversalRobotSimulator::Configuration::Configuration(void) :
+    Version(osaUniversalRobotPacketDecoder::VER_32), Period(0.008), Jitter(0.0),
+    FragmentProbability(0.0), CoalesceProbability(0.0), Port(30003), DashboardPort(29999),
+    Seed(1)
+{
+}
+
+osaUniversalRobotSimulator::osaUniversalRobotSimulator(size_t maxCommandRecords) :
+    Client(0), DashboardClient(0), ClientAccepted(false), StopRequested(false), Running(false), Period(0.008),
+    PacketsSent(0), CommandsDropped(0), RandomState(1),
+    Motion(MOTION_NONE), MotionTimeout(0.0), MaxRecords(maxCommandRecords),
+    InProgram(false), OutSize(0)
+{
+    memset(&State, 0, sizeof(State));
+    State.RobotMode = SIMULATED_ROBOT_MODE;
+    for (size_t i = 0; i < 6; i++) {
+        MotionVelocity[i] = 0.0;
+        MotionTarget[i] = 0.0;
+    }
+    Records.reserve(MaxRecords);
+    // Room for a coalesced packet and the next one
+    const unsigned long maxLength = osaUniversalRobotPacketDecoder::PacketLength[osaUniversalRobotPacketDecoder::VER_MAX-1];
+    OutBuffer.resize(2 * maxLength);
+}
+
+osaUniversalRobotSimulator::~osaUniversalRobotSimulator()
+{
+    Stop();
+}
+
+bool osaUniversalRobotSimulator::Start(const Configuration &config)
+{
+    if (Running)
+        return false;
+    if ((config.Version <= osaUniversalRobotPacketDecoder::VER_UNKNOWN)
+        || (config.Version >= osaUniversalRobotPacketDecoder::VER_MAX) || (config.Period <= 0.0)) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotSimulator::Start: invalid configuration" << std::endl;
+        return false;
+    }
+    Config = config;
+    Period = config.Period;
+    RandomState = config.Seed ? config.Seed : 1;
+    if (!Server.AssignPort(Config.Port) || !Server.Listen()) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotSimulator::Start: can't listen on port "
+                           << Config.Port << std::endl;
+        return false;
+    }
+    if (Config.DashboardPort
+        && (!DashboardServer.AssignPort(Config.DashboardPort) || !DashboardServer.Listen())) {
+        CMN_LOG_INIT_WARNING << "osaUniversalRobotSimulator::Start: can't listen on dashboard port "
+                             << Config.DashboardPort << std::endl;
+        Config.DashboardPort = 0;
+    }
+    StopRequested = false;
+    Running = true;
+    Thread.Create<osaUniversalRobotSimulator, void *>(this, &osaUniversalRobotSimulator::RunThread,
+                                                       0, "URsim");
+    return true;
+}
+
+void osaUniversalRobotSimulator::Stop(void)
+{
+    if (!Running)
+        return;
+    StopRequested = true;
+    Thread.Wait();
+    Running = false;
+    CloseRealTimeClient();
+    CloseClient(DashboardClient);
+    Server.Close();
+    if (Config.DashboardPort)
+        DashboardServer.Close();
+}
+
+bool osaUniversalRobotSimulator::SetPeriod(double period)
+{
+    if (period <= 0.0)
+        return false;
+    Period = period;
+    return true;
+}
+
+void osaUniversalRobotSimulator::GetJointPosition(double position[6])
+{
+    Mutex.Lock();
+    for (size_t i = 0; i < 6; i++)
+        position[i] = State.JointPosition[i];
+    Mutex.Unlock();
+}
+
+void osaUniversalRobotSimulator::SetJointPosition(const double position[6])
+{
+    Mutex.Lock();
+    for (size_t i = 0; i < 6; i++) {
+        State.JointPosition[i] = position[i];
+        State.JointTargetPosition[i] = position[i];
+    }
+    Motion = MOTION_NONE;
+    Mutex.Unlock();
+}
+
+void osaUniversalRobotSimulator::GetCommandRecords(std::vector<CommandRecord> &records)
+{
+    Mutex.Lock();
+    records.insert(records.end(), Records.begin(), Records.end());
+    Records.clear();
+    Mutex.Unlock();
+}
+
+double osaUniversalRobotSimulator::Random(void)
+{
+    // xorshift64*
+    RandomState ^= RandomState >> 12;
+    RandomState ^= RandomState << 25;
+    RandomState ^= RandomState >> 27;
+    const unsigned long long value = RandomState * 2685821657736338717ULL;
+    return static_cast<double>(value >> 11) / 9007199254740992.0;
+}
+
+void osaUniversalRobotSimulator::CloseClient(osaSocket *&client)
+{
+    if (client) {
+        client->Close();
+        delete client;
+        client = 0;
+    }
+}
+
+void osaUniversalRobotSimulator::CloseRealTimeClient(void)
+{
+    ClientAccepted = false;
+    CloseClient(Client);
+}
+
+void * osaUniversalRobotSimulator::RunThread(void *)
+{
+    double nextPacket = osaUniversalRobotMonotonicTime() + Period;
+    double sendTime = nextPacket;
+    while (!StopRequested) {
+        const double period = Period;
+        AcceptClients();
+        const double now = osaUniversalRobotMonotonicTime();
+        if (Client)
+            ReceiveCommands(now);
+        if (DashboardClient)
+            ServeDashboard();
+        if (now >= sendTime) {
+            Integrate(period);
+            if (Client)
+                SendPacket();
+            // Packets are scheduled at a fixed period; jitter only delays them
+            nextPacket += period;
+            if (nextPacket < now)
+                nextPacket = now;   // We were late, don't send a burst
+            sendTime = nextPacket + Random() * Config.Jitter;
+        }
+        else {
+            // Short sleeps so that commands are timestamped accurately
+            const double remaining = sendTime - now;
+            osaSleep((remaining < 0.0005) ? remaining : 0.0005);
+        }
+    }
+    return 0;
+}
+
+void osaUniversalRobotSimulator::AcceptClients(void)
+{
+    // Accept does not block; a new client replaces the previous one
+    osaSocket *client = Server.Accept();
+    if (client) {
+        CloseClient(Client);
+        Client = client;
+        ClientAccepted = true;
+        CommandLine.clear();
+        InProgram = false;
+        OutSize = 0;
+    }
+    if (Config.DashboardPort) {
+        client = DashboardServer.Accept();
+        if (client) {
+            CloseClient(DashboardClient);
+            DashboardClient = client;
+            DashboardLine.clear();
+            DashboardClient->Send("Connected: Universal Robots Dashboard Server\n");
+        }
+    }
+}
+
+void osaUniversalRobotSimulator::ReceiveCommands(double now)
+{
+    char buffer[1024];
+    int numBytes;
+    while ((numBytes = Client->Receive(buffer, sizeof(buffer), 0.0)) > 0) {
+        for (int i = 0; i < numBytes; i++) {
+            if (buffer[i] != '\n') {
+                CommandLine += buffer[i];
+                continue;
+            }
+            // Remove indentation
+            const size_t start = CommandLine.find_first_not_of(" \t");
+            const char *line = (start == std::string::npos) ? "" : CommandLine.c_str() + start;
+            if (InProgram) {
+                // Programs are recorded but not executed; only the final "end" is not indented
+                if (CommandLine == "end")
+                    InProgram = false;
+            }
+            else if (*line != '\0')
+                ExecuteCommand(line, now);
+            CommandLine.clear();
+        }
+    }
+    if (numBytes < 0)
+        CloseRealTimeClient();
+}
+
+// Parse up to count numbers found in text, skipping other characters
+static size_t ParseNumbers(const char *text, double *values, size_t count)
+{
+    size_t numValues = 0;
+    while (*text && (numValues < count)) {
+        if (((*text >= '0') && (*text <= '9')) || (*text == '-') || (*text == '.')) {
+            char *end;
+            values[numValues] = strtod(text, &end);
+            if (end != text) {
+                numValues++;
+                text = end;
+                continue;
+            }
+        }
+        text++;
+    }
+    return numValues;
+}
+
+void osaUniversalRobotSimulator::ExecuteCommand(const char *command, double now)
+{
+    CommandRecord record;
+    record.ArrivalTime = now;
+    size_t nameSize = strcspn(command, "( ");
+    if (nameSize >= CommandRecord::NAME_SIZE)
+        nameSize = CommandRecord::NAME_SIZE - 1;
+    memcpy(record.Name, command, nameSize);
+    record.Name[nameSize] = '\0';
+    const char *arguments = strchr(command, '(');
+
+    Mutex.Lock();
+    record.ControllerTime = State.Time;
+    if (Records.size() < MaxRecords)
+        Records.push_back(record);
+    else
+        CommandsDropped++;
+
+    double values[8];
+    if ((strcmp(record.Name, "def") == 0) || (strcmp(record.Name, "sec") == 0)) {
+        // A new program stops the current motion
+        InProgram = true;
+        Motion = MOTION_NONE;
+    }
+    else if (!arguments)
+        ;
+    else if (strcmp(record.Name, "speedj") == 0) {
+        // speedj(qd, a, t); acceleration is not simulated
+        const size_t numValues = ParseNumbers(arguments, values, 8);
+        if (numValues >= 6) {
+            for (size_t i = 0; i < 6; i++)
+                MotionVelocity[i] = values[i];
+            MotionTimeout = (numValues >= 8) ? values[7] : 0.0;
+            Motion = MOTION_SPEEDJ;
+        }
+    }
+    else if (strcmp(record.Name, "movej") == 0) {
+        // movej(q, a=a, v=v): all joints arrive at the same time, at velocity v for the largest motion
+        const size_t numValues = ParseNumbers(arguments, values, 8);
+        if (numValues >= 6) {
+            const double velocity = (numValues >= 8) ? values[7] : 1.05;
+            double largest = 0.0;
+            for (size_t i = 0; i < 6; i++) {
+                MotionTarget[i] = values[i];
+                largest = std::max(largest, fabs(values[i] - State.JointPosition[i]));
+            }
+            const double duration = (velocity > 0.0) ? largest / velocity : 0.0;
+            for (size_t i = 0; i < 6; i++) {
+                const double distance = MotionTarget[i] - State.JointPosition[i];
+                MotionVelocity[i] = (duration > 0.0) ? distance / duration : 0.0;
+            }
+            Motion = MOTION_MOVEJ;
+        }
+    }
+    else if ((strcmp(record.Name, "stopj") == 0) || (strcmp(record.Name, "stopl") == 0))
+        Motion = MOTION_NONE;
+    Mutex.Unlock();
+}
+
+void osaUniversalRobotSimulator::ServeDashboard(void)
+{
+    char buffer[256];
+    int numBytes;
+    while ((numBytes = DashboardClient->Receive(buffer, sizeof(buffer), 0.0)) > 0) {
+        for (int i = 0; i < numBytes; i++) {
+            if (buffer[i] != '\n') {
+                DashboardLine += buffer[i];
+                continue;
+            }
+            std::string reply;
+            if (DashboardLine == "PolyscopeVersion") {
+                static const char *versions[osaUniversalRobotPacketDecoder::VER_MAX] = {
+                    "", "URSoftware 1.7.0", "URSoftware 1.8.0", "URSoftware 3.1.0", "URSoftware 3.2.0" };
+                reply = versions[Config.Version];
+            }
+            else if (DashboardLine == "robotmode")
+                reply = "Robotmode: RUNNING";
+            else if (DashboardLine == "safetymode")
+                reply = "Safetymode: NORMAL";
+            else if (DashboardLine == "programState")
+                reply = InProgram ? "PLAYING" : "STOPPED";
+            else
+                reply = "could not understand: '" + DashboardLine + "'";
+            DashboardClient->Send(reply + "\n");
+            DashboardLine.clear();
+        }
+    }
+    if (numBytes < 0)
+        CloseClient(DashboardClient);
+}
+
+void osaUniversalRobotSimulator::Integrate(double dt)
+{
+    Mutex.Lock();
+    State.Time += dt;
+    switch (Motion) {
+    case MOTION_SPEEDJ:
+        for (size_t i = 0; i < 6; i++)
+            State.JointPosition[i] += MotionVelocity[i] * dt;
+        if (MotionTimeout > 0.0) {
+            MotionTimeout -= dt;
+            if (MotionTimeout <= 0.0)
+                Motion = MOTION_NONE;
+        }
+        break;
+    case MOTION_MOVEJ:
+        {
+            bool done = true;
+            for (size_t i = 0; i < 6; i++) {
+                const double remaining = MotionTarget[i] - State.JointPosition[i];
+                const double step = MotionVelocity[i] * dt;
+                if (fabs(step) >= fabs(remaining))
+                    State.JointPosition[i] = MotionTarget[i];
+                else {
+                    State.JointPosition[i] += step;
+                    done = false;
+                }
+            }
+            if (done)
+                Motion = MOTION_NONE;
+        }
+        break;
+    default:
+        break;
+    }
+    for (size_t i = 0; i < 6; i++) {
+        State.JointVelocity[i] = (Motion == MOTION_NONE) ? 0.0 : MotionVelocity[i];
+        State.JointTargetPosition[i] = State.JointPosition[i];
+        State.JointTargetVelocity[i] = State.JointVelocity[i];
+    }
+    Mutex.Unlock();
+}
+
+void osaUniversalRobotSimulator::SendPacket(void)
+{
+    const unsigned long length = osaUniversalRobotPacketDecoder::PacketLength[Config.Version];
+    Mutex.Lock();
+    osaUniversalRobotPacketDecoder::Encode(Config.Version, State, &OutBuffer[OutSize], length);
+    Mutex.Unlock();
+    OutSize += length;
+    PacketsSent++;
+
+    // Hold this packet and send it with the next one (at most two packets at once)
+    if ((OutSize == length) && (Random() < Config.CoalesceProbability))
+        return;
+
+    int numBytes;
+    if (Random() < Config.FragmentProbability) {
+        // Split at a random position, including inside the length header
+        const size_t split = 1 + static_cast<size_t>(Random() * (OutSize - 1));
+        numBytes = Client->Send(&OutBuffer[0], static_cast<unsigned int>(split));
+        if (numBytes >= 0) {
+            osaSleep(FRAGMENT_DELAY);
+            numBytes = Client->Send(&OutBuffer[split], static_cast<unsigned int>(OutSize - split));
+        }
+    }
+    else
+        numBytes = Client->Send(&OutBuffer[0], static_cast<unsigned int>(OutSize));
+    OutSize = 0;
+    if (numBytes < 0)
+        CloseRealTimeClient();
+}
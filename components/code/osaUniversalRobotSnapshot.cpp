@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cstring>
+#include <new>
+
+#include <cisstCommon/cmnLogger.h>
+#include <sawUniversalRobot/osaUniversalRobotSnapshot.h>
+
+#if (CISST_OS != CISST_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Identifies the shared memory objects ("URSN") and their layout
+const uint32_t SNAPSHOT_MAGIC = 0x5552534e;
+const uint32_t SNAPSHOT_VERSION = 1;
+
+osaUniversalRobotSnapshot::osaUniversalRobotSnapshot(void) :
+    Memory(&Local), Mapping(0)
+{
+    Initialize(Local);
+}
+
+osaUniversalRobotSnapshot::~osaUniversalRobotSnapshot()
+{
+    Close();
+}
+
+void osaUniversalRobotSnapshot::Initialize(Block &block)
+{
+    block.Sequence.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < NUM_WORDS; i++)
+        block.Words[i].store(0, std::memory_order_relaxed);
+    block.Version = SNAPSHOT_VERSION;
+    block.DataSize = sizeof(osaUniversalRobotSnapshotData);
+    // Written last, so that a reader opening the object checks a complete header
+    std::atomic_thread_fence(std::memory_order_release);
+    block.Magic = SNAPSHOT_MAGIC;
+}
+
+bool osaUniversalRobotSnapshot::CreateShared(const std::string &name)
+{
+#if (CISST_OS != CISST_WINDOWS)
+    Close();
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotSnapshot: can't create shared memory " << name << std::endl;
+        return false;
+    }
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, sizeof(Block)) == 0)
+        mapping = mmap(0, sizeof(Block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotSnapshot: can't map shared memory " << name << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+    Block *block = new (mapping) Block;
+    block->Magic = 0;
+    Initialize(*block);
+    // Keep the data published so far
+    osaUniversalRobotSnapshotData data;
+    const bool published = Read(data);
+    Memory = block;
+    Mapping = mapping;
+    SharedName = name;
+    if (published)
+        Publish(data);
+    return true;
+#else
+    CMN_LOG_INIT_ERROR << "osaUniversalRobotSnapshot: shared memory is not supported on this platform" << std::endl;
+    return false;
+#endif
+}
+
+bool osaUniversalRobotSnapshot::OpenShared(const std::string &name)
+{
+#if (CISST_OS != CISST_WINDOWS)
+    Close();
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat status;
+    void *mapping = MAP_FAILED;
+    if ((fstat(fd, &status) == 0) && (static_cast<size_t>(status.st_size) >= sizeof(Block)))
+        mapping = mmap(0, sizeof(Block), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    const Block *block = static_cast<const Block *>(mapping);
+    if ((block->Magic != SNAPSHOT_MAGIC) || (block->Version != SNAPSHOT_VERSION)
+        || (block->DataSize != sizeof(osaUniversalRobotSnapshotData))) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotSnapshot: shared memory " << name
+                           << " has a different layout" << std::endl;
+        munmap(mapping, sizeof(Block));
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    Memory = static_cast<Block *>(mapping);
+    Mapping = mapping;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void osaUniversalRobotSnapshot::Close(void)
+{
+    if (!Mapping)
+        return;
+#if (CISST_OS != CISST_WINDOWS)
+    // The writer keeps the latest data in process memory
+    osaUniversalRobotSnapshotData data;
+    const bool published = !SharedName.empty() && Read(data);
+    Memory = &Local;
+    munmap(Mapping, sizeof(Block));
+    Mapping = 0;
+    if (!SharedName.empty()) {
+        shm_unlink(SharedName.c_str());
+        SharedName.clear();
+    }
+    if (published)
+        Publish(data);
+#endif
+}
+
+void osaUniversalRobotSnapshot::Publish(const osaUniversalRobotSnapshotData &data)
+{
+    uint64_t words[NUM_WORDS];
+    memcpy(words, &data, sizeof(words));
+    Block &block = *Memory;
+    const uint64_t sequence = block.Sequence.load(std::memory_order_relaxed);
+    block.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < NUM_WORDS; i++)
+        block.Words[i].store(words[i], std::memory_order_relaxed);
+    block.Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool osaUniversalRobotSnapshot::Read(osaUniversalRobotSnapshotData &data) const
+{
+    const Block &block = *Memory;
+    uint64_t words[NUM_WORDS];
+    for (size_t attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        const uint64_t before = block.Sequence.load(std::memory_order_acquire);
+        if (before == 0)
+            return false;
+        if (before & 1)
+            continue;
+        for (size_t i = 0; i < NUM_WORDS; i++)
+            words[i] = block.Words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block.Sequence.load(std::memory_order_relaxed) == before) {
+            memcpy(&data, words, sizeof(words));
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t osaUniversalRobotSnapshot::GetNumberOfUpdates(void) const
+{
+    return Memory->Sequence.load(std::memory_order_acquire) / 2;
+}
@@ -0,0 +1,212 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <string.h>
+
+#include <cisstOSAbstraction/osaSocket.h>
+#include <sawUniversalRobot/osaUniversalRobotStreamFramer.h>
+
+osaUniversalRobotStreamFramer::osaUniversalRobotStreamFramer(size_t capacity, size_t headerSize) :
+    HeaderSize(headerSize), Head(0), Tail(0), MinLength(headerSize), MaxLength(0),
+    Policy(ALL_FRAMES), InResync(false)
+{
+    size_t size = 64;
+    while (size < capacity)
+        size <<= 1;
+    Ring.resize(size);
+    Mask = size - 1;
+    // By default, any frame that fits in half the ring is valid
+    SetLengthRange(headerSize, size/2);
+    memset(&Stats, 0, sizeof(Stats));
+}
+
+void osaUniversalRobotStreamFramer::SetLengthRange(unsigned long minLength, unsigned long maxLength)
+{
+    if (minLength < HeaderSize)
+        minLength = HeaderSize;
+    // We need room for at least two frames so that a frame can be completed
+    // while the previous one is being processed
+    if (maxLength > Ring.size()/2)
+        maxLength = Ring.size()/2;
+    MinLength = minLength;
+    MaxLength = maxLength;
+    Scratch.resize(MaxLength);
+}
+
+void osaUniversalRobotStreamFramer::Reset(void)
+{
+    Head = Tail = 0;
+    InResync = false;
+}
+
+void osaUniversalRobotStreamFramer::KeepNewest(void)
+{
+    // Invalid data is left to NextFrame, which resynchronizes and counts it
+    unsigned long length, nextLength;
+    while (FrameAt(0, length) && FrameAt(length, nextLength))
+        Head += length;
+}
+
+char * osaUniversalRobotStreamFramer::WritePointer(void)
+{
+    return &Ring[Tail & Mask];
+}
+
+size_t osaUniversalRobotStreamFramer::WriteAvailable(void) const
+{
+    const size_t freeSpace = Ring.size() - Size();
+    const size_t toEnd = Ring.size() - (Tail & Mask);
+    return (freeSpace < toEnd) ? freeSpace : toEnd;
+}
+
+void osaUniversalRobotStreamFramer::Commit(size_t numBytes)
+{
+    Tail += numBytes;
+}
+
+bool osaUniversalRobotStreamFramer::PrepareWrite(void)
+{
+    // Make sure there is always room for a complete frame
+    if (Ring.size() - Size() >= MaxLength)
+        return true;
+    if (Policy == NEWEST_FRAME) {
+        MakeRoom(MaxLength);
+        return true;
+    }
+    // Frames are never dropped: the rest of the burst stays in the kernel buffer
+    // until NextFrame has made room.  Since the ring holds two frames of MaxLength,
+    // there is room once the invalid data has been skipped.
+    unsigned long length;
+    return !FrameAvailable(length);
+}
+
+int osaUniversalRobotStreamFramer::Receive(osaSocket &socket, double timeoutSec)
+{
+    int total = 0;
+    double timeout = timeoutSec;
+    while (PrepareWrite()) {
+        size_t available = WriteAvailable();
+        int numBytes = socket.Receive(WritePointer(), static_cast<unsigned int>(available), timeout);
+        if (numBytes < 0)
+            return -1;
+        if (numBytes == 0)
+            break;
+        Commit(numBytes);
+        total += numBytes;
+        // Only the first receive waits; then we read what the kernel already has
+        timeout = 0.0;
+        // A partial read means the kernel buffer is empty
+        if (static_cast<size_t>(numBytes) < available)
+            break;
+    }
+    return total;
+}
+
+void osaUniversalRobotStreamFramer::Peek(size_t offset, size_t numBytes, char *dest) const
+{
+    const size_t start = (Head + offset) & Mask;
+    const size_t first = Ring.size() - start;
+    if (numBytes <= first)
+        memcpy(dest, &Ring[start], numBytes);
+    else {
+        memcpy(dest, &Ring[start], first);
+        memcpy(dest + first, &Ring[0], numBytes - first);
+    }
+}
+
+unsigned long osaUniversalRobotStreamFramer::HeaderLength(size_t offset) const
+{
+    unsigned char header[4];
+    Peek(offset, HeaderSize, reinterpret_cast<char *>(header));
+    unsigned long length = 0;
+    for (size_t i = 0; i < HeaderSize; i++)
+        length = (length << 8) | header[i];
+    return length;
+}
+
+bool osaUniversalRobotStreamFramer::FrameAt(size_t offset, unsigned long &length) const
+{
+    if (Size() < offset + HeaderSize)
+        return false;
+    length = HeaderLength(offset);
+    if ((length < MinLength) || (length > MaxLength))
+        return false;
+    return (Size() >= offset + length);
+}
+
+bool osaUniversalRobotStreamFramer::FrameAvailable(unsigned long &length)
+{
+    while (Size() >= HeaderSize) {
+        length = HeaderLength(0);
+        if ((length >= MinLength) && (length <= MaxLength)) {
+            InResync = false;
+            return (Size() >= length);   // False if the frame is not complete yet
+        }
+        // Invalid header, skip one byte and try again
+        if (!InResync) {
+            InResync = true;
+            Stats.Resyncs++;
+            Stats.LastInvalidLength = length;
+        }
+        Stats.BytesDiscarded++;
+        Head++;
+    }
+    return false;
+}
+
+bool osaUniversalRobotStreamFramer::NextFrame(const char *&frame, unsigned long &length)
+{
+    if (!FrameAvailable(length))
+        return false;
+    Stats.FramesReceived++;
+    if (Policy == NEWEST_FRAME) {
+        unsigned long nextLength;
+        while (FrameAt(length, nextLength)) {
+            Head += length;
+            Stats.FramesCoalesced++;
+            Stats.FramesReceived++;
+            length = nextLength;
+        }
+    }
+    const size_t start = Head & Mask;
+    if (start + length <= Ring.size())
+        frame = &Ring[start];
+    else {
+        Peek(0, length, &Scratch[0]);
+        frame = &Scratch[0];
+    }
+    Head += length;
+    Stats.FramesDelivered++;
+    return true;
+}
+
+void osaUniversalRobotStreamFramer::MakeRoom(size_t numBytes)
+{
+    unsigned long length;
+    while (Ring.size() - Size() < numBytes) {
+        if (FrameAvailable(length)) {
+            Head += length;
+            Stats.FramesReceived++;
+            Stats.FramesDropped++;
+        }
+        else if (Size() >= MaxLength) {
+            // Should not happen since a valid frame fits in MaxLength; start over
+            Stats.BytesDiscarded += Size();
+            Reset();
+        }
+        else
+            break;
+    }
+}
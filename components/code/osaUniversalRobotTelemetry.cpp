@@ -0,0 +1,347 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <cstring>
+#include <sstream>
+
+#include <cisstCommon/cmnLogger.h>
+#include <cisstCommon/cmnUnits.h>
+#include <sawUniversalRobot/osaUniversalRobotTelemetry.h>
+
+#ifdef SAW_UNIVERSAL_ROBOT_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+typedef osaUniversalRobotPacketDecoder Decoder;
+
+const char FILE_MAGIC[8] = { 'U', 'R', 'T', 'E', 'L', 'E', 'M', '1' };
+const char CHUNK_MAGIC[4] = { 'C', 'H', 'N', 'K' };
+const uint32_t FORMAT_VERSION = 1;
+enum { COLUMN_FLOAT64 = 0, COLUMN_UINT64 = 1 };
+enum { COMPRESSION_NONE = 0, COMPRESSION_ZLIB = 1 };
+
+// All fields are 8-byte big-endian values, so one conversion handles doubles and integers
+static inline uint64_t LoadBigEndian64(const char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__GNUC__)
+    return __builtin_bswap64(value);
+#else
+    uint64_t result = 0;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(p);
+    for (size_t i = 0; i < 8; i++)
+        result = (result << 8) | bytes[i];
+    return result;
+#endif
+}
+
+template <class _type>
+static void WriteValue(std::FILE *file, _type value)
+{
+    std::fwrite(&value, sizeof(value), 1, file);
+}
+
+osaUniversalRobotTelemetry::osaUniversalRobotTelemetry(void) :
+    RowsPerChunk(0), CompressionLevel(0), Version(Decoder::VER_UNKNOWN), NumColumns(0),
+    FullChunks(MAX_CHUNKS), FreeChunks(MAX_CHUNKS), Current(NO_CHUNK), File(0), HeaderWritten(false),
+    StopRequested(false), Running(false), RowsWritten(0), RowsDropped(0), FramesIgnored(0)
+{
+}
+
+osaUniversalRobotTelemetry::~osaUniversalRobotTelemetry()
+{
+    Close();
+}
+
+bool osaUniversalRobotTelemetry::CompressionAvailable(void)
+{
+#ifdef SAW_UNIVERSAL_ROBOT_HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool osaUniversalRobotTelemetry::Selected(const char *name) const
+{
+    if (FieldNames.empty())
+        return true;
+    for (size_t i = 0; i < FieldNames.size(); i++) {
+        if (FieldNames[i] == name)
+            return true;
+    }
+    return false;
+}
+
+bool osaUniversalRobotTelemetry::Open(const std::string &filename, const std::vector<std::string> &fields,
+                                      size_t rowsPerChunk, int compressionLevel, size_t numChunks)
+{
+    Close();
+    FieldNames = fields;
+    if ((compressionLevel > 0) && !CompressionAvailable()) {
+        CMN_LOG_INIT_WARNING << "osaUniversalRobotTelemetry::Open: compiled without zlib, chunks are not compressed"
+                             << std::endl;
+        compressionLevel = 0;
+    }
+    CompressionLevel = (compressionLevel > 9) ? 9 : compressionLevel;
+    RowsPerChunk = (rowsPerChunk > 0) ? rowsPerChunk : 1;
+
+    // Largest number of columns over all versions, and check the field names
+    size_t maxColumns = 0;
+    std::vector<bool> found(FieldNames.size(), false);
+    for (int version = Decoder::VER_UNKNOWN + 1; version < Decoder::VER_MAX; version++) {
+        size_t numFields;
+        const Decoder::Field *table = Decoder::GetFields(static_cast<Decoder::FirmwareVersion>(version), numFields);
+        size_t numColumns = 0;
+        for (size_t i = 0; i < numFields; i++) {
+            if (!Selected(table[i].Name))
+                continue;
+            numColumns += table[i].Count;
+            for (size_t j = 0; j < FieldNames.size(); j++) {
+                if (FieldNames[j] == table[i].Name)
+                    found[j] = true;
+            }
+        }
+        if (numColumns > maxColumns)
+            maxColumns = numColumns;
+    }
+    for (size_t j = 0; j < FieldNames.size(); j++) {
+        if (!found[j]) {
+            CMN_LOG_INIT_ERROR << "osaUniversalRobotTelemetry::Open: unknown field \"" << FieldNames[j]
+                               << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    File = std::fopen(filename.c_str(), "wb");
+    if (!File) {
+        CMN_LOG_INIT_ERROR << "osaUniversalRobotTelemetry::Open: can't create \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    HeaderWritten = false;
+    Version = Decoder::VER_UNKNOWN;
+    ColumnOffsets.clear();
+    ColumnOffsets.reserve(maxColumns);
+    NumColumns = 0;
+
+    // Preallocate the chunks; the receive time is the first column
+    const size_t valuesPerChunk = (maxColumns + 1) * RowsPerChunk;
+    if (numChunks < 2)
+        numChunks = 2;
+    else if (numChunks > MAX_CHUNKS)
+        numChunks = MAX_CHUNKS;
+    Chunks.resize(numChunks);
+    // The writer thread is stopped, empty the queues of a previous file
+    while (FullChunks.Front())
+        FullChunks.Pop();
+    while (FreeChunks.Front())
+        FreeChunks.Pop();
+    for (size_t i = 0; i < Chunks.size(); i++) {
+        Chunks[i].Values.assign(valuesPerChunk, 0);
+        Chunks[i].Rows = 0;
+        *FreeChunks.WriteSlot() = i;
+        FreeChunks.Push();
+    }
+    Current = NO_CHUNK;
+    RawBuffer.resize(valuesPerChunk * sizeof(uint64_t));
+#ifdef SAW_UNIVERSAL_ROBOT_HAS_ZLIB
+    CompressedBuffer.resize(compressBound(static_cast<uLong>(RawBuffer.size())));
+#endif
+    RowsWritten = 0;
+    RowsDropped = 0;
+    FramesIgnored = 0;
+
+    StopRequested = false;
+    Running = true;
+    Thread.Create<osaUniversalRobotTelemetry, void *>(this, &osaUniversalRobotTelemetry::RunThread,
+                                                       0, "URtelem");
+    return true;
+}
+
+void osaUniversalRobotTelemetry::Close(void)
+{
+    if (!File)
+        return;
+    // Write the partial chunk
+    if (Current != NO_CHUNK)
+        PushChunk();
+    if (Running) {
+        StopRequested = true;
+        ChunkReady.Raise();
+        Thread.Wait();
+        Running = false;
+    }
+    std::fclose(File);
+    File = 0;
+}
+
+void osaUniversalRobotTelemetry::SetSchema(Decoder::FirmwareVersion version)
+{
+    size_t numFields;
+    const Decoder::Field *table = Decoder::GetFields(version, numFields);
+    // Capacity was reserved by Open, so this does not allocate
+    ColumnOffsets.clear();
+    for (size_t i = 0; i < numFields; i++) {
+        if (!Selected(table[i].Name))
+            continue;
+        for (unsigned short j = 0; j < table[i].Count; j++)
+            ColumnOffsets.push_back(static_cast<unsigned short>(table[i].Offset + 8 * j));
+    }
+    NumColumns = ColumnOffsets.size() + 1;
+    Version = version;
+}
+
+void osaUniversalRobotTelemetry::PushChunk(void)
+{
+    *FullChunks.WriteSlot() = Current;
+    FullChunks.Push();
+    Current = NO_CHUNK;
+    ChunkReady.Raise();
+}
+
+void osaUniversalRobotTelemetry::Frame(const char *frame, unsigned long length, double receiveTime)
+{
+    if (!File)
+        return;
+    // The schema is set by the first frame
+    if (Version == Decoder::VER_UNKNOWN) {
+        const Decoder::FirmwareVersion version = Decoder::VersionFromLength(length);
+        if (version == Decoder::VER_UNKNOWN) {
+            FramesIgnored++;
+            return;
+        }
+        SetSchema(version);
+    }
+    else if (length != Decoder::PacketLength[Version]) {
+        FramesIgnored++;
+        return;
+    }
+
+    if (Current == NO_CHUNK) {
+        const size_t *chunkIndex = FreeChunks.Front();
+        if (!chunkIndex) {
+            RowsDropped++;
+            return;
+        }
+        Current = *chunkIndex;
+        FreeChunks.Pop();
+    }
+
+    Chunk &chunk = Chunks[Current];
+    uint64_t *column = &chunk.Values[chunk.Rows];
+    memcpy(column, &receiveTime, sizeof(uint64_t));
+    const size_t numFieldColumns = NumColumns - 1;
+    for (size_t i = 0; i < numFieldColumns; i++) {
+        column += RowsPerChunk;
+        *column = LoadBigEndian64(frame + ColumnOffsets[i]);
+    }
+    chunk.Rows++;
+    if (chunk.Rows == RowsPerChunk)
+        PushChunk();
+}
+
+void osaUniversalRobotTelemetry::WriteHeader(void)
+{
+    std::fwrite(FILE_MAGIC, sizeof(FILE_MAGIC), 1, File);
+    WriteValue<uint32_t>(File, FORMAT_VERSION);
+    WriteValue<uint32_t>(File, static_cast<uint32_t>(Version));
+    WriteValue<uint32_t>(File, static_cast<uint32_t>(RowsPerChunk));
+    WriteValue<uint32_t>(File, static_cast<uint32_t>(NumColumns));
+
+    std::vector<std::string> names(1, "receive_time");
+    std::vector<unsigned char> types(1, COLUMN_FLOAT64);
+    size_t numFields;
+    const Decoder::Field *table = Decoder::GetFields(Version, numFields);
+    for (size_t i = 0; i < numFields; i++) {
+        if (!Selected(table[i].Name))
+            continue;
+        for (unsigned short j = 0; j < table[i].Count; j++) {
+            std::stringstream name;
+            name << table[i].Name;
+            if (table[i].Count > 1)
+                name << "[" << j << "]";
+            names.push_back(name.str());
+            types.push_back(table[i].Integer ? COLUMN_UINT64 : COLUMN_FLOAT64);
+        }
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        WriteValue<uint8_t>(File, types[i]);
+        WriteValue<uint8_t>(File, static_cast<uint8_t>(names[i].size()));
+        std::fwrite(names[i].data(), 1, names[i].size(), File);
+    }
+    HeaderWritten = true;
+}
+
+void osaUniversalRobotTelemetry::WriteChunk(const Chunk &chunk)
+{
+    if (chunk.Rows == 0)
+        return;
+    if (!HeaderWritten)
+        WriteHeader();
+
+    // Columns one after the other, without the unused rows of a partial chunk
+    const size_t columnSize = chunk.Rows * sizeof(uint64_t);
+    const size_t rawSize = NumColumns * columnSize;
+    for (size_t i = 0; i < NumColumns; i++)
+        memcpy(&RawBuffer[i * columnSize], &chunk.Values[i * RowsPerChunk], columnSize);
+
+    const char *payload = &RawBuffer[0];
+    size_t payloadSize = rawSize;
+    uint32_t compression = COMPRESSION_NONE;
+#ifdef SAW_UNIVERSAL_ROBOT_HAS_ZLIB
+    if (CompressionLevel > 0) {
+        uLongf compressedSize = static_cast<uLongf>(CompressedBuffer.size());
+        if (compress2(reinterpret_cast<Bytef *>(&CompressedBuffer[0]), &compressedSize,
+                      reinterpret_cast<const Bytef *>(&RawBuffer[0]), static_cast<uLong>(rawSize),
+                      CompressionLevel) == Z_OK) {
+            payload = &CompressedBuffer[0];
+            payloadSize = compressedSize;
+            compression = COMPRESSION_ZLIB;
+        }
+    }
+#endif
+    std::fwrite(CHUNK_MAGIC, sizeof(CHUNK_MAGIC), 1, File);
+    WriteValue<uint32_t>(File, static_cast<uint32_t>(chunk.Rows));
+    WriteValue<uint32_t>(File, compression);
+    WriteValue<uint32_t>(File, 0);
+    WriteValue<uint64_t>(File, payloadSize);
+    WriteValue<uint64_t>(File, rawSize);
+    std::fwrite(payload, 1, payloadSize, File);
+    std::fflush(File);
+    RowsWritten += chunk.Rows;
+}
+
+void * osaUniversalRobotTelemetry::RunThread(void *)
+{
+    while (true) {
+        // Check StopRequested before emptying the queue, so that the chunks pushed
+        // before the request are written
+        const bool stop = StopRequested;
+        const size_t *chunkIndex;
+        while ((chunkIndex = FullChunks.Front()) != 0) {
+            const size_t index = *chunkIndex;
+            FullChunks.Pop();
+            WriteChunk(Chunks[index]);
+            Chunks[index].Rows = 0;
+            *FreeChunks.WriteSlot() = index;
+            FreeChunks.Push();
+        }
+        if (stop)
+            break;
+        ChunkReady.Wait(0.1 * cmn_s);
+    }
+    return 0;
+}
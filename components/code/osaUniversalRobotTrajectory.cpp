@@ -0,0 +1,263 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <sawUniversalRobot/osaUniversalRobotTrajectory.h>
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+
+// Segments shorter than this (rad or m) are skipped
+const double MIN_LENGTH = 1.0e-9;
+
+void osaUniversalRobotTrajectory::Profile::Compute(double velocity, double acceleration, double jerk)
+{
+    // Rest to rest over a distance of 1
+    Jerk = jerk;
+    if (velocity * jerk >= acceleration * acceleration) {
+        JerkTime = acceleration / jerk;
+        AccelerationTime = JerkTime + velocity / acceleration;
+    }
+    else {
+        JerkTime = std::sqrt(velocity / jerk);
+        AccelerationTime = 2.0 * JerkTime;
+    }
+    CruiseTime = 1.0 / velocity - AccelerationTime;
+    if (CruiseTime < 0.0) {
+        // Maximum velocity is not reached
+        CruiseTime = 0.0;
+        if (acceleration * acceleration * acceleration <= 0.5 * jerk * jerk) {
+            JerkTime = acceleration / jerk;
+            AccelerationTime = 0.5 * JerkTime + std::sqrt(0.25 * JerkTime * JerkTime + 1.0 / acceleration);
+        }
+        else {
+            JerkTime = std::pow(0.5 / jerk, 1.0 / 3.0);
+            AccelerationTime = 2.0 * JerkTime;
+        }
+    }
+    MaxAcceleration = jerk * JerkTime;
+    MaxVelocity = MaxAcceleration * (AccelerationTime - JerkTime);
+    Duration = 2.0 * AccelerationTime + CruiseTime;
+}
+
+double osaUniversalRobotTrajectory::Profile::AccelerationPhase(double time) const
+{
+    if (time < JerkTime)
+        return Jerk * time * time * time / 6.0;
+    if (time < AccelerationTime - JerkTime)
+        return MaxAcceleration * (3.0 * time * time - 3.0 * JerkTime * time + JerkTime * JerkTime) / 6.0;
+    const double remaining = AccelerationTime - time;
+    return 0.5 * MaxVelocity * AccelerationTime - MaxVelocity * remaining
+        + Jerk * remaining * remaining * remaining / 6.0;
+}
+
+double osaUniversalRobotTrajectory::Profile::Position(double time) const
+{
+    if (time <= 0.0)
+        return 0.0;
+    if (time >= Duration)
+        return 1.0;
+    // The deceleration is symmetric to the acceleration
+    if (time > AccelerationTime + CruiseTime)
+        return 1.0 - AccelerationPhase(Duration - time);
+    if (time > AccelerationTime)
+        return MaxVelocity * (0.5 * AccelerationTime + time - AccelerationTime);
+    return AccelerationPhase(time);
+}
+
+osaUniversalRobotTrajectory::osaUniversalRobotTrajectory(void)
+{
+    Clear();
+}
+
+void osaUniversalRobotTrajectory::Clear(void)
+{
+    Active = false;
+    TrajectorySpace = JOINT;
+    NumWaypoints = 0;
+    Duration = 0.0;
+    Segments.clear();
+    memset(BasePosition, 0, sizeof(BasePosition));
+    osaUniversalRobotPoseConverter::AxisAngleToRotation(BasePosition + 3, BaseRotation);
+    FirstActive = 0;
+    WaypointsReached = 0;
+}
+
+void osaUniversalRobotTrajectory::AddSegment(const double delta[6], double velocity, double acceleration,
+                                             double jerk, double blend)
+{
+    Segment segment;
+    memcpy(segment.Delta, delta, sizeof(segment.Delta));
+    segment.Shape.Compute(velocity, acceleration, jerk);
+    segment.Start = 0.0;
+    if (!Segments.empty()) {
+        const Segment &previous = Segments.back();
+        double overlap = previous.Shape.AccelerationTime;
+        if (segment.Shape.AccelerationTime < overlap)
+            overlap = segment.Shape.AccelerationTime;
+        segment.Start = previous.Start + previous.Shape.Duration - blend * overlap;
+    }
+    Segments.push_back(segment);
+    if (segment.Start + segment.Shape.Duration > Duration)
+        Duration = segment.Start + segment.Shape.Duration;
+}
+
+bool osaUniversalRobotTrajectory::SetJoint(const double start[6], const double *waypoints, size_t numWaypoints,
+                                           const double velocity[6], const double acceleration[6],
+                                           const double jerk[6], double blend)
+{
+    for (size_t i = 0; i < 6; i++) {
+        if (!(velocity[i] > 0.0) || !(acceleration[i] > 0.0) || !(jerk[i] > 0.0))
+            return false;
+    }
+    Clear();
+    blend = (blend < 0.0) ? 0.0 : ((blend > 1.0) ? 1.0 : blend);
+    TrajectorySpace = JOINT;
+    NumWaypoints = numWaypoints;
+    memcpy(BasePosition, start, sizeof(BasePosition));
+    Segments.reserve(numWaypoints);
+    const double *previous = start;
+    for (size_t w = 0; w < numWaypoints; w++) {
+        const double *waypoint = waypoints + 6 * w;
+        double delta[6];
+        // Limits of the segment parameter (0 to 1): the most constrained joint
+        double v = HUGE_VAL, a = HUGE_VAL, j = HUGE_VAL;
+        for (size_t i = 0; i < 6; i++) {
+            delta[i] = waypoint[i] - previous[i];
+            const double length = std::fabs(delta[i]);
+            if (length > MIN_LENGTH) {
+                v = std::min(v, velocity[i] / length);
+                a = std::min(a, acceleration[i] / length);
+                j = std::min(j, jerk[i] / length);
+            }
+        }
+        previous = waypoint;
+        if (v == HUGE_VAL) {
+            // Same as the previous waypoint; it is reached with it
+            memset(delta, 0, sizeof(delta));
+            v = a = j = 1.0e9;
+        }
+        AddSegment(delta, v, a, j, blend);
+    }
+    Active = true;
+    return true;
+}
+
+bool osaUniversalRobotTrajectory::SetCartesian(const double start[6], const double *waypoints,
+                                               size_t numWaypoints, const double velocity[2],
+                                               const double acceleration[2], const double jerk[2],
+                                               double blend)
+{
+    for (size_t i = 0; i < 2; i++) {
+        if (!(velocity[i] > 0.0) || !(acceleration[i] > 0.0) || !(jerk[i] > 0.0))
+            return false;
+    }
+    Clear();
+    blend = (blend < 0.0) ? 0.0 : ((blend > 1.0) ? 1.0 : blend);
+    TrajectorySpace = CARTESIAN;
+    NumWaypoints = numWaypoints;
+    memcpy(BasePosition, start, sizeof(BasePosition));
+    osaUniversalRobotPoseConverter::AxisAngleToRotation(start + 3, BaseRotation);
+    Segments.reserve(numWaypoints);
+    const double *previous = start;
+    double previousRotation[9];
+    memcpy(previousRotation, BaseRotation, sizeof(previousRotation));
+    for (size_t w = 0; w < numWaypoints; w++) {
+        const double *waypoint = waypoints + 6 * w;
+        double rotation[9];
+        osaUniversalRobotPoseConverter::AxisAngleToRotation(waypoint + 3, rotation);
+        // Rotation from the previous waypoint, in its frame
+        double relative[9];
+        for (size_t row = 0; row < 3; row++)
+            for (size_t column = 0; column < 3; column++)
+                relative[3*row + column] = previousRotation[row] * rotation[column]
+                                         + previousRotation[3 + row] * rotation[3 + column]
+                                         + previousRotation[6 + row] * rotation[6 + column];
+        double delta[6];
+        for (size_t i = 0; i < 3; i++)
+            delta[i] = waypoint[i] - previous[i];
+        osaUniversalRobotPoseConverter::RotationToAxisAngle(relative, delta + 3);
+        const double lengths[2] = {
+            std::sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]),
+            std::sqrt(delta[3] * delta[3] + delta[4] * delta[4] + delta[5] * delta[5]) };
+        double v = HUGE_VAL, a = HUGE_VAL, j = HUGE_VAL;
+        for (size_t i = 0; i < 2; i++) {
+            if (lengths[i] > MIN_LENGTH) {
+                v = std::min(v, velocity[i] / lengths[i]);
+                a = std::min(a, acceleration[i] / lengths[i]);
+                j = std::min(j, jerk[i] / lengths[i]);
+            }
+        }
+        previous = waypoint;
+        memcpy(previousRotation, rotation, sizeof(previousRotation));
+        if (v == HUGE_VAL) {
+            memset(delta, 0, sizeof(delta));
+            v = a = j = 1.0e9;
+        }
+        AddSegment(delta, v, a, j, blend);
+    }
+    Active = true;
+    return true;
+}
+
+void osaUniversalRobotTrajectory::Apply(const Segment &segment, double s, double position[6], double rotation[9]) const
+{
+    if (TrajectorySpace == JOINT) {
+        for (size_t i = 0; i < 6; i++)
+            position[i] += s * segment.Delta[i];
+        return;
+    }
+    for (size_t i = 0; i < 3; i++)
+        position[i] += s * segment.Delta[i];
+    const double axisAngle[3] = { s * segment.Delta[3], s * segment.Delta[4], s * segment.Delta[5] };
+    double step[9];
+    osaUniversalRobotPoseConverter::AxisAngleToRotation(axisAngle, step);
+    double result[9];
+    for (size_t row = 0; row < 3; row++)
+        for (size_t column = 0; column < 3; column++)
+            result[3*row + column] = rotation[3*row] * step[column]
+                                   + rotation[3*row + 1] * step[3 + column]
+                                   + rotation[3*row + 2] * step[6 + column];
+    memcpy(rotation, result, sizeof(result));
+}
+
+void osaUniversalRobotTrajectory::Evaluate(double time, double setpoint[6])
+{
+    time = (time < 0.0) ? 0.0 : ((time > Duration) ? Duration : time);
+    // Completed segments are added to the base once
+    while ((FirstActive < Segments.size())
+           && (time >= Segments[FirstActive].Start + Segments[FirstActive].Shape.Duration)) {
+        Apply(Segments[FirstActive], 1.0, BasePosition, BaseRotation);
+        FirstActive++;
+    }
+    WaypointsReached = FirstActive;
+
+    double position[6];
+    double rotation[9];
+    memcpy(position, BasePosition, sizeof(position));
+    memcpy(rotation, BaseRotation, sizeof(rotation));
+    for (size_t k = FirstActive; (k < Segments.size()) && (Segments[k].Start <= time); k++)
+        Apply(Segments[k], Segments[k].Shape.Position(time - Segments[k].Start), position, rotation);
+
+    for (size_t i = 0; i < 3; i++)
+        setpoint[i] = position[i];
+    if (TrajectorySpace == JOINT) {
+        for (size_t i = 3; i < 6; i++)
+            setpoint[i] = position[i];
+    }
+    else
+        osaUniversalRobotPoseConverter::RotationToAxisAngle(rotation, setpoint + 3);
+}
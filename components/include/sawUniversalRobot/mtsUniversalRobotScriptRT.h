@@ -18,8 +18,12 @@ http://www.cisst.org/cisst/license.txt.
 #ifndef _mtsUniversalRobotScriptRT_h
 #define _mtsUniversalRobotScriptRT_h
 
+#include <atomic>
+
 #include <cisstVector/vctTypes.h>
+#include <cisstOSAbstraction/osaMutex.h>
 #include <cisstOSAbstraction/osaSocket.h>
+#include <cisstOSAbstraction/osaThread.h>
 #include <cisstMultiTask/mtsTaskContinuous.h>
 #include <cisstParameterTypes/prmStateJoint.h>
 #include <cisstParameterTypes/prmPositionJointGet.h>
@@ -31,6 +35,31 @@ http://www.cisst.org/cisst/license.txt.
 #include <cisstParameterTypes/prmVelocityCartesianGet.h>
 #include <cisstParameterTypes/prmVelocityCartesianSet.h>
 #include <cisstParameterTypes/prmForceCartesianGet.h>
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+#include <sawUniversalRobot/osaUniversalRobotStreamFramer.h>
+#include <sawUniversalRobot/osaUniversalRobotLatencyHistogram.h>
+#include <sawUniversalRobot/osaUniversalRobotCommandEncoder.h>
+#include <sawUniversalRobot/osaUniversalRobotReconnect.h>
+#include <sawUniversalRobot/osaUniversalRobotClockSync.h>
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+#include <sawUniversalRobot/osaUniversalRobotKinematics.h>
+#include <sawUniversalRobot/osaUniversalRobotTrajectory.h>
+#include <sawUniversalRobot/osaUniversalRobotMotionQueue.h>
+#include <sawUniversalRobot/osaUniversalRobotJointPath.h>
+#include <sawUniversalRobot/mtsUniversalRobotSample.h>
+#include <sawUniversalRobot/mtsUniversalRobotTrajectory.h>
+#include <sawUniversalRobot/mtsUniversalRobotController.h>
+
+class osaUniversalRobotReceiver;
+class osaUniversalRobotIOEngine;
+class osaUniversalRobotRecorder;
+class osaUniversalRobotTelemetry;
+class osaUniversalRobotFrameSink;
+class osaUniversalRobotReplay;
+class osaUniversalRobotRTDE;
+class osaUniversalRobotDashboard;
+class osaUniversalRobotSecondaryClient;
+class osaUniversalRobotSnapshot;
 
 // Always include last
 #include <sawUniversalRobot/sawUniversalRobotExport.h>
@@ -43,7 +72,7 @@ protected:
 
     enum {NB_Actuators = 6};
 
-    enum UR_STATES { UR_NOT_CONNECTED, UR_IDLE, UR_POS_MOVING, UR_VEL_MOVING, UR_FREE_DRIVE, UR_POWERING_OFF, UR_POWERING_ON };
+    enum UR_STATES { UR_NOT_CONNECTED, UR_IDLE, UR_POS_MOVING, UR_VEL_MOVING, UR_FREE_DRIVE, UR_POWERING_OFF, UR_POWERING_ON, UR_SERVO };
     UR_STATES UR_State;
 
     enum RobotModes { ROBOT_MODE_DISCONNECTED, ROBOT_MODE_CONFIRM_SAFETY, ROBOT_MODE_BOOTING,
@@ -58,13 +87,124 @@ protected:
                       JOINT_PART_D_CALIBRATION_ERROR_MODE, JOINT_BOOTLOADER_MODE,
                       JOINT_CALIBRATION_MODE, JOINT_FAULT_MODE, JOINT_RUNNING_MODE, JOINT_IDLE_MODE };
 
-    // This buffer must be large enough for largest packet size.
-    // According to documentation, port 30003 packets are up to 1060 bytes (Version 3.2)
-    // (On port 30001, have seen packets as large as 1295 bytes).
-    // We keep it less than twice the minimum packet length (764 bytes) so that we cannot
-    // accumulate more than one complete packet in the buffer.
-    char buffer[1500];
-    unsigned int buffer_idx;
+    // Reassembles packets from the socket stream.  According to documentation, port 30003
+    // packets are up to 1060 bytes (Version 3.2); the ring buffer holds several packets
+    // so that bursts are not lost.
+    osaUniversalRobotStreamFramer Framer;
+    unsigned long FramerResyncs;   // Last value of Framer resync count, to detect new ones
+    // FramesReceived, FramesDelivered, FramesCoalesced, FramesDropped, Resyncs, BytesDiscarded
+    // of the framer in use (from the receiver when the receive thread is used)
+    vctULong6 FramingStatistics;
+
+    // Optional receive thread (0 if packets are received by the task)
+    osaUniversalRobotReceiver *Receiver;
+    int ReceiverCPU;
+    // I/O engine servicing the receiver instead of its own thread (0 if not used)
+    osaUniversalRobotIOEngine *IOEngine;
+    // Optional RTDE client (0 if data is received from port 30003).  When RTDE is
+    // used, port 30003 is only used to send commands.
+    osaUniversalRobotRTDE *RTDE;
+    double RTDEFrequency;
+    std::vector<std::string> RTDEOutputs;
+    size_t RTDEInputDoubleRegisters;   // Number of input double registers to set up
+    size_t RTDEInputRegisterOffset;    // Index of first input double register
+    int RTDEInputRecipe;               // Recipe id for input registers (-1 if none)
+
+    // Servo mode: a URScript program, uploaded once, calls servoj every controller cycle
+    // with the setpoint read from RTDE input double registers:
+    //   offset + 0      mode (see ServoModes)
+    //   offset + 1..6   joint positions or Cartesian pose (x, y, z, rx, ry, rz)
+    //   offset + 7      counter, incremented for each setpoint; the robot is stopped if
+    //                   it does not change for ServoTimeoutCycles controller cycles
+    enum ServoModes { SERVO_IDLE, SERVO_JOINT, SERVO_CARTESIAN };
+    enum { SERVO_MODE_REGISTER, SERVO_SETPOINT_REGISTER, SERVO_COUNTER_REGISTER = 7, SERVO_NB_REGISTERS };
+    bool ServoEnabled;
+    size_t ServoRegisterOffset;
+    double ServoLookahead;       // servoj lookahead time (0.03 to 0.2 s)
+    double ServoGain;            // servoj proportional gain (100 to 2000)
+    double ServoTime;            // servoj time, i.e., controller period
+    int ServoTimeoutCycles;
+    int ServoRecipe;             // RTDE input recipe id (-1 if servo mode is not available)
+    double ServoRegisters[SERVO_NB_REGISTERS];
+    std::string ServoProgram;
+
+    // Jerk-limited trajectory streamed to the servo program, one setpoint per packet
+    // received (see TrajectoryJoint and TrajectoryCartesian)
+    osaUniversalRobotTrajectory Trajectory;
+    double TrajectoryStartTime;               // Controller time of the first setpoint
+    vctDouble6 TrajectoryJointVelocity;       // Default limits
+    vctDouble6 TrajectoryJointAcceleration;
+    vctDouble6 TrajectoryJointJerk;
+    vctDouble2 TrajectoryCartesianVelocity;   // Linear and angular
+    vctDouble2 TrajectoryCartesianAcceleration;
+    vctDouble2 TrajectoryCartesianJerk;
+    vctDouble3 TrajectoryStatus;              // Progress (0 to 1), time remaining, waypoints reached
+
+    // Dense timed joint path played back to the servo program (see JointPath)
+    osaUniversalRobotJointPath Path;
+    double PathStartTime;                     // Controller time of the first setpoint
+    vctDouble6 PathPositionLimits;            // Absolute joint positions (rad)
+    vctDouble6 PathVelocityLimits;            // Absolute joint velocities (rad/s)
+    vctDouble3 PathStatus;                    // Progress (0 to 1), time remaining, points passed
+    vctDoubleMat PathTrackingError;           // RMS (row 0) and maximum (row 1) of each joint
+
+    // movej/movel waypoints executed by one program (see MotionQueueAdd)
+    osaUniversalRobotMotionQueue MotionQueue;
+    std::string MotionQueueProgram;
+    vctDouble3 MotionQueueStatus;             // Waypoints pending, last completed (-1 if none), next id
+
+    // Optional flight recorder of the raw port 30003 frames (0 if not used)
+    osaUniversalRobotRecorder *Recorder;
+    // Optional columnar export of the packet fields (0 if not used)
+    osaUniversalRobotTelemetry *Telemetry;
+    // Recorder and telemetry, called for each frame received
+    std::vector<osaUniversalRobotFrameSink *> FrameSinks;
+    // Optional replay of a recording instead of the socket (0 if not used)
+    osaUniversalRobotReplay *Replay;
+    double ReplaySpeed;          // 1 for original speed, 0 for as fast as possible
+    bool ReplayLoop;             // Restart at the end of the recording
+    double ReplayStartTime;      // Host time the first frame was replayed (negative before)
+    double ReplayFirstTime;      // Receive time of the first frame
+
+    // Latency between packet reception and update of the state table, and time spent in
+    // the queue of the receive thread.  The histograms are updated by the task and read
+    // by the commands in the threads of the clients, with LatencyMutex locked.
+    osaUniversalRobotLatencyHistogram PublishLatency;
+    osaUniversalRobotLatencyHistogram QueueLatency;
+    mutable osaMutex LatencyMutex;
+
+    // Automatic reconnection after the connection is lost
+    osaUniversalRobotReconnect Reconnect;
+    bool ReconnectEnabled;
+    // Connection attempts (port 30003, RTDE setup and start) are made by ConnectThread,
+    // so that Configure and Run do not wait for the network.  The thread uses socket
+    // and RTDE until FinishConnect returns its result.
+    enum ConnectStatusType { CONNECT_NONE, CONNECT_IN_PROGRESS, CONNECT_OK, CONNECT_FAILED,
+                             CONNECT_RTDE_FAILED };
+    osaThread ConnectThread;
+    std::atomic<int> ConnectStatus;
+    double DisconnectTime;                          // Monotonic time the connection was lost
+    osaUniversalRobotLatencyHistogram RecoveryTime; // From connection lost to reconnected
+
+    // Optional dashboard server client (0 if not used)
+    osaUniversalRobotDashboard *Dashboard;
+    bool DashboardEnabled;
+    double DashboardTimeout;     // Time to wait for each reply (s)
+    double DashboardPollPeriod;  // Period of the status queries (0 for none)
+    double DashboardPollTime;    // Monotonic time of the last status queries
+    // Tags of the dashboard requests
+    enum DashboardTags { DASHBOARD_INTERNAL, DASHBOARD_CLIENT };
+
+    // Optional secondary interface client (0 if not used)
+    osaUniversalRobotSecondaryClient *Secondary;
+    bool SecondaryEnabled;
+    unsigned short SecondaryPort;
+    bool SecondaryCalibration;   // Use the calibrated kinematics of the controller
+    bool CalibrationPending;     // Calibration received while moving, applied once idle
+
+    // Optional snapshot of the latest sample for readers outside the task (0 if not used)
+    osaUniversalRobotSnapshot *Snapshot;
+    unsigned long long SnapshotIndex;    // Index of the last sample published
 
     struct PolyScopeVersion {
         int major;
@@ -93,26 +233,133 @@ protected:
     vct6 TCPSpeed;                        // Actual Cartesian velocity
     prmVelocityCartesianGet CartVelParam; // Actual Cartesian velocity (standard payload)
 
+    prmPositionCartesianGet CartPosDesired;       // Target Cartesian position (3.0+)
+    prmVelocityCartesianGet CartVelDesiredParam;  // Target Cartesian velocity (3.0+)
+    osaUniversalRobotPoseConverter PoseActual;    // Rotation of the actual pose
+    osaUniversalRobotPoseConverter PoseDesired;   // Rotation of the target pose
+
+    // Last replies of the dashboard server, e.g., "URSoftware 3.15.7.106331 (Jan 01 2021)",
+    // "RUNNING", "NORMAL" and "STOPPED <unnamed>"; empty until received
+    std::string PolyscopeVersionString;
+    std::string DashboardRobotMode;
+    std::string DashboardSafetyMode;
+    std::string DashboardProgramState;
+
+    // Last values of the change events (see PublishChanges); all the events are raised
+    // for the first sample
+    bool ChangesInitialized;
+    int LastRobotMode;
+    int LastSafetyMode;
+    int LastProgramState;
+    vctInt6 LastJointModes;
+    vctULong2 LastDigitalIO;              // Inputs and outputs
+    // Significant motion events, raised when a joint or the tool moved more than the
+    // threshold since the last event (0 to disable), or at least every maximum period
+    double MotionJointThreshold;          // rad
+    double MotionLinearThreshold;         // m
+    double MotionAngularThreshold;        // rad
+    double MotionMaximumPeriod;           // s
+    vct6 MotionJointPosition;             // At the last JointMotion event
+    double MotionJointTime;
+    vctFrm3 MotionCartesianPosition;      // At the last CartesianMotion event
+    double MotionCartesianTime;
+
+    // State and configuration from the secondary interface
+    mtsUniversalRobotControllerState ControllerState;
+    mtsUniversalRobotControllerConfiguration ControllerConfiguration;
+
+    // Time from Configure to the connection to port 30003 (and RTDE), the first valid
+    // sample and the Polyscope version (s, -1 until then)
+    double StartupBeginTime;
+    vctDouble3 StartupTime;
+
+    // Host-side kinematics (not used if no model is set)
+    osaUniversalRobotKinematics Kinematics;
+    prmPositionCartesianGet CartPosKinematics;    // Tool pose computed from JointPos
+    vctDoubleMat JacobianSpatial;                 // 6x6 geometric Jacobian in base frame
+    size_t InverseKinematicsThreads;              // Threads for InverseKinematicsBatch (0 for all)
+    // Copy of Kinematics for the inverse kinematics commands, which run in the threads
+    // of the clients; updated by the task with KinematicsMutex locked when the model changes
+    osaUniversalRobotKinematics InverseKinematicsModel;
+    mutable osaMutex KinematicsMutex;
+
     vct6 TCPForce;                        // Actual Cartesian force/torque
     prmForceCartesianGet WrenchGet;       // Actual Cartesian force/torque (standard payload)
 
+    mtsUniversalRobotSample Sample;       // All the packet fields
+
+    // Controller clock to host clock
+    osaUniversalRobotClockSync ClockSync;
+    int FrameStatus;                      // Status of the last frame (see osaUniversalRobotClockSync)
+    // Offset (s), drift, delay (s), jitter (s), frames dropped, frames duplicated
+    vct6 ClockStatus;
+
+    // Packet fields and reception information of a sample (see mtsUniversalRobotSample);
+    // all the fields are 8 bytes
+    struct SampleRecord {
+        unsigned long long Index;
+        double Version;
+        double FrameStatus;
+        double ReceiveTime;
+        double HostTime;
+        osaUniversalRobotSample Data;
+    };
+    enum { SAMPLE_RECORD_WORDS = sizeof(SampleRecord) / 8 };
+    // Sequence lock, as osaUniversalRobotSnapshot: the task increments Sequence before
+    // and after writing the record, copied as 64-bit atomic words, so that readers can
+    // detect the records that changed during their copy
+    struct SampleSlot {
+        std::atomic<unsigned long long> Sequence;
+        std::atomic<unsigned long long> Words[SAMPLE_RECORD_WORDS];
+    };
+    // Most recent samples for GetSamplesSince, sample i is in slot i % SampleHistorySize.
+    // Written by the task only; SampleHistoryLatest is the index of the last sample written.
+    SampleSlot *SampleHistory;
+    size_t SampleHistorySize;
+    std::atomic<unsigned long long> SampleHistoryLatest;
+
     // Internal use
-    char VelCmdString[100];
-    char VelCmdStop[100];
+    osaUniversalRobotCommandEncoder VelCmd;       // Velocity command, resent every cycle
+    osaUniversalRobotCommandEncoder VelCmdStop;   // Command to stop velocity motion
+    osaUniversalRobotCommandEncoder PosCmd;       // Position command
     int  VelCmdTimeout;
 
     // For real-time debugging
     vct6 debug;
 
-    // For UR version determination
-    enum FirmwareVersion {VER_UNKNOWN, VER_PRE_18, VER_18, VER_30_31, VER_32, VER_MAX};
-    FirmwareVersion version;
-    static unsigned long PacketLength[VER_MAX];
-    unsigned long PacketCount[VER_MAX];
+    // For UR version determination and packet decoding.  The decoder belongs to the
+    // receive thread while it is running.
+    typedef osaUniversalRobotPacketDecoder::FirmwareVersion FirmwareVersion;
+    osaUniversalRobotPacketDecoder Decoder;
+    osaUniversalRobotDecodedPacket Packet;
+    // Version of the last packet processed (3.2+ with RTDE), used to select the script
+    // commands and returned by GetVersion
+    std::atomic<int> PacketVersion;
 
     // Called by constructors
     void Init(void);
 
+    // Copy a decoded sample to the state table entries
+    void PublishSample(const osaUniversalRobotSample &sample);
+    // Copy a translation and row-major rotation matrix to a state table entry
+    static void SetPosition(const double *translation, const double *rotation,
+                            prmPositionCartesianGet &position);
+    // Copy all the fields of the packet to Sample and the sample history
+    void UpdateSample(const osaUniversalRobotDecodedPacket &packet);
+    static void RecordToSample(const SampleRecord &record, mtsUniversalRobotSample &sample);
+    // Copy sample index from the history, from any thread; returns false if it is no
+    // longer in the history
+    bool ReadSampleRecord(unsigned long long index, SampleRecord &record) const;
+    // Joint positions of the latest sample (0 before the first one), from any thread
+    void LatestJointPosition(double position[6]) const;
+    // Copy Kinematics to InverseKinematicsModel, after each change of the model
+    void UpdateInverseKinematicsModel(void);
+    // Advance the state table, then publish the new sample to the snapshot
+    void AdvanceStateTable(void);
+    void PublishSnapshot(void);
+    // Raise the events of the discrete values that changed and of significant motions
+    void PublishChanges(const osaUniversalRobotDecodedPacket &packet);
+
     // Methods for provided interface
 
     // Disable motor power
@@ -146,10 +393,125 @@ protected:
 
     void GetVersion(int &ver) const
     {
-        ver = static_cast<int>(version);
+        ver = PacketVersion;
     }
 
-    void GetPolyscopeVersion(std::string &pver);
+    // Latency statistics: number of samples, 50th, 99th and 99.9th percentiles, and maximum
+    // (the queue latency is the time from the receive thread to the task)
+    void GetQueueLatency(vctDoubleVec &latency) const;
+    void GetPublishLatency(vctDoubleVec &latency) const;
+    // Time to recover from connection losses (same format)
+    void GetRecoveryTime(vctDoubleVec &recovery) const;
+
+    // Receive thread or I/O engine: Wakeups, PacketsQueued, Overflows
+    void GetReceiverStatistics(vctULong3 &stats) const;
+
+    // Samples with an index greater than index still in the history, oldest first.
+    // Called from the thread of the client.
+    void GetSamplesSince(const unsigned long long &index, mtsUniversalRobotSamples &samples) const;
+
+    // Joint positions for the tool pose (see SetKinematics), on the branch nearest to
+    // the latest joint positions; empty if the pose is not reachable or no model is
+    // set.  Called from the thread of the client.
+    void InverseKinematics(const vctFrm3 &pose, vctDoubleVec &jointPosition) const;
+    // Same for N tool poses (N x 6, x, y, z, rx, ry, rz); rows of unreachable poses
+    // are set to NaN.  Called from the thread of the client.
+    void InverseKinematicsBatch(const vctDoubleMat &poses, vctDoubleMat &jointPositions) const;
+
+    // Receive packets directly from the socket or from the receive thread;
+    // return number of packets processed
+    int ReceiveFromSocket(void);
+    int ReceiveFromThread(void);
+    int ReceiveFromRTDE(void);
+    int ReceiveFromReplay(void);
+    // Give the recorder and telemetry to the receive thread
+    void UpdateFrameSinks(void);
+
+    // Connect and set up RTDE recipes; returns false on error
+    bool ConnectRTDE(void);
+
+    // Write RTDE input double registers (see EnableRTDE)
+    void SetInputDoubleRegisters(const vctDoubleVec &values);
+
+    // Servo to joint position or Cartesian pose (see EnableServo); the first setpoint
+    // uploads the servo program
+    void ServoJoint(const prmPositionJointSet &jtpos);
+    void ServoCartesian(const prmPositionCartesianSet &cartPos);
+    void StopServo(void);
+    // Write the servo registers; returns false on error
+    bool SendServoSetpoint(ServoModes mode, const double setpoint[6]);
+    bool StartServo(void);
+
+    // Move through waypoints with a jerk-limited trajectory streamed to the servo
+    // program (see EnableServo); a new trajectory replaces the current one and starts
+    // at rest from the last setpoint
+    void TrajectoryJoint(const mtsUniversalRobotJointTrajectory &trajectory);
+    void TrajectoryCartesian(const mtsUniversalRobotCartesianTrajectory &trajectory);
+    // Send the first setpoint of Trajectory, starting the servo program if needed
+    bool StartTrajectory(void);
+    // Send the setpoint of the current cycle, raise the events and stop at the end
+    void RunTrajectory(void);
+    // Start point of a trajectory: last setpoint in servo mode, or current position
+    void TrajectoryStart(ServoModes mode, double start[6]) const;
+
+    // Check a whole timed joint path against the limits and play it back to the servo
+    // program (see EnableServo); replaces the current trajectory or path
+    void JointPath(const mtsUniversalRobotJointPath &path);
+    // Send the setpoint of the current cycle, update the tracking error and stop at the end
+    void RunPath(void);
+
+    // Add waypoints to the motion queue and send the program moving through the queue
+    void MotionQueueAdd(const mtsUniversalRobotMotionBatch &batch);
+    // Complete the waypoints reached and raise the events
+    void RunMotionQueue(void);
+    void UpdateMotionQueueStatus(void);
+
+    // Send a command to the dashboard server; the reply is sent with the DashboardReply
+    // event, or the command with the DashboardError event if it fails
+    void DashboardCommand(const std::string &command);
+    void PowerOn(void);
+    void PowerOff(void);
+    void BrakeRelease(void);
+    void LoadProgram(const std::string &program);
+    void PlayProgram(void);
+    // Query the Polyscope version and the robot, safety and program states
+    void RefreshDashboard(void);
+    // Queue a request; returns false if the dashboard is not enabled or busy
+    bool DashboardRequest(const std::string &command, DashboardTags tag);
+    // Query the robot, safety and program states
+    void QueryDashboardStatus(void);
+    // Process the replies received and send the periodic queries; called by Run
+    void RunDashboard(void);
+
+    // Copy the values received on the secondary interface, apply the calibration and
+    // raise the events; called by Run
+    void RunSecondary(void);
+    // Apply the calibration of ControllerConfiguration to the kinematics (robot idle only)
+    void ApplyCalibration(void);
+
+    // Process one packet received from the controller
+    void ProcessPacket(const osaUniversalRobotDecodedPacket &packet);
+
+    void ReportFramerResyncs(const osaUniversalRobotStreamFramer::Statistics &stats,
+                             unsigned long numBytes);
+    // Copy the statistics of the framer in use to FramingStatistics
+    void UpdateFramingStatistics(void);
+
+    // Close socket after error; starts reconnecting if enabled
+    void CloseSocket(void);
+
+    // Flush the socket and start receiving robot data (RTDE or receive thread)
+    void StartReceiving(void);
+
+    // Start a connection attempt in ConnectThread
+    void StartConnect(void);
+    void * RunConnect(void *);
+    // Result of the connection attempt, waiting at most timeout seconds; returns
+    // CONNECT_IN_PROGRESS if it is not finished and CONNECT_NONE if there is none
+    int FinishConnect(double timeout = 0.0);
+
+    // Advance the reconnection; called by Run when not connected
+    void TryReconnect(void);
 
     // Connection Parameters
     // IP address (TCP/IP)
@@ -158,8 +520,8 @@ protected:
     //    30001  - primary client (10 Hz)
     //    30002  - secondary client (10 Hz)
     //    30003  - real-time client (125 Hz)
-    //    30004  - RTDE port (125 Hz)
-    // Currently, only port 30003 is supported
+    //    30004  - RTDE port (125 Hz, 500 Hz on e-Series)
+    // Port 30003 is used for commands and, unless RTDE is enabled, for robot data
     unsigned short currentPort;
     // Socket to UR controller
     osaSocket socket;
@@ -171,9 +533,32 @@ protected:
     void RobotNotReady(void);
     mtsFunctionVoid ReceiveTimeoutEvent;
     void ReceiveTimeout(void);
-
-    // return TRUE on success, FALSE on fail
-    bool SendAndReceive(osaSocket &socket, std::string cmd, std::string &recv);
+    mtsFunctionWrite ReconnectAttemptEvent;   // Attempt number
+    mtsFunctionWrite ReconnectedEvent;        // Time to recover (s)
+    mtsFunctionWrite WaypointReachedEvent;    // Waypoint index, from 0
+    mtsFunctionWrite TrajectoryCompletedEvent; // Duration (s)
+    mtsFunctionWrite PathCompletedEvent;       // Maximum tracking error (rad)
+    mtsFunctionWrite MotionWaypointCompletedEvent; // Waypoint id
+    mtsFunctionWrite MotionQueueCompletedEvent;    // Id of the last waypoint
+    mtsFunctionWrite DashboardReplyEvent;          // Reply to DashboardCommand, etc.
+    mtsFunctionWrite DashboardErrorEvent;          // Command not answered
+    mtsFunctionWrite RobotModeChangedEvent;        // Robot mode (see RobotModes)
+    mtsFunctionWrite SafetyModeChangedEvent;       // Safety mode
+    mtsFunctionWrite ProgramStateChangedEvent;     // Program state (3.2+)
+    mtsFunctionWrite JointModesChangedEvent;       // Joint modes (see JointModes)
+    mtsFunctionWrite DigitalIOChangedEvent;        // Digital input and output bits
+    mtsFunctionWrite JointMotionEvent;             // Joint state after a significant motion
+    mtsFunctionWrite CartesianMotionEvent;         // Tool pose after a significant motion
+    mtsFunctionWrite ControllerStateEvent;         // Robot mode, safety mode or digital I/O changed
+    mtsFunctionWrite ControllerConfigurationEvent; // Configuration changed
+    mtsFunctionWrite ControllerMessageEvent;       // Error or message from the controller
+
+    // Send an encoded command or a script on port 30003; raises SocketError and returns
+    // false on error.  Nothing is sent when replaying a recording.
+    bool SendCommand(const osaUniversalRobotCommandEncoder &command);
+    bool SendCommand(const char *script);
+    bool SendCommand(const std::string &script);
+    bool SendCommand(const char *data, size_t length);
 
     mtsFunctionWrite PacketInvalid;
     mtsInterfaceProvided * mInterface;
@@ -186,7 +571,152 @@ public:
 
     virtual ~mtsUniversalRobotScriptRT();
 
-    void Configure(const std::string &ipAddr = "");
+    // Argument is either the IP address of the controller or a JSON configuration
+    // file (with extension .json), e.g.:
+    //   { "ip": "192.168.1.10",
+    //     "frame-policy": "all",         // or "newest"
+    //     "sample-history": 1000,
+    //     "kinematics": { "model": "UR5", "tool": [0, 0, 0.1, 0, 0, 0], "ik-threads": 0 },
+    //     "receive-thread": { "enable": true, "cpu": 2, "queue-size": 64 },
+    //     "io-engine": { "enable": true, "cpu": 3 },   // instead of "receive-thread"
+    //     "rtde": { "enable": true, "frequency": 500, "input-double-registers": 6 },
+    //     "servo": { "enable": true, "lookahead": 0.1, "gain": 300 },
+    //     "trajectory": { "joint": { "velocity": [...6], "acceleration": [...6], "jerk": [...6] },
+    //                     "cartesian": { "velocity": [0.25, 1.05], ... } },
+    //     "path": { "position-limits": [...6], "velocity-limits": [...6] },
+    //     "motion-queue": { "capacity": 64 },
+    //     "dashboard": { "enable": true, "timeout": 2, "poll-period": 1 },
+    //     "secondary": { "enable": true, "port": 30002, "calibration": true },
+    //     "snapshot": { "enable": true, "shared-memory": "/ur-snapshot" },
+    //     "motion-events": { "joint-threshold": 0.001, "linear-threshold": 0.001,
+    //                        "angular-threshold": 0.005, "max-period": 1 },
+    //     "reconnect": { "enable": true, "initial-delay": 0.1, "max-delay": 5 },
+    //     "recorder": { "file": "ur.rec", "size-mb": 64 },
+    //     "telemetry": { "file": "ur.tlm", "fields": ["actual_q"], "compression-level": 6 },
+    //     "replay": { "file": "ur.rec", "speed": 1.0 } }   // instead of "ip"
+    void Configure(const std::string &ipAddrOrFile = "");
+
+    // Read configuration from JSON file without connecting (ipAddr is set from the
+    // file); returns false on error.  Configure with an IP address then connects,
+    // e.g., to use the file with another controller.
+    bool ConfigureJSON(const std::string &filename, std::string &ipAddr);
+
+    // Receive packets in a dedicated thread, pinned to cpu (-1 for no pinning).
+    // Must be called before Startup.
+    void EnableReceiveThread(int cpu = -1, size_t queueSize = 64);
+
+    // Number of samples kept for the GetSamplesSince command (1000 by default, i.e.,
+    // 8 s at 125 Hz).  Must be called before Startup.
+    void SetSampleHistorySize(size_t size);
+
+    // Compute the tool pose and Jacobian from the joint positions each cycle, with the
+    // kinematic model ("UR3", "UR5" or "UR10") and the tool pose in the flange frame
+    // (x, y, z, rx, ry, rz).  Returns false if the model is unknown.
+    bool SetKinematics(const std::string &model, const vctDouble6 &tool = vctDouble6(0.0));
+
+    // Receive packets in the thread of engine, which can service several robots; the
+    // engine is started with cpu (-1 for no pinning) if it is not running yet.
+    // Must be called before Startup.
+    void EnableIOEngine(osaUniversalRobotIOEngine &engine, int cpu = -1, size_t queueSize = 64);
+
+    // Receive robot data from the RTDE interface (port 30004) instead of port 30003.
+    // outputs are the RTDE fields to subscribe to (see osaUniversalRobotRTDE), empty for
+    // the default ones.  numInputDoubleRegisters input double registers, starting at
+    // inputRegisterOffset, can be written with the SetInputDoubleRegisters command.
+    // Must be called before Configure connects to the controller.
+    void EnableRTDE(double frequency = 125.0,
+                    const std::vector<std::string> &outputs = std::vector<std::string>(),
+                    size_t numInputDoubleRegisters = 0, size_t inputRegisterOffset = 0);
+
+    // Enable the ServoJoint and ServoCartesian commands, which stream setpoints to a servoj
+    // loop running on the controller through RTDE input double registers registerOffset to
+    // registerOffset+7 (RTDE is enabled if needed, with the "timestamp" output used to time
+    // the trajectories and paths).  time is the servoj time (0.008 s on CB3,
+    // 0.002 s on e-Series); the robot stops if no setpoint is received for timeoutCycles
+    // controller cycles.  Must be called before Configure connects to the controller.
+    void EnableServo(size_t registerOffset = 0, double lookahead = 0.1, double gain = 300.0,
+                     double time = 0.008, int timeoutCycles = 10);
+
+    // Default limits of the trajectories (TrajectoryJoint, TrajectoryCartesian, and
+    // JointPositionMove and CartesianPositionMove in servo mode); Cartesian limits are
+    // linear and angular
+    void SetTrajectoryJointLimits(const vctDouble6 &velocity, const vctDouble6 &acceleration,
+                                  const vctDouble6 &jerk);
+    void SetTrajectoryCartesianLimits(const vctDouble2 &velocity, const vctDouble2 &acceleration,
+                                      const vctDouble2 &jerk);
+
+    // Limits of the joint paths (JointPath), as absolute values: 2 pi rad and pi rad/s
+    // by default
+    void SetPathLimits(const vctDouble6 &position, const vctDouble6 &velocity);
+
+    // Raise the JointMotion and CartesianMotion events when a joint moved more than
+    // jointThreshold (rad), or the tool more than linearThreshold (m) or angularThreshold
+    // (rad), since the last event, and at least every maximumPeriod seconds (0 for no
+    // minimum rate).  Thresholds that are 0 disable the event (the default).
+    void SetMotionEvents(double jointThreshold, double linearThreshold, double angularThreshold,
+                         double maximumPeriod = 0.0);
+
+    // Maximum number of waypoints in the motion queue (64 by default)
+    void SetMotionQueueCapacity(size_t capacity);
+
+    // Connect to the dashboard server (port 29999) in a dedicated thread (enabled by
+    // default): the Polyscope version and the robot, safety and program states are
+    // queried while Configure connects to port 30003, then every pollPeriod seconds
+    // (0 for never).  timeout is the time to wait for each reply.  Must be called
+    // before Configure.
+    void EnableDashboard(double timeout = 2.0, double pollPeriod = 0.0);
+    void DisableDashboard(void)
+    { DashboardEnabled = false; }
+
+    // Read the controller state, configuration and messages from the secondary interface
+    // (port 30002, or 30001 for the primary interface) in a dedicated thread.  With
+    // useCalibration, the calibrated kinematic parameters of the robot replace the
+    // nominal ones of the host-side kinematics (see SetKinematics; the model is selected
+    // from the parameters if none is set).  Must be called before Configure.
+    void EnableSecondary(unsigned short port = 30002, bool useCalibration = true);
+
+    // Publish the joint and tool state of each sample, once the state table is advanced,
+    // to a snapshot that other threads read without going through the task commands
+    // (see osaUniversalRobotSnapshot and GetSnapshot).  With sharedMemoryName (e.g.,
+    // "/ur-snapshot"), the snapshot is in POSIX shared memory, so that other processes
+    // can map it with osaUniversalRobotSnapshot::OpenShared.  Returns false if the shared
+    // memory can not be created (the snapshot is then only available in process).
+    bool EnableSnapshot(const std::string &sharedMemoryName = "");
+
+    // Snapshot of the latest sample, 0 if not enabled; Read can be called from any thread
+    const osaUniversalRobotSnapshot * GetSnapshot(void) const
+    { return Snapshot; }
+
+    // Record the raw frames received on port 30003, with their receive time, in a ring
+    // file of capacity bytes (see osaUniversalRobotRecorder).  Must be called before Startup.
+    void EnableRecorder(const std::string &filename, size_t capacity = 64 * 1024 * 1024);
+
+    // Export the selected packet fields (all if fields is empty, see
+    // osaUniversalRobotPacketDecoder::GetFields) to a columnar file, optionally compressed
+    // with zlib (see osaUniversalRobotTelemetry).  Replayed frames are exported too.  Must be
+    // called before Startup.
+    void EnableTelemetry(const std::string &filename,
+                         const std::vector<std::string> &fields = std::vector<std::string>(),
+                         size_t rowsPerChunk = 1000, int compressionLevel = 0);
+
+    // Read the frames from a recording instead of the controller, at speed times the
+    // original speed (0 for as fast as possible), optionally restarting at the end.
+    // Commands are not sent.  Must be called before Configure.
+    void EnableReplay(const std::string &filename, double speed = 1.0, bool loop = false);
+
+    // Reconnect automatically when the connection is lost (enabled by default): attempts
+    // start initialDelay seconds after the loss and the delay doubles after each failed
+    // attempt, up to maximumDelay.  Attempts are made in another thread; Configure waits
+    // at most connectTimeout seconds for the first connection.
+    void EnableReconnect(double initialDelay = 0.1, double maximumDelay = 5.0,
+                         double connectTimeout = 1.0);
+    void DisableReconnect(void)
+    { ReconnectEnabled = false; }
+
+    // ALL_FRAMES (default) publishes every packet received; NEWEST_FRAME only publishes
+    // the most recent packet when several were received at once.
+    void SetFramePolicy(osaUniversalRobotStreamFramer::FramePolicy policy)
+    { Framer.SetPolicy(policy); }
 
     void Startup(void);
 
@@ -0,0 +1,27 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotClock_h
+#define _osaUniversalRobotClock_h
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+// Host monotonic time in seconds (CLOCK_MONOTONIC on Linux).  Unlike osaGetTime,
+// this clock is not affected by changes of the system time, so it can be used to
+// timestamp packets and measure latencies.
+CISST_EXPORT double osaUniversalRobotMonotonicTime(void);
+
+#endif // _osaUniversalRobotClock_h
@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotClockSync_h
+#define _osaUniversalRobotClockSync_h
+
+#include <cstddef>
+#include <vector>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Synchronization of the controller clock (the time field of the packets)
+  with the host monotonic clock (see osaUniversalRobotMonotonicTime).
+
+  The receive time of a packet is its send time plus a network and
+  scheduling delay which is never negative, so the host time of a
+  controller time is estimated from the lower envelope of the receive
+  times rather than from their average: packets are grouped in blocks, the
+  smallest (receiveTime - controllerTime) of each block is kept, and a line
+  is fitted through the minima of the last blocks, which gives the offset
+  and the drift between the clocks.  Packets received earlier than the
+  model predicts lower the envelope immediately.  The delay above the
+  envelope (mean and standard deviation, i.e., jitter) is tracked with an
+  exponential moving average.
+
+  Frames are also checked against the controller period: a gap in the
+  controller time means frames were dropped, no progress means a
+  duplicate, and a jump back means the controller was restarted (the model
+  is then reset).  Nothing is allocated after construction. */
+class CISST_EXPORT osaUniversalRobotClockSync
+{
+public:
+    enum FrameStatus {
+        FRAME_OK,           // Next frame
+        FRAME_FIRST,        // First frame since Reset
+        FRAME_DROPPED,      // Frames are missing before this one
+        FRAME_DUPLICATE,    // Same controller time as the previous frame (ignored)
+        FRAME_RESET         // Controller time went back; the model was reset
+    };
+
+    // nominalPeriod is the controller period (0.008 s for CB3, 0.002 s for e-Series
+    // RTDE); blockSize packets per block and numBlocks blocks are used for the fit
+    osaUniversalRobotClockSync(double nominalPeriod = 0.008, size_t blockSize = 125,
+                               size_t numBlocks = 60);
+
+    void SetNominalPeriod(double period);
+
+    // Forget the model; the frame counters are kept
+    void Reset(void);
+
+    // Add a frame with its controller time and host receive time
+    FrameStatus Update(double controllerTime, double hostTime);
+
+    // Controller time converted to the host monotonic clock, and conversely
+    double ToHost(double controllerTime) const;
+    double ToController(double hostTime) const;
+
+    // True once a line was fitted through two blocks or more (before, the drift is 0)
+    bool IsSynchronized(void) const
+    { return (NumBlocksUsed >= 2); }
+
+    // Host time minus controller time at the last frame
+    double GetOffset(void) const;
+
+    // Relative rate of the host clock with respect to the controller clock, minus 1
+    double GetDrift(void) const
+    { return Slope; }
+
+    // Mean and standard deviation of the delay above the envelope
+    double GetDelay(void) const
+    { return DelayMean; }
+
+    double GetJitter(void) const;
+
+    // Measured controller period
+    double GetPeriod(void) const
+    { return Period; }
+
+    unsigned long GetFramesDropped(void) const
+    { return FramesDropped; }
+
+    unsigned long GetFramesDuplicated(void) const
+    { return FramesDuplicated; }
+
+    unsigned long GetResets(void) const
+    { return Resets; }
+
+protected:
+    // Least-squares line through the block minima
+    void Fit(void);
+
+    double NominalPeriod;
+    double Period;
+    size_t BlockSize;
+
+    // Times are relative to the first frame to keep the fit well conditioned
+    bool Started;
+    double ControllerOrigin;
+    double HostOrigin;
+    double LastControllerTime;       // Relative
+
+    // Minimum of (host - controller) in each block, with the controller time
+    // where it was found (ring)
+    std::vector<double> BlockMinimum;
+    std::vector<double> BlockTime;
+    size_t NumBlocksUsed;
+    size_t NextBlock;
+    size_t BlockCount;               // Frames in the current block
+    double CurrentMinimum;
+    double CurrentMinimumTime;
+
+    // Model: host - controller = Intercept + Slope * controller (relative times)
+    double Intercept;
+    double Slope;
+
+    double DelayMean;
+    double DelayVariance;
+
+    unsigned long FramesDropped;
+    unsigned long FramesDuplicated;
+    unsigned long Resets;
+};
+
+#endif // _osaUniversalRobotClockSync_h
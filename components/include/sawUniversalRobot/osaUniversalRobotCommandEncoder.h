@@ -0,0 +1,83 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotCommandEncoder_h
+#define _osaUniversalRobotCommandEncoder_h
+
+#include <cstddef>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Formats URScript commands into a fixed-size buffer.
+
+  Numbers are written with 4 decimals using integer arithmetic instead of
+  sprintf, and no memory is allocated, so commands can be encoded at every
+  control cycle.  All writes are bounds-checked: if a value is not finite or
+  too large, or if the command does not fit in the buffer, the encoding
+  methods return false and the command is empty (Length() is 0), so that a
+  truncated command is never sent to the controller. */
+class CISST_EXPORT osaUniversalRobotCommandEncoder
+{
+public:
+    enum { BUFFER_SIZE = 256 };
+
+    // Largest absolute value that can be encoded
+    static const double MAX_VALUE;
+
+    osaUniversalRobotCommandEncoder(void);
+
+    // speedj(qd, a, t)
+    bool SpeedJ(const double qd[6], double acceleration, double time);
+    // speedl(xd, a, t)
+    bool SpeedL(const double xd[6], double acceleration, double time);
+    // movej(q, a=a, v=v, r=r); the blend radius is only written if not 0
+    bool MoveJ(const double q[6], double acceleration, double velocity, double radius = 0.0);
+    // movel(p[x, y, z, rx, ry, rz], a=a, v=v, r=r); the blend radius is only written if not 0
+    bool MoveL(const double pose[6], double acceleration, double velocity, double radius = 0.0);
+    // stopj(a)
+    bool StopJ(double acceleration);
+
+    // Building blocks for other commands; Finish must be called last
+    void Reset(void);
+    bool Append(const char *text);
+    bool AppendNumber(double value);
+    // Append "[v0, v1, ...]"
+    bool AppendVector(const double *values, size_t size);
+    // Append the newline that terminates the command; returns false if any write failed
+    bool Finish(void);
+
+    // Null-terminated command
+    const char * Data(void) const
+    { return Buffer; }
+
+    size_t Length(void) const
+    { return Size; }
+
+    bool Empty(void) const
+    { return (Size == 0); }
+
+protected:
+    bool Encode6(const char *prefix, const double values[6], const char *separator,
+                 double value1, const char *separator2, double value2);
+    bool EncodeMove(const char *prefix, const double values[6], double acceleration,
+                    double velocity, double radius);
+
+    char Buffer[BUFFER_SIZE];
+    size_t Size;
+    bool Failed;
+};
+
+#endif // _osaUniversalRobotCommandEncoder_h
@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotDashboard_h
+#define _osaUniversalRobotDashboard_h
+
+#include <atomic>
+#include <deque>
+#include <string>
+
+#include <cisstOSAbstraction/osaMutex.h>
+#include <cisstOSAbstraction/osaSocket.h>
+#include <cisstOSAbstraction/osaThread.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Client for the dashboard server (port 29999), e.g., "robotmode",
+  "power on", "brake release", "load <program>" or "play".
+
+  Requests are queued by the caller and sent by a dedicated thread over a
+  persistent connection, without waiting for the previous replies: the
+  server answers each command with one line, in order, so replies are
+  matched to requests in order.  A request that is not answered within the
+  timeout fails, and the connection is closed since later replies could no
+  longer be matched; the requests already sent fail too (they are not sent
+  again, as they may have been executed).  The connection is reopened when
+  there are requests to send.
+
+  Request and NextReply never block on the network, so they can be called
+  from the control loop. */
+class CISST_EXPORT osaUniversalRobotDashboard
+{
+public:
+    enum Status { REPLY_OK, REPLY_TIMEOUT, REPLY_DISCONNECTED };
+
+    class Reply {
+    public:
+        std::string Command;
+        std::string Text;        // Reply line, without the newline
+        Status Result;
+        unsigned int Tag;        // Tag of the request
+    };
+
+    osaUniversalRobotDashboard(void);
+
+    ~osaUniversalRobotDashboard();
+
+    // Start the thread, connecting to host:port; timeout is the time to wait for each reply
+    bool Start(const std::string &host, unsigned short port = 29999, double timeout = 2.0);
+
+    // Stop the thread and close the connection; pending requests are dropped
+    void Stop(void);
+
+    bool IsRunning(void) const
+    { return Running; }
+
+    bool IsConnected(void) const
+    { return Connected; }
+
+    /*! Queue a command (without the newline); tag is returned with the reply.
+      Returns false if the thread is not running or too many requests are
+      pending. */
+    bool Request(const std::string &command, unsigned int tag = 0);
+
+    // Next reply or failure, in request order; returns false if there is none
+    bool NextReply(Reply &reply);
+
+    // Maximum number of requests queued or waiting for a reply
+    enum { MAX_PENDING = 64 };
+
+protected:
+    class Pending {
+    public:
+        std::string Command;
+        unsigned int Tag;
+        double Deadline;         // Monotonic time the reply is due (once sent)
+    };
+
+    void * RunThread(void *);
+
+    bool Connect(void);
+    void Disconnect(void);
+    // Fail the requests sent, the first one with status
+    void FailSent(Status status);
+    void AddReply(const Pending &pending, const std::string &text, Status status);
+    // Process the lines received; returns false if the server closed the connection
+    bool ReceiveLines(double timeoutSec);
+
+    std::string Host;
+    unsigned short Port;
+    double Timeout;
+    osaSocket Socket;
+    osaThread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<bool> Connected;
+    bool GreetingReceived;
+    double NextConnectTime;
+    std::string Line;            // Partial line received
+
+    // Shared with the thread of the caller
+    osaMutex Mutex;
+    std::deque<Pending> Requests;    // Not sent yet
+    std::deque<Reply> Replies;
+    // Used by the thread only
+    std::deque<Pending> Sent;        // Waiting for a reply
+};
+
+#endif // _osaUniversalRobotDashboard_h
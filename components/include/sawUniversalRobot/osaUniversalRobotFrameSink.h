@@ -0,0 +1,31 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotFrameSink_h
+#define _osaUniversalRobotFrameSink_h
+
+/*! Interface of the objects receiving the raw port 30003 frames, e.g., to
+  record them.  Frame is called by the thread that receives the frames (task,
+  receive thread or I/O engine) for each complete frame, so it must not block
+  or allocate memory. */
+class osaUniversalRobotFrameSink
+{
+public:
+    virtual ~osaUniversalRobotFrameSink() {}
+
+    virtual void Frame(const char *frame, unsigned long length, double receiveTime) = 0;
+};
+
+#endif // _osaUniversalRobotFrameSink_h
@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotIOEngine_h
+#define _osaUniversalRobotIOEngine_h
+
+#include <atomic>
+#include <vector>
+
+#include <cisstOSAbstraction/osaMutex.h>
+#include <cisstOSAbstraction/osaThread.h>
+
+class osaUniversalRobotReceiver;
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Single thread receiving packets for several robots.
+
+  The sockets of all the receivers added to the engine are monitored with
+  epoll; when data is available, the receiver of that socket decodes it and
+  queues the packets for its component, as its own receive thread would.
+  With N robots this uses one I/O thread instead of N, which can be pinned
+  to an isolated CPU.  Only available on Linux. */
+class CISST_EXPORT osaUniversalRobotIOEngine
+{
+public:
+    osaUniversalRobotIOEngine(void);
+
+    ~osaUniversalRobotIOEngine();
+
+    // Start the I/O thread, pinned to cpu (-1 for no pinning).  Returns true if the
+    // thread is running, including when it was already started.
+    bool Start(int cpu = -1);
+
+    // Stop the I/O thread; receivers that are still added no longer receive packets
+    void Stop(void);
+
+    bool IsRunning(void) const
+    { return Running; }
+
+    // Add the receiver to the engine; socketId is the socket file descriptor
+    bool Add(osaUniversalRobotReceiver *receiver, int socketId);
+
+    // Remove the receiver; when this returns, the I/O thread no longer uses it
+    void Remove(osaUniversalRobotReceiver *receiver);
+
+    size_t GetNumberOfReceivers(void);
+
+    // Number of times the thread woke up with data available, and number of
+    // sockets serviced (several sockets can be serviced per wakeup)
+    unsigned long GetWakeups(void) const
+    { return Wakeups; }
+
+    unsigned long GetSocketsServiced(void) const
+    { return SocketsServiced; }
+
+    // Engine shared by all the components of the process that enable it
+    static osaUniversalRobotIOEngine & Shared(void);
+
+protected:
+    struct Entry {
+        osaUniversalRobotReceiver *Receiver;
+        int SocketId;
+    };
+
+    void * RunThread(void *);
+
+    // Must be called with Mutex locked; returns Entries.size() if not found
+    size_t Find(const osaUniversalRobotReceiver *receiver) const;
+    void RemoveEntry(size_t index);
+
+    int EpollId;
+    int CPU;
+    osaThread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<unsigned long> Wakeups;
+    std::atomic<unsigned long> SocketsServiced;
+
+    // Held by the I/O thread while it services sockets
+    osaMutex Mutex;
+    std::vector<Entry> Entries;
+};
+
+#endif // _osaUniversalRobotIOEngine_h
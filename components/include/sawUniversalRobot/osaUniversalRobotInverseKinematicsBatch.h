@@ -0,0 +1,85 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotInverseKinematicsBatch_h
+#define _osaUniversalRobotInverseKinematicsBatch_h
+
+#include <vector>
+
+#include <cisstOSAbstraction/osaThread.h>
+#include <sawUniversalRobot/osaUniversalRobotKinematics.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Inverse kinematics of many poses, e.g., candidate grasps, split between
+  several threads.  Poses and solutions are stored by component (one array
+  of x for all the poses, one of y, ...) so that each thread reads and
+  writes contiguous memory.  Each pose is solved on the branch nearest to a
+  seed (see osaUniversalRobotKinematics::Inverse).
+
+  Buffers are only allocated by Resize; threads are created by Solve and
+  stopped before it returns. */
+class CISST_EXPORT osaUniversalRobotInverseKinematicsBatch
+{
+public:
+    // numThreads 0 for one thread per processor
+    osaUniversalRobotInverseKinematicsBatch(size_t numThreads = 0);
+    ~osaUniversalRobotInverseKinematicsBatch();
+
+    void Resize(size_t numPoses);
+
+    size_t GetNumberOfPoses(void) const
+    { return Valid.size(); }
+
+    // Component of all the poses: x, y, z (0 to 2) and axis-angle rx, ry, rz (3 to 5)
+    double * Pose(size_t component)
+    { return PoseData[component].data(); }
+
+    // Joint position of all the poses (undefined if the pose is not reachable)
+    const double * Joint(size_t joint) const
+    { return JointData[joint].data(); }
+
+    // 1 if the pose is reachable, 0 otherwise
+    const unsigned char * Reachable(void) const
+    { return Valid.data(); }
+
+    // Solve all the poses; returns the number of reachable poses
+    size_t Solve(const osaUniversalRobotKinematics &kinematics, const double seed[6]);
+
+protected:
+    // Poses [Begin, End) solved by one thread
+    class Worker {
+    public:
+        osaUniversalRobotInverseKinematicsBatch *Batch;
+        const osaUniversalRobotKinematics *Kinematics;
+        const double *Seed;
+        size_t Begin;
+        size_t End;
+        size_t NumSolved;
+        osaThread Thread;
+        void * RunThread(void *);
+    };
+
+    void SolveRange(const osaUniversalRobotKinematics &kinematics, const double seed[6],
+                    size_t begin, size_t end, size_t &numSolved);
+
+    std::vector<Worker *> Workers;
+    std::vector<double> PoseData[6];
+    std::vector<double> JointData[6];
+    std::vector<unsigned char> Valid;
+};
+
+#endif // _osaUniversalRobotInverseKinematicsBatch_h
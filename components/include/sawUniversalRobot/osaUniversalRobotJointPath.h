@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotJointPath_h
+#define _osaUniversalRobotJointPath_h
+
+#include <cstddef>
+#include <vector>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Dense timed joint path, e.g., from an offline planner, played back
+  every controller cycle to stream servoj setpoints.
+
+  Points are stored by joint (one array of times, one array of positions
+  per joint), so that Check runs branch-free loops over contiguous memory
+  that the compiler can vectorize; the first point that violates a limit
+  is only searched for when there is one.  Positions are interpolated
+  linearly between points.
+
+  Buffers are only allocated by Resize, so a path can be reloaded without
+  allocating if it is not longer than the previous one; Evaluate and
+  Track do not allocate. */
+class CISST_EXPORT osaUniversalRobotJointPath
+{
+public:
+    enum Violation { VALID, TIME_NOT_INCREASING, POSITION_LIMIT, VELOCITY_LIMIT };
+
+    osaUniversalRobotJointPath(void);
+
+    // Number of points, including the start point at time 0; clears the path
+    void Resize(size_t numPoints);
+
+    size_t GetNumberOfPoints(void) const
+    { return NumPoints; }
+
+    // Time of all the points (s), from 0 for the first one
+    double * Time(void)
+    { return &TimeData[0]; }
+
+    // Position of one joint for all the points (rad)
+    double * Position(size_t joint)
+    { return &PositionData[joint][0]; }
+
+    /*! Check that times increase and that the positions and the velocities
+      between consecutive points are within the limits (absolute values).
+      Returns the first violation found (in the order of the enum, for the
+      first joint), with the index of the point and the joint; positions
+      that are not finite violate the position limit. */
+    Violation Check(const double positionLimits[6], const double velocityLimits[6],
+                    size_t &point, size_t &joint) const;
+
+    // Start the playback and the tracking error statistics
+    void Activate(void);
+    void Clear(void);
+
+    // True from Activate to Clear or Resize
+    bool IsActive(void) const
+    { return Active; }
+
+    double GetDuration(void) const
+    { return (NumPoints > 0) ? TimeData[NumPoints - 1] : 0.0; }
+
+    /*! Position at time from the start, clamped to the duration.  Time must
+      not decrease from one call to the next.  Returns the number of points
+      passed. */
+    size_t Evaluate(double time, double position[6]);
+
+    /*! Add the difference between the actual joint positions and the path
+      at time to the tracking error statistics.  Time must not decrease. */
+    void Track(double time, const double actual[6]);
+
+    // Root mean square and maximum absolute tracking error of each joint
+    void GetTrackingError(double rms[6], double maximum[6]) const;
+
+    size_t GetNumberOfTrackingSamples(void) const
+    { return NumTrackingSamples; }
+
+protected:
+    // Position at time, starting the search at cursor
+    void Interpolate(double time, size_t &cursor, double position[6]) const;
+
+    size_t NumPoints;
+    std::vector<double> TimeData;
+    std::vector<double> PositionData[6];
+    bool Active;
+    size_t Cursor;
+    size_t TrackingCursor;
+    size_t NumTrackingSamples;
+    double SumSquaredError[6];
+    double MaximumError[6];
+};
+
+#endif // _osaUniversalRobotJointPath_h
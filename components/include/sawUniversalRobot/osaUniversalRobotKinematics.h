@@ -0,0 +1,352 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotKinematics_h
+#define _osaUniversalRobotKinematics_h
+
+#include <cmath>
+#include <string>
+
+#include <cisstCommon/cmnConstants.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Denavit-Hartenberg parameters (standard convention, meters) published by
+  Universal Robots.  All models share the twist angles (pi/2, 0, 0, pi/2,
+  -pi/2, 0) and only d1, a2, a3, d4, d5 and d6 are not zero.  The base frame
+  and flange frame are the ones of the controller (tool_vec). */
+struct osaUniversalRobotUR3 {
+    static const char * Name(void) { return "UR3"; }
+    static double D1(void) { return  0.1519; }
+    static double A2(void) { return -0.24365; }
+    static double A3(void) { return -0.21325; }
+    static double D4(void) { return  0.11235; }
+    static double D5(void) { return  0.08535; }
+    static double D6(void) { return  0.0819; }
+};
+
+struct osaUniversalRobotUR5 {
+    static const char * Name(void) { return "UR5"; }
+    static double D1(void) { return  0.089159; }
+    static double A2(void) { return -0.425; }
+    static double A3(void) { return -0.39225; }
+    static double D4(void) { return  0.10915; }
+    static double D5(void) { return  0.09465; }
+    static double D6(void) { return  0.0823; }
+};
+
+struct osaUniversalRobotUR10 {
+    static const char * Name(void) { return "UR10"; }
+    static double D1(void) { return  0.1273; }
+    static double A2(void) { return -0.612; }
+    static double A3(void) { return -0.5723; }
+    static double D4(void) { return  0.163941; }
+    static double D5(void) { return  0.1157; }
+    static double D6(void) { return  0.0922; }
+};
+
+/*! Forward kinematics, geometric Jacobian and closed-form inverse
+  kinematics of a model (see osaUniversalRobotUR5).  The parameters are
+  compile-time constants and the twist angles are only 0 or +/-pi/2, so
+  each link transformation reduces to a few products once inlined.
+  Matrices are row-major; nothing is allocated. */
+template <class _model>
+class osaUniversalRobotKinematicsModel
+{
+public:
+    /*! Compute the pose of the tool (rotation[9], translation[3]) in the
+      base frame for the joint positions q, with toolRotation and
+      toolTranslation the pose of the tool in the flange frame.  If jacobian
+      is not 0, it is set to the 6x6 geometric Jacobian of the tool (rows
+      vx, vy, vz, wx, wy, wz in the base frame). */
+    static void Compute(const double q[6],
+                        const double toolRotation[9], const double toolTranslation[3],
+                        double rotation[9], double translation[3], double *jacobian)
+    {
+        // Accumulated transformation, and joint axes and origins for the Jacobian
+        double R[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+        double p[3] = { 0.0, 0.0, 0.0 };
+        double axis[6][3];
+        double origin[6][3];
+
+        for (size_t i = 0; i < 6; i++) {
+            for (size_t k = 0; k < 3; k++) {
+                axis[i][k] = R[3*k + 2];
+                origin[i][k] = p[k];
+            }
+            double link[9], linkTranslation[3];
+            Link(i, q[i], link, linkTranslation);
+            Multiply(R, p, link, linkTranslation);
+        }
+        Multiply(R, p, toolRotation, toolTranslation);
+
+        for (size_t k = 0; k < 9; k++)
+            rotation[k] = R[k];
+        for (size_t k = 0; k < 3; k++)
+            translation[k] = p[k];
+
+        if (!jacobian)
+            return;
+        // Column i: (z_i x (p - o_i), z_i)
+        for (size_t i = 0; i < 6; i++) {
+            const double *z = axis[i];
+            const double r[3] = { p[0] - origin[i][0], p[1] - origin[i][1], p[2] - origin[i][2] };
+            jacobian[     i] = z[1] * r[2] - z[2] * r[1];
+            jacobian[ 6 + i] = z[2] * r[0] - z[0] * r[2];
+            jacobian[12 + i] = z[0] * r[1] - z[1] * r[0];
+            jacobian[18 + i] = z[0];
+            jacobian[24 + i] = z[1];
+            jacobian[30 + i] = z[2];
+        }
+    }
+
+    /*! Compute all the joint positions (up to 8: shoulder left/right, wrist
+      up/down, elbow up/down) for the pose of the flange (rotation[9],
+      translation[3]) in the base frame.  Angles are in [-pi, pi].  When the
+      wrist is singular (q5 = 0), q6 is set to 0.  Returns the number of
+      solutions, 0 if the pose is not reachable. */
+    static size_t Inverse(const double rotation[9], const double translation[3], double solutions[8][6])
+    {
+        const double epsilon = 1.0e-10;
+        const double a2 = _model::A2();
+        const double a3 = _model::A3();
+        const double d4 = _model::D4();
+        const double d6 = _model::D6();
+        size_t numSolutions = 0;
+
+        // Wrist center (origin of frame 5) gives q1
+        const double p05x = translation[0] - d6 * rotation[2];
+        const double p05y = translation[1] - d6 * rotation[5];
+        const double radius = std::sqrt(p05x * p05x + p05y * p05y);
+        if (radius < std::fabs(d4))
+            return 0;
+        const double phi1 = std::atan2(p05y, p05x) + 0.5 * cmnPI;
+        const double psi1 = std::acos(d4 / radius);
+        for (int shoulder = 0; shoulder < 2; shoulder++) {
+            const double q1 = Wrap(phi1 + ((shoulder == 0) ? psi1 : -psi1));
+            const double s1 = std::sin(q1);
+            const double c1 = std::cos(q1);
+            double c5 = (translation[0] * s1 - translation[1] * c1 - d4) / d6;
+            if (std::fabs(c5) > 1.0 + epsilon)
+                continue;
+            c5 = (c5 > 1.0) ? 1.0 : ((c5 < -1.0) ? -1.0 : c5);
+            for (int wrist = 0; wrist < 2; wrist++) {
+                const double q5 = (wrist == 0) ? std::acos(c5) : -std::acos(c5);
+                const double s5 = std::sin(q5);
+                double q6 = 0.0;
+                if (std::fabs(s5) > epsilon)
+                    q6 = std::atan2((-rotation[1] * s1 + rotation[4] * c1) / s5,
+                                    (rotation[0] * s1 - rotation[3] * c1) / s5);
+
+                // T14 = inverse(T01) T06 inverse(T56) inverse(T45)
+                double R[9], p[3], link[9], linkTranslation[3];
+                Link(0, q1, link, linkTranslation);
+                Invert(link, linkTranslation, R, p);
+                Multiply(R, p, rotation, translation);
+                double inverse[9], inverseTranslation[3];
+                Link(5, q6, link, linkTranslation);
+                Invert(link, linkTranslation, inverse, inverseTranslation);
+                Multiply(R, p, inverse, inverseTranslation);
+                Link(4, q5, link, linkTranslation);
+                Invert(link, linkTranslation, inverse, inverseTranslation);
+                Multiply(R, p, inverse, inverseTranslation);
+
+                // Planar arm (q2, q3) in the x-y plane of frame 1
+                const double c3 = (p[0] * p[0] + p[1] * p[1] - a2 * a2 - a3 * a3) / (2.0 * a2 * a3);
+                if (std::fabs(c3) > 1.0 + epsilon)
+                    continue;
+                const double acos3 = std::acos((c3 > 1.0) ? 1.0 : ((c3 < -1.0) ? -1.0 : c3));
+                for (int elbow = 0; elbow < 2; elbow++) {
+                    const double q3 = (elbow == 0) ? acos3 : -acos3;
+                    const double q2 = std::atan2(p[1], p[0])
+                        - std::atan2(a3 * std::sin(q3), a2 + a3 * std::cos(q3));
+                    const double q4 = std::atan2(R[3], R[0]) - q2 - q3;
+                    double *solution = solutions[numSolutions++];
+                    solution[0] = q1;
+                    solution[1] = Wrap(q2);
+                    solution[2] = q3;
+                    solution[3] = Wrap(q4);
+                    solution[4] = q5;
+                    solution[5] = q6;
+                }
+            }
+        }
+        return numSolutions;
+    }
+
+protected:
+    // Transformation of link i (standard DH) for the joint position q
+    static void Link(size_t i, double q, double rotation[9], double translation[3])
+    {
+        const double a[6] = { 0.0, _model::A2(), _model::A3(), 0.0, 0.0, 0.0 };
+        const double d[6] = { _model::D1(), 0.0, 0.0, _model::D4(), _model::D5(), _model::D6() };
+        // Sine of the twist angles; the cosine is 1 when the sine is 0
+        const double sinAlpha[6] = { 1.0, 0.0, 0.0, 1.0, -1.0, 0.0 };
+        const double c = std::cos(q);
+        const double s = std::sin(q);
+        // Rows (c, -s ca, s sa), (s, c ca, -c sa), (0, sa, ca) and translation (a c, a s, d)
+        if (sinAlpha[i] == 0.0) {
+            rotation[0] = c;   rotation[1] = -s;  rotation[2] = 0.0;
+            rotation[3] = s;   rotation[4] = c;   rotation[5] = 0.0;
+            rotation[6] = 0.0; rotation[7] = 0.0; rotation[8] = 1.0;
+        }
+        else {
+            const double sa = sinAlpha[i];
+            rotation[0] = c;   rotation[1] = 0.0; rotation[2] = s * sa;
+            rotation[3] = s;   rotation[4] = 0.0; rotation[5] = -c * sa;
+            rotation[6] = 0.0; rotation[7] = sa;  rotation[8] = 0.0;
+        }
+        translation[0] = a[i] * c;
+        translation[1] = a[i] * s;
+        translation[2] = d[i];
+    }
+
+    // (R, p) = (R, p) * (rotation, translation)
+    static void Multiply(double R[9], double p[3], const double rotation[9], const double translation[3])
+    {
+        double result[9];
+        for (size_t row = 0; row < 3; row++) {
+            const double *Rrow = R + 3*row;
+            p[row] += Rrow[0] * translation[0] + Rrow[1] * translation[1] + Rrow[2] * translation[2];
+            for (size_t column = 0; column < 3; column++)
+                result[3*row + column] = Rrow[0] * rotation[column]
+                                       + Rrow[1] * rotation[3 + column]
+                                       + Rrow[2] * rotation[6 + column];
+        }
+        for (size_t k = 0; k < 9; k++)
+            R[k] = result[k];
+    }
+
+    // (R, p) = inverse(rotation, translation)
+    static void Invert(const double rotation[9], const double translation[3], double R[9], double p[3])
+    {
+        for (size_t row = 0; row < 3; row++) {
+            for (size_t column = 0; column < 3; column++)
+                R[3*row + column] = rotation[3*column + row];
+            p[row] = -(rotation[row] * translation[0] + rotation[3 + row] * translation[1]
+                       + rotation[6 + row] * translation[2]);
+        }
+    }
+
+    // Angle in [-pi, pi]
+    static double Wrap(double angle)
+    {
+        if (angle > cmnPI)
+            return angle - 2.0 * cmnPI;
+        if (angle < -cmnPI)
+            return angle + 2.0 * cmnPI;
+        return angle;
+    }
+};
+
+/*! Kinematics of the model selected at run time (e.g., from the
+  configuration file), with an optional tool (TCP) offset.  The model
+  specific code is osaUniversalRobotKinematicsModel.
+
+  The calibrated parameters of a robot (see SetCalibration) replace the
+  nominal ones: the forward kinematics then use the general
+  Denavit-Hartenberg transformation, and the closed-form solutions of the
+  nominal model are refined with a few Newton iterations. */
+class CISST_EXPORT osaUniversalRobotKinematics
+{
+public:
+    osaUniversalRobotKinematics(void);
+
+    // "UR3", "UR5" or "UR10"; returns false (and keeps the previous model) if unknown
+    bool SetModel(const std::string &model);
+
+    // Model name, empty if no model is set
+    std::string GetModel(void) const;
+
+    bool IsValid(void) const
+    { return (Function != 0); }
+
+    /*! Use the calibrated Denavit-Hartenberg parameters of the robot (standard
+      convention, meters and radians, e.g., read from the controller) instead
+      of the nominal ones, until the next SetModel.  If no model is set, the
+      model with the nearest flange poses is selected.  Returns false, and
+      keeps the nominal parameters, if the flange poses differ by more than
+      1 cm or about 0.01 rad from the nominal ones of the model (or of all
+      the models) at a few joint positions. */
+    bool SetCalibration(const double a[6], const double d[6], const double alpha[6], const double theta[6]);
+
+    bool IsCalibrated(void) const
+    { return Calibrated; }
+
+    // Pose of the tool in the flange frame (x, y, z, rx, ry, rz), as the controller TCP
+    void SetTool(const double pose[6]);
+
+    // Compute the tool pose, and the Jacobian if requested, for the joint positions q
+    void Update(const double q[6], bool computeJacobian = true);
+
+    // Row-major rotation matrix and translation of the tool in the base frame
+    const double * Rotation(void) const
+    { return RotationMatrix; }
+
+    const double * Translation(void) const
+    { return TranslationVector; }
+
+    // Row-major 6x6 geometric Jacobian (see osaUniversalRobotKinematicsModel)
+    const double * Jacobian(void) const
+    { return JacobianMatrix; }
+
+    // All the joint positions (up to 8) for the pose of the tool in the base frame;
+    // returns the number of solutions.  With a calibration, solutions that do not
+    // converge are dropped.
+    size_t InverseAll(const double rotation[9], const double translation[3],
+                      double solutions[8][6]) const;
+
+    /*! Joint positions for the pose of the tool (x, y, z, rx, ry, rz) in the base
+      frame, on the branch nearest to seed (e.g., the current joint positions).
+      Each angle is shifted by 2 pi when it brings it closer to seed, within the
+      [-2 pi, 2 pi] joint limits.  Returns false if the pose is not reachable. */
+    bool Inverse(const double pose[6], const double seed[6], double q[6]) const;
+    bool Inverse(const double rotation[9], const double translation[3],
+                 const double seed[6], double q[6]) const;
+
+protected:
+    // Forward kinematics and Jacobian with the calibrated parameters (see Compute in
+    // osaUniversalRobotKinematicsModel)
+    void ComputeCalibrated(const double q[6],
+                           const double toolRotation[9], const double toolTranslation[3],
+                           double rotation[9], double translation[3], double *jacobian) const;
+    // Newton iterations from q to the joint positions of the flange pose with the
+    // calibrated parameters; returns false if they do not converge
+    bool Refine(const double rotation[9], const double translation[3], double q[6]) const;
+
+    typedef void (*ComputeFunction)(const double q[6],
+                                    const double toolRotation[9], const double toolTranslation[3],
+                                    double rotation[9], double translation[3], double *jacobian);
+    ComputeFunction Function;
+    typedef size_t (*InverseFunction)(const double rotation[9], const double translation[3],
+                                      double solutions[8][6]);
+    InverseFunction Inverter;
+    const char *Name;
+
+    bool Calibrated;
+    double CalibrationA[6];
+    double CalibrationD[6];
+    double CalibrationAlpha[6];
+    double CalibrationTheta[6];
+
+    double ToolRotation[9];
+    double ToolTranslation[3];
+    double RotationMatrix[9];
+    double TranslationVector[3];
+    double JacobianMatrix[36];
+};
+
+#endif // _osaUniversalRobotKinematics_h
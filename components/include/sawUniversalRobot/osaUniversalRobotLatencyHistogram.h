@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotLatencyHistogram_h
+#define _osaUniversalRobotLatencyHistogram_h
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Fixed-size histogram of latencies (in seconds), with logarithmic buckets
+  (8 buckets per power of two, from 1 microsecond to about 1 minute).  Adding
+  a value does not allocate memory, so it can be used in real-time loops.
+  It is meant to be updated by a single thread; reading it from another thread
+  gives approximate results. */
+class CISST_EXPORT osaUniversalRobotLatencyHistogram
+{
+public:
+    enum { SUB_BUCKETS = 8, OCTAVES = 26, NB_BUCKETS = SUB_BUCKETS * OCTAVES + 2 };
+
+    osaUniversalRobotLatencyHistogram(void);
+
+    void Reset(void);
+
+    void Add(double latency);
+
+    unsigned long Count(void) const
+    { return NumSamples; }
+
+    double Minimum(void) const
+    { return (NumSamples > 0) ? Min : 0.0; }
+
+    double Maximum(void) const
+    { return Max; }
+
+    double Mean(void) const
+    { return (NumSamples > 0) ? Sum / NumSamples : 0.0; }
+
+    // Latency below which the fraction p (0 to 1) of the samples are; the result
+    // is the upper bound of the bucket, so the error is less than 10%
+    double Percentile(double p) const;
+
+protected:
+    static size_t BucketIndex(double latency);
+    static double BucketUpperBound(size_t index);
+
+    unsigned long Buckets[NB_BUCKETS];
+    unsigned long NumSamples;
+    double Sum;
+    double Min;
+    double Max;
+};
+
+#endif // _osaUniversalRobotLatencyHistogram_h
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotMotionQueue_h
+#define _osaUniversalRobotMotionQueue_h
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Bounded queue of movej/movel waypoints, executed by a single URScript
+  program instead of one command per move.
+
+  Consecutive moves are blended by the controller (blend radius r of movej
+  and movel), so the robot does not stop at the intermediate waypoints.
+  The radii are reduced to half the distance between neighboring waypoints
+  when both tool positions are known, so that blends do not overlap (which
+  the controller reports as an error), and the last waypoint is never
+  blended.
+
+  The program does not report its progress, so waypoints are completed on
+  the host from the robot state (see NumberReached): a waypoint is reached
+  when the tool enters its blend radius, or when the robot is at the
+  waypoint if it is not blended.  Blended joint waypoints need their tool
+  position (e.g., from osaUniversalRobotKinematics); without it, they are
+  completed with the next waypoint.
+
+  Waypoints are numbered in the order they are added, starting at 0. */
+class CISST_EXPORT osaUniversalRobotMotionQueue
+{
+public:
+    enum MoveType { MOVE_JOINT, MOVE_LINEAR };
+
+    /*! APPEND adds the waypoints after the ones in the queue; REPLACE
+      keeps the waypoint the robot is moving to and drops the others;
+      PREEMPT drops all of them, so the robot moves to the new waypoints
+      from where it is. */
+    enum Policy { APPEND, REPLACE, PREEMPT };
+
+    class Waypoint {
+    public:
+        MoveType Type;
+        double Position[6];      // Joint positions, or tool pose (x, y, z, rx, ry, rz)
+        double Acceleration;     // rad/s^2 for movej, m/s^2 for movel
+        double Velocity;         // rad/s for movej, m/s for movel
+        double BlendRadius;      // m, 0 to stop at the waypoint
+        // Tool position in the base frame; set by Add for linear moves
+        double ToolPosition[3];
+        bool HasToolPosition;
+        int Id;                  // Set by Add
+    };
+
+    osaUniversalRobotMotionQueue(size_t capacity = 64);
+
+    // Maximum number of waypoints in the queue; clears the queue
+    void SetCapacity(size_t capacity);
+
+    size_t GetCapacity(void) const
+    { return Capacity; }
+
+    size_t Size(void) const
+    { return Waypoints.size(); }
+
+    bool Empty(void) const
+    { return Waypoints.empty(); }
+
+    /*! Add numWaypoints waypoints with policy, and set their Id.  Returns
+      false, and leaves the queue unchanged, if they do not fit. */
+    bool Add(Waypoint *waypoints, size_t numWaypoints, Policy policy);
+
+    // Waypoint the robot is moving to
+    const Waypoint & Front(void) const
+    { return Waypoints.front(); }
+
+    // Complete the first waypoint
+    void Pop(void);
+
+    // Drop all the waypoints
+    void Clear(void);
+
+    // Id of the next waypoint added
+    int GetNextId(void) const
+    { return NextId; }
+
+    // Id of the last waypoint completed, -1 if none
+    int GetLastCompleted(void) const
+    { return LastCompleted; }
+
+    /*! Number of waypoints, from the front, reached by the robot at joint
+      positions jointPosition and tool pose toolPose (x, y, z, rx, ry, rz, as
+      reported by the controller).  modelToolPosition is the tool position
+      computed with the same model as the HasToolPosition of the joint
+      waypoints, 0 if there is none. */
+    size_t NumberReached(const double jointPosition[6], const double toolPose[6],
+                         const double *modelToolPosition) const;
+
+    // URScript program moving through the waypoints of the queue; returns false
+    // (and an empty program) if a value can not be encoded
+    bool Compile(std::string &program) const;
+
+protected:
+    bool IsReached(const Waypoint &waypoint, bool last, const double jointPosition[6],
+                   const double toolPose[6], const double *modelToolPosition) const;
+
+    // Reduce the blend radii so that they do not overlap
+    void LimitBlendRadii(void);
+
+    std::deque<Waypoint> Waypoints;
+    size_t Capacity;
+    int NextId;
+    int LastCompleted;
+};
+
+#endif // _osaUniversalRobotMotionQueue_h
@@ -0,0 +1,160 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotPacketDecoder_h
+#define _osaUniversalRobotPacketDecoder_h
+
+#include <cisstCommon/cmnPortability.h>
+
+#if (CISST_OS == CISST_WINDOWS)
+typedef unsigned __int32 uint32_t;
+#else
+#include <stdint.h>
+#endif
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Fields of the port 30003 real-time packet, converted to host byte order.
+  Units are the ones used by the controller (radians, meters, seconds, amps,
+  volts, degC).  Fields that are not sent by the firmware version of the
+  packet are set to 0. */
+struct osaUniversalRobotSample {
+    double Time;                    // Time elapsed since controller was started
+    double JointPosition[6];        // Actual joint positions
+    double JointVelocity[6];        // Actual joint velocities
+    double JointCurrent[6];         // Actual joint currents
+    double JointTargetPosition[6];  // Target joint positions
+    double JointTargetVelocity[6];  // Target joint velocities
+    double JointTargetCurrent[6];   // Target joint currents
+    double ToolVector[6];           // Actual tool Cartesian pose (x, y, z, rx, ry, rz)
+    double TCPSpeed[6];             // Actual tool Cartesian speed
+    double TCPForce[6];             // Generalized forces in the TCP
+    double ControllerExecTime;      // Controller real-time thread execution time
+    double RobotMode;               // Robot mode (see RobotModes in mtsUniversalRobotScriptRT)
+    double JointTargetAcceleration[6];  // Target joint accelerations
+    double JointTargetTorque[6];    // Target joint torques
+    double MotorTemperature[6];     // Joint temperatures
+    double DigitalInputs;           // Digital input bits
+    double ToolAccelerometer[3];    // Tool accelerometer values (1.7+)
+    double JointMode[6];            // Joint control modes (1.8+, see JointModes)
+    double JointControlCurrent[6];  // Joint control currents (3.0+)
+    double ToolTargetVector[6];     // Target tool Cartesian pose (3.0+)
+    double TCPTargetSpeed[6];       // Target tool Cartesian speed (3.0+)
+    double JointVoltage[6];         // Actual joint voltages (3.0+)
+    double SafetyMode;              // Safety mode (3.0+)
+    double SpeedScaling;            // Speed scaling of trajectory limiter (3.0+)
+    double LinearMomentumNorm;      // Norm of Cartesian linear momentum (3.0+)
+    double MainVoltage;             // Masterboard main voltage (3.0+)
+    double RobotVoltage;            // Masterboard robot voltage, 48V (3.0+)
+    double RobotCurrent;            // Masterboard robot current (3.0+)
+    double DigitalOutputs;          // Digital output bits (3.2+)
+    double ProgramState;            // Program state (3.2+)
+};
+
+/*! Decoded packet along with reception information, as passed from the code
+  receiving packets (socket or receive thread) to the task. */
+struct osaUniversalRobotDecodedPacket {
+    osaUniversalRobotSample Sample;
+    unsigned long Length;   // Packet length (header included)
+    int Version;            // Firmware version detected when the packet was decoded
+    bool Decoded;           // False if the version is unknown or the packet too short
+    double ReceiveTime;     // Host monotonic time when the packet was received
+    double DecodeTime;      // Host monotonic time when the packet was decoded
+};
+
+/*! Decoder for the port 30003 real-time packets.
+
+  Decoding reads the big-endian fields directly from the network buffer
+  (the buffer is never modified) into osaUniversalRobotSample.  The packet layout depends on the firmware
+  version, which is detected from the packet length; one decode function
+  is compiled per layout and selected once when the version changes, so
+  that the per-packet cost does not include any layout dispatch. */
+class CISST_EXPORT osaUniversalRobotPacketDecoder
+{
+public:
+    enum FirmwareVersion {VER_UNKNOWN, VER_PRE_18, VER_18, VER_30_31, VER_32, VER_MAX};
+
+    // Expected packet length for each firmware version
+    static const unsigned long PacketLength[VER_MAX];
+
+    // Description of a packet field: Count consecutive big-endian 8-byte values
+    // (doubles, or unsigned integers if Integer is true) at Offset
+    struct Field {
+        const char *Name;
+        unsigned short Offset;
+        unsigned short Count;
+        bool Integer;
+    };
+
+    // All the fields of the packets of the specified version (0 for VER_UNKNOWN)
+    static const Field * GetFields(FirmwareVersion version, size_t &numFields);
+
+    typedef void (*DecodeFunction)(const char *packet, osaUniversalRobotSample &sample);
+
+    osaUniversalRobotPacketDecoder(void);
+
+    // Returns the firmware version matching the packet length, VER_UNKNOWN if none
+    static FirmwareVersion VersionFromLength(unsigned long length);
+
+    // Returns the (big-endian) packet length stored in the first 4 bytes of buffer
+    static uint32_t PacketLengthFromHeader(const char *buffer);
+
+    // Returns the decode function for the specified version, 0 for VER_UNKNOWN
+    static DecodeFunction GetDecodeFunction(FirmwareVersion version);
+
+    // Record the length of a received packet and update the detected version.
+    // Even if we already know which version of firmware we are communicating with,
+    // we keep checking in case we made a mistake.  This also collects useful debug data.
+    FirmwareVersion Update(unsigned long packageLength);
+
+    // Force the firmware version (bypasses detection)
+    void SetVersion(FirmwareVersion version);
+
+    // After a reconnection: keep the current version while the packet length matches
+    // it, but switch on the first packet of another known length (the controller may
+    // have been updated) instead of waiting for its count to exceed the current one.
+    // Packet counts are kept.
+    void Resynchronize(void)
+    { Resync = true; }
+
+    FirmwareVersion GetVersion(void) const
+    { return Version; }
+
+    unsigned long GetPacketCount(FirmwareVersion version) const
+    { return PacketCount[version]; }
+
+    // Decode packet (of the specified length) into sample.  Returns false if the
+    // version is not known or if the packet is shorter than expected for the version.
+    bool Decode(const char *packet, unsigned long length, osaUniversalRobotSample &sample) const;
+
+    // Inverse of Decode, used to simulate a controller: writes the packet for the
+    // specified version (header included) into packet, which must hold at least
+    // PacketLength[version] bytes.  Fields not in the sample are set to 0.
+    static bool Encode(FirmwareVersion version, const osaUniversalRobotSample &sample,
+                       char *packet, unsigned long size);
+
+    // Update the detected version and decode packet; fills all fields of result
+    // except the timestamps
+    void DecodePacket(const char *packet, unsigned long length, osaUniversalRobotDecodedPacket &result);
+
+protected:
+    FirmwareVersion Version;
+    DecodeFunction DecodeCurrent;
+    unsigned long PacketCount[VER_MAX];
+    bool Resync;
+};
+
+#endif // _osaUniversalRobotPacketDecoder_h
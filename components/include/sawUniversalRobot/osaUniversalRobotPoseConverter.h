@@ -0,0 +1,61 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotPoseConverter_h
+#define _osaUniversalRobotPoseConverter_h
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Conversion of a controller pose (x, y, z, rx, ry, rz), where (rx, ry, rz)
+  is an axis-angle (Rodrigues) vector, to a rotation matrix.
+
+  The rotation is computed directly from the vector (one sin, one cos, no
+  temporary objects, a single test for small angles) and is only computed
+  again when the pose is not bit-identical to the previous one, e.g., not
+  while the robot is idle. */
+class CISST_EXPORT osaUniversalRobotPoseConverter
+{
+public:
+    osaUniversalRobotPoseConverter(void);
+
+    // Rotation matrix (row-major) of the axis-angle vector
+    static void AxisAngleToRotation(const double axisAngle[3], double rotation[9]);
+
+    // Axis-angle vector (angle in [0, pi]) of the row-major rotation matrix
+    static void RotationToAxisAngle(const double rotation[9], double axisAngle[3]);
+
+    // Convert pose; returns false if it is the same as the previous one (the
+    // rotation is not computed again)
+    bool Update(const double pose[6]);
+
+    // Forget the previous pose
+    void Reset(void)
+    { Valid = false; }
+
+    const double * Translation(void) const
+    { return Pose; }
+
+    // Row-major rotation matrix
+    const double * Rotation(void) const
+    { return RotationMatrix; }
+
+protected:
+    bool Valid;
+    double Pose[6];
+    double RotationMatrix[9];
+};
+
+#endif // _osaUniversalRobotPoseConverter_h
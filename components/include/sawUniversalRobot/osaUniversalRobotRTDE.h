@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotRTDE_h
+#define _osaUniversalRobotRTDE_h
+
+#include <string>
+#include <vector>
+
+#include <cisstOSAbstraction/osaSocket.h>
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+#include <sawUniversalRobot/osaUniversalRobotStreamFramer.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Client for the Real-Time Data Exchange (RTDE) interface, port 30004.
+
+  RTDE (software 3.4 and later) sends only the fields requested in an output
+  "recipe", at a configurable frequency (up to 125 Hz on CB3 and 500 Hz on
+  e-Series).  Each package has a 2-byte big-endian size and a 1-byte type;
+  the stream is reassembled with osaUniversalRobotStreamFramer.
+
+  The setup methods (NegotiateProtocolVersion, SetupOutputs, SetupInputs,
+  Start) send a request and wait for the reply; they must be called before
+  data is received.  Output fields are decoded into osaUniversalRobotSample,
+  so that RTDE and port 30003 data are published the same way; only fields
+  with a corresponding sample member can be subscribed. */
+class CISST_EXPORT osaUniversalRobotRTDE
+{
+public:
+    enum PackageType {
+        REQUEST_PROTOCOL_VERSION = 'V',
+        GET_URCONTROL_VERSION = 'v',
+        TEXT_MESSAGE = 'M',
+        DATA_PACKAGE = 'U',
+        CONTROL_PACKAGE_SETUP_OUTPUTS = 'O',
+        CONTROL_PACKAGE_SETUP_INPUTS = 'I',
+        CONTROL_PACKAGE_START = 'S',
+        CONTROL_PACKAGE_PAUSE = 'P'
+    };
+
+    enum FieldType { TYPE_BOOL, TYPE_UINT8, TYPE_UINT32, TYPE_UINT64, TYPE_INT32, TYPE_DOUBLE,
+                     TYPE_VECTOR3D, TYPE_VECTOR6D, TYPE_VECTOR6INT32, TYPE_VECTOR6UINT32,
+                     TYPE_UNKNOWN };
+
+    osaUniversalRobotRTDE(void);
+
+    bool Connect(const std::string &host, unsigned short port = 30004);
+    void Close(void);
+
+    // Request protocol version (2 supports the output frequency); returns false if refused
+    bool NegotiateProtocolVersion(unsigned short version = 2);
+
+    // Get controller software version (major, minor, bugfix, build)
+    bool GetControllerVersion(unsigned int version[4]);
+
+    // Default output fields, i.e., those published by mtsUniversalRobotScriptRT
+    static const std::vector<std::string> & DefaultOutputs(void);
+
+    // Subscribe to the named output fields at frequency (Hz).  Returns false if a field
+    // is not supported by this class or by the controller.
+    bool SetupOutputs(double frequency, const std::vector<std::string> &names = DefaultOutputs());
+
+    // Set up an input recipe (e.g., "input_double_register_0").  Returns the recipe id,
+    // or -1 if a field is unknown or already used by another client.
+    int SetupInputs(const std::vector<std::string> &names);
+
+    // Start/pause data synchronization
+    bool Start(void);
+    bool Pause(void);
+
+    // Receive available data, see osaUniversalRobotStreamFramer::Receive
+    int Receive(double timeoutSec);
+
+    // Receive available data without waiting and keep only the newest package, e.g.,
+    // to skip the data sent between Start and the first call to Receive
+    void KeepNewest(void);
+
+    // Decode the next data package received (text messages are logged and skipped)
+    bool NextPacket(osaUniversalRobotDecodedPacket &packet);
+
+    // Send values for an input recipe; values are converted to the recipe field types
+    bool SendInputs(int recipeId, const double *values, size_t count);
+
+    void SetFramePolicy(osaUniversalRobotStreamFramer::FramePolicy policy)
+    { Framer.SetPolicy(policy); }
+
+    double GetFrequency(void) const
+    { return Frequency; }
+
+    const osaUniversalRobotStreamFramer & GetFramer(void) const
+    { return Framer; }
+
+protected:
+    // Output field: type on the wire and offset of the value in osaUniversalRobotSample
+    struct OutputField {
+        FieldType Type;
+        size_t SampleOffset;
+    };
+
+    struct InputRecipe {
+        int Id;
+        std::vector<FieldType> Types;
+    };
+
+    static FieldType TypeFromName(const std::string &name);
+    static size_t TypeSize(FieldType type);
+
+    std::string TextMessage(const char *payload, size_t size) const;
+    bool SendPackage(char type, const char *payload, size_t size);
+    // Wait for a reply of the given type; returns payload (after type byte)
+    bool WaitForReply(char type, const char *&payload, unsigned long &size, double timeoutSec = 1.0);
+    // Parse comma separated type names; returns false if a type is unknown
+    static bool ParseTypes(const char *names, size_t size, std::vector<FieldType> &types);
+
+    osaSocket Socket;
+    osaUniversalRobotStreamFramer Framer;
+    unsigned short ProtocolVersion;
+    double Frequency;
+    int OutputRecipeId;
+    unsigned long OutputLength;    // Expected data package length (header included)
+    std::vector<OutputField> Outputs;
+    std::vector<InputRecipe> Inputs;
+    std::vector<char> SendBuffer;
+};
+
+#endif // _osaUniversalRobotRTDE_h
@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotReceiver_h
+#define _osaUniversalRobotReceiver_h
+
+#include <atomic>
+#include <vector>
+
+#include <cisstOSAbstraction/osaThread.h>
+#include <cisstOSAbstraction/osaThreadSignal.h>
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+#include <sawUniversalRobot/osaUniversalRobotStreamFramer.h>
+#include <sawUniversalRobot/osaUniversalRobotSPSCQueue.h>
+
+class osaSocket;
+class osaUniversalRobotIOEngine;
+class osaUniversalRobotFrameSink;
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Dedicated thread receiving and decoding packets from the controller.
+
+  The thread only reads from the socket (commands are still sent by the task),
+  timestamps each packet with the host monotonic clock when it is received,
+  decodes it and pushes it to a lock-free single producer / single consumer
+  queue read by the task.  Packets are decoded just before they are queued,
+  so the time spent in the queue is measured from their DecodeTime.  The
+  framer and decoder belong to the thread while the receiver is running;
+  their statistics are published for the task as atomic copies (see
+  GetFramerStatistics).  The thread can be pinned to a CPU so that packet
+  reception is not delayed by the processing done in the task.
+
+  Instead of its own thread, the receiver can be serviced by an
+  osaUniversalRobotIOEngine shared by several robots. */
+class CISST_EXPORT osaUniversalRobotReceiver
+{
+public:
+    typedef osaUniversalRobotSPSCQueue<osaUniversalRobotDecodedPacket> QueueType;
+
+    // The framer and decoder must not be used by other threads while the receiver is running
+    osaUniversalRobotReceiver(osaUniversalRobotStreamFramer &framer,
+                              osaUniversalRobotPacketDecoder &decoder,
+                              size_t queueSize = 64);
+
+    ~osaUniversalRobotReceiver();
+
+    // Start the receive thread; cpu is the CPU to pin the thread to (-1 for no pinning)
+    bool Start(osaSocket *socket, int cpu = -1);
+
+    // Service the socket from the I/O engine thread instead of a dedicated thread;
+    // the engine must be running
+    bool Start(osaSocket *socket, osaUniversalRobotIOEngine &engine);
+
+    // Stop the receive thread (or remove the socket from the I/O engine) and wait for
+    // the current receive to finish
+    void Stop(void);
+
+    // Receive what the socket has available and queue the decoded packets.  Called
+    // by the receive thread or the I/O engine; returns -1 on socket error.
+    int Service(double timeoutSec);
+
+    bool IsRunning(void) const
+    { return Running; }
+
+    // True if the thread stopped because of a socket error
+    bool SocketErrorOccurred(void) const
+    { return SocketErrorFlag; }
+
+    // Set the socket error flag and wake up the task
+    void ReportSocketError(void);
+
+    // Wait until packets are available, up to timeoutSec.  Returns false on timeout.
+    bool WaitForPackets(double timeoutSec);
+
+    // Consumer side of the queue
+    QueueType & Queue(void)
+    { return PacketQueue; }
+
+    // Packets lost because the queue was full
+    unsigned long GetOverflows(void) const
+    { return Overflows; }
+
+    // Copy of the framer statistics and of the number of bytes buffered, published
+    // after each receive (each value is up to date, not necessarily the whole set)
+    void GetFramerStatistics(osaUniversalRobotStreamFramer::Statistics &stats,
+                             unsigned long &bytesBuffered) const;
+
+    // Number of times data was received from the socket
+    unsigned long GetWakeups(void) const
+    { return Wakeups; }
+
+    unsigned long GetPacketsQueued(void) const
+    { return PacketsQueued; }
+
+    // Objects receiving the raw frames (e.g., recorder); must be called while stopped
+    void SetFrameSinks(const std::vector<osaUniversalRobotFrameSink *> &sinks)
+    { FrameSinks = sinks; }
+
+    // Pin the calling thread to cpu (Linux only); returns false on error
+    static bool PinCurrentThread(int cpu);
+
+protected:
+    void * RunThread(void *);
+
+    // Copy the framer statistics to the atomic ones
+    void PublishFramerStatistics(void);
+
+    osaUniversalRobotStreamFramer &Framer;
+    osaUniversalRobotPacketDecoder &Decoder;
+    QueueType PacketQueue;
+    // Decoded when the queue is full, so that the decoder state and statistics advance
+    osaUniversalRobotDecodedPacket DroppedPacket;
+
+    osaSocket *Socket;
+    int CPU;
+    osaUniversalRobotIOEngine *Engine;   // 0 when using a dedicated thread
+    std::vector<osaUniversalRobotFrameSink *> FrameSinks;
+    osaThread Thread;
+    osaThreadSignal PacketsAvailable;
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<bool> SocketErrorFlag;
+    std::atomic<unsigned long> Overflows;
+    std::atomic<unsigned long> Wakeups;
+    std::atomic<unsigned long> PacketsQueued;
+
+    // Written by the receiving thread only
+    enum { NB_FRAMER_STATISTICS = sizeof(osaUniversalRobotStreamFramer::Statistics) / sizeof(unsigned long) };
+    std::atomic<unsigned long> FramerStatistics[NB_FRAMER_STATISTICS];
+    std::atomic<unsigned long> FramerBytesBuffered;
+};
+
+#endif // _osaUniversalRobotReceiver_h
@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotReconnect_h
+#define _osaUniversalRobotReconnect_h
+
+#include <string>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Reconnection with exponential backoff.
+
+  After the connection is lost, Poll is called periodically (e.g., at each
+  cycle of the task).  When the backoff delay has elapsed, Poll returns
+  STARTED once and the caller starts a connection attempt, e.g., in another
+  thread so that the task does not wait for the network; Poll then returns
+  IN_PROGRESS until the caller reports the result with Stop (connected) or
+  Retry (failed).  After each failure, the delay is multiplied until it
+  reaches its maximum. */
+class CISST_EXPORT osaUniversalRobotReconnect
+{
+public:
+    enum Status {
+        IDLE,           // Not reconnecting
+        WAITING,        // Waiting for the backoff delay
+        STARTED,        // The caller must start an attempt
+        IN_PROGRESS     // Attempt in progress, waiting for Stop or Retry
+    };
+
+    osaUniversalRobotReconnect(void);
+
+    // Delays in seconds; the first attempt is made initialDelay after Start
+    void SetBackoff(double initialDelay, double maximumDelay, double multiplier = 2.0);
+
+    // Time to wait for each connection attempt, see Probe (s)
+    void SetConnectTimeout(double timeout)
+    { ConnectTimeout = timeout; }
+
+    double GetConnectTimeout(void) const
+    { return ConnectTimeout; }
+
+    /*! Wait up to timeout seconds for host:port to accept a connection, with a
+      non-blocking connect, so that a thread can check that the controller is
+      reachable without waiting for the operating system timeout; the caller
+      then connects its own socket.  Returns false on timeout or if the
+      connection is refused. */
+    static bool Probe(const std::string &host, unsigned short port, double timeout);
+
+    // Start reconnecting to host:port; now is the current (monotonic) time
+    void Start(const std::string &host, unsigned short port, double now);
+
+    // Advance the reconnection; never blocks
+    Status Poll(double now);
+
+    // The attempt failed: try again after the next delay
+    void Retry(double now);
+
+    // Stop reconnecting, e.g., once connected
+    void Stop(void);
+
+    bool IsActive(void) const
+    { return (State != IDLE); }
+
+    // Number of attempts since Start
+    unsigned int GetAttempts(void) const
+    { return Attempts; }
+
+protected:
+    void ScheduleNext(double now);
+
+    std::string Host;
+    unsigned short Port;
+    double InitialDelay;
+    double MaximumDelay;
+    double Multiplier;
+    double ConnectTimeout;
+
+    Status State;
+    double Delay;               // Current backoff delay
+    double NextAttemptTime;
+    unsigned int Attempts;
+};
+
+#endif // _osaUniversalRobotReconnect_h
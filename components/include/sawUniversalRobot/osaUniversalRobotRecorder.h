@@ -0,0 +1,156 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotRecorder_h
+#define _osaUniversalRobotRecorder_h
+
+#include <string>
+#include <stdint.h>
+
+#include <sawUniversalRobot/osaUniversalRobotFrameSink.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Format of the recording files, shared by osaUniversalRobotRecorder and
+  osaUniversalRobotReplay.
+
+  The file starts with a FileHeader followed by a ring of records.  Each
+  record is a RecordHeader followed by the raw frame, padded to 8 bytes.
+  When a record does not fit at the end of the ring, a wrap marker is
+  written and the record starts at the beginning; the oldest records are
+  overwritten.  Fields are stored in the byte order of the host. */
+namespace osaUniversalRobotRecording {
+    const char MAGIC[8] = { 'U', 'R', 'F', 'R', 'A', 'M', 'E', 'S' };
+    const uint32_t FORMAT_VERSION = 1;
+    const uint32_t RECORD_MARKER = 0x52524655;   // Valid record
+    const uint32_t WRAP_MARKER = 0x50415257;     // Next record at the start of the ring
+
+    struct FileHeader {
+        char Magic[8];
+        uint32_t FormatVersion;
+        uint32_t HeaderSize;
+        uint64_t Capacity;          // Size of the ring (bytes)
+        uint64_t Head;              // Offset of the next record in the ring
+        uint64_t Tail;              // Offset of the oldest record in the ring
+        uint64_t Records;           // Number of records in the ring
+        uint64_t RecordsWritten;    // Number of records written since the file was created
+        uint64_t Reserved;
+    };
+
+    struct RecordHeader {
+        uint32_t Length;            // Frame length (bytes)
+        uint32_t Marker;            // RECORD_MARKER or WRAP_MARKER
+        double ReceiveTime;         // Host monotonic time the frame was received
+    };
+
+    // Size of the record for a frame of length bytes
+    inline uint64_t RecordSize(uint64_t length)
+    { return sizeof(RecordHeader) + ((length + 7) & ~static_cast<uint64_t>(7)); }
+}
+
+/*! Flight recorder of the raw frames received from the controller.
+
+  Frames are appended with their receive time to a memory-mapped ring file,
+  preallocated when it is opened, so that recording a frame only copies it
+  (no memory allocation and no system call).  Once the ring is full, the
+  oldest frames are overwritten, so the file holds the most recent traffic.
+  The file header is updated after each frame is written, so the file is
+  consistent even if the process crashes.  Not thread safe: frames must be
+  recorded by a single thread.  Not available on Windows. */
+class CISST_EXPORT osaUniversalRobotRecorder : public osaUniversalRobotFrameSink
+{
+public:
+    osaUniversalRobotRecorder(void);
+
+    ~osaUniversalRobotRecorder();
+
+    // Create (or overwrite) the file, with a ring of capacity bytes
+    bool Open(const std::string &filename, size_t capacity);
+
+    void Close(void);
+
+    bool IsOpen(void) const
+    { return (Header != 0); }
+
+    // Append a frame; returns false if the recorder is not open or the frame is
+    // larger than half the ring
+    bool Record(const char *frame, unsigned long length, double receiveTime);
+
+    void Frame(const char *frame, unsigned long length, double receiveTime)
+    { Record(frame, length, receiveTime); }
+
+    unsigned long long GetRecordsWritten(void) const;
+
+protected:
+    // Offset of the next record after the one at offset
+    uint64_t NextOffset(uint64_t offset) const;
+    // Remove the oldest record
+    void DropOldest(void);
+
+    osaUniversalRobotRecording::FileHeader *Header;
+    char *Ring;
+    size_t MappedSize;
+    int FileId;
+};
+
+/*! Reads a file written by osaUniversalRobotRecorder, from the oldest frame
+  to the most recent.  The file is memory-mapped; frames returned by Front
+  point into the mapping and remain valid until Close. */
+class CISST_EXPORT osaUniversalRobotReplay
+{
+public:
+    struct Frame {
+        const char *Data;
+        unsigned long Length;
+        double ReceiveTime;
+    };
+
+    osaUniversalRobotReplay(void);
+
+    ~osaUniversalRobotReplay();
+
+    bool Open(const std::string &filename);
+
+    void Close(void);
+
+    bool IsOpen(void) const
+    { return (Header != 0); }
+
+    // Current frame; returns false at the end of the recording
+    bool Front(Frame &frame) const;
+
+    // Go to the next frame
+    void Pop(void);
+
+    // Go back to the oldest frame
+    void Rewind(void);
+
+    unsigned long long GetNumberOfFrames(void) const;
+
+protected:
+    // Check the offsets of the header and the length of each record against the ring
+    bool CheckRecords(void) const;
+    // Skip wrap markers
+    void SkipWrap(void);
+
+    const osaUniversalRobotRecording::FileHeader *Header;
+    const char *Ring;
+    size_t MappedSize;
+    uint64_t Offset;            // Offset of the current record
+    uint64_t Remaining;         // Number of records left, including the current one
+};
+
+#endif // _osaUniversalRobotRecorder_h
@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotSPSCQueue_h
+#define _osaUniversalRobotSPSCQueue_h
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*! Lock-free, wait-free, single producer / single consumer queue.
+
+  All elements are allocated by the constructor; elements are written and read
+  in place (WriteSlot/Push and Front/Pop) so that no copy or allocation happens
+  while the queue is in use.  Only one thread may call WriteSlot/Push and only
+  one (other) thread may call Front/Pop. */
+template <class _elementType>
+class osaUniversalRobotSPSCQueue
+{
+public:
+    typedef _elementType value_type;
+
+    // capacity is rounded up to a power of two
+    osaUniversalRobotSPSCQueue(size_t capacity = 64) :
+        Head(0), Tail(0)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        Elements.resize(size);
+        Mask = size - 1;
+    }
+
+    size_t Capacity(void) const
+    { return Elements.size(); }
+
+    // Number of elements in the queue (approximate if called by a third thread)
+    size_t Size(void) const
+    { return Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire); }
+
+    // Producer: returns the slot to write the next element into, 0 if the queue is full
+    value_type * WriteSlot(void)
+    {
+        const size_t tail = Tail.load(std::memory_order_relaxed);
+        if (tail - Head.load(std::memory_order_acquire) >= Elements.size())
+            return 0;
+        return &Elements[tail & Mask];
+    }
+
+    // Producer: make the element written in WriteSlot visible to the consumer
+    void Push(void)
+    { Tail.store(Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: returns the oldest element, 0 if the queue is empty
+    value_type * Front(void)
+    {
+        const size_t head = Head.load(std::memory_order_relaxed);
+        if (head == Tail.load(std::memory_order_acquire))
+            return 0;
+        return &Elements[head & Mask];
+    }
+
+    // Consumer: release the element returned by Front
+    void Pop(void)
+    { Head.store(Head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+protected:
+    std::vector<value_type> Elements;
+    size_t Mask;
+    // Keep the indices on separate cache lines to avoid false sharing
+    char Padding0[64];
+    std::atomic<size_t> Head;
+    char Padding1[64];
+    std::atomic<size_t> Tail;
+    char Padding2[64];
+};
+
+#endif // _osaUniversalRobotSPSCQueue_h
@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotSecondaryClient_h
+#define _osaUniversalRobotSecondaryClient_h
+
+#include <atomic>
+#include <string>
+
+#include <cisstOSAbstraction/osaMutex.h>
+#include <cisstOSAbstraction/osaSocket.h>
+#include <cisstOSAbstraction/osaThread.h>
+#include <sawUniversalRobot/osaUniversalRobotSecondaryParser.h>
+#include <sawUniversalRobot/osaUniversalRobotStreamFramer.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Client for the primary or secondary interface (port 30001 or 30002).
+
+  A dedicated thread receives and parses the messages (see
+  osaUniversalRobotSecondaryParser), so that the control loop only copies
+  the values when they were updated; robot messages are kept in a
+  fixed-size ring (the oldest ones are dropped if it is full).  The
+  connection is reopened every second when it is lost.  Nothing is
+  allocated once started. */
+class CISST_EXPORT osaUniversalRobotSecondaryClient
+{
+public:
+    osaUniversalRobotSecondaryClient(void);
+
+    ~osaUniversalRobotSecondaryClient();
+
+    bool Start(const std::string &host, unsigned short port = 30002);
+
+    void Stop(void);
+
+    bool IsRunning(void) const
+    { return Running; }
+
+    bool IsConnected(void) const
+    { return Connected; }
+
+    /*! Copy the values if they were updated since the last call; returns the
+      changes (see osaUniversalRobotSecondaryParser::Change) accumulated since
+      then, MESSAGE_RECEIVED excluded, 0 if nothing was received.  Never
+      blocks on the network. */
+    unsigned int Fetch(osaUniversalRobotSecondaryParser::Data &data);
+
+    // Next robot message, in order; returns false if there is none
+    bool NextMessage(osaUniversalRobotSecondaryParser::Message &message);
+
+    // Number of messages dropped because the ring was full
+    unsigned long GetNumberOfMessagesDropped(void) const
+    { return MessagesDropped; }
+
+    enum { MAX_MESSAGES = 32 };
+
+protected:
+    void * RunThread(void *);
+
+    std::string Host;
+    unsigned short Port;
+    osaSocket Socket;
+    osaThread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<bool> Connected;
+    // Used by the thread only
+    osaUniversalRobotStreamFramer Framer;
+    osaUniversalRobotSecondaryParser Parser;
+
+    // Shared with the thread of the caller
+    osaMutex Mutex;
+    osaUniversalRobotSecondaryParser::Data Shared;
+    unsigned int Changes;
+    osaUniversalRobotSecondaryParser::Message Messages[MAX_MESSAGES];
+    size_t FirstMessage;
+    size_t NumMessages;
+    unsigned long MessagesDropped;
+};
+
+#endif // _osaUniversalRobotSecondaryClient_h
@@ -0,0 +1,185 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotSecondaryParser_h
+#define _osaUniversalRobotSecondaryParser_h
+
+#include <cstddef>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Parser for the messages of the primary and secondary interfaces
+  (ports 30001 and 30002), which the controller sends at 10 Hz: robot
+  state packages (robot mode, masterboard, Cartesian, kinematics and
+  configuration data) and robot messages (version, errors, popups, ...).
+
+  Each message is parsed in place from the frame (see
+  osaUniversalRobotStreamFramer, 4 byte length header) into fixed-size
+  structures, with bounds-checked big-endian reads; unknown or short
+  packages are skipped, and nothing is allocated.  Parse returns which
+  groups of values changed, so that the configuration (which the
+  controller sends every time) is only published when it changes, and
+  the robot mode and masterboard state only when a discrete value (mode,
+  flags, digital I/O) changes.
+
+  The robot state packages are only parsed once the version message
+  (sent when the connection is opened) shows a CB3 or e-Series
+  controller (major version 3 or more), since the package layouts of
+  older versions differ. */
+class CISST_EXPORT osaUniversalRobotSecondaryParser
+{
+public:
+    // Message types (byte after the length)
+    enum { MESSAGE_ROBOT_STATE = 16, MESSAGE_ROBOT = 20 };
+
+    // Robot state package types
+    enum { PACKAGE_ROBOT_MODE = 0, PACKAGE_JOINT = 1, PACKAGE_TOOL = 2, PACKAGE_MASTERBOARD = 3,
+           PACKAGE_CARTESIAN = 4, PACKAGE_KINEMATICS = 5, PACKAGE_CONFIGURATION = 6,
+           PACKAGE_FORCE = 7, PACKAGE_ADDITIONAL = 8, PACKAGE_CALIBRATION = 9, PACKAGE_SAFETY = 10 };
+
+    // Robot message types
+    enum { ROBOT_MESSAGE_TEXT = 0, ROBOT_MESSAGE_LABEL = 1, ROBOT_MESSAGE_POPUP = 2,
+           ROBOT_MESSAGE_VERSION = 3, ROBOT_MESSAGE_SAFETY_MODE = 5, ROBOT_MESSAGE_ERROR_CODE = 6,
+           ROBOT_MESSAGE_KEY = 7, ROBOT_MESSAGE_REQUEST_VALUE = 9, ROBOT_MESSAGE_RUNTIME_EXCEPTION = 10 };
+
+    // Report levels of the messages
+    enum { REPORT_DEBUG = 0, REPORT_INFO = 1, REPORT_WARNING = 2, REPORT_VIOLATION = 3, REPORT_FAULT = 4 };
+
+    // Bits returned by Parse
+    enum Change {
+        ROBOT_MODE = 0x01,        // Robot mode data, other than speed scaling
+        MASTERBOARD = 0x02,       // Digital I/O, safety mode or reduced mode
+        TCP_OFFSET = 0x04,
+        KINEMATICS = 0x08,        // Calibrated Denavit-Hartenberg parameters
+        CONFIGURATION = 0x10,
+        VERSION = 0x20,
+        STATE_RECEIVED = 0x40,    // Robot state message received (values may have changed)
+        MESSAGE_RECEIVED = 0x80   // See GetMessage
+    };
+
+    struct RobotModeData {
+        bool RealRobotConnected;
+        bool RealRobotEnabled;
+        bool PowerOn;
+        bool EmergencyStopped;
+        bool ProtectiveStopped;
+        bool ProgramRunning;
+        bool ProgramPaused;
+        int RobotMode;
+        int ControlMode;
+        double TargetSpeedFraction;
+        double SpeedScaling;
+    };
+
+    struct MasterboardData {
+        unsigned int DigitalInputs;
+        unsigned int DigitalOutputs;
+        int SafetyMode;
+        bool ReducedMode;
+        double Temperature;       // degC
+        double RobotVoltage;      // V (48V supply)
+        double RobotCurrent;      // A
+        double IOCurrent;         // A
+    };
+
+    struct KinematicsData {
+        unsigned int Checksum[6];
+        // Calibrated Denavit-Hartenberg parameters (m and rad)
+        double Theta[6];
+        double A[6];
+        double D[6];
+        double Alpha[6];
+        unsigned int CalibrationStatus;
+    };
+
+    struct ConfigurationData {
+        double JointMinimum[6];   // rad
+        double JointMaximum[6];
+        double JointMaximumSpeed[6];
+        double JointMaximumAcceleration[6];
+        double JointDefaultVelocity;
+        double JointDefaultAcceleration;
+        double ToolDefaultVelocity;
+        double ToolDefaultAcceleration;
+        double EquivalentRadius;
+        // Nominal Denavit-Hartenberg parameters
+        double A[6];
+        double D[6];
+        double Alpha[6];
+        double Theta[6];
+        int MasterboardVersion;
+        int ControllerBoxType;
+        int RobotType;
+        int RobotSubType;
+    };
+
+    struct VersionData {
+        char ProjectName[32];
+        int Major;
+        int Minor;
+        int Bugfix;
+        int Build;
+        char BuildDate[32];
+    };
+
+    // All the values, zero until received
+    struct Data {
+        RobotModeData RobotMode;
+        MasterboardData Masterboard;
+        double TCPOffset[6];      // x, y, z, rx, ry, rz
+        KinematicsData Kinematics;
+        ConfigurationData Configuration;
+        VersionData Version;
+    };
+
+    struct Message {
+        int Type;                 // ROBOT_MESSAGE_*
+        int Source;               // Source of the message (e.g., -2 controller)
+        int Code;                 // Error code and argument (C<code>A<argument>), 0 if none
+        int Argument;
+        int ReportLevel;          // REPORT_*
+        char Text[256];           // Title and text, truncated
+    };
+
+    osaUniversalRobotSecondaryParser(void);
+
+    // Clear all the values, e.g., when the connection is reopened
+    void Reset(void);
+
+    // Parse a complete message (length header included); returns the Change bits
+    unsigned int Parse(const char *frame, unsigned long length);
+
+    const Data & GetData(void) const
+    { return Values; }
+
+    // Last message received (see MESSAGE_RECEIVED)
+    const Message & GetMessage(void) const
+    { return LastMessage; }
+
+    // Number of messages and packages skipped because they were too short
+    unsigned long GetNumberOfErrors(void) const
+    { return NumErrors; }
+
+protected:
+    unsigned int ParseRobotState(const char *payload, size_t size);
+    unsigned int ParseRobotMessage(const char *payload, size_t size);
+
+    Data Values;
+    Message LastMessage;
+    unsigned long NumErrors;
+};
+
+#endif // _osaUniversalRobotSecondaryParser_h
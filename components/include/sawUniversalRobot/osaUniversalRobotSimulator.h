@@ -0,0 +1,148 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotSimulator_h
+#define _osaUniversalRobotSimulator_h
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <cisstOSAbstraction/osaMutex.h>
+#include <cisstOSAbstraction/osaThread.h>
+#include <cisstOSAbstraction/osaSocketServer.h>
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotSimulatorExport.h>
+
+/*! Minimal simulation of a UR controller, to test and benchmark the driver
+  without a robot.
+
+  A thread accepts one client on the real-time port and sends packets of the
+  selected firmware version at a fixed period.  Network effects can be
+  simulated: random delay (jitter), packets sent in two parts (fragmentation)
+  and packets held back and sent with the next one (coalescing).  speedj,
+  stopj and movej commands are integrated into the simulated joint state;
+  all commands received are recorded with their arrival time.  A few
+  dashboard server requests (e.g., PolyscopeVersion) are also answered.
+  RTDE and Cartesian motions are not simulated. */
+class CISST_EXPORT osaUniversalRobotSimulator
+{
+public:
+    struct Configuration {
+        Configuration(void);
+        osaUniversalRobotPacketDecoder::FirmwareVersion Version;   // Default VER_32
+        double Period;                  // Packet period, default 0.008 s
+        double Jitter;                  // Maximum random delay added to each packet (s)
+        double FragmentProbability;     // Probability that a packet is sent in two parts
+        double CoalesceProbability;     // Probability that a packet is sent with the next one
+        unsigned short Port;            // Real-time port, default 30003
+        unsigned short DashboardPort;   // Dashboard server port, 0 to disable (default 29999)
+        unsigned int Seed;              // Seed of the random number generator
+    };
+
+    struct CommandRecord {
+        enum { NAME_SIZE = 16 };
+        double ArrivalTime;             // Host monotonic time
+        double ControllerTime;          // Simulated controller time
+        char Name[NAME_SIZE];           // Command name, e.g., "speedj" ("def" for programs)
+    };
+
+    // Up to maxCommandRecords commands are recorded between calls to GetCommandRecords
+    osaUniversalRobotSimulator(size_t maxCommandRecords = 100000);
+
+    ~osaUniversalRobotSimulator();
+
+    bool Start(const Configuration &config = Configuration());
+
+    void Stop(void);
+
+    bool IsRunning(void) const
+    { return Running; }
+
+    bool ClientConnected(void) const
+    { return ClientAccepted; }
+
+    unsigned long GetPacketsSent(void) const
+    { return PacketsSent; }
+
+    // Commands that could not be recorded because the record buffer was full
+    unsigned long GetCommandsDropped(void) const
+    { return CommandsDropped; }
+
+    // Change the packet period while running, e.g., to find the highest rate supported
+    bool SetPeriod(double period);
+
+    double GetPeriod(void) const
+    { return Period; }
+
+    void GetJointPosition(double position[6]);
+    void SetJointPosition(const double position[6]);
+
+    // Move the commands recorded so far to records
+    void GetCommandRecords(std::vector<CommandRecord> &records);
+
+protected:
+    enum MotionType { MOTION_NONE, MOTION_SPEEDJ, MOTION_MOVEJ };
+
+    void * RunThread(void *);
+    void AcceptClients(void);
+    void ReceiveCommands(double now);
+    void ExecuteCommand(const char *command, double now);
+    void ServeDashboard(void);
+    void Integrate(double dt);
+    void SendPacket(void);
+    // Uniform random number in [0, 1)
+    double Random(void);
+    void CloseClient(osaSocket *&client);
+    // Close the real-time client (see ClientAccepted)
+    void CloseRealTimeClient(void);
+
+    Configuration Config;
+    osaSocketServer Server;
+    osaSocketServer DashboardServer;
+    // Used by the simulator thread only; ClientAccepted is set while Client is not 0
+    osaSocket *Client;
+    osaSocket *DashboardClient;
+    std::atomic<bool> ClientAccepted;
+    osaThread Thread;
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+    std::atomic<double> Period;
+    std::atomic<unsigned long> PacketsSent;
+    std::atomic<unsigned long> CommandsDropped;
+    unsigned long long RandomState;
+
+    // Protects State, the motion and Records
+    osaMutex Mutex;
+    osaUniversalRobotSample State;
+    MotionType Motion;
+    double MotionVelocity[6];       // speedj velocity or movej velocity of each joint
+    double MotionTarget[6];         // movej target
+    double MotionTimeout;           // speedj time (0 for no timeout)
+    std::vector<CommandRecord> Records;
+    size_t MaxRecords;
+
+    // Partial lines received from the clients
+    std::string CommandLine;
+    std::string DashboardLine;
+    bool InProgram;                 // Receiving the lines of a "def ... end" program
+    // Packets not sent yet (coalescing)
+    std::vector<char> OutBuffer;
+    size_t OutSize;
+};
+
+#endif // _osaUniversalRobotSimulator_h
@@ -0,0 +1,121 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotSnapshot_h
+#define _osaUniversalRobotSnapshot_h
+
+#include <atomic>
+#include <string>
+
+#include <cisstCommon/cmnPortability.h>
+
+#if (CISST_OS == CISST_WINDOWS)
+typedef unsigned __int32 uint32_t;
+typedef unsigned __int64 uint64_t;
+#else
+#include <stdint.h>
+#endif
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Latest robot state, as published by mtsUniversalRobotScriptRT.  All the
+  fields are 8 bytes, so that the layout is the same for all the
+  processes reading the shared memory. */
+struct osaUniversalRobotSnapshotData {
+    uint64_t Index;                 // Sample index (see mtsUniversalRobotSample), 0 until the first one
+    double ControllerTime;          // Controller time of the sample (s)
+    double HostTime;                // Controller time converted to host monotonic time (s)
+    double ReceiveTime;             // Host monotonic time the packet was received (s)
+    double JointPosition[6];        // rad
+    double JointVelocity[6];        // rad/s
+    double JointEffort[6];          // Joint currents (A)
+    double ToolPose[6];             // x, y, z, rx, ry, rz (as the controller)
+    double ToolRotation[9];         // Row-major rotation matrix of ToolPose
+    double ToolSpeed[6];
+    double ToolForce[6];
+    double RobotMode;
+    double SafetyMode;
+};
+
+/*! Single-writer, multi-reader snapshot of the latest robot state, for
+  consumers that need it at high rates without going through the task
+  commands (e.g., vision or planning threads, or other processes).
+
+  The snapshot is a sequence lock: the writer increments the sequence
+  number before and after copying the data, and readers retry if the
+  sequence number was odd or changed during their copy.  The writer never
+  waits for the readers, and a read only retries if it overlapped a
+  write (which takes well under a microsecond, once per packet), so reads
+  are bounded: Read gives up after MAX_READ_ATTEMPTS attempts.  The data
+  is copied as 64-bit atomic words, so that concurrent reads and writes
+  are well defined.
+
+  The snapshot is in process memory by default; CreateShared places it in
+  POSIX shared memory, which other processes map read-only with
+  OpenShared (not available on Windows). */
+class CISST_EXPORT osaUniversalRobotSnapshot
+{
+public:
+    osaUniversalRobotSnapshot(void);
+
+    ~osaUniversalRobotSnapshot();
+
+    /*! Writer: move the snapshot to the POSIX shared memory object name (e.g.,
+      "/ur-snapshot"), created if needed; the object is removed by Close.
+      Returns false, and keeps the snapshot in process memory, on error. */
+    bool CreateShared(const std::string &name);
+
+    /*! Reader in another process: map the shared memory object created by the
+      writer.  Returns false if it does not exist or its layout differs. */
+    bool OpenShared(const std::string &name);
+
+    // Unmap the shared memory (removing the object if created) and return to process memory
+    void Close(void);
+
+    bool IsShared(void) const
+    { return (Mapping != 0); }
+
+    // Writer only
+    void Publish(const osaUniversalRobotSnapshotData &data);
+
+    /*! Copy the latest data, from any thread.  Returns false if nothing was
+      published yet or if every attempt overlapped a write. */
+    bool Read(osaUniversalRobotSnapshotData &data) const;
+
+    // Number of times Publish was called (e.g., to poll for new data)
+    uint64_t GetNumberOfUpdates(void) const;
+
+    enum { NUM_WORDS = sizeof(osaUniversalRobotSnapshotData) / 8, MAX_READ_ATTEMPTS = 1024 };
+
+protected:
+    // Layout of the snapshot memory
+    struct Block {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t DataSize;
+        std::atomic<uint64_t> Sequence;     // Odd while the data is written
+        std::atomic<uint64_t> Words[NUM_WORDS];
+    };
+
+    static void Initialize(Block &block);
+
+    Block *Memory;               // Block in use
+    Block Local;                 // Process memory block
+    void *Mapping;               // Shared memory, 0 if not used
+    std::string SharedName;      // Set if the shared memory object was created
+};
+
+#endif // _osaUniversalRobotSnapshot_h
@@ -0,0 +1,130 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotStreamFramer_h
+#define _osaUniversalRobotStreamFramer_h
+
+#include <cstddef>
+#include <vector>
+
+class osaSocket;
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Reassembles length-prefixed frames from a TCP byte stream.
+
+  Bytes are received into a power-of-two ring buffer that can hold several
+  frames, so that a burst of packets (e.g., after the receiving thread was
+  delayed) is not lost.  Each frame starts with a big-endian length field
+  (including the length field itself).  When the length field is outside the
+  valid range, the framer discards one byte at a time until it finds a valid
+  header again, rather than flushing the socket.
+
+  With the ALL_FRAMES policy, NextFrame returns every complete frame in order;
+  when the ring is full, Receive stops reading and leaves the rest of the burst
+  in the kernel buffer.  With NEWEST_FRAME, older complete frames are skipped
+  (and counted as coalesced) so that only the most recent one is returned, and
+  the oldest frames are dropped when the ring is full. */
+class CISST_EXPORT osaUniversalRobotStreamFramer
+{
+public:
+    enum FramePolicy { ALL_FRAMES, NEWEST_FRAME };
+
+    struct Statistics {
+        unsigned long FramesReceived;   // Complete frames found in the stream
+        unsigned long FramesDelivered;  // Frames returned by NextFrame
+        unsigned long FramesCoalesced;  // Frames skipped by the NEWEST_FRAME policy
+        unsigned long FramesDropped;    // Frames discarded because the ring was full
+        unsigned long Resyncs;          // Number of times an invalid header was found
+        unsigned long BytesDiscarded;   // Bytes discarded while resynchronizing
+        unsigned long LastInvalidLength;
+    };
+
+    // capacity is rounded up to a power of two; headerSize is 2 or 4 bytes
+    osaUniversalRobotStreamFramer(size_t capacity = 8192, size_t headerSize = 4);
+
+    // Set the range of valid frame lengths (header included)
+    void SetLengthRange(unsigned long minLength, unsigned long maxLength);
+
+    void SetPolicy(FramePolicy policy)
+    { Policy = policy; }
+
+    FramePolicy GetPolicy(void) const
+    { return Policy; }
+
+    // Discard all buffered data (statistics are preserved)
+    void Reset(void);
+
+    // Discard the complete frames before the most recent one, e.g., data buffered
+    // by the kernel before the stream was read (not counted in the statistics)
+    void KeepNewest(void);
+
+    // Make room for a complete frame before writing, according to the frame policy.
+    // Returns false if nothing can be written until NextFrame has returned frames.
+    bool PrepareWrite(void);
+    // Contiguous free space in the ring, to receive directly into it
+    char * WritePointer(void);
+    size_t WriteAvailable(void) const;
+    // Mark numBytes as written at WritePointer
+    void Commit(size_t numBytes);
+
+    // Receive as many bytes as the socket has available.  The first receive waits
+    // up to timeoutSec; following ones do not block.  Returns the number of bytes
+    // received, 0 on timeout (or if the ring is full of frames with the ALL_FRAMES
+    // policy) and -1 on socket error.
+    int Receive(osaSocket &socket, double timeoutSec);
+
+    // Get the next complete frame, according to the frame policy.  The frame
+    // remains valid until the next call to Commit, Receive or Reset.
+    bool NextFrame(const char *&frame, unsigned long &length);
+
+    // True if a complete frame is buffered at the read position
+    bool HasFrame(void) const
+    { unsigned long length; return FrameAt(0, length); }
+
+    // Number of bytes buffered but not yet returned as frames
+    size_t Size(void) const
+    { return static_cast<size_t>(Tail - Head); }
+
+    const Statistics & GetStatistics(void) const
+    { return Stats; }
+
+protected:
+    // Copy numBytes starting at offset (from Head) into dest, handling wrap-around
+    void Peek(size_t offset, size_t numBytes, char *dest) const;
+    // Check if there is a complete frame at Head (after resynchronizing if needed)
+    bool FrameAvailable(unsigned long &length);
+    // Check if there is a complete, valid frame at offset from Head, without consuming data
+    bool FrameAt(size_t offset, unsigned long &length) const;
+    unsigned long HeaderLength(size_t offset) const;
+    // Drop the oldest frames until at least numBytes are free (NEWEST_FRAME policy)
+    void MakeRoom(size_t numBytes);
+
+    std::vector<char> Ring;
+    std::vector<char> Scratch;   // For frames that wrap around the end of the ring
+    size_t Mask;
+    size_t HeaderSize;
+    // Read and write positions; these only increase, the ring index is (position & Mask)
+    unsigned long Head;
+    unsigned long Tail;
+    unsigned long MinLength;
+    unsigned long MaxLength;
+    FramePolicy Policy;
+    bool InResync;
+    Statistics Stats;
+};
+
+#endif // _osaUniversalRobotStreamFramer_h
@@ -0,0 +1,141 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotTelemetry_h
+#define _osaUniversalRobotTelemetry_h
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <cisstOSAbstraction/osaThread.h>
+#include <cisstOSAbstraction/osaThreadSignal.h>
+#include <sawUniversalRobot/osaUniversalRobotFrameSink.h>
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+#include <sawUniversalRobot/osaUniversalRobotSPSCQueue.h>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Columnar export of the port 30003 packet fields, for analytics.
+
+  For each frame, the selected fields (see
+  osaUniversalRobotPacketDecoder::GetFields, all by default) are converted to
+  host byte order and stored, with the receive time, in the columns of a
+  preallocated chunk.  Full chunks are written to the file by a separate
+  thread, which also compresses them (zlib, if available), so that the
+  receiving thread only copies values.  If the writer does not keep up, rows
+  are dropped and counted.
+
+  The schema is set by the first frame: frames of other firmware versions are
+  ignored.  File format (host byte order, i.e., little-endian on x86):
+    header:  "URTELEM1", uint32 format version (1), uint32 firmware version,
+             uint32 rows per chunk, uint32 number of columns, then for each
+             column: uint8 type (0: float64, 1: uint64), uint8 name length, name
+    chunks:  "CHNK", uint32 number of rows, uint32 compression (0: none, 1: zlib),
+             uint32 reserved, uint64 payload size, uint64 uncompressed size,
+             payload: the columns one after the other, 8 bytes per value
+  The first column is "receive_time" (host monotonic time); fields with
+  several values are split in columns "name[0]", "name[1]", ... */
+class CISST_EXPORT osaUniversalRobotTelemetry : public osaUniversalRobotFrameSink
+{
+public:
+    osaUniversalRobotTelemetry(void);
+
+    ~osaUniversalRobotTelemetry();
+
+    enum { MAX_CHUNKS = 64 };
+
+    // fields are field names (empty for all); compressionLevel is the zlib level
+    // (0 for no compression); numChunks is at most MAX_CHUNKS.  All buffers are
+    // allocated here.
+    bool Open(const std::string &filename,
+              const std::vector<std::string> &fields = std::vector<std::string>(),
+              size_t rowsPerChunk = 1000, int compressionLevel = 0, size_t numChunks = 4);
+
+    // Write the current chunk and close the file; must not be called while frames
+    // are received
+    void Close(void);
+
+    bool IsOpen(void) const
+    { return (File != 0); }
+
+    // Receiving thread
+    void Frame(const char *frame, unsigned long length, double receiveTime);
+
+    unsigned long long GetRowsWritten(void) const
+    { return RowsWritten; }
+
+    // Rows lost because the writer thread did not keep up
+    unsigned long long GetRowsDropped(void) const
+    { return RowsDropped; }
+
+    // Frames of another firmware version than the first frame
+    unsigned long long GetFramesIgnored(void) const
+    { return FramesIgnored; }
+
+    // True if the library was compiled with zlib
+    static bool CompressionAvailable(void);
+
+protected:
+    static const size_t NO_CHUNK = static_cast<size_t>(-1);
+
+    struct Chunk {
+        std::vector<uint64_t> Values;   // Column-major, RowsPerChunk values per column
+        size_t Rows;
+    };
+
+    // True if the field is selected
+    bool Selected(const char *name) const;
+    // Select the columns for the version of the first frame
+    void SetSchema(osaUniversalRobotPacketDecoder::FirmwareVersion version);
+    // Hand the current chunk to the writer thread
+    void PushChunk(void);
+
+    void * RunThread(void *);
+    void WriteHeader(void);
+    void WriteChunk(const Chunk &chunk);
+
+    std::vector<std::string> FieldNames;
+    size_t RowsPerChunk;
+    int CompressionLevel;
+
+    // Schema (set by the first frame)
+    osaUniversalRobotPacketDecoder::FirmwareVersion Version;
+    std::vector<unsigned short> ColumnOffsets;          // Offset in the packet of each field column
+    size_t NumColumns;                                  // Including receive_time
+
+    std::vector<Chunk> Chunks;
+    osaUniversalRobotSPSCQueue<size_t> FullChunks;      // Receiving thread to writer
+    osaUniversalRobotSPSCQueue<size_t> FreeChunks;      // Writer to receiving thread
+    size_t Current;
+
+    // Writer thread
+    std::FILE *File;
+    bool HeaderWritten;
+    std::vector<char> RawBuffer;
+    std::vector<char> CompressedBuffer;
+    osaThread Thread;
+    osaThreadSignal ChunkReady;
+    std::atomic<bool> StopRequested;
+    std::atomic<bool> Running;
+
+    std::atomic<unsigned long long> RowsWritten;
+    std::atomic<unsigned long long> RowsDropped;
+    std::atomic<unsigned long long> FramesIgnored;
+};
+
+#endif // _osaUniversalRobotTelemetry_h
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+#ifndef _osaUniversalRobotTrajectory_h
+#define _osaUniversalRobotTrajectory_h
+
+#include <cstddef>
+#include <vector>
+
+// Always include last
+#include <sawUniversalRobot/sawUniversalRobotExport.h>
+
+/*! Jerk-limited trajectory through waypoints, in joint space or Cartesian
+  space, evaluated every controller cycle to stream servoj setpoints.
+
+  Each segment between two waypoints is a straight line (joint positions,
+  or position and rotation about a fixed axis) with a time-optimal
+  double-S profile (bounded jerk, acceleration and velocity, starting and
+  ending at rest): the limits of each axis are scaled by the length of the
+  segment along that axis and the smallest ones are used, so all the axes
+  start and stop together.  With blend > 0, a segment starts before the
+  previous one ends (up to its whole deceleration for blend = 1) and the
+  two motions add up, so the robot does not stop at the waypoint.  The
+  limits hold during a blend for axes that keep their direction; for axes
+  that reverse, the accelerations of the two segments can add up.
+
+  Waypoints and limits are set by SetJoint or SetCartesian, which allocate;
+  Evaluate does not. */
+class CISST_EXPORT osaUniversalRobotTrajectory
+{
+public:
+    enum Space { JOINT, CARTESIAN };
+
+    osaUniversalRobotTrajectory(void);
+
+    /*! Trajectory from the joint positions start through numWaypoints
+      waypoints (row-major, 6 joint positions each), with per-joint
+      velocity, acceleration and jerk limits.  Returns false if a limit is
+      not positive. */
+    bool SetJoint(const double start[6], const double *waypoints, size_t numWaypoints,
+                  const double velocity[6], const double acceleration[6], const double jerk[6],
+                  double blend = 0.0);
+
+    /*! Trajectory from the tool pose start through numWaypoints poses
+      (x, y, z, rx, ry, rz each); limits are linear (index 0, m/s...) and
+      angular (index 1, rad/s...).  Returns false if a limit is not
+      positive. */
+    bool SetCartesian(const double start[6], const double *waypoints, size_t numWaypoints,
+                      const double velocity[2], const double acceleration[2], const double jerk[2],
+                      double blend = 0.0);
+
+    void Clear(void);
+
+    // True from SetJoint or SetCartesian to Clear
+    bool IsActive(void) const
+    { return Active; }
+
+    Space GetSpace(void) const
+    { return TrajectorySpace; }
+
+    // Time from start to the last waypoint
+    double GetDuration(void) const
+    { return Duration; }
+
+    size_t GetNumberOfWaypoints(void) const
+    { return NumWaypoints; }
+
+    /*! Setpoint (joint positions, or x, y, z, rx, ry, rz) at time from the
+      start, clamped to [0, duration].  Time must not decrease from one
+      call to the next. */
+    void Evaluate(double time, double setpoint[6]);
+
+    // Waypoints reached at the last Evaluate (all of them once the duration is over)
+    size_t GetWaypointsReached(void) const
+    { return WaypointsReached; }
+
+protected:
+    // Double-S profile from 0 to 1 (see Biagiotti and Melchiorri, Trajectory Planning
+    // for Automatic Machines and Robots, 2008)
+    class Profile {
+    public:
+        void Compute(double velocity, double acceleration, double jerk);
+        double Position(double time) const;
+        double Duration;
+        double AccelerationTime;     // Ta, also the deceleration time
+        double JerkTime;             // Tj
+        double CruiseTime;           // Tv
+        double Jerk;
+        double MaxAcceleration;      // Reached, i.e., jerk * Tj
+        double MaxVelocity;          // Reached
+    protected:
+        double AccelerationPhase(double time) const;
+    };
+
+    class Segment {
+    public:
+        // Joint displacement, or translation and rotation (axis-angle, in the
+        // frame of the previous waypoint)
+        double Delta[6];
+        double Start;
+        Profile Shape;
+    };
+
+    // Add a segment after the previous one, overlapping it by blend
+    void AddSegment(const double delta[6], double velocity, double acceleration, double jerk, double blend);
+
+    // Add the displacement of a segment at s (0 to 1) to the current position
+    void Apply(const Segment &segment, double s, double position[6], double rotation[9]) const;
+
+    bool Active;
+    Space TrajectorySpace;
+    size_t NumWaypoints;
+    double Duration;
+    std::vector<Segment> Segments;
+
+    // Position (and row-major rotation in Cartesian space) at the end of the
+    // completed segments, i.e., before FirstActive
+    double BasePosition[6];
+    double BaseRotation[9];
+    size_t FirstActive;
+    size_t WaypointsReached;
+};
+
+#endif // _osaUniversalRobotTrajectory_h
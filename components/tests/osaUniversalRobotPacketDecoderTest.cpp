@@ -0,0 +1,245 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+// Decodes packets of each firmware version, built byte by byte from the
+// offsets documented by Universal Robots (not from the decoder tables), and
+// checks every field of the sample.  Returns the number of failures.
+
+#include <stddef.h>
+#include <string.h>
+#include <iostream>
+
+#include <sawUniversalRobot/osaUniversalRobotPacketDecoder.h>
+
+typedef osaUniversalRobotPacketDecoder Decoder;
+
+// A packet field: Count big-endian values at Offset, decoded in the sample
+// member at SampleOffset; 64-bit integers if Bits is true
+struct FieldCase {
+    const char *Name;
+    unsigned long Offset;
+    size_t Count;
+    size_t SampleOffset;
+    bool Bits;
+};
+
+#define FIELD(_name, _offset, _count, _member) \
+    { _name, _offset, _count, offsetof(osaUniversalRobotSample, _member), false }
+#define BITS(_name, _offset, _member) \
+    { _name, _offset, 1, offsetof(osaUniversalRobotSample, _member), true }
+
+// Common to all versions
+#define BASE_FIELDS \
+    FIELD("time",        4, 1, Time), \
+    FIELD("q_target",   12, 6, JointTargetPosition), \
+    FIELD("qd_target",  60, 6, JointTargetVelocity), \
+    FIELD("qdd_target", 108, 6, JointTargetAcceleration), \
+    FIELD("i_target",   156, 6, JointTargetCurrent), \
+    FIELD("m_target",   204, 6, JointTargetTorque), \
+    FIELD("q_actual",   252, 6, JointPosition), \
+    FIELD("qd_actual",  300, 6, JointVelocity), \
+    FIELD("i_actual",   348, 6, JointCurrent), \
+    BITS("digital_inputs",      684, DigitalInputs), \
+    FIELD("motor_temperatures", 692, 6, MotorTemperature), \
+    FIELD("controller_time",    740, 1, ControllerExecTime), \
+    FIELD("robot_mode",         756, 1, RobotMode)
+
+#define PRE_3_FIELDS \
+    FIELD("tool_accelerometer", 396, 3, ToolAccelerometer), \
+    FIELD("tcp_force",          540, 6, TCPForce), \
+    FIELD("tool_vector",        588, 6, ToolVector), \
+    FIELD("tcp_speed",          636, 6, TCPSpeed)
+
+#define PACKET_3_FIELDS \
+    FIELD("joint_modes",          764, 6, JointMode), \
+    FIELD("i_control",            396, 6, JointControlCurrent), \
+    FIELD("tool_vector_actual",   444, 6, ToolVector), \
+    FIELD("tcp_speed_actual",     492, 6, TCPSpeed), \
+    FIELD("tcp_force",            540, 6, TCPForce), \
+    FIELD("tool_vector_target",   588, 6, ToolTargetVector), \
+    FIELD("tcp_speed_target",     636, 6, TCPTargetSpeed), \
+    FIELD("safety_mode",          812, 1, SafetyMode), \
+    FIELD("tool_accelerometer",   868, 3, ToolAccelerometer), \
+    FIELD("speed_scaling",        940, 1, SpeedScaling), \
+    FIELD("linear_momentum_norm", 948, 1, LinearMomentumNorm), \
+    FIELD("v_main",               972, 1, MainVoltage), \
+    FIELD("v_robot",              980, 1, RobotVoltage), \
+    FIELD("i_robot",              988, 1, RobotCurrent), \
+    FIELD("v_joint_actual",       996, 6, JointVoltage)
+
+static const FieldCase FieldsPre18[] = {
+    BASE_FIELDS,
+    PRE_3_FIELDS
+};
+
+static const FieldCase Fields18[] = {
+    BASE_FIELDS,
+    PRE_3_FIELDS,
+    FIELD("joint_modes", 764, 6, JointMode)
+};
+
+static const FieldCase Fields3031[] = {
+    BASE_FIELDS,
+    PACKET_3_FIELDS
+};
+
+static const FieldCase Fields32[] = {
+    BASE_FIELDS,
+    PACKET_3_FIELDS,
+    BITS("digital_outputs", 1044, DigitalOutputs),
+    FIELD("program_state",  1052, 1, ProgramState)
+};
+
+#define NB_FIELDS(_table) (sizeof(_table) / sizeof(_table[0]))
+
+struct PacketCase {
+    Decoder::FirmwareVersion Version;
+    unsigned long Length;
+    const FieldCase *Fields;
+    size_t NumFields;
+};
+
+static const PacketCase Packets[] = {
+    { Decoder::VER_PRE_18,  764, FieldsPre18, NB_FIELDS(FieldsPre18) },
+    { Decoder::VER_18,      812, Fields18,    NB_FIELDS(Fields18) },
+    { Decoder::VER_30_31,  1044, Fields3031,  NB_FIELDS(Fields3031) },
+    { Decoder::VER_32,     1060, Fields32,    NB_FIELDS(Fields32) }
+};
+
+static const size_t MAX_LENGTH = 1060;
+static const size_t SAMPLE_SIZE = sizeof(osaUniversalRobotSample) / sizeof(double);
+
+static void StoreBigEndian(char *p, unsigned long long bits, size_t size)
+{
+    for (size_t i = size; i > 0; i--) {
+        p[i-1] = static_cast<char>(bits & 0xff);
+        bits >>= 8;
+    }
+}
+
+// Distinct values for each element, with different upper and lower 32 bits
+static double DoubleValue(size_t field, size_t element)
+{
+    return (field + 1) * 10.0 + element + 1.0 / 3.0;
+}
+
+static unsigned long long BitsValue(size_t field)
+{
+    return 0x0001000200030004ULL + field;
+}
+
+static int Check(const PacketCase &packet, const char *what, bool condition)
+{
+    if (condition)
+        return 0;
+    std::cerr << "packet " << packet.Length << ": " << what << std::endl;
+    return 1;
+}
+
+// Build the packet with a distinct value in each field and check the decoded sample
+static int TestDecode(const PacketCase &packet)
+{
+    int failures = 0;
+    char buffer[MAX_LENGTH];
+    memset(buffer, 0, sizeof(buffer));
+    StoreBigEndian(buffer, packet.Length, 4);
+
+    // Expected sample: fields not in the packet are 0
+    double expected[SAMPLE_SIZE];
+    for (size_t i = 0; i < SAMPLE_SIZE; i++)
+        expected[i] = 0.0;
+    for (size_t f = 0; f < packet.NumFields; f++) {
+        const FieldCase &field = packet.Fields[f];
+        for (size_t i = 0; i < field.Count; i++) {
+            double value;
+            unsigned long long bits;
+            if (field.Bits) {
+                bits = BitsValue(f);
+                value = static_cast<double>(bits);
+            } else {
+                value = DoubleValue(f, i);
+                memcpy(&bits, &value, sizeof(bits));
+            }
+            StoreBigEndian(buffer + field.Offset + 8 * i, bits, 8);
+            expected[field.SampleOffset / sizeof(double) + i] = value;
+        }
+    }
+
+    // Sample filled with garbage, to check that missing fields are reset
+    osaUniversalRobotSample sample;
+    memset(&sample, 0xff, sizeof(sample));
+
+    failures += Check(packet, "header length",
+                      Decoder::PacketLengthFromHeader(buffer) == packet.Length);
+    failures += Check(packet, "version from length",
+                      Decoder::VersionFromLength(packet.Length) == packet.Version);
+
+    Decoder decoder;
+    osaUniversalRobotDecodedPacket decoded;
+    decoder.DecodePacket(buffer, packet.Length, decoded);
+    failures += Check(packet, "decoded", decoded.Decoded);
+    failures += Check(packet, "detected version", decoded.Version == packet.Version);
+    if (!decoded.Decoded)
+        return failures;
+
+    if (!decoder.Decode(buffer, packet.Length, sample))
+        return failures + Check(packet, "decode", false);
+    const double *actual = reinterpret_cast<const double *>(&sample);
+    for (size_t i = 0; i < SAMPLE_SIZE; i++) {
+        if (actual[i] != expected[i]) {
+            std::cerr << "packet " << packet.Length << ": sample word " << i << " is "
+                      << actual[i] << ", expected " << expected[i] << std::endl;
+            failures++;
+        }
+    }
+
+    // Shorter packets are rejected
+    failures += Check(packet, "short packet rejected",
+                      !decoder.Decode(buffer, packet.Length - 8, sample));
+
+    // Encode is the inverse of Decode
+    char encoded[MAX_LENGTH];
+    failures += Check(packet, "encode",
+                      Decoder::Encode(packet.Version, decoded.Sample, encoded, sizeof(encoded)));
+    osaUniversalRobotSample roundTrip;
+    failures += Check(packet, "decode encoded", decoder.Decode(encoded, packet.Length, roundTrip));
+    failures += Check(packet, "round trip",
+                      memcmp(&roundTrip, &decoded.Sample, sizeof(roundTrip)) == 0);
+    return failures;
+}
+
+int main(void)
+{
+    int failures = 0;
+    for (size_t p = 0; p < NB_FIELDS(Packets); p++)
+        failures += TestDecode(Packets[p]);
+
+    // Unknown lengths are not decoded
+    Decoder decoder;
+    char buffer[MAX_LENGTH];
+    memset(buffer, 0, sizeof(buffer));
+    osaUniversalRobotDecodedPacket decoded;
+    decoder.DecodePacket(buffer, 1000, decoded);
+    if (decoded.Decoded || (decoded.Version != Decoder::VER_UNKNOWN)) {
+        std::cerr << "packet 1000: unknown length decoded" << std::endl;
+        failures++;
+    }
+
+    if (failures == 0)
+        std::cout << "osaUniversalRobotPacketDecoderTest: all tests passed" << std::endl;
+    else
+        std::cout << "osaUniversalRobotPacketDecoderTest: " << failures << " failure(s)" << std::endl;
+    return failures;
+}
@@ -0,0 +1,238 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-    */
+/* ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab: */
+
+/*
+  (C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+// Feeds bursts of frames to the framer, in chunks written the same way
+// Receive writes the bytes of the socket, and checks the frames returned
+// and the statistics of each frame policy.  Returns the number of failures.
+
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#include <sawUniversalRobot/osaUniversalRobotStreamFramer.h>
+
+typedef osaUniversalRobotStreamFramer Framer;
+
+// Same configuration as the component for port 30003
+static const size_t CAPACITY = 8192;
+static const unsigned long MIN_LENGTH = 764;
+static const unsigned long MAX_LENGTH = 4096;
+static const unsigned long LENGTH = 1060;
+
+// Bytes sent by the controller and not received yet
+struct Stream {
+    std::vector<char> Bytes;
+    size_t Position;
+    Stream(void) : Position(0) {}
+    size_t Remaining(void) const
+    { return Bytes.size() - Position; }
+};
+
+// Frame with its length in the header, then bytes that depend on the frame index
+static void AddFrame(Stream &stream, unsigned long length, unsigned char index)
+{
+    stream.Bytes.push_back(static_cast<char>((length >> 24) & 0xff));
+    stream.Bytes.push_back(static_cast<char>((length >> 16) & 0xff));
+    stream.Bytes.push_back(static_cast<char>((length >> 8) & 0xff));
+    stream.Bytes.push_back(static_cast<char>(length & 0xff));
+    for (unsigned long i = 4; i < length; i++)
+        stream.Bytes.push_back(static_cast<char>(index + i));
+}
+
+static bool CheckFrame(const char *frame, unsigned long length, unsigned char index)
+{
+    if (length != LENGTH)
+        return false;
+    for (unsigned long i = 4; i < length; i++)
+        if (frame[i] != static_cast<char>(index + i))
+            return false;
+    return true;
+}
+
+// Same loop as Receive, at most chunkSize bytes per read; returns the number of bytes
+static size_t Receive(Framer &framer, Stream &stream, size_t chunkSize)
+{
+    size_t total = 0;
+    while ((stream.Remaining() > 0) && framer.PrepareWrite()) {
+        size_t numBytes = framer.WriteAvailable();
+        if (numBytes > chunkSize)
+            numBytes = chunkSize;
+        if (numBytes > stream.Remaining())
+            numBytes = stream.Remaining();
+        memcpy(framer.WritePointer(), &stream.Bytes[stream.Position], numBytes);
+        framer.Commit(numBytes);
+        stream.Position += numBytes;
+        total += numBytes;
+    }
+    return total;
+}
+
+static int Check(const char *test, const char *what, bool condition)
+{
+    if (condition)
+        return 0;
+    std::cerr << test << ": " << what << std::endl;
+    return 1;
+}
+
+// Burst of frames with the ALL_FRAMES policy: all of them are returned, in order
+static int TestAllFrames(size_t numFrames, size_t chunkSize)
+{
+    int failures = 0;
+    Framer framer(CAPACITY);
+    framer.SetLengthRange(MIN_LENGTH, MAX_LENGTH);
+    Stream stream;
+    for (size_t i = 0; i < numFrames; i++)
+        AddFrame(stream, LENGTH, static_cast<unsigned char>(i));
+
+    size_t next = 0;
+    bool inOrder = true;
+    do {
+        Receive(framer, stream, chunkSize);
+        const char *frame;
+        unsigned long length;
+        while (framer.NextFrame(frame, length)) {
+            inOrder = inOrder && CheckFrame(frame, length, static_cast<unsigned char>(next));
+            next++;
+        }
+    } while (stream.Remaining() > 0);
+    const Framer::Statistics &stats = framer.GetStatistics();
+    failures += Check("all frames", "frames returned in order", inOrder);
+    failures += Check("all frames", "all frames returned", next == numFrames);
+    failures += Check("all frames", "received", stats.FramesReceived == numFrames);
+    failures += Check("all frames", "delivered", stats.FramesDelivered == numFrames);
+    failures += Check("all frames", "dropped", stats.FramesDropped == 0);
+    failures += Check("all frames", "coalesced", stats.FramesCoalesced == 0);
+    failures += Check("all frames", "data left", framer.Size() == 0);
+    return failures;
+}
+
+// Burst of frames with the NEWEST_FRAME policy: only the last one is returned,
+// the others are coalesced or dropped
+static int TestNewestFrame(size_t numFrames)
+{
+    int failures = 0;
+    Framer framer(CAPACITY);
+    framer.SetLengthRange(MIN_LENGTH, MAX_LENGTH);
+    framer.SetPolicy(Framer::NEWEST_FRAME);
+    Stream stream;
+    for (size_t i = 0; i < numFrames; i++)
+        AddFrame(stream, LENGTH, static_cast<unsigned char>(i));
+
+    Receive(framer, stream, stream.Bytes.size());
+    const char *frame;
+    unsigned long length;
+    failures += Check("newest frame", "frame returned", framer.NextFrame(frame, length));
+    failures += Check("newest frame", "newest",
+                      CheckFrame(frame, length, static_cast<unsigned char>(numFrames - 1)));
+    failures += Check("newest frame", "single frame", !framer.NextFrame(frame, length));
+    const Framer::Statistics &stats = framer.GetStatistics();
+    failures += Check("newest frame", "received", stats.FramesReceived == numFrames);
+    failures += Check("newest frame", "delivered", stats.FramesDelivered == 1);
+    failures += Check("newest frame", "coalesced and dropped",
+                      stats.FramesCoalesced + stats.FramesDropped == numFrames - 1);
+    return failures;
+}
+
+// Invalid bytes before a frame are skipped, one resynchronization is counted
+static int TestResync(void)
+{
+    int failures = 0;
+    Framer framer(CAPACITY);
+    framer.SetLengthRange(MIN_LENGTH, MAX_LENGTH);
+    Stream stream;
+    for (size_t i = 0; i < 5; i++)
+        stream.Bytes.push_back(static_cast<char>(0xff));
+    AddFrame(stream, LENGTH, 0);
+    AddFrame(stream, LENGTH, 1);
+
+    Receive(framer, stream, stream.Bytes.size());
+    const char *frame;
+    unsigned long length;
+    failures += Check("resync", "first frame",
+                      framer.NextFrame(frame, length) && CheckFrame(frame, length, 0));
+    failures += Check("resync", "second frame",
+                      framer.NextFrame(frame, length) && CheckFrame(frame, length, 1));
+    const Framer::Statistics &stats = framer.GetStatistics();
+    failures += Check("resync", "resyncs", stats.Resyncs == 1);
+    failures += Check("resync", "bytes discarded", stats.BytesDiscarded == 5);
+    failures += Check("resync", "invalid length", stats.LastInvalidLength == 0xffffffffUL);
+    return failures;
+}
+
+// A frame is only returned once all its bytes are received
+static int TestPartialFrame(void)
+{
+    int failures = 0;
+    Framer framer(CAPACITY);
+    framer.SetLengthRange(MIN_LENGTH, MAX_LENGTH);
+    Stream stream;
+    AddFrame(stream, LENGTH, 0);
+
+    const char *frame;
+    unsigned long length;
+    bool early = false;
+    for (size_t i = 0; i < LENGTH; i++) {
+        early = early || framer.HasFrame() || framer.NextFrame(frame, length);
+        framer.PrepareWrite();
+        *framer.WritePointer() = stream.Bytes[i];
+        framer.Commit(1);
+    }
+    failures += Check("partial frame", "returned before complete", !early);
+    failures += Check("partial frame", "complete frame",
+                      framer.NextFrame(frame, length) && CheckFrame(frame, length, 0));
+    return failures;
+}
+
+// KeepNewest discards the complete frames before the newest one
+static int TestKeepNewest(void)
+{
+    int failures = 0;
+    Framer framer(CAPACITY);
+    framer.SetLengthRange(MIN_LENGTH, MAX_LENGTH);
+    Stream stream;
+    for (size_t i = 0; i < 3; i++)
+        AddFrame(stream, LENGTH, static_cast<unsigned char>(i));
+
+    Receive(framer, stream, stream.Bytes.size());
+    framer.KeepNewest();
+    const char *frame;
+    unsigned long length;
+    failures += Check("keep newest", "newest frame",
+                      framer.NextFrame(frame, length) && CheckFrame(frame, length, 2));
+    failures += Check("keep newest", "single frame", !framer.NextFrame(frame, length));
+    return failures;
+}
+
+int main(void)
+{
+    int failures = 0;
+    // Bursts larger than the ring, read in one or many chunks
+    failures += TestAllFrames(1, 8192);
+    failures += TestAllFrames(8, 8192);
+    failures += TestAllFrames(20, 8192);
+    failures += TestAllFrames(20, 100);
+    failures += TestNewestFrame(8);
+    failures += TestNewestFrame(20);
+    failures += TestResync();
+    failures += TestPartialFrame();
+    failures += TestKeepNewest();
+
+    if (failures == 0)
+        std::cout << "osaUniversalRobotStreamFramerTest: all tests passed" << std::endl;
+    else
+        std::cout << "osaUniversalRobotStreamFramerTest: " << failures << " failure(s)" << std::endl;
+    return failures;
+}
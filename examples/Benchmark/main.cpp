@@ -0,0 +1,558 @@
+/*-*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-   */
+/*ex: set filetype=cpp softtabstop=4 shiftwidth=4 tabstop=4 cindent expandtab:*/
+
+/*
+(C) Copyright 2016-2017 Johns Hopkins University (JHU), All Rights Reserved.
+
+--- begin cisst license - do not edit ---
+
+This software is provided "as is" under an open source license, with
+no warranty.  The complete license can be found in license.txt and
+http://www.cisst.org/cisst/license.txt.
+
+--- end cisst license ---
+*/
+
+// Latency and throughput benchmarks of mtsUniversalRobotScriptRT, using the
+// simulator on the loopback interface.  Results are printed and optionally
+// saved in a JSON file for regression tracking.
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <cisstCommon/cmnLogger.h>
+#include <cisstCommon/cmnCommandLineOptions.h>
+#include <cisstOSAbstraction/osaSleep.h>
+#include <cisstMultiTask/mtsManagerLocal.h>
+#include <cisstMultiTask/mtsTaskContinuous.h>
+#include <cisstMultiTask/mtsInterfaceRequired.h>
+#include <sawUniversalRobot/mtsUniversalRobotScriptRT.h>
+#include <sawUniversalRobot/osaUniversalRobotClock.h>
+#include <sawUniversalRobot/osaUniversalRobotLatencyHistogram.h>
+#include <sawUniversalRobot/osaUniversalRobotKinematics.h>
+#include <sawUniversalRobot/osaUniversalRobotJointPath.h>
+#include <sawUniversalRobot/osaUniversalRobotPoseConverter.h>
+#include <sawUniversalRobot/osaUniversalRobotRecorder.h>
+#include <sawUniversalRobot/osaUniversalRobotSimulator.h>
+
+// Percentiles of a histogram, as a JSON object
+static std::string Summary(const osaUniversalRobotLatencyHistogram &histogram)
+{
+    std::ostringstream json;
+    json << std::setprecision(9)
+         << "{ \"count\": " << histogram.Count()
+         << ", \"p50\": " << histogram.Percentile(0.5)
+         << ", \"p99\": " << histogram.Percentile(0.99)
+         << ", \"p99.9\": " << histogram.Percentile(0.999)
+         << ", \"max\": " << histogram.Maximum() << " }";
+    return json.str();
+}
+
+// Same, from the [count, p50, p99, p99.9, max] vector returned by the component
+static std::string Summary(const vctDoubleVec &latency)
+{
+    std::ostringstream json;
+    json << std::setprecision(9)
+         << "{ \"count\": " << latency[0] << ", \"p50\": " << latency[1]
+         << ", \"p99\": " << latency[2] << ", \"p99.9\": " << latency[3]
+         << ", \"max\": " << latency[4] << " }";
+    return json.str();
+}
+
+static void PrintLatency(const std::string &name, double count, double p50, double p99,
+                         double p999, double max)
+{
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+              << std::setw(9) << static_cast<unsigned long>(count)
+              << std::setprecision(1)
+              << std::setw(10) << 1.0e6 * p50 << std::setw(10) << 1.0e6 * p99
+              << std::setw(10) << 1.0e6 * p999 << std::setw(10) << 1.0e6 * max
+              << " us" << std::endl;
+}
+
+// Reads the joint state as fast as possible in its own thread and measures the
+// time between the state table update and the read
+class BenchmarkReader : public mtsTaskContinuous
+{
+public:
+    osaUniversalRobotLatencyHistogram Latency;
+
+    BenchmarkReader(void) : mtsTaskContinuous("BenchmarkReader"), LastTimestamp(0.0)
+    {
+        mtsInterfaceRequired *required = AddInterfaceRequired("Robot");
+        if (required)
+            required->AddFunction("GetStateJoint", GetStateJoint);
+    }
+
+    void Startup(void) {}
+
+    void Run(void)
+    {
+        ProcessQueuedEvents();
+        GetStateJoint(State);
+        if (State.Timestamp() != LastTimestamp) {
+            const double now = mtsManagerLocal::GetInstance()->GetTimeServer().GetRelativeTime();
+            if (LastTimestamp != 0.0)
+                Latency.Add(now - State.Timestamp());
+            LastTimestamp = State.Timestamp();
+        }
+        // Short sleep, so that the reader does not use a full core
+        osaSleep(50.0 * cmn_us);
+    }
+
+    void Cleanup(void) {}
+
+protected:
+    mtsFunctionRead GetStateJoint;
+    prmStateJoint State;
+    double LastTimestamp;
+};
+
+// Sends commands and collects statistics from the main thread
+class BenchmarkClient : public mtsComponent
+{
+public:
+    mtsFunctionRead GetConnected;
+    mtsFunctionRead GetPositionJoint;
+    mtsFunctionWrite JointPositionMove;
+    mtsFunctionRead GetFramingStatistics;
+    mtsFunctionRead GetPublishLatency;
+    mtsFunctionRead GetQueueLatency;
+    mtsFunctionRead GetStartupTime;
+
+    BenchmarkClient(void) : mtsComponent("BenchmarkClient")
+    {
+        mtsInterfaceRequired *required = AddInterfaceRequired("Robot");
+        if (required) {
+            required->AddFunction("GetConnected", GetConnected);
+            required->AddFunction("GetPositionJoint", GetPositionJoint);
+            required->AddFunction("JointPositionMove", JointPositionMove);
+            required->AddFunction("GetFramingStatistics", GetFramingStatistics);
+            required->AddFunction("GetPublishLatency", GetPublishLatency);
+            required->AddFunction("GetQueueLatency", GetQueueLatency);
+            required->AddFunction("GetStartupTime", GetStartupTime);
+        }
+    }
+};
+
+// Decode time per packet for each firmware version (nanoseconds)
+static void BenchmarkDecode(unsigned long numPackets, std::ostream &json)
+{
+    const char *names[osaUniversalRobotPacketDecoder::VER_MAX] = { "", "pre-1.8", "1.8", "3.0/3.1", "3.2" };
+    osaUniversalRobotSample sample;
+    memset(&sample, 0, sizeof(sample));
+    for (size_t i = 0; i < 6; i++)
+        sample.JointPosition[i] = 0.1 * i;
+    std::vector<char> packet(osaUniversalRobotPacketDecoder::PacketLength[osaUniversalRobotPacketDecoder::VER_MAX-1]);
+
+    std::cout << std::endl << "Decode time per packet" << std::endl;
+    json << "  \"decode_ns\": {";
+    for (int version = osaUniversalRobotPacketDecoder::VER_PRE_18;
+         version < osaUniversalRobotPacketDecoder::VER_MAX; version++) {
+        const osaUniversalRobotPacketDecoder::FirmwareVersion ver =
+            static_cast<osaUniversalRobotPacketDecoder::FirmwareVersion>(version);
+        const unsigned long length = osaUniversalRobotPacketDecoder::PacketLength[ver];
+        osaUniversalRobotPacketDecoder::Encode(ver, sample, &packet[0], length);
+        osaUniversalRobotPacketDecoder decoder;
+        osaUniversalRobotDecodedPacket decoded;
+        double checksum = 0.0;
+        const double start = osaUniversalRobotMonotonicTime();
+        for (unsigned long i = 0; i < numPackets; i++) {
+            decoder.DecodePacket(&packet[0], length, decoded);
+            checksum += decoded.Sample.JointPosition[5];
+        }
+        const double nsPerPacket = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPackets;
+        std::cout << "  " << std::left << std::setw(10) << names[version] << std::right
+                  << std::setw(8) << std::setprecision(1) << std::fixed << nsPerPacket << " ns"
+                  << ((checksum < 0.0) ? " " : "") << std::endl;
+        json << ((version > 1) ? ", " : " ") << "\"" << names[version] << "\": " << nsPerPacket;
+    }
+    json << " },\n";
+}
+
+// Pose conversion time (nanoseconds): cisst temporaries (previous path),
+// direct kernel for a moving robot and cached rotation for an idle robot
+static void BenchmarkPose(unsigned long numPoses, std::ostream &json)
+{
+    double pose[6] = { 0.3, -0.2, 0.5, 0.1, 1.2, -0.7 };
+    double checksum = 0.0;
+    prmPositionCartesianGet position;
+
+    double start = osaUniversalRobotMonotonicTime();
+    for (unsigned long i = 0; i < numPoses; i++) {
+        pose[3] += 1.0e-9;
+        vct3 translation(pose);
+        vct3 orientation(pose + 3);
+        vctRodriguezRotation3<double> rodriguez(orientation);
+        vctDoubleRot3 rotation(rodriguez);
+        vctFrm3 frame(rotation, translation);
+        position.SetPosition(frame);
+        checksum += position.Position().Rotation().Element(0, 1);
+    }
+    const double nsCisst = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPoses;
+
+    osaUniversalRobotPoseConverter converter;
+    start = osaUniversalRobotMonotonicTime();
+    for (unsigned long i = 0; i < numPoses; i++) {
+        pose[3] += 1.0e-9;
+        converter.Update(pose);
+        checksum += converter.Rotation()[1];
+    }
+    const double nsMoving = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPoses;
+
+    start = osaUniversalRobotMonotonicTime();
+    for (unsigned long i = 0; i < numPoses; i++) {
+        converter.Update(pose);
+        checksum += converter.Rotation()[1];
+    }
+    const double nsIdle = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPoses;
+
+    std::cout << std::endl << "Pose conversion time" << std::endl
+              << std::setprecision(1) << std::fixed
+              << "  cisst     " << std::setw(8) << nsCisst << " ns" << std::endl
+              << "  moving    " << std::setw(8) << nsMoving << " ns" << std::endl
+              << "  idle      " << std::setw(8) << nsIdle << " ns"
+              << ((checksum < -1.0e9) ? " " : "") << std::endl;
+    json << "  \"pose_ns\": { \"cisst\": " << nsCisst << ", \"moving\": " << nsMoving
+         << ", \"idle\": " << nsIdle << " },\n";
+}
+
+// Host-side kinematics time (nanoseconds): forward kinematics alone and with
+// the Jacobian, and inverse kinematics (nearest branch), for each model
+static void BenchmarkKinematics(unsigned long numPoses, std::ostream &json)
+{
+    const char *models[] = { "UR3", "UR5", "UR10" };
+    const double tool[6] = { 0.0, 0.0, 0.1, 0.0, 0.0, 0.0 };
+    double q[6] = { 0.3, -1.1, 1.4, -0.5, 0.8, 2.0 };
+    double checksum = 0.0;
+
+    std::cout << std::endl << "Kinematics time (forward, forward and Jacobian, inverse)" << std::endl;
+    json << "  \"kinematics_ns\": {";
+    for (size_t model = 0; model < 3; model++) {
+        osaUniversalRobotKinematics kinematics;
+        kinematics.SetModel(models[model]);
+        kinematics.SetTool(tool);
+        double start = osaUniversalRobotMonotonicTime();
+        for (unsigned long i = 0; i < numPoses; i++) {
+            q[0] += 1.0e-9;
+            kinematics.Update(q, false);
+            checksum += kinematics.Translation()[0];
+        }
+        const double nsForward = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPoses;
+        start = osaUniversalRobotMonotonicTime();
+        for (unsigned long i = 0; i < numPoses; i++) {
+            q[0] += 1.0e-9;
+            kinematics.Update(q, true);
+            checksum += kinematics.Jacobian()[0];
+        }
+        const double nsJacobian = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPoses;
+        const double seed[6] = { 0.3, -1.1, 1.4, -0.5, 0.8, 2.0 };
+        double solution[6];
+        start = osaUniversalRobotMonotonicTime();
+        for (unsigned long i = 0; i < numPoses; i++) {
+            kinematics.Inverse(kinematics.Rotation(), kinematics.Translation(), seed, solution);
+            checksum += solution[0];
+        }
+        const double nsInverse = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPoses;
+        std::cout << "  " << std::left << std::setw(10) << models[model] << std::right
+                  << std::setprecision(1) << std::fixed
+                  << std::setw(8) << nsForward << " ns" << std::setw(8) << nsJacobian << " ns"
+                  << std::setw(8) << nsInverse << " ns"
+                  << ((checksum < -1.0e9) ? " " : "") << std::endl;
+        json << ((model > 0) ? ", " : " ") << "\"" << models[model] << "\": { \"forward\": "
+             << nsForward << ", \"jacobian\": " << nsJacobian << ", \"inverse\": " << nsInverse << " }";
+    }
+    json << " },\n";
+}
+
+// Time to check a dense joint path against the position and velocity limits, per
+// point (nanoseconds)
+static void BenchmarkPathCheck(unsigned long numPoints, std::ostream &json)
+{
+    osaUniversalRobotJointPath path;
+    path.Resize(numPoints);
+    for (unsigned long k = 0; k < numPoints; k++) {
+        path.Time()[k] = 0.002 * k;
+        for (size_t joint = 0; joint < 6; joint++)
+            path.Position(joint)[k] = std::sin(0.001 * k + joint);
+    }
+    const double positionLimits[6] = { 6.28, 6.28, 6.28, 6.28, 6.28, 6.28 };
+    const double velocityLimits[6] = { 3.14, 3.14, 3.14, 3.14, 3.14, 3.14 };
+    const unsigned long numPasses = 100;
+    size_t point, joint, numViolations = 0;
+    const double start = osaUniversalRobotMonotonicTime();
+    for (unsigned long i = 0; i < numPasses; i++) {
+        if (path.Check(positionLimits, velocityLimits, point, joint) != osaUniversalRobotJointPath::VALID)
+            numViolations++;
+    }
+    const double nsPoint = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / (numPasses * numPoints);
+    std::cout << std::endl << "Joint path check time" << std::endl
+              << std::setprecision(2) << std::fixed
+              << "  per point " << std::setw(8) << nsPoint << " ns"
+              << ((numViolations > 0) ? " (invalid path)" : "") << std::endl;
+    json << "  \"path_check_ns\": " << nsPoint << ",\n";
+}
+
+// Decode time per packet for the frames of a recording (nanoseconds)
+static void BenchmarkDecodeRecording(const std::string &filename, unsigned long numPasses, std::ostream &json)
+{
+    osaUniversalRobotReplay replay;
+    if (!replay.Open(filename) || (replay.GetNumberOfFrames() == 0)) {
+        std::cerr << "Error: no frames in recording \"" << filename << "\"" << std::endl;
+        return;
+    }
+    osaUniversalRobotPacketDecoder decoder;
+    osaUniversalRobotDecodedPacket decoded;
+    osaUniversalRobotReplay::Frame frame;
+    unsigned long numPackets = 0;
+    const double start = osaUniversalRobotMonotonicTime();
+    for (unsigned long pass = 0; pass < numPasses; pass++) {
+        for (replay.Rewind(); replay.Front(frame); replay.Pop()) {
+            decoder.DecodePacket(frame.Data, frame.Length, decoded);
+            numPackets++;
+        }
+    }
+    const double nsPerPacket = 1.0e9 * (osaUniversalRobotMonotonicTime() - start) / numPackets;
+    std::cout << "  recording " << std::setw(8) << std::setprecision(1) << std::fixed << nsPerPacket
+              << " ns (" << replay.GetNumberOfFrames() << " frames)" << std::endl;
+    json << "  \"decode_recording_ns\": " << nsPerPacket << ",\n";
+}
+
+int main(int argc, char **argv)
+{
+    cmnLogger::SetMask(CMN_LOG_ALLOW_ALL);
+    cmnLogger::SetMaskFunction(CMN_LOG_ALLOW_ALL);
+    cmnLogger::SetMaskDefaultLog(CMN_LOG_ALLOW_ALL);
+    cmnLogger::AddChannel(std::cerr, CMN_LOG_ALLOW_ERRORS_AND_WARNINGS);
+
+    double duration = 10.0;
+    double jitter = 0.0;
+    double fragment = 0.0;
+    double coalesce = 0.0;
+    int version = osaUniversalRobotPacketDecoder::VER_32;
+    std::string jsonFile;
+    std::string configFile;
+    std::string recordingFile;
+
+    cmnCommandLineOptions options;
+    options.AddOptionOneValue("d", "duration",
+                              "duration of the latency measurement (s, default 10)",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &duration);
+    options.AddOptionOneValue("j", "jitter",
+                              "maximum random delay added to each packet (s)",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &jitter);
+    options.AddOptionOneValue("f", "fragment",
+                              "probability that a packet is sent in two parts",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &fragment);
+    options.AddOptionOneValue("c", "coalesce",
+                              "probability that a packet is sent with the next one",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &coalesce);
+    options.AddOptionOneValue("v", "version",
+                              "firmware version simulated (1: pre-1.8, 2: 1.8, 3: 3.0/3.1, 4: 3.2)",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &version);
+    options.AddOptionOneValue("o", "output",
+                              "JSON file to save the results",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &jsonFile);
+    options.AddOptionOneValue("C", "config",
+                              "JSON configuration file for the component (the IP address is ignored)",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &configFile);
+    options.AddOptionOneValue("r", "recording",
+                              "recording (see osaUniversalRobotRecorder) to measure the decoding time on real traffic",
+                              cmnCommandLineOptions::OPTIONAL_OPTION, &recordingFile);
+    std::string errorMessage;
+    if (!options.Parse(argc, argv, errorMessage)) {
+        std::cerr << "Error: " << errorMessage << std::endl;
+        options.PrintUsage(std::cerr);
+        return -1;
+    }
+    if ((version <= osaUniversalRobotPacketDecoder::VER_UNKNOWN)
+        || (version >= osaUniversalRobotPacketDecoder::VER_MAX)) {
+        std::cerr << "Error: invalid version " << version << std::endl;
+        return -1;
+    }
+
+    std::ostringstream json;
+    json << "{\n";
+    BenchmarkDecode(1000000, json);
+    BenchmarkPose(1000000, json);
+    BenchmarkKinematics(1000000, json);
+    BenchmarkPathCheck(100000, json);
+    if (!recordingFile.empty())
+        BenchmarkDecodeRecording(recordingFile, 10, json);
+
+    // Simulated controller
+    osaUniversalRobotSimulator simulator;
+    osaUniversalRobotSimulator::Configuration simConfig;
+    simConfig.Version = static_cast<osaUniversalRobotPacketDecoder::FirmwareVersion>(version);
+    simConfig.Jitter = jitter;
+    simConfig.FragmentProbability = fragment;
+    simConfig.CoalesceProbability = coalesce;
+    if (!simulator.Start(simConfig)) {
+        std::cerr << "Error: failed to start simulator" << std::endl;
+        return -1;
+    }
+
+    mtsUniversalRobotScriptRT *robot = new mtsUniversalRobotScriptRT("Robot");
+    // The configuration file is applied but the component connects to the simulator
+    std::string configAddress;
+    if (!configFile.empty() && !robot->ConfigureJSON(configFile, configAddress)) {
+        std::cerr << "Error: failed to read configuration file " << configFile << std::endl;
+        simulator.Stop();
+        delete robot;
+        return -1;
+    }
+    robot->Configure("127.0.0.1");
+    BenchmarkReader *reader = new BenchmarkReader;
+    BenchmarkClient *client = new BenchmarkClient;
+
+    mtsManagerLocal *componentManager = mtsManagerLocal::GetInstance();
+    componentManager->AddComponent(robot);
+    componentManager->AddComponent(reader);
+    componentManager->AddComponent(client);
+    if (!componentManager->Connect(reader->GetName(), "Robot", robot->GetName(), "control")
+        || !componentManager->Connect(client->GetName(), "Robot", robot->GetName(), "control")) {
+        std::cerr << "Error: failed to connect components" << std::endl;
+        return -1;
+    }
+    componentManager->CreateAllAndWait(2.0 * cmn_s);
+    componentManager->StartAllAndWait(2.0 * cmn_s);
+
+    bool connected = false;
+    client->GetConnected(connected);
+    if (!connected) {
+        std::cerr << "Error: component not connected to simulator" << std::endl;
+        return -1;
+    }
+
+    // Startup: time from Configure to the connection, the first sample and the Polyscope
+    // version (includes the creation and start of the components)
+    vctDouble3 startupTime(-1.0);
+    const double startupEnd = osaUniversalRobotMonotonicTime() + 1.0;
+    while (((startupTime[1] < 0.0) || (startupTime[2] < 0.0)) && (osaUniversalRobotMonotonicTime() < startupEnd)) {
+        osaSleep(1.0 * cmn_ms);
+        client->GetStartupTime(startupTime);
+    }
+    std::cout << std::endl << "Startup: connected " << std::fixed << std::setprecision(1)
+              << 1000.0 * startupTime[0] << " ms, first sample " << 1000.0 * startupTime[1]
+              << " ms, Polyscope version " << 1000.0 * startupTime[2] << " ms after Configure"
+              << std::endl;
+    json << "  \"startup_ms\": { \"connect\": " << 1000.0 * startupTime[0]
+         << ", \"first_sample\": " << 1000.0 * startupTime[1]
+         << ", \"polyscope_version\": " << 1000.0 * startupTime[2] << " },\n";
+
+    // Latency measurement: send a movej to the current position every 50 ms (the
+    // robot returns to idle on the next packet) and match it with the simulator records
+    std::cout << std::endl << "Measuring latencies for " << duration << " s ..." << std::endl;
+    std::vector<double> commandTimes;
+    prmPositionJointGet position;
+    prmPositionJointSet goal;
+    const double end = osaUniversalRobotMonotonicTime() + duration;
+    while (osaUniversalRobotMonotonicTime() < end) {
+        client->GetPositionJoint(position);
+        goal.SetGoal(position.Position());
+        commandTimes.push_back(osaUniversalRobotMonotonicTime());
+        client->JointPositionMove(goal);
+        osaSleep(50.0 * cmn_ms);
+    }
+    osaSleep(0.1 * cmn_s);
+    std::vector<osaUniversalRobotSimulator::CommandRecord> records;
+    simulator.GetCommandRecords(records);
+    osaUniversalRobotLatencyHistogram commandLatency;
+    size_t command = 0;
+    for (size_t i = 0; (i < records.size()) && (command < commandTimes.size()); i++) {
+        if (strcmp(records[i].Name, "movej") != 0)
+            continue;
+        // Skip commands that were not sent (e.g., robot not ready)
+        while ((command + 1 < commandTimes.size()) && (commandTimes[command + 1] < records[i].ArrivalTime))
+            command++;
+        commandLatency.Add(records[i].ArrivalTime - commandTimes[command]);
+        command++;
+    }
+
+    vctDoubleVec publishLatency, queueLatency;
+    client->GetPublishLatency(publishLatency);
+    client->GetQueueLatency(queueLatency);
+
+    std::cout << std::endl << std::left << std::setw(36) << "Latency" << std::right
+              << std::setw(9) << "count" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+    PrintLatency("packet arrival to state table", publishLatency[0], publishLatency[1],
+                 publishLatency[2], publishLatency[3], publishLatency[4]);
+    if (queueLatency[0] > 0.0)
+        PrintLatency("time in the receive queue", queueLatency[0], queueLatency[1],
+                     queueLatency[2], queueLatency[3], queueLatency[4]);
+    // The reader updates its histogram until it is stopped
+    reader->Kill();
+    reader->WaitForState(mtsComponentState::FINISHED, 2.0 * cmn_s);
+    const osaUniversalRobotLatencyHistogram &readerLatency = reader->Latency;
+    PrintLatency("state table to GetStateJoint", readerLatency.Count(), readerLatency.Percentile(0.5),
+                 readerLatency.Percentile(0.99), readerLatency.Percentile(0.999), readerLatency.Maximum());
+    PrintLatency("command call to controller", commandLatency.Count(), commandLatency.Percentile(0.5),
+                 commandLatency.Percentile(0.99), commandLatency.Percentile(0.999), commandLatency.Maximum());
+    std::cout << "  (" << commandTimes.size() << " commands sent)" << std::endl;
+
+    json << "  \"publish_latency\": " << Summary(publishLatency) << ",\n"
+         << "  \"queue_latency\": " << Summary(queueLatency) << ",\n"
+         << "  \"reader_latency\": " << Summary(readerLatency) << ",\n"
+         << "  \"command_latency\": " << Summary(commandLatency) << ",\n";
+
+    // Throughput: increase the packet rate until packets are lost
+    std::cout << std::endl << std::setw(12) << "rate (Hz)" << std::setw(12) << "sent"
+              << std::setw(12) << "delivered" << std::setw(12) << "coalesced"
+              << std::setw(12) << "dropped" << std::setw(10) << "loss (%)" << std::endl;
+    json << "  \"rate_sweep\": [";
+    const double periods[] = { 0.008, 0.004, 0.002, 0.001, 0.0005, 0.00025 };
+    const size_t numPeriods = sizeof(periods)/sizeof(periods[0]);
+    double maxRate = 0.0;
+    for (size_t i = 0; i < numPeriods; i++) {
+        simulator.SetPeriod(periods[i]);
+        osaSleep(0.5 * cmn_s);
+        vctULong6 statsBefore, statsAfter;
+        const unsigned long sentBefore = simulator.GetPacketsSent();
+        client->GetFramingStatistics(statsBefore);
+        osaSleep(2.0 * cmn_s);
+        const unsigned long sent = simulator.GetPacketsSent() - sentBefore;
+        client->GetFramingStatistics(statsAfter);
+        // Frames published by the component (some may still be in flight); frames
+        // received but coalesced or dropped by the framer are lost for the clients
+        const unsigned long delivered = statsAfter[1] - statsBefore[1];
+        const unsigned long coalesced = statsAfter[2] - statsBefore[2];
+        const unsigned long dropped = statsAfter[3] - statsBefore[3];
+        const double loss = (sent > delivered) ? 100.0 * (sent - delivered) / sent : 0.0;
+        const double rate = 1.0 / periods[i];
+        std::cout << std::setw(12) << std::setprecision(0) << rate << std::setw(12) << sent
+                  << std::setw(12) << delivered << std::setw(12) << coalesced
+                  << std::setw(12) << dropped << std::setw(10) << std::setprecision(2) << loss << std::endl;
+        json << ((i > 0) ? ", " : " ") << "{ \"rate\": " << rate << ", \"sent\": " << sent
+             << ", \"delivered\": " << delivered << ", \"coalesced\": " << coalesced
+             << ", \"dropped\": " << dropped << ", \"loss_percent\": " << loss << " }";
+        // Allow for packets in flight, but not for dropped frames
+        if ((loss < 0.1) && (dropped == 0))
+            maxRate = rate;
+        else
+            break;
+    }
+    json << " ],\n"
+         << "  \"max_rate_hz\": " << maxRate << "\n"
+         << "}\n";
+    std::cout << "Maximum sustainable rate: " << maxRate << " Hz" << std::endl;
+
+    componentManager->KillAllAndWait(2.0 * cmn_s);
+    componentManager->Cleanup();
+    simulator.Stop();
+
+    if (!jsonFile.empty()) {
+        std::ofstream output(jsonFile.c_str());
+        output << json.str();
+        std::cout << "Results saved in " << jsonFile << std::endl;
+    }
+
+    cmnLogger::SetMask(CMN_LOG_ALLOW_NONE);
+    delete client;
+    delete reader;
+    delete robot;
+    return 0;
+}
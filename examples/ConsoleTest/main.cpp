@@ -28,18 +28,14 @@ http://www.cisst.org/cisst/license.txt.
 class UniversalRobotClient : public mtsTaskMain {
 
 private:
-    prmPositionJointGet jtpos;
-    prmPositionCartesianGet cartpos;
+    mtsUniversalRobotSample sample;
     vctDoubleVec jtgoal, jtvel;
     prmPositionJointSet jtposSet;
     prmPositionCartesianSet cartposSet;
     prmVelocityJointSet jtvelSet;
     prmVelocityCartesianSet cartVelSet;
 
-    mtsFunctionRead GetControllerTime;
-    mtsFunctionRead GetControllerExecTime;
-    mtsFunctionRead GetPositionJoint;
-    mtsFunctionRead GetPositionCartesian;
+    mtsFunctionRead GetSample;
     mtsFunctionRead GetConnected;
     mtsFunctionRead GetVersion;
     mtsFunctionRead GetAveragePeriod;
@@ -72,15 +68,12 @@ private:
 public:
 
     UniversalRobotClient() : mtsTaskMain("UniversalRobotClient"),
-                             jtpos(6), jtgoal(6), jtvel(6), jtposSet(6), jtvelSet(6),
+                             jtgoal(6), jtvel(6), jtposSet(6), jtvelSet(6),
                              debugMode(false)
     {
         mtsInterfaceRequired *req = AddInterfaceRequired("Input", MTS_OPTIONAL);
         if (req) {
-            req->AddFunction("GetControllerTime", GetControllerTime);
-            req->AddFunction("GetControllerExecTime", GetControllerExecTime);
-            req->AddFunction("GetPositionJoint", GetPositionJoint);
-            req->AddFunction("GetPositionCartesian", GetPositionCartesian);
+            req->AddFunction("GetSample", GetSample);
             req->AddFunction("GetConnected", GetConnected);
             req->AddFunction("GetAveragePeriod", GetAveragePeriod);
             req->AddFunction("JointPositionMove", PositionMoveJoint);
@@ -125,7 +118,7 @@ public:
     void Run() {
 
         bool connected = false;
-        double period, cTime, cExecTime;
+        double period;
         vct3 velxyz, velrot;
         vct3 cartPos, cartVec;
         vctDoubleRot3 cartRot;
@@ -135,11 +128,10 @@ public:
 
         ProcessQueuedEvents();
 
-        GetDebug(debug);
-        GetControllerTime(cTime);
-        GetControllerExecTime(cExecTime);
-        GetPositionJoint(jtpos);
-        GetPositionCartesian(cartpos);
+        // All the robot data in one command
+        GetSample(sample);
+        if (debugMode)
+            GetDebug(debug);
         GetConnected(connected);
         GetAveragePeriod(period);
 
@@ -167,8 +159,11 @@ public:
                         vctRodriguezRotation3<double> rot(cartVec);
                         cartRot.From(rot);
                     }
-                    else
-                        cartRot.Assign(cartpos.Position().Rotation());
+                    else {
+                        vct3 currentVec(sample.PoseCartesian[3], sample.PoseCartesian[4],
+                                        sample.PoseCartesian[5]);
+                        cartRot.From(vctRodriguezRotation3<double>(currentVec));
+                    }
                     cartposSet.SetGoal(cartRot);
                     PositionMoveCartesian(cartposSet);
                     break;
@@ -228,7 +223,7 @@ public:
                 }
             }
 
-            vctDoubleVec jtposDeg(jtpos.Position());
+            vctDoubleVec jtposDeg(sample.PositionJoint);
             jtposDeg.Multiply(cmn180_PI);
             if (debugMode)
                printf("DEBUG: [%6.1lf,%6.1lf,%6.1lf,%6.1lf,%6.1lf,%6.1lf]                           \r",
@@ -240,7 +235,7 @@ public:
 #else
             else
                 printf("TIME (s): %6.1lf, JOINTS (deg): [%5.2lf,%5.2lf,%5.2lf,%5.2lf,%5.2lf,%5.2lf]\r",
-                       cTime, jtposDeg[0], jtposDeg[1], jtposDeg[2], jtposDeg[3], jtposDeg[4], jtposDeg[5]);
+                       sample.ControllerTime, jtposDeg[0], jtposDeg[1], jtposDeg[2], jtposDeg[3], jtposDeg[4], jtposDeg[5]);
 #endif
 
         }
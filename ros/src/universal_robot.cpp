@@ -56,6 +56,9 @@ int main(int argc, char * argv[])
     options.AddOptionOneValue("p", "ros-period",
                               "period in seconds to read all tool positions (default 0.01, 10 ms, 100Hz).  There is no point to have a period higher than the tracker component",
                               cmnCommandLineOptions::OPTIONAL_OPTION, &rosPeriod);    
+    options.AddOptionNoValue("e", "motion-events",
+                             "publish the joint states and tool position when the robot moves (and every second) instead of every ros-period",
+                             cmnCommandLineOptions::OPTIONAL_OPTION);
 
     // check that all required options have been provided
     std::string errorMessage;
@@ -70,6 +73,9 @@ int main(int argc, char * argv[])
 
     // create the components
     mtsUniversalRobotScriptRT * device = new mtsUniversalRobotScriptRT("UR");
+    const bool motionEvents = options.IsSet("motion-events");
+    if (motionEvents)
+        device->SetMotionEvents(0.0001, 0.0001, 0.0005, 1.0);
     device->Configure(ipAddress);
 
     // add the components to the component manager
@@ -88,13 +94,24 @@ int main(int argc, char * argv[])
     // configure all components
 
     // ROS publisher
-    rosBridge->AddPublisherFromCommandRead<prmPositionCartesianGet, geometry_msgs::PoseStamped>
-        ("Component", "GetPositionCartesian",
-         "position_cartesian_current");
-
-    rosBridge->AddPublisherFromCommandRead<prmStateJoint, sensor_msgs::JointState>
-        ("Component", "GetStateJoint",
-         "joint_states");
+    if (motionEvents) {
+        rosBridge->AddPublisherFromEventWrite<prmPositionCartesianGet, geometry_msgs::PoseStamped>
+            ("Component", "CartesianMotion",
+             "position_cartesian_current");
+
+        rosBridge->AddPublisherFromEventWrite<prmStateJoint, sensor_msgs::JointState>
+            ("Component", "JointMotion",
+             "joint_states");
+    }
+    else {
+        rosBridge->AddPublisherFromCommandRead<prmPositionCartesianGet, geometry_msgs::PoseStamped>
+            ("Component", "GetPositionCartesian",
+             "position_cartesian_current");
+
+        rosBridge->AddPublisherFromCommandRead<prmStateJoint, sensor_msgs::JointState>
+            ("Component", "GetStateJoint",
+             "joint_states");
+    }
 
     rosBridge->AddSubscriberToCommandVoid("Component", "SetRobotFreeDriveMode", "SetRobotFreeDriveMode");
     rosBridge->AddSubscriberToCommandVoid("Component", "SetRobotRunningMode", "SetRobotRunningMode");